@@ -100,6 +100,10 @@ function setupLoRaWANTab()
             [
                 ['select#region',           data.region],
                 ['input#subband',           data.subband],
+                ['select#devclass',         data.devclass],
+                ['input#join_trials',       data.join_trials],
+                ['input#datarate',          data.datarate],
+                ['input#txpower',           data.txpower],
                 ['input#deviceEUI_ESP32',   lorawan_formatEUI(data.deviceEUI_ESP32)],
                 ['input#deviceEUI',         lorawan_formatEUI((data.deviceEUI == undefined) ? data.deviceEUI_ESP32 : data.deviceEUI)],
                 ['input#appEUI',            (data.appEUI == undefined) ? '' : lorawan_formatEUI(data.appEUI)],
@@ -108,6 +112,12 @@ function setupLoRaWANTab()
                 ['input#txconf_retries',    (data.txconf_retries != null) ? data.txconf_retries : '3' ],
             ].forEach(t => pane.querySelector(t[0]).value = t[1]);
 
+            pane.querySelector('input#subband_scan').checked = !!data.subband_scan;
+            pane.querySelector('input#adr').checked = !!data.adr;
+            pane.querySelector('input#dr_policy').checked = !!data.dr_policy;
+            pane.querySelector('div.lorawan-stats#subband_active').textContent = data.subband_active;
+            pane.querySelector('div.lorawan-stats#devclass_active').textContent = 'ABC'.charAt(data.devclass_active);
+
             pane.querySelector('div.txconfretries').style = (data.txconf_retries == null) ? 'display: none;' : '';
 
             sel_region.dispatchEvent(new Event('change'));
@@ -116,24 +126,33 @@ function setupLoRaWANTab()
         if (!!window.EventSource) {
             let sse = new EventSource(yuboxAPI('lorawan')+'/status');
             sse.addEventListener('message', function (e) {
+                // Los eventos pueden traer sólo los campos modificados desde el evento anterior
                 let data = JSON.parse(e.data);
 
                 lw_updatestatus(data);
 
                 [ 'rx', 'tx_ok', 'tx_fail', 'confirmtx_start' ]
+                .filter(k => (k in data))
                 .forEach(k => {
                     var div_stats = pane.querySelector('div.lorawan-stats#'+k);
                     if (div_stats != null)
                         div_stats.textContent = lorawan_format_tsactivity(data[k], data.ts);
                     else console.error('No se encuentra selector', 'div.lorawan-stats#'+k);
                 });
-                [ 'num_confirmtx_ok', 'num_confirmtx_fail' ]
+                [ 'num_confirmtx_ok', 'num_confirmtx_fail', 'rssi', 'snr', 'rssi_avg', 'snr_avg' ]
+                .filter(k => (k in data))
                 .forEach(k => {
                     var div_stats = pane.querySelector('div.lorawan-stats#'+k);
                     if (div_stats != null)
-                        div_stats.textContent = data[k];
+                        div_stats.textContent = (data[k] == null) ? '-' : data[k];
                     else console.error('No se encuentra selector', 'div.lorawan-stats#'+k);
                 });
+                if ('subband' in data) {
+                    pane.querySelector('div.lorawan-stats#subband_active').textContent = (data.subband == null) ? '-' : data.subband;
+                }
+                if ('devclass' in data) {
+                    pane.querySelector('div.lorawan-stats#devclass_active').textContent = 'ABC'.charAt(data.devclass);
+                }
                 if (data.confirmtx_start != null) {}
             });
             sse.addEventListener('error', function (e) {
@@ -168,6 +187,13 @@ function setupLoRaWANTab()
         let postData = {
             region:     pane.querySelector('select#region').value,
             subband:    pane.querySelector('input#subband').value,
+            subband_scan: pane.querySelector('input#subband_scan').checked ? 1 : 0,
+            devclass:   pane.querySelector('select#devclass').value,
+            join_trials: pane.querySelector('input#join_trials').value,
+            datarate:   pane.querySelector('input#datarate').value,
+            txpower:    pane.querySelector('input#txpower').value,
+            adr:        pane.querySelector('input#adr').checked ? 1 : 0,
+            dr_policy:  pane.querySelector('input#dr_policy').checked ? 1 : 0,
             deviceEUI:  lorawan_unformatEUI(pane.querySelector('input#deviceEUI').value),
             appKey:     lorawan_unformatEUI(pane.querySelector('input#appKey').value),
             tx_duty_sec: pane.querySelector('input#tx_duty_sec').value,
@@ -189,19 +189,20 @@ void lorawan_payload(AsyncWebServerRequest * request)
 void send_lora_frame(void)
 {
     if (!YuboxLoRaWANConf.isJoined()) {
-      log_w("todavía no se une a una red LoRaWAN...");
-    } else {
-      const char * test_payload = "Hola mundo";
-      uint8_t * payload = (uint8_t *)test_payload;
-      uint8_t payloadlen = strlen(test_payload);
-      if (str_payload.length() > 0) {
-        payload = (uint8_t *)(str_payload.c_str());
-        payloadlen = str_payload.length();
-      }
-
-      log_i("INFO: enviando payload (%d bytes)... ", payloadlen);
-      bool ok = YuboxLoRaWANConf.send(/*buffer*/payload, payloadlen);
-      str_payload = "";
-      if (ok) log_i("OK") ; else log_e("ERR");
+      log_w("todavía no se une a una red LoRaWAN, se encola para envío posterior...");
+    }
+
+    const char * test_payload = "Hola mundo";
+    uint8_t * payload = (uint8_t *)test_payload;
+    uint8_t payloadlen = strlen(test_payload);
+    if (str_payload.length() > 0) {
+      payload = (uint8_t *)(str_payload.c_str());
+      payloadlen = str_payload.length();
     }
+
+    // La cola copia el payload, y lo envía desde YuboxLoRaWANConf.update()
+    log_i("INFO: encolando payload (%d bytes)... ", payloadlen);
+    bool ok = YuboxLoRaWANConf.enqueue(/*buffer*/payload, payloadlen);
+    str_payload = "";
+    if (ok) log_i("OK (%u en cola)", YuboxLoRaWANConf.getUplinkQueueDepth()) ; else log_e("ERR");
 }
@@ -0,0 +1,232 @@
+#ifndef _YUBOX_LORAWAN_AIRTIME_H_
+#define _YUBOX_LORAWAN_AIRTIME_H_
+
+#include <stdint.h>
+#include <string.h>
+
+// Bytes de PHYPayload que se agregan al payload de aplicación en un uplink sin
+// FOpts: MHDR(1) + FHDR(7) + FPort(1) + MIC(4)
+#define YUBOX_LORAWAN_PHY_OVERHEAD 13
+
+// Familias de tablas de datarate. Varias regiones comparten la misma tabla.
+typedef enum {
+  YBX_LW_DRT_EU868 = 0,   // EU868, EU433, CN779, RU864
+  YBX_LW_DRT_AS923,       // AS923 y sus variantes
+  YBX_LW_DRT_US915,
+  YBX_LW_DRT_AU915,
+  YBX_LW_DRT_CN470,
+  YBX_LW_DRT_KR920,
+  YBX_LW_DRT_IN865,
+
+  YBX_LW_DRT_MAX
+} yuboxlorawan_drtable_t;
+
+#define YUBOX_LORAWAN_DR_MAX 16
+
+// Modulación de un datarate. sf=0 indica FSK a 50 kbps, bw_khz=0 indica DR no definido.
+typedef struct YuboxLoRaWAN_dr_mod
+{
+  uint8_t sf;
+  uint16_t bw_khz;
+} yuboxlorawan_dr_mod_t;
+
+#define YBX_DR_NONE { 0, 0 }
+#define YBX_DR_FSK  { 0, 50 }
+
+static const yuboxlorawan_dr_mod_t yuboxlorawan_dr_tables[YBX_LW_DRT_MAX][YUBOX_LORAWAN_DR_MAX] = {
+  // EU868
+  { {12,125}, {11,125}, {10,125}, {9,125}, {8,125}, {7,125}, {7,250}, YBX_DR_FSK,
+    YBX_DR_NONE, YBX_DR_NONE, YBX_DR_NONE, YBX_DR_NONE, YBX_DR_NONE, YBX_DR_NONE, YBX_DR_NONE, YBX_DR_NONE },
+  // AS923
+  { {12,125}, {11,125}, {10,125}, {9,125}, {8,125}, {7,125}, {7,250}, YBX_DR_FSK,
+    YBX_DR_NONE, YBX_DR_NONE, YBX_DR_NONE, YBX_DR_NONE, YBX_DR_NONE, YBX_DR_NONE, YBX_DR_NONE, YBX_DR_NONE },
+  // US915: DR0..DR4 uplink, DR8..DR13 downlink
+  { {10,125}, {9,125}, {8,125}, {7,125}, {8,500}, YBX_DR_NONE, YBX_DR_NONE, YBX_DR_NONE,
+    {12,500}, {11,500}, {10,500}, {9,500}, {8,500}, {7,500}, YBX_DR_NONE, YBX_DR_NONE },
+  // AU915: DR0..DR6 uplink, DR8..DR13 downlink
+  { {12,125}, {11,125}, {10,125}, {9,125}, {8,125}, {7,125}, {8,500}, YBX_DR_NONE,
+    {12,500}, {11,500}, {10,500}, {9,500}, {8,500}, {7,500}, YBX_DR_NONE, YBX_DR_NONE },
+  // CN470
+  { {12,125}, {11,125}, {10,125}, {9,125}, {8,125}, {7,125}, YBX_DR_NONE, YBX_DR_NONE,
+    YBX_DR_NONE, YBX_DR_NONE, YBX_DR_NONE, YBX_DR_NONE, YBX_DR_NONE, YBX_DR_NONE, YBX_DR_NONE, YBX_DR_NONE },
+  // KR920
+  { {12,125}, {11,125}, {10,125}, {9,125}, {8,125}, {7,125}, YBX_DR_NONE, YBX_DR_NONE,
+    YBX_DR_NONE, YBX_DR_NONE, YBX_DR_NONE, YBX_DR_NONE, YBX_DR_NONE, YBX_DR_NONE, YBX_DR_NONE, YBX_DR_NONE },
+  // IN865: DR6 reservado
+  { {12,125}, {11,125}, {10,125}, {9,125}, {8,125}, {7,125}, YBX_DR_NONE, YBX_DR_FSK,
+    YBX_DR_NONE, YBX_DR_NONE, YBX_DR_NONE, YBX_DR_NONE, YBX_DR_NONE, YBX_DR_NONE, YBX_DR_NONE, YBX_DR_NONE },
+};
+
+#undef YBX_DR_NONE
+#undef YBX_DR_FSK
+
+/*
+ * Tiempo en aire en microsegundos de una trama LoRa, según la fórmula de
+ * Semtech AN1200.13: preámbulo de 8 símbolos, encabezado explícito, CRC activo
+ * y codificación 4/(4+cr). La optimización de bajo datarate se activa cuando
+ * el símbolo dura más de 16 ms, como lo hace la MAC. Devuelve 0 si la
+ * modulación no es válida.
+ */
+inline uint32_t yuboxlorawan_lora_airtime_us(uint8_t sf, uint16_t bw_khz, uint16_t phy_len, uint8_t cr = 1, bool crc = true)
+{
+  if (sf < 6 || sf > 12 || bw_khz == 0) return 0;
+
+  // 1000/bw_khz es exacto para 125, 250 y 500 kHz
+  uint32_t tsym_us = ((uint32_t)1 << sf) * 1000 / bw_khz;
+  uint32_t de = (tsym_us > 16000) ? 1 : 0;
+
+  int32_t num = 8 * (int32_t)phy_len - 4 * (int32_t)sf + 28 + (crc ? 16 : 0);
+  int32_t den = 4 * ((int32_t)sf - 2 * (int32_t)de);
+  int32_t nsym = 8;
+  if (num > 0) nsym += ((num + den - 1) / den) * (cr + 4);
+
+  // Preámbulo de 8 + 4.25 símbolos = 49/4 símbolos
+  return (49 * tsym_us) / 4 + (uint32_t)nsym * tsym_us;
+}
+
+// Tiempo en aire de una trama FSK a 50 kbps: preámbulo(5) + sync(3) + longitud(1) + payload + CRC(2)
+inline uint32_t yuboxlorawan_fsk_airtime_us(uint16_t phy_len)
+{
+  return (5 + 3 + 1 + (uint32_t)phy_len + 2) * 8 * 20;
+}
+
+// Tiempo en aire de un uplink con n bytes de payload de aplicación, en el
+// datarate indicado de la tabla indicada. Devuelve 0 si el datarate no existe.
+inline uint32_t yuboxlorawan_airtime_us(yuboxlorawan_drtable_t t, uint8_t dr, uint16_t n)
+{
+  if (t >= YBX_LW_DRT_MAX || dr >= YUBOX_LORAWAN_DR_MAX) return 0;
+
+  const yuboxlorawan_dr_mod_t & m = yuboxlorawan_dr_tables[t][dr];
+  if (m.bw_khz == 0) return 0;
+
+  uint16_t phy_len = n + YUBOX_LORAWAN_PHY_OVERHEAD;
+  return (m.sf == 0) ? yuboxlorawan_fsk_airtime_us(phy_len) : yuboxlorawan_lora_airtime_us(m.sf, m.bw_khz, phy_len);
+}
+
+// Número de cubetas en que se divide la ventana de ciclo de trabajo
+#ifndef YUBOX_LORAWAN_DUTY_BUCKETS
+#define YUBOX_LORAWAN_DUTY_BUCKETS 60
+#endif
+
+/*
+ * Presupuesto de tiempo en aire sobre una ventana deslizante, sin asignación
+ * dinámica. La ventana se divide en YUBOX_LORAWAN_DUTY_BUCKETS cubetas, y cada
+ * transmisión se suma a la cubeta de su instante. Una cubeta se considera
+ * vigente hasta que la ventana completa pasa más allá de su FINAL, así que el
+ * cálculo nunca subestima el tiempo usado. Por eso una ventana que termina a
+ * mitad de cubeta toca YUBOX_LORAWAN_DUTY_BUCKETS + 1 cubetas: la actual y las
+ * de edad 1 a YUBOX_LORAWAN_DUTY_BUCKETS, y se reserva espacio para todas.
+ * Con límite 0 no hay restricción.
+ */
+class YuboxLoRaWANDutyBudget
+{
+private:
+  uint32_t _limit_permille;
+  uint32_t _window_ms;
+  uint32_t _bucket_ms;
+
+  uint32_t _bucket_epoch[YUBOX_LORAWAN_DUTY_BUCKETS + 1];
+  uint32_t _bucket_airtime_ms[YUBOX_LORAWAN_DUTY_BUCKETS + 1];
+
+  uint32_t _total_airtime_ms;
+
+  // Cubeta vigente en el instante now, si la época coincide
+  bool _live(uint8_t i, uint32_t epoch_now)
+  {
+    return _bucket_airtime_ms[i] > 0 && epoch_now - _bucket_epoch[i] <= YUBOX_LORAWAN_DUTY_BUCKETS;
+  }
+
+public:
+  YuboxLoRaWANDutyBudget(void) : _total_airtime_ms(0) { configure(0, 3600000UL); }
+
+  // Configurar límite en milésimas del tiempo de la ventana. Borra el historial.
+  void configure(uint32_t limit_permille, uint32_t window_ms)
+  {
+    if (window_ms < YUBOX_LORAWAN_DUTY_BUCKETS) window_ms = YUBOX_LORAWAN_DUTY_BUCKETS;
+    _limit_permille = limit_permille;
+    _window_ms = window_ms;
+    _bucket_ms = window_ms / YUBOX_LORAWAN_DUTY_BUCKETS;
+    memset(_bucket_epoch, 0, sizeof(_bucket_epoch));
+    memset(_bucket_airtime_ms, 0, sizeof(_bucket_airtime_ms));
+  }
+
+  bool limited(void) { return _limit_permille > 0; }
+  uint32_t getLimitPermille(void) { return _limit_permille; }
+  uint32_t getWindowMs(void) { return _window_ms; }
+
+  // Tiempo en aire permitido por ventana
+  uint32_t budget(void) { return (uint32_t)(((uint64_t)_window_ms * _limit_permille) / 1000); }
+
+  void record(uint32_t now, uint32_t airtime_ms)
+  {
+    _total_airtime_ms += airtime_ms;
+
+    uint32_t epoch = now / _bucket_ms;
+    uint8_t i = epoch % (YUBOX_LORAWAN_DUTY_BUCKETS + 1);
+    if (_bucket_epoch[i] != epoch) {
+      _bucket_epoch[i] = epoch;
+      _bucket_airtime_ms[i] = 0;
+    }
+    _bucket_airtime_ms[i] += airtime_ms;
+  }
+
+  // Tiempo en aire usado dentro de la ventana que termina en now
+  uint32_t used(uint32_t now)
+  {
+    uint32_t epoch = now / _bucket_ms;
+    uint32_t u = 0;
+    for (uint8_t i = 0; i <= YUBOX_LORAWAN_DUTY_BUCKETS; i++) if (_live(i, epoch)) u += _bucket_airtime_ms[i];
+    return u;
+  }
+
+  // Tiempo en aire restante dentro de la ventana, UINT32_MAX sin límite
+  uint32_t remaining(uint32_t now)
+  {
+    if (!limited()) return UINT32_MAX;
+    uint32_t u = used(now);
+    uint32_t b = budget();
+    return (u >= b) ? 0 : b - u;
+  }
+
+  // Milisegundos que faltan para poder transmitir airtime_ms sin exceder el
+  // presupuesto. 0 si se puede transmitir ya. UINT32_MAX si la transmisión
+  // por sí sola excede el presupuesto de toda la ventana.
+  uint32_t delayFor(uint32_t now, uint32_t airtime_ms)
+  {
+    if (!limited()) return 0;
+
+    uint32_t b = budget();
+    if (airtime_ms > b) return UINT32_MAX;
+
+    uint32_t epoch = now / _bucket_ms;
+    uint32_t u = used(now);
+    if (u + airtime_ms <= b) return 0;
+
+    // Se recorren las cubetas vigentes de la más antigua a la más reciente
+    for (uint32_t age = YUBOX_LORAWAN_DUTY_BUCKETS + 1; age > 0; age--) {
+      uint32_t e = epoch - (age - 1);
+      uint8_t i = e % (YUBOX_LORAWAN_DUTY_BUCKETS + 1);
+      if (_bucket_epoch[i] != e || !_live(i, epoch)) continue;
+
+      u -= _bucket_airtime_ms[i];
+      if (u + airtime_ms <= b) {
+        // La cubeta deja de contar cuando la ventana completa pasa su final
+        return (e + YUBOX_LORAWAN_DUTY_BUCKETS + 1) * _bucket_ms - now;
+      }
+    }
+    return 0;
+  }
+
+  // Tiempo en aire acumulado desde el arranque
+  uint32_t total(void) { return _total_airtime_ms; }
+
+  // Intervalo mínimo en segundos entre transmisiones de airtime_ms para no
+  // exceder el límite de forma sostenida. 0 sin límite.
+  uint32_t minIntervalSec(uint32_t airtime_ms)
+  {
+    if (!limited()) return 0;
+    return (uint32_t)((((uint64_t)airtime_ms * 1000) / _limit_permille + 999) / 1000);
+  }
+};
+
+#endif
@@ -0,0 +1,173 @@
+#ifndef _YUBOX_LORAWAN_CALLBACK_LIST_H_
+#define _YUBOX_LORAWAN_CALLBACK_LIST_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <utility>
+#include <vector>
+
+// Generación compartida por todas las listas, para que un ID de un tipo de
+// evento no pueda confundirse con un ID válido de otro tipo.
+inline uint16_t yuboxlorawan_next_callback_gen(void)
+{
+  static uint16_t gen = 0;
+  gen++;
+  if (gen == 0) gen = 1;
+  return gen;
+}
+
+/*
+ * Registro de callbacks para UN tipo de evento. Cada entrada guarda un solo
+ * objeto invocable. El ID devuelto codifica la posición de la entrada (16 bits
+ * bajos, base 1) y una generación (16 bits altos), así que la remoción por ID
+ * es O(1) y un ID ya removido no puede borrar a otra entrada que reuse la
+ * posición.
+ *
+ * Comportamiento durante despacho: un callback que se agrega durante el
+ * despacho NO se invoca en esa ronda, y un callback que se remueve durante el
+ * despacho ya no se invoca si todavía no le tocaba. El objeto invocable
+ * removido se destruye sólo al terminar el despacho, así que un callback
+ * puede removerse a sí mismo.
+ */
+template <typename F>
+class YuboxLoRaWANCallbackList
+{
+private:
+  typedef struct {
+    F fn;
+    uint16_t gen;
+    uint16_t tag;
+    bool active;
+  } entry_t;
+
+  std::vector<entry_t> _slots;
+  std::vector<entry_t> _pending;
+  std::vector<uint16_t> _free;
+  uint16_t _dispatchDepth;
+  bool _needsSettle;
+
+  static size_t _makeId(size_t slot, uint16_t gen) { return (((size_t)gen) << 16) | (slot + 1); }
+
+  entry_t * _find(size_t id)
+  {
+    size_t slot = (id & 0xFFFF);
+    if (slot == 0) return NULL;
+    slot--;
+
+    entry_t * e = NULL;
+    if (slot < _slots.size()) e = &(_slots[slot]);
+    else if (slot - _slots.size() < _pending.size()) e = &(_pending[slot - _slots.size()]);
+    if (e == NULL || !e->active || e->gen != (uint16_t)(id >> 16)) return NULL;
+    return e;
+  }
+
+  // Incorporar altas y liberar bajas que ocurrieron durante el despacho
+  void _settle(void)
+  {
+    if (!_needsSettle) return;
+    _needsSettle = false;
+
+    for (size_t i = 0; i < _slots.size(); i++) {
+      if (!_slots[i].active && _slots[i].fn) {
+        _slots[i].fn = nullptr;
+        _free.push_back(i);
+      }
+    }
+    for (size_t i = 0; i < _pending.size(); i++) {
+      _slots.push_back(std::move(_pending[i]));
+      if (!_slots.back().active) {
+        _slots.back().fn = nullptr;
+        _free.push_back(_slots.size() - 1);
+      }
+    }
+    _pending.clear();
+  }
+
+public:
+  YuboxLoRaWANCallbackList(void) : _dispatchDepth(0), _needsSettle(false) {}
+
+  // Devuelve ID distinto de 0, o 0 si el callback está vacío o no hay espacio.
+  // La etiqueta es un valor opaco para filtrar en dispatchIf().
+  size_t add(F fn, uint16_t tag = 0)
+  {
+    if (!fn) return 0;
+
+    entry_t e;
+    e.fn = std::move(fn);
+    e.gen = yuboxlorawan_next_callback_gen();
+    e.tag = tag;
+    e.active = true;
+
+    if (_dispatchDepth > 0) {
+      // No se puede tocar _slots mientras se recorre
+      size_t slot = _slots.size() + _pending.size();
+      if (slot >= 0xFFFF) return 0;
+      _pending.push_back(std::move(e));
+      _needsSettle = true;
+      return _makeId(slot, _pending.back().gen);
+    }
+
+    size_t slot;
+    if (!_free.empty()) {
+      slot = _free.back();
+      _free.pop_back();
+      _slots[slot] = std::move(e);
+    } else {
+      slot = _slots.size();
+      if (slot >= 0xFFFF) return 0;
+      _slots.push_back(std::move(e));
+    }
+    return _makeId(slot, _slots[slot].gen);
+  }
+
+  void remove(size_t id)
+  {
+    entry_t * e = _find(id);
+    if (e == NULL) return;
+
+    e->active = false;
+    if (_dispatchDepth > 0) {
+      _needsSettle = true;
+      return;
+    }
+    e->fn = nullptr;
+    _free.push_back((id & 0xFFFF) - 1);
+  }
+
+  // Invocar todos los callbacks activos, sin copiar las entradas
+  template <typename... A>
+  void dispatch(A... args)
+  {
+    _dispatchDepth++;
+    size_t n = _slots.size();
+    for (size_t i = 0; i < n; i++) {
+      if (_slots[i].active) _slots[i].fn(args...);
+    }
+    _dispatchDepth--;
+    if (_dispatchDepth == 0) _settle();
+  }
+
+  // Invocar los callbacks activos cuya etiqueta cumple con el predicado
+  template <typename P, typename... A>
+  void dispatchIf(P match, A... args)
+  {
+    _dispatchDepth++;
+    size_t n = _slots.size();
+    for (size_t i = 0; i < n; i++) {
+      if (_slots[i].active && match(_slots[i].tag)) _slots[i].fn(args...);
+    }
+    _dispatchDepth--;
+    if (_dispatchDepth == 0) _settle();
+  }
+
+  // Visitar las etiquetas de todas las entradas activas, incluyendo pendientes
+  template <typename V>
+  void forEachTag(V visit)
+  {
+    for (size_t i = 0; i < _slots.size(); i++) if (_slots[i].active) visit(_slots[i].tag);
+    for (size_t i = 0; i < _pending.size(); i++) if (_pending[i].active) visit(_pending[i].tag);
+  }
+};
+
+#endif
@@ -5,12 +5,15 @@
 #include <LoRaWan-Arduino.h>
 #include <SPI.h>
 #include "YuboxLoRaWANConfigClass.h"
+#include "YuboxLoRaWANJSONWriter.h"
 #include <YuboxParamPOST.h>
 
 #include <functional>
 
 #include <Preferences.h>
 
+#include <esp_sleep.h>
+
 #define ARDUINOJSON_USE_LONG_LONG 1
 
 #include "AsyncJson.h"
@@ -20,33 +23,84 @@
 
 #define LORAWAN_APP_DEFAULT_TX_DUTYCYCLE 10     /* Default number of seconds for duty cycle */
 
-typedef enum {
-  YBX_LW_NETJOIN = 0,
-  YBX_LW_RX = 1,
-  YBX_LW_TXDUTY_CHANGE = 2,
-  YBX_LW_TX_CONFIRM = 3,
+#define LORAWAN_APP_DEFAULT_FCNT_WINDOW 1       /* Tramas entre escrituras de contadores a NVRAM */
+#define LORAWAN_APP_DEFAULT_FCNT_MAXSEC 0       /* Segundos máximos con contadores sin escribir, 0 para desactivar */
 
-  YBX_LW_EVENT_MAX = 255
-} yuboxlorawan_event_t;
+#define LORAWAN_APP_UPLINK_QUEUE_RETRY_MS 1000  /* Espera mínima entre intentos de despachar la cola de uplink */
+#define LORAWAN_APP_UPLINK_QUEUE_MAX_ATTEMPTS 10    /* Intentos fallidos antes de descartar el mensaje a la cabeza de la cola */
 
-typedef struct YuboxLoRaWAN_rx_List
-{
-  static yuboxlorawan_event_id_t current_id;
-  yuboxlorawan_event_t event_type;
-  yuboxlorawan_event_id_t id;
+#define LORAWAN_JOIN_DEFAULT_BACKOFF_BASE_MS 10000  /* Espera antes del primer reintento de join */
+#define LORAWAN_JOIN_DEFAULT_BACKOFF_MAX_MS 600000  /* Espera máxima entre reintentos de join */
+#define LORAWAN_JOIN_DEFAULT_RETRY_BUDGET 0         /* Fallos de join antes de abandonar, 0 para nunca abandonar */
+
+#define LORAWAN_CONFIRM_RETRY_BASE_MS 5000      /* Espera antes de la primera retransmisión de uplink confirmado */
+#define LORAWAN_CONFIRM_RETRY_MAX_MS 60000      /* Espera máxima entre retransmisiones de uplink confirmado */
 
-  YuboxLoRaWAN_join_func_cb j_fcb;
-  YuboxLoRaWAN_rx_func_cb rx_fcb;
-  YuboxLoRaWAN_txdutychange_func_cb txd_fcb;
-  YuboxLoRaWAN_txconfirm_func_cb txc_fcb;
+#define LORAWAN_DUTY_DEFAULT_WINDOW_SEC 3600    /* Ventana de ciclo de trabajo por omisión */
 
-  YuboxLoRaWAN_rx_List() : event_type(YBX_LW_EVENT_MAX), id(current_id++), j_fcb(NULL), rx_fcb(NULL), txd_fcb(NULL), txc_fcb(NULL) {}
-} YuboxLoRaWAN_rx_List_t;
-yuboxlorawan_event_id_t YuboxLoRaWAN_rx_List::current_id = 1;
+#define LORAWAN_TXPOWER_MAX_INDEX 15              /* Mayor índice TX_POWER_x en cualquier región */
+#define LORAWAN_JOINREQ_MAX_TRIALS 48             /* Máximo de intentos por join aceptado por la MAC */
+#define LORAWAN_DR_POLICY_MARGIN_DB 10            /* Margen sobre el SNR mínimo de demodulación para subir datarate */
 
-static std::vector<YuboxLoRaWAN_rx_List_t> cbRXList;
+#define LORAWAN_LOG_REPLAY_INTERVAL_MS 5000     /* Espera mínima entre uplinks reproducidos desde el log en flash */
+#define LORAWAN_LOG_REPLAY_BACKOFF_MS 60000     /* Espera luego de un uplink confirmado del log sin confirmación */
+
+#define LORAWAN_STATUS_DEFAULT_INTERVAL_MS 500  /* Intervalo mínimo entre eventos de estado */
+#define LORAWAN_STATUS_FULL_INTERVAL_MS 30000   /* Intervalo entre eventos de estado completos (no delta) */
+#define LORAWAN_STATUS_MAX_QUEUED 4             /* Promedio de mensajes SSE encolados por cliente a partir del cual se aplaza el envío */
+
+// Tamaños de buffers (en pila) para generar JSON sin asignación dinámica
+#define LORAWAN_STATUS_JSON_LEN 640
+#define LORAWAN_CONFIG_JSON_LEN 1536
+#define LORAWAN_REGIONS_JSON_LEN 1024
+#define LORAWAN_METRICS_JSON_LEN 3072      /* Peor caso ~2.8 KB con todos los contadores en su máximo */
+
+typedef enum {
+  YBX_LW_STKIND_JOIN,   // Estado de join, como cadena
+  YBX_LW_STKIND_TS,     // Timestamp, o null si es 0
+  YBX_LW_STKIND_UINT,   // Número sin signo
+  YBX_LW_STKIND_INT     // Número con signo, o null si es LORAWAN_STATUS_INT_NULL
+} yuboxlorawan_status_kind_t;
+
+#define LORAWAN_STATUS_INT_NULL ((uint32_t)INT32_MIN)
+
+static const struct {
+  const char * key;
+  yuboxlorawan_status_kind_t kind;
+} lwStatusFields[YBX_LW_ST_MAX] = {
+  { "join",                 YBX_LW_STKIND_JOIN },
+  { "tx_ok",                YBX_LW_STKIND_TS },
+  { "tx_fail",              YBX_LW_STKIND_TS },
+  { "rx",                   YBX_LW_STKIND_TS },
+  { "num_confirmtx_ok",     YBX_LW_STKIND_UINT },
+  { "num_confirmtx_fail",   YBX_LW_STKIND_UINT },
+  { "confirmtx_start",      YBX_LW_STKIND_TS },
+  { "fcnt_writes",          YBX_LW_STKIND_UINT },
+  { "fcnt_writes_avoided",  YBX_LW_STKIND_UINT },
+  { "txq_depth",            YBX_LW_STKIND_UINT },
+  { "txq_dropped",          YBX_LW_STKIND_UINT },
+  { "ev_dropped",           YBX_LW_STKIND_UINT },
+  { "rssi",                 YBX_LW_STKIND_INT },
+  { "snr",                  YBX_LW_STKIND_INT },
+  { "rssi_avg",             YBX_LW_STKIND_INT },
+  { "snr_avg",              YBX_LW_STKIND_INT },
+  { "join_attempt",         YBX_LW_STKIND_UINT },
+  { "join_next",            YBX_LW_STKIND_TS },
+  { "subband",              YBX_LW_STKIND_UINT },
+  { "airtime_left",         YBX_LW_STKIND_INT },
+  { "tx_next",              YBX_LW_STKIND_TS },
+  { "devclass",             YBX_LW_STKIND_UINT },
+};
+
+#define LORAWAN_PORT_MIN 1
+#define LORAWAN_PORT_MAX 223
+
+// Puertos disponibles para la aplicación: el de fragmentos queda reservado
+#define LORAWAN_PORT_IS_USER(port) \
+    ((port) >= LORAWAN_PORT_MIN && (port) <= LORAWAN_PORT_MAX && (port) != YUBOX_LORAWAN_FRAG_PORT)
 
 const char * YuboxLoRaWANConfigClass::_ns_nvram_yuboxframework_lorawan = "YUBOX/LoRaWAN";
+YuboxLoRaWANConfigClass * YuboxLoRaWANConfigClass::_activeInstance = NULL;
 
 static void lorawan_has_joined_handler(void);
 static void lorawan_rx_handler(lmh_app_data_t *app_data);
@@ -54,10 +108,32 @@ static void lorawan_confirm_class_handler(DeviceClass_t Class);
 static void lorawan_join_failed_handler(void);
 static void lorawan_confirmed_tx_result(bool);
 
+// Copia de sesión que sobrevive al sueño profundo, ver prepareDeepSleep(). Es
+// única por firmware, como la MAC: no admite más de una instancia activa.
+static RTC_DATA_ATTR yuboxlorawan_rtc_session_t rtcSession;
+
 YuboxLoRaWANConfigClass::YuboxLoRaWANConfigClass(void)
 {
     _lw_region = LORAMAC_REGION_AU915;
     _lw_subband = 1;
+    _lw_subband_scan = false;
+    _lw_subband_cached = 0;
+    _lw_subband_active = 1;
+    _lw_devclass = CLASS_A;
+    _lw_devclass_active = CLASS_A;
+    _devclass_apply = false;
+    _devclass_switched = -1;
+    _lw_adr = true;
+    _lw_datarate = LORAWAN_DEFAULT_DATARATE;
+    _lw_txpower = LORAWAN_DEFAULT_TX_POWER;
+    _lw_jointrials = JOINREQ_NBTRIALS;
+    _lw_dr_policy = false;
+    _lw_datarate_start = LORAWAN_DEFAULT_DATARATE;
+    _txparams_apply = false;
+    _airtime_baseline_ms = 0;
+    _airtime_app_ms = 0;
+    _consumerTask = NULL;
+    _localEvents = 0;
     memset(_lw_devEUI, 0, sizeof(_lw_devEUI));
     memset(_lw_appEUI, 0, sizeof(_lw_appEUI));
     memset(_lw_appKey, 0, sizeof(_lw_appKey));
@@ -73,6 +149,12 @@ YuboxLoRaWANConfigClass::YuboxLoRaWANConfigClass(void)
     _tx_conf_num_retries = 3;
     _tx_conf_display = false;
 
+    _fcnt_commit_window = LORAWAN_APP_DEFAULT_FCNT_WINDOW;
+    _fcnt_commit_maxsec = LORAWAN_APP_DEFAULT_FCNT_MAXSEC;
+    _ts_fcnt_lastCommit = 0;
+    _num_fcnt_writes = 0;
+    _num_fcnt_writes_avoided = 0;
+
     // Estas claves se asumen pendientes de negociar
     _clearSessionKeys();
 
@@ -97,12 +179,56 @@ YuboxLoRaWANConfigClass::YuboxLoRaWANConfigClass(void)
 
     _ts_errorAfterJoin = 0;
     _pEvents = NULL;
+    _status_dirty = false;
+    _status_min_interval_ms = LORAWAN_STATUS_DEFAULT_INTERVAL_MS;
+    _ts_status_lastSent = 0;
+    _ts_status_lastFull = 0;
+    memset(_statusSent, 0, sizeof(_statusSent));
     _ts_ultimoTX_OK = 0;
     _ts_ultimoTX_FAIL = 0;
     _ts_ultimoRX = 0;
     _ts_lastDownlinkActivity = 0;
     _tx_duty_sec = LORAWAN_APP_DEFAULT_TX_DUTYCYCLE;
     _tx_duty_sec_changed = false;
+    _ts_uplinkQueue_lastTry = 0;
+    _ts_join_start = 0;
+
+    _join_backoff_base_ms = LORAWAN_JOIN_DEFAULT_BACKOFF_BASE_MS;
+    _join_backoff_max_ms = LORAWAN_JOIN_DEFAULT_BACKOFF_MAX_MS;
+    _join_retry_budget = LORAWAN_JOIN_DEFAULT_RETRY_BUDGET;
+    _backoff_rng = 0;
+    _resetJoinRetry();
+
+    _frag_msgid = 0;
+    _num_frag_tx = 0;
+
+    _duty_custom = false;
+    _duty_enforce = false;
+    _last_airtime_ms = 0;
+
+    memset(&_confirmMsg, 0, sizeof(_confirmMsg));
+    _confirm_attempts = 0;
+    _confirm_retry_pending = false;
+    _ts_confirm_retry_start = 0;
+    _confirm_retry_delay = 0;
+
+    _log_inflight = false;
+    _log_inflight_seq = 0;
+    _ts_log_lastTry = 0;
+    _log_retry_delay = LORAWAN_LOG_REPLAY_INTERVAL_MS;
+
+    _rtc_resumed = false;
+    _rtc_restore_pending = false;
+    memset(&_rtcResume, 0, sizeof(_rtcResume));
+    _ts_boot_tx = 0;
+
+    memset(_rxPortMap, 0, sizeof(_rxPortMap));
+}
+
+YuboxLoRaWANConfigClass::~YuboxLoRaWANConfigClass()
+{
+    // Los eventos de radio posteriores se descartan en lugar de llegar a un objeto destruido
+    if (_activeInstance == this) _activeInstance = NULL;
 }
 
 void YuboxLoRaWANConfigClass::_clearSessionKeys()
@@ -112,29 +238,20 @@ void YuboxLoRaWANConfigClass::_clearSessionKeys()
     _lw_DevAddr = 0;
     _lw_UpLinkCounter = 0;
     _lw_DownLinkCounter = 0;
+    _fcnt_UpLinkCommitted = 0;
+    _fcnt_DownLinkCommitted = 0;
     _lw_useOTAA = true;
-}
-
-void YuboxLoRaWANConfigClass::_destroySessionKeys(Preferences & nvram)
-{
-    _clearSessionKeys();
-    nvram.remove("NwkSKey");
-    nvram.remove("AppSKey");
-    nvram.remove("devaddr");
-    nvram.remove("uplinkcnt");
-    nvram.remove("downlinkcnt");
+    _rtc_restore_pending = false;
 }
 
 void YuboxLoRaWANConfigClass::destroySessionKeys(void)
 {
-    Preferences nvram;
-    nvram.begin(_ns_nvram_yuboxframework_lorawan, false);
-
-    _destroySessionKeys(nvram);
+    _clearSessionKeys();
+    _saveStateToNVRAM();
     _lw_needsInit = true;
 }
 
-void YuboxLoRaWANConfigClass::_saveFrameCounters(Preferences & nvram)
+void YuboxLoRaWANConfigClass::_readFrameCounters(void)
 {
     MibRequestConfirm_t mibReq;
 
@@ -143,21 +260,108 @@ void YuboxLoRaWANConfigClass::_saveFrameCounters(Preferences & nvram)
     LoRaMacMibGetRequestConfirm(&mibReq);
     _lw_UpLinkCounter = mibReq.Param.UpLinkCounter;
     log_v("- UpLinkCounter = %u", _lw_UpLinkCounter);
-    nvram.putUInt("uplinkcnt", _lw_UpLinkCounter);
 
     memset(&mibReq, 0, sizeof(MibRequestConfirm_t));
     mibReq.Type = MIB_DOWNLINK_COUNTER;
     LoRaMacMibGetRequestConfirm(&mibReq);
     _lw_DownLinkCounter = mibReq.Param.DownLinkCounter;
     log_v("- DownLinkCounter = %u", _lw_DownLinkCounter);
-    nvram.putUInt("downlinkcnt", _lw_DownLinkCounter);
 }
 
-void YuboxLoRaWANConfigClass::_saveFrameCounters(void)
+void YuboxLoRaWANConfigClass::_commitFrameCounters(void)
 {
-    Preferences nvram;
-    nvram.begin(_ns_nvram_yuboxframework_lorawan, false);
-    _saveFrameCounters(nvram);
+    // Los valores confirmados sólo avanzan si la escritura tuvo éxito, para
+    // que el siguiente intento vuelva a considerarlos pendientes
+    uint32_t old_up = _fcnt_UpLinkCommitted;
+    uint32_t old_down = _fcnt_DownLinkCommitted;
+    _fcnt_UpLinkCommitted = _lw_UpLinkCounter;
+    _fcnt_DownLinkCommitted = _lw_DownLinkCounter;
+
+    if (!_saveFrameCountersToNVRAM()) {
+        _fcnt_UpLinkCommitted = old_up;
+        _fcnt_DownLinkCommitted = old_down;
+        _metrics.inc(YBX_LW_MET_FCNT_WRITE_FAIL);
+        log_e("No se pudieron guardar contadores de trama (up=%u down=%u) en NVRAM", _lw_UpLinkCounter, _lw_DownLinkCounter);
+        return;
+    }
+
+    _ts_fcnt_lastCommit = millis();
+    _num_fcnt_writes++;
+}
+
+bool YuboxLoRaWANConfigClass::_frameCountersPending(void)
+{
+    return (_lw_UpLinkCounter != _fcnt_UpLinkCommitted || _lw_DownLinkCounter != _fcnt_DownLinkCommitted);
+}
+
+void YuboxLoRaWANConfigClass::_saveFrameCounters(bool force)
+{
+    // Sin sesión negociada no hay contadores que valga la pena guardar
+    if (_lw_useOTAA) return;
+
+    _readFrameCounters();
+    if (!_frameCountersPending()) return;
+
+    /* La diferencia se calcula respecto al último valor escrito, y no por número
+     * de llamadas, para contar también las tramas vacías de negociación de
+     * payload que se envían sin pasar por aquí. */
+    bool commit = force
+        || (_fcnt_commit_window <= 1)
+        || (_lw_UpLinkCounter - _fcnt_UpLinkCommitted >= _fcnt_commit_window)
+        || (_lw_DownLinkCounter - _fcnt_DownLinkCommitted >= _fcnt_commit_window)
+        || (_fcnt_commit_maxsec > 0 && millis() - _ts_fcnt_lastCommit >= 1000 * _fcnt_commit_maxsec);
+    if (!commit) {
+        _num_fcnt_writes_avoided++;
+        return;
+    }
+
+    _commitFrameCounters();
+}
+
+bool YuboxLoRaWANConfigClass::flushFrameCounters(void)
+{
+    if (!_lorahw_init || _lw_needsInit) return false;
+    if (lmh_join_status_get() != LMH_SET) return false;
+
+    _saveFrameCounters(true);
+    return true;
+}
+
+bool YuboxLoRaWANConfigClass::setFrameCounterCommitWindow(uint32_t nframes, uint32_t maxsec)
+{
+    if (nframes < 1) return false;
+    if (nframes == _fcnt_commit_window && maxsec == _fcnt_commit_maxsec) return true;
+
+    // Los contadores pendientes se escribieron bajo la ventana anterior
+    bool flushed = flushFrameCounters();
+
+    bool bumped = false;
+    uint32_t old_committed = _fcnt_UpLinkCommitted;
+    if (!flushed && !_lw_useOTAA && nframes < _fcnt_commit_window) {
+        /* Sin sesión activa no se conoce cuánto avanzó el contador guardado bajo
+         * la ventana anterior. Se adelanta el valor guardado para que el salto
+         * con la nueva ventana (más pequeña) cubra el mismo rango. Un contador
+         * más alto es siempre seguro, aunque falle la escritura. */
+        _lw_UpLinkCounter = _fcnt_UpLinkCommitted + (_fcnt_commit_window - nframes);
+        _fcnt_UpLinkCommitted = _lw_UpLinkCounter;
+        bumped = true;
+    }
+
+    // Contadores y ventana nueva se escriben juntos
+    uint32_t old_window = _fcnt_commit_window;
+    uint32_t old_maxsec = _fcnt_commit_maxsec;
+    _fcnt_commit_window = nframes;
+    _fcnt_commit_maxsec = maxsec;
+    if (!_saveStateToNVRAM()) {
+        _fcnt_commit_window = old_window;
+        _fcnt_commit_maxsec = old_maxsec;
+
+        // El contador adelantado queda pendiente de escribir
+        _fcnt_UpLinkCommitted = old_committed;
+        return false;
+    }
+    if (bumped) _num_fcnt_writes++;
+    return true;
 }
 
 #ifdef YUBOX_HELTEC_WIFI_LORA_V3
@@ -211,7 +415,16 @@ bool YuboxLoRaWANConfigClass::begin(AsyncWebServer & srv, bool displayTxConf)
 {
     _tx_conf_display = displayTxConf;
 
-    _loadSavedCredentialsFromNVRAM();
+    /* La copia en RTC se consume una sola vez: si el dispositivo vuelve a
+     * dormir sin llamar a prepareDeepSleep(), sus contadores ya no son válidos. */
+    _rtc_resumed = (esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_UNDEFINED) && _loadSessionFromRTC();
+    yuboxlorawan_rtc_session_clear(rtcSession);
+    if (_rtc_resumed) {
+        log_i("Sesión LoRaWAN reanudada desde memoria RTC");
+        _metrics.inc(YBX_LW_MET_RTC_RESUME);
+    } else {
+        _loadSavedCredentialsFromNVRAM();
+    }
     _setupHTTPRoutes(srv);
 
     hw_config hwConfig;
@@ -230,24 +443,150 @@ bool YuboxLoRaWANConfigClass::begin(AsyncWebServer & srv, bool displayTxConf)
     hwConfig.USE_DIO3_TCXO = true;        // Example uses an CircuitRocks Alora RFM1262 which uses DIO3 to control oscillator voltage
     hwConfig.USE_DIO3_ANT_SWITCH = false;   // Only Insight ISP4520 module uses DIO3 as antenna control
 
-    uint32_t err_code = lora_hardware_init(hwConfig);
+    // Al despertar, la radio dormida conserva su configuración y no se reinicia
+    uint32_t err_code = _rtc_resumed ? lora_hardware_re_init(hwConfig) : lora_hardware_init(hwConfig);
     if (err_code != 0) {
         log_e("lora_hardware_init failed - %d", err_code);
     } else {
         _lorahw_init = true;
     }
 
+    /* La semilla se combina con el DevEUI para que nodos con una misma fuente
+     * de aleatoriedad débil no elijan las mismas esperas de reintento. */
+    _backoff_rng = BoardGetRandomSeed();
+    for (auto i = 0; i < 8; i++) _backoff_rng = (_backoff_rng * 31) ^ _lw_devEUI[i] ^ _lw_default_devEUI[i];
+    if (_backoff_rng == 0) _backoff_rng = 1;
+
+    if (!_flashLog.begin()) {
+        log_d("Partición %s no disponible, log persistente de uplinks desactivado", YUBOX_LORAWAN_LOG_PARTITION_LABEL);
+    }
+
     return _lorahw_init;
 }
 
 void YuboxLoRaWANConfigClass::_loadSavedCredentialsFromNVRAM(void)
 {
     Preferences nvram;
-    bool ok = true;
 
-    // Para cada una de las preferencias, si no está seteada se obtendrá cadena vacía
     nvram.begin(_ns_nvram_yuboxframework_lorawan, true);
+    bool found = _loadStateFromNVRAM(nvram);
+    if (!found) _loadLegacyKeysFromNVRAM(nvram);
+    nvram.end();
+
+    // Validar si región seleccionada es válida...
+    if (!_isValidLoRaWANRegion((uint8_t)_lw_region)) _lw_region = LORAMAC_REGION_AU915;
+
+    // Validar si sub-banda almacenada es válida para región...
+    if (_lw_subband < 1) _lw_subband = 1;
+    if (_lw_subband > _getMaxLoRaWANRegionSubchannel(_lw_region)) _lw_subband = 1;
+    if (_lw_subband_cached > _getMaxLoRaWANRegionSubchannel(_lw_region)) _lw_subband_cached = 0;
+    _lw_subband_active = _lw_subband;
+
+    if (_fcnt_commit_window < 1) _fcnt_commit_window = 1;
+
+    // Validar parámetros de transmisión, el datarate depende de la región
+    if (!_isValidUplinkDatarate(_lw_region, _lw_datarate)) _lw_datarate = LORAWAN_DEFAULT_DATARATE;
+    if (_lw_txpower < 0 || _lw_txpower > LORAWAN_TXPOWER_MAX_INDEX) _lw_txpower = LORAWAN_DEFAULT_TX_POWER;
+    if (_lw_jointrials < 1 || _lw_jointrials > LORAWAN_JOINREQ_MAX_TRIALS) _lw_jointrials = JOINREQ_NBTRIALS;
+
+    if (!found && _lw_confExists) {
+        /* Migración desde claves individuales. Las claves anteriores se borran
+         * sólo luego de escribir el registro nuevo, y si la energía se pierde
+         * antes de borrarlas, el registro nuevo tiene precedencia. */
+        if (_saveStateToNVRAM()) {
+            static const char * const legacyKeys[] = {
+                "devEUI", "appEUI", "appKey", "region", "subband", "subbandscan", "subbandok",
+                "txduty", "txconfretries", "fcntwindow", "fcntmaxsec",
+                "NwkSKey", "AppSKey", "devaddr", "uplinkcnt", "downlinkcnt",
+            };
+
+            nvram.begin(_ns_nvram_yuboxframework_lorawan, false);
+            for (size_t i = 0; i < sizeof(legacyKeys) / sizeof(legacyKeys[0]); i++) nvram.remove(legacyKeys[i]);
+            nvram.end();
+            log_i("Configuración LoRaWAN migrada a registro único en NVRAM");
+        } else {
+            log_e("No se puede migrar configuración LoRaWAN a registro único, se conservan claves anteriores");
+        }
+    }
+}
+
+bool YuboxLoRaWANConfigClass::_loadStateFromNVRAM(Preferences & nvram)
+{
+    uint8_t buf[YUBOX_LORAWAN_NVRAM_MAX_SIZE];
+    yuboxlorawan_nvram_state_t s;
+
+    size_t n = nvram.getBytesLength(YUBOX_LORAWAN_NVRAM_STATE_KEY);
+    if (n == 0) return false;
+    if (n > sizeof(buf) || nvram.getBytes(YUBOX_LORAWAN_NVRAM_STATE_KEY, buf, n) != n) {
+        log_e("No se puede leer registro de configuración LoRaWAN (%u bytes)", n);
+        return false;
+    }
+
+    // Valores por omisión para campos ausentes en registros de versiones anteriores
+    memset(&s, 0, sizeof(s));
+    s.region = (uint8_t)LORAMAC_REGION_AU915;
+    s.subband = 1;
+    s.txduty = LORAWAN_APP_DEFAULT_TX_DUTYCYCLE;
+    s.txconfretries = 3;
+    s.fcntwindow = LORAWAN_APP_DEFAULT_FCNT_WINDOW;
+    s.fcntmaxsec = LORAWAN_APP_DEFAULT_FCNT_MAXSEC;
+    s.adr = LORAWAN_ADR_ON;
+    s.datarate = LORAWAN_DEFAULT_DATARATE;
+    s.txpower = LORAWAN_DEFAULT_TX_POWER;
+    s.jointrials = JOINREQ_NBTRIALS;
+    if (!yuboxlorawan_nvram_state_decode(buf, n, s)) {
+        log_e("Registro de configuración LoRaWAN corrupto, se ignora");
+        return false;
+    }
+
+    _lw_confExists = ((s.flags & YBX_NVRAM_F_CONF) != 0);
+    memcpy(_lw_devEUI, s.devEUI, sizeof(_lw_devEUI));
+    memcpy(_lw_appEUI, s.appEUI, sizeof(_lw_appEUI));
+    memcpy(_lw_appKey, s.appKey, sizeof(_lw_appKey));
+    _lw_region = (LoRaMacRegion_t)s.region;
+    _lw_subband = s.subband;
+    _lw_subband_scan = ((s.flags & YBX_NVRAM_F_SUBBANDSCAN) != 0);
+    _lw_subband_cached = s.subbandok;
+    _tx_duty_sec = s.txduty;
+    _tx_conf_num_retries = s.txconfretries;
+    _fcnt_commit_window = s.fcntwindow;
+    _fcnt_commit_maxsec = s.fcntmaxsec;
+    _lw_devclass = (s.devclass == CLASS_C) ? CLASS_C : CLASS_A;
+    _lw_adr = (s.adr != 0);
+    _lw_datarate = s.datarate;
+    _lw_txpower = s.txpower;
+    _lw_jointrials = s.jointrials;
+    _lw_dr_policy = (s.drpolicy != 0);
+
+    if (_lw_confExists && (s.flags & YBX_NVRAM_F_SESSION) && s.devaddr != 0) {
+        memcpy(_lw_NwkSKey, s.NwkSKey, sizeof(_lw_NwkSKey));
+        memcpy(_lw_AppSKey, s.AppSKey, sizeof(_lw_AppSKey));
+        _lw_DevAddr = s.devaddr;
+        _lw_UpLinkCounter = s.uplinkcnt;
+        _lw_DownLinkCounter = s.downlinkcnt;
+
+        // Los contadores más recientes están en su propia clave
+        yuboxlorawan_nvram_fcnt_t f;
+        if (nvram.getBytesLength(YUBOX_LORAWAN_NVRAM_FCNT_KEY) == sizeof(f)
+            && nvram.getBytes(YUBOX_LORAWAN_NVRAM_FCNT_KEY, &f, sizeof(f)) == sizeof(f)
+            && f.devaddr == s.devaddr && f.uplinkcnt >= s.uplinkcnt) {
+            _lw_UpLinkCounter = f.uplinkcnt;
+            _lw_DownLinkCounter = f.downlinkcnt;
+        }
+        _fcnt_UpLinkCommitted = _lw_UpLinkCounter;
+        _fcnt_DownLinkCommitted = _lw_DownLinkCounter;
+        _lw_useOTAA = false;
+    } else {
+        _clearSessionKeys();
+    }
+    return true;
+}
+
+void YuboxLoRaWANConfigClass::_loadLegacyKeysFromNVRAM(Preferences & nvram)
+{
+    bool ok = true;
 
+    // Para cada una de las preferencias, si no está seteada se obtendrá cadena vacía
 #define LWPARAM_LOAD(P) \
     if (nvram.getBytesLength(#P) >= sizeof(_lw_##P)) {\
         nvram.getBytes(#P, _lw_##P, sizeof(_lw_##P));\
@@ -260,16 +599,14 @@ void YuboxLoRaWANConfigClass::_loadSavedCredentialsFromNVRAM(void)
     LWPARAM_LOAD(appKey)
     _lw_region = (LoRaMacRegion_t) nvram.getUChar("region", (uint8_t)LORAMAC_REGION_AU915);
     _lw_subband = nvram.getUChar("subband", 1);
+    _lw_subband_scan = nvram.getBool("subbandscan", false);
+    _lw_subband_cached = nvram.getUChar("subbandok", 0);
     _tx_duty_sec = nvram.getUInt("txduty", LORAWAN_APP_DEFAULT_TX_DUTYCYCLE);
 
     _tx_conf_num_retries = nvram.getUInt("txconfretries", 3);
 
-    // Validar si región seleccionada es válida...
-    if (!_isValidLoRaWANRegion((uint8_t)_lw_region)) _lw_region = LORAMAC_REGION_AU915;
-
-    // Validar si sub-banda almacenada es válida para región...
-    if (_lw_subband < 1) _lw_subband = 1;
-    if (_lw_subband > _getMaxLoRaWANRegionSubchannel(_lw_region)) _lw_subband = 1;
+    _fcnt_commit_window = nvram.getUInt("fcntwindow", LORAWAN_APP_DEFAULT_FCNT_WINDOW);
+    _fcnt_commit_maxsec = nvram.getUInt("fcntmaxsec", LORAWAN_APP_DEFAULT_FCNT_MAXSEC);
 
     _lw_confExists = ok;
 
@@ -284,12 +621,183 @@ void YuboxLoRaWANConfigClass::_loadSavedCredentialsFromNVRAM(void)
         // Contador de downlink puede se legítimamente 0 si sólo se envía y no recibe.
         if (ok) _lw_DownLinkCounter = nvram.getUInt("downlinkcnt", 0);
 
+        _fcnt_UpLinkCommitted = _lw_UpLinkCounter;
+        _fcnt_DownLinkCommitted = _lw_DownLinkCounter;
+
         if (ok) _lw_useOTAA = false;
     }
+#undef LWPARAM_LOAD
 
     if (!ok) _clearSessionKeys();
 }
 
+bool YuboxLoRaWANConfigClass::_saveStateToNVRAM(void)
+{
+    yuboxlorawan_nvram_state_t s;
+
+    memset(&s, 0, sizeof(s));
+    if (_lw_confExists) s.flags |= YBX_NVRAM_F_CONF;
+    if (_lw_subband_scan) s.flags |= YBX_NVRAM_F_SUBBANDSCAN;
+    s.region = (uint8_t)_lw_region;
+    s.subband = _lw_subband;
+    s.subbandok = _lw_subband_cached;
+    memcpy(s.devEUI, _lw_devEUI, sizeof(s.devEUI));
+    memcpy(s.appEUI, _lw_appEUI, sizeof(s.appEUI));
+    memcpy(s.appKey, _lw_appKey, sizeof(s.appKey));
+    s.txduty = _tx_duty_sec;
+    s.txconfretries = _tx_conf_num_retries;
+    s.fcntwindow = _fcnt_commit_window;
+    s.fcntmaxsec = _fcnt_commit_maxsec;
+    s.devclass = (uint8_t)_lw_devclass;
+    s.adr = _lw_adr ? 1 : 0;
+    s.datarate = _lw_datarate;
+    s.txpower = _lw_txpower;
+    s.jointrials = _lw_jointrials;
+    s.drpolicy = _lw_dr_policy ? 1 : 0;
+
+    // Se guardan los contadores ya confirmados, que son los que cubre la ventana de escritura
+    if (!_lw_useOTAA && _lw_DevAddr != 0) {
+        s.flags |= YBX_NVRAM_F_SESSION;
+        memcpy(s.NwkSKey, _lw_NwkSKey, sizeof(s.NwkSKey));
+        memcpy(s.AppSKey, _lw_AppSKey, sizeof(s.AppSKey));
+        s.devaddr = _lw_DevAddr;
+        s.uplinkcnt = _fcnt_UpLinkCommitted;
+        s.downlinkcnt = _fcnt_DownLinkCommitted;
+    }
+    yuboxlorawan_nvram_state_seal(s);
+
+    Preferences nvram;
+    nvram.begin(_ns_nvram_yuboxframework_lorawan, false);
+    bool ok = (nvram.putBytes(YUBOX_LORAWAN_NVRAM_STATE_KEY, &s, sizeof(s)) == sizeof(s));
+    nvram.end();
+
+    if (!ok) log_e("No se puede escribir registro de configuración LoRaWAN");
+
+    // Se reescribe también "fcnt": el de una sesión anterior con el mismo
+    // devaddr adelantaría los contadores de la nueva al cargar
+    if (ok && (s.flags & YBX_NVRAM_F_SESSION)) ok = _saveFrameCountersToNVRAM();
+    return ok;
+}
+
+bool YuboxLoRaWANConfigClass::_saveFrameCountersToNVRAM(void)
+{
+    yuboxlorawan_nvram_fcnt_t f;
+
+    f.devaddr = _lw_DevAddr;
+    f.uplinkcnt = _fcnt_UpLinkCommitted;
+    f.downlinkcnt = _fcnt_DownLinkCommitted;
+
+    Preferences nvram;
+    nvram.begin(_ns_nvram_yuboxframework_lorawan, false);
+    bool ok = (nvram.putBytes(YUBOX_LORAWAN_NVRAM_FCNT_KEY, &f, sizeof(f)) == sizeof(f));
+    nvram.end();
+
+    if (!ok) log_e("No se puede escribir contadores de trama LoRaWAN");
+    return ok;
+}
+
+bool YuboxLoRaWANConfigClass::_loadSessionFromRTC(void)
+{
+    if (!yuboxlorawan_rtc_session_valid(rtcSession)) return false;
+    if (!_isValidLoRaWANRegion(rtcSession.region)) return false;
+
+    memcpy(&_rtcResume, &rtcSession, sizeof(_rtcResume));
+
+    memcpy(_lw_devEUI, _rtcResume.devEUI, sizeof(_lw_devEUI));
+    memcpy(_lw_appEUI, _rtcResume.appEUI, sizeof(_lw_appEUI));
+    memcpy(_lw_appKey, _rtcResume.appKey, sizeof(_lw_appKey));
+    _lw_region = (LoRaMacRegion_t)_rtcResume.region;
+    _lw_subband = _rtcResume.subband;
+    _lw_subband_scan = (_rtcResume.subband_scan != 0);
+    _lw_subband_cached = _rtcResume.subband_cached;
+    _lw_subband_active = _rtcResume.subband_active;
+    _tx_duty_sec = _rtcResume.txduty;
+    _tx_conf_num_retries = _rtcResume.txconfretries;
+    _fcnt_commit_window = _rtcResume.fcntwindow;
+    _fcnt_commit_maxsec = _rtcResume.fcntmaxsec;
+    _lw_devclass = (_rtcResume.devclass == CLASS_C) ? CLASS_C : CLASS_A;
+    _lw_adr = (_rtcResume.cfg_adr != 0);
+    _lw_datarate = _rtcResume.cfg_datarate;
+    _lw_txpower = _rtcResume.cfg_txpower;
+    _lw_jointrials = _rtcResume.jointrials;
+    _lw_dr_policy = (_rtcResume.drpolicy != 0);
+    _lw_confExists = true;
+
+    if (_rtcResume.has_session) {
+        memcpy(_lw_NwkSKey, _rtcResume.NwkSKey, sizeof(_lw_NwkSKey));
+        memcpy(_lw_AppSKey, _rtcResume.AppSKey, sizeof(_lw_AppSKey));
+        _lw_DevAddr = _rtcResume.DevAddr;
+        _lw_UpLinkCounter = _rtcResume.UpLinkCounter;
+        _lw_DownLinkCounter = _rtcResume.DownLinkCounter;
+        _fcnt_UpLinkCommitted = _rtcResume.UpLinkCommitted;
+        _fcnt_DownLinkCommitted = _rtcResume.DownLinkCommitted;
+        _lw_useOTAA = false;
+        _rtc_restore_pending = true;
+    } else {
+        _clearSessionKeys();
+    }
+    return true;
+}
+
+bool YuboxLoRaWANConfigClass::prepareDeepSleep(void)
+{
+    yuboxlorawan_rtc_session_clear(rtcSession);
+    if (_flashLog.ready()) _flashLog.flush();
+    if (!_lw_confExists) return false;
+
+    memcpy(rtcSession.devEUI, _lw_devEUI, sizeof(rtcSession.devEUI));
+    memcpy(rtcSession.appEUI, _lw_appEUI, sizeof(rtcSession.appEUI));
+    memcpy(rtcSession.appKey, _lw_appKey, sizeof(rtcSession.appKey));
+    rtcSession.region = (uint8_t)_lw_region;
+    rtcSession.subband = _lw_subband;
+    rtcSession.subband_scan = _lw_subband_scan ? 1 : 0;
+    rtcSession.subband_cached = _lw_subband_cached;
+    rtcSession.subband_active = _lw_subband_active;
+    rtcSession.txduty = _tx_duty_sec;
+    rtcSession.txconfretries = _tx_conf_num_retries;
+    rtcSession.fcntwindow = _fcnt_commit_window;
+    rtcSession.fcntmaxsec = _fcnt_commit_maxsec;
+    rtcSession.devclass = (uint8_t)_lw_devclass;
+    rtcSession.cfg_adr = _lw_adr ? 1 : 0;
+    rtcSession.cfg_datarate = _lw_datarate;
+    rtcSession.cfg_txpower = _lw_txpower;
+    rtcSession.jointrials = _lw_jointrials;
+    rtcSession.drpolicy = _lw_dr_policy ? 1 : 0;
+
+    // Sólo una sesión establecida y en uso tiene contadores y estado de MAC válidos
+    if (!_lw_useOTAA && _lorahw_init && !_lw_needsInit && lmh_join_status_get() == LMH_SET) {
+        MibRequestConfirm_t mibReq;
+
+        _readFrameCounters();
+        rtcSession.has_session = 1;
+        memcpy(rtcSession.NwkSKey, _lw_NwkSKey, sizeof(rtcSession.NwkSKey));
+        memcpy(rtcSession.AppSKey, _lw_AppSKey, sizeof(rtcSession.AppSKey));
+        rtcSession.DevAddr = _lw_DevAddr;
+        rtcSession.UpLinkCounter = _lw_UpLinkCounter;
+        rtcSession.DownLinkCounter = _lw_DownLinkCounter;
+        rtcSession.UpLinkCommitted = _fcnt_UpLinkCommitted;
+        rtcSession.DownLinkCommitted = _fcnt_DownLinkCommitted;
+
+        memset(&mibReq, 0, sizeof(MibRequestConfirm_t));
+        mibReq.Type = MIB_ADR;
+        LoRaMacMibGetRequestConfirm(&mibReq);
+        rtcSession.adr = mibReq.Param.AdrEnable ? 1 : 0;
+
+        rtcSession.datarate = _getCurrentDatarate();
+
+        memset(&mibReq, 0, sizeof(MibRequestConfirm_t));
+        mibReq.Type = MIB_CHANNELS_TX_POWER;
+        LoRaMacMibGetRequestConfirm(&mibReq);
+        rtcSession.txpower = mibReq.Param.ChannelsTxPower;
+    }
+    yuboxlorawan_rtc_session_seal(rtcSession);
+
+    if (_lorahw_init) Radio.Sleep();
+
+    log_d("Sesión LoRaWAN guardada en memoria RTC (%s sesión)", rtcSession.has_session ? "con" : "sin");
+    return true;
+}
+
 bool YuboxLoRaWANConfigClass::_isValidLoRaWANRegion(uint8_t r)
 {
     switch (r) {
@@ -346,6 +854,68 @@ const char * YuboxLoRaWANConfigClass::_getLoRaWANRegionName(LoRaMacRegion_t regi
     }
 }
 
+yuboxlorawan_drtable_t YuboxLoRaWANConfigClass::_getLoRaWANRegionDRTable(LoRaMacRegion_t region)
+{
+    switch (region) {
+    case LORAMAC_REGION_AS923:
+    case LORAMAC_REGION_AS923_2:
+    case LORAMAC_REGION_AS923_3:
+    case LORAMAC_REGION_AS923_4:
+        return YBX_LW_DRT_AS923;
+    case LORAMAC_REGION_AU915:
+        return YBX_LW_DRT_AU915;
+    case LORAMAC_REGION_US915:
+        return YBX_LW_DRT_US915;
+    case LORAMAC_REGION_CN470:
+        return YBX_LW_DRT_CN470;
+    case LORAMAC_REGION_KR920:
+        return YBX_LW_DRT_KR920;
+    case LORAMAC_REGION_IN865:
+        return YBX_LW_DRT_IN865;
+    case LORAMAC_REGION_CN779:
+    case LORAMAC_REGION_EU433:
+    case LORAMAC_REGION_EU868:
+    case LORAMAC_REGION_RU864:
+    default:
+        return YBX_LW_DRT_EU868;
+    }
+}
+
+uint32_t YuboxLoRaWANConfigClass::_getLoRaWANRegionDutyPermille(LoRaMacRegion_t region)
+{
+    // Límite agregado más común de la región. Las regiones sin límite de ciclo
+    // de trabajo regulan por tiempo de permanencia o LBT.
+    switch (region) {
+    case LORAMAC_REGION_CN779:
+    case LORAMAC_REGION_EU433:
+    case LORAMAC_REGION_EU868:
+    case LORAMAC_REGION_RU864:
+    case LORAMAC_REGION_AS923:
+    case LORAMAC_REGION_AS923_2:
+    case LORAMAC_REGION_AS923_3:
+    case LORAMAC_REGION_AS923_4:
+        return 10;
+    default:
+        return 0;
+    }
+}
+
+uint8_t YuboxLoRaWANConfigClass::_getLoRaWANRegionMinPayload(LoRaMacRegion_t region)
+{
+    // Payload máximo del datarate de uplink más bajo, con el dwell time por
+    // omisión de SX126x-Arduino en cada región
+    switch (region) {
+    case LORAMAC_REGION_US915:
+    case LORAMAC_REGION_AS923:
+    case LORAMAC_REGION_AS923_2:
+    case LORAMAC_REGION_AS923_3:
+    case LORAMAC_REGION_AS923_4:
+        return 11;
+    default:
+        return 51;
+    }
+}
+
 uint8_t YuboxLoRaWANConfigClass::_getMaxLoRaWANRegionSubchannel(LoRaMacRegion_t region)
 {
     switch (region) {
@@ -381,39 +951,103 @@ void YuboxLoRaWANConfigClass::_setupHTTPRoutes(AsyncWebServer & srv)
   _pEvents->onConnect(std::bind(&YuboxLoRaWANConfigClass::_routeHandler_yuboxAPI_lorawan_status_onConnect, this, std::placeholders::_1));
   srv.on("/yubox-api/lorawan/regions.json", HTTP_GET, std::bind(&YuboxLoRaWANConfigClass::_routeHandler_yuboxAPI_lorawanregionsjson_GET, this, std::placeholders::_1));
   srv.on("/yubox-api/lorawan/resetconn", HTTP_POST, std::bind(&YuboxLoRaWANConfigClass::_routeHandler_yuboxAPI_lorawanresetconn_POST, this, std::placeholders::_1));
+  srv.on("/yubox-api/lorawan/metrics.json", HTTP_GET, std::bind(&YuboxLoRaWANConfigClass::_routeHandler_yuboxAPI_lorawanmetricsjson_GET, this, std::placeholders::_1));
+  srv.on("/yubox-api/lorawan/metrics", HTTP_GET, std::bind(&YuboxLoRaWANConfigClass::_routeHandler_yuboxAPI_lorawanmetrics_GET, this, std::placeholders::_1));
 }
 
-String YuboxLoRaWANConfigClass::_reportActivityJSON(void)
+void YuboxLoRaWANConfigClass::_collectActivityStatus(uint32_t * v)
 {
-#if ARDUINOJSON_VERSION_MAJOR <= 6
-    DynamicJsonDocument json_doc(JSON_OBJECT_SIZE(8));
-#else
-    JsonDocument json_doc;
-#endif
-    switch (lmh_join_status_get()) {
-    case LMH_RESET:     json_doc["join"] = "RESET"; break;
-    case LMH_SET:       json_doc["join"] = "SET"; break;
-    case LMH_ONGOING:   json_doc["join"] = "ONGOING"; break;
-    case LMH_FAILED:    json_doc["join"] = "FAILED"; break;
+    v[YBX_LW_ST_JOIN] = (uint32_t)lmh_join_status_get();
+    v[YBX_LW_ST_TX_OK] = _ts_ultimoTX_OK;
+    v[YBX_LW_ST_TX_FAIL] = _ts_ultimoTX_FAIL;
+    v[YBX_LW_ST_RX] = _ts_ultimoRX;
+    v[YBX_LW_ST_NUM_CONFIRMTX_OK] = _num_confirmTX_OK;
+    v[YBX_LW_ST_NUM_CONFIRMTX_FAIL] = _num_confirmTX_FAIL;
+    v[YBX_LW_ST_CONFIRMTX_START] = _tx_waiting_confirm ? _ts_confirmTX_start : 0;
+    v[YBX_LW_ST_FCNT_WRITES] = _num_fcnt_writes;
+    v[YBX_LW_ST_FCNT_WRITES_AVOIDED] = _num_fcnt_writes_avoided;
+    v[YBX_LW_ST_TXQ_DEPTH] = _uplinkQueue.depth();
+    v[YBX_LW_ST_TXQ_DROPPED] = _uplinkQueue.getNumDropped();
+    v[YBX_LW_ST_EV_DROPPED] = _radioEvents.getNumDropped();
+    v[YBX_LW_ST_JOIN_ATTEMPT] = _join_attempt;
+    v[YBX_LW_ST_JOIN_NEXT] = getNextJoinAttempt();
+    v[YBX_LW_ST_SUBBAND] = _lw_subband_active;
+    v[YBX_LW_ST_DEVCLASS] = (uint32_t)_lw_devclass_active;
+
+    uint32_t t = millis();
+    uint32_t left = _dutyBudget.remaining(t);
+    uint32_t wait = _dutyBudget.delayFor(t, _last_airtime_ms);
+    v[YBX_LW_ST_AIRTIME_LEFT] = (left == UINT32_MAX) ? LORAWAN_STATUS_INT_NULL : left;
+    v[YBX_LW_ST_TX_NEXT] = (wait == 0 || wait == UINT32_MAX) ? 0 : t + wait;
+
+    const yuboxlorawan_link_sample_t * l = _linkStats.last();
+    int16_t rssi_avg, snr_avg;
+    if (l != NULL && _linkStats.mean(rssi_avg, snr_avg)) {
+        v[YBX_LW_ST_RSSI] = (uint32_t)(int32_t)l->rssi;
+        v[YBX_LW_ST_SNR] = (uint32_t)(int32_t)l->snr;
+        v[YBX_LW_ST_RSSI_AVG] = (uint32_t)(int32_t)rssi_avg;
+        v[YBX_LW_ST_SNR_AVG] = (uint32_t)(int32_t)snr_avg;
+    } else {
+        v[YBX_LW_ST_RSSI] = LORAWAN_STATUS_INT_NULL;
+        v[YBX_LW_ST_SNR] = LORAWAN_STATUS_INT_NULL;
+        v[YBX_LW_ST_RSSI_AVG] = LORAWAN_STATUS_INT_NULL;
+        v[YBX_LW_ST_SNR_AVG] = LORAWAN_STATUS_INT_NULL;
+    }
+}
+
+static const char * joinStatusName(lmh_join_status st)
+{
+    switch (st) {
+    case LMH_RESET:     return "RESET";
+    case LMH_SET:       return "SET";
+    case LMH_ONGOING:   return "ONGOING";
+    case LMH_FAILED:    return "FAILED";
+    default:            return NULL;
     }
-    if (_ts_ultimoTX_OK != 0) json_doc["tx_ok"] = _ts_ultimoTX_OK; else json_doc["tx_ok"] = (const char *)NULL;
-    if (_ts_ultimoTX_FAIL != 0) json_doc["tx_fail"] = _ts_ultimoTX_FAIL; else json_doc["tx_fail"] = (const char *)NULL;
-    if (_ts_ultimoRX != 0) json_doc["rx"] = _ts_ultimoRX; else json_doc["rx"] = (const char *)NULL;
-    json_doc["ts"] = millis();
+}
 
-    json_doc["num_confirmtx_ok"] = _num_confirmTX_OK;
-    json_doc["num_confirmtx_fail"] = _num_confirmTX_FAIL;
-    if (_tx_waiting_confirm) json_doc["confirmtx_start"] = _ts_confirmTX_start; else json_doc["confirmtx_start"] = (const char *)NULL;
+size_t YuboxLoRaWANConfigClass::_reportActivityJSON(char * buf, size_t len, const uint32_t * v, const uint32_t * prev)
+{
+    YuboxLoRaWANJSONWriter json(buf, len);
+
+    json.beginObject();
+    // Si se proporciona el estado previo, sólo se reportan los campos modificados
+    for (auto i = 0; i < YBX_LW_ST_MAX; i++) {
+        if (prev != NULL && prev[i] == v[i]) continue;
+
+        const char * k = lwStatusFields[i].key;
+        switch (lwStatusFields[i].kind) {
+        case YBX_LW_STKIND_JOIN:
+            json.fieldStr(k, joinStatusName((lmh_join_status)v[i]));
+            break;
+        case YBX_LW_STKIND_TS:
+            json.fieldTS(k, v[i]);
+            break;
+        case YBX_LW_STKIND_UINT:
+            json.fieldUInt(k, v[i]);
+            break;
+        case YBX_LW_STKIND_INT:
+            if (v[i] == LORAWAN_STATUS_INT_NULL)
+                json.fieldNull(k);
+            else json.fieldInt(k, (int32_t)v[i]);
+            break;
+        }
+    }
+    json.fieldUInt("ts", millis());
+    json.endObject();
 
-    String json_str;
-    serializeJson(json_doc, json_str);
-    return json_str;
+    if (json.overflow()) log_e("Buffer de %u bytes insuficiente para JSON de estado", len);
+    return json.length();
 }
 
 void YuboxLoRaWANConfigClass::_routeHandler_yuboxAPI_lorawan_status_onConnect(AsyncEventSourceClient * c)
 {
-    String json_str = _reportActivityJSON();
-    c->send(json_str.c_str());
+    uint32_t v[YBX_LW_ST_MAX];
+    char json_buf[LORAWAN_STATUS_JSON_LEN];
+
+    _collectActivityStatus(v);
+    _reportActivityJSON(json_buf, sizeof(json_buf), v);
+    c->send(json_buf);
 }
 
 void YuboxLoRaWANConfigClass::_routeHandler_yuboxAPI_lorawanregionsjson_GET(AsyncWebServerRequest * request)
@@ -424,26 +1058,23 @@ void YuboxLoRaWANConfigClass::_routeHandler_yuboxAPI_lorawanregionsjson_GET(Asyn
     uint8_t numRegions = 0;
     while (_isValidLoRaWANRegion(numRegions)) numRegions++;
 
-    AsyncResponseStream *response = request->beginResponseStream("application/json");
-#if ARDUINOJSON_VERSION_MAJOR <= 6
-    DynamicJsonDocument json_doc(JSON_ARRAY_SIZE(numRegions) + numRegions * JSON_OBJECT_SIZE(3));
-#else
-    JsonDocument json_doc;
-#endif
+    char json_buf[LORAWAN_REGIONS_JSON_LEN];
+    YuboxLoRaWANJSONWriter json(json_buf, sizeof(json_buf));
 
+    json.beginArray();
     for (auto i = 0; i < numRegions; i++) {
-        JsonObject region =
-#if ARDUINOJSON_VERSION_MAJOR <= 6
-            json_doc.createNestedObject();
-#else
-            json_doc.add<JsonObject>();
-#endif
-        region["id"] = i;
-        region["name"] = _getLoRaWANRegionName((LoRaMacRegion_t)i);
-        region["max_sb"] = _getMaxLoRaWANRegionSubchannel((LoRaMacRegion_t)i);
+        json.beginObject();
+        json.fieldUInt("id", i);
+        json.fieldStr("name", _getLoRaWANRegionName((LoRaMacRegion_t)i));
+        json.fieldUInt("max_sb", _getMaxLoRaWANRegionSubchannel((LoRaMacRegion_t)i));
+        json.endObject();
     }
+    json.endArray();
+
+    if (json.overflow()) log_e("Buffer de %u bytes insuficiente para JSON de regiones", sizeof(json_buf));
 
-    serializeJson(json_doc, *response);
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+    response->write((const uint8_t *)json.c_str(), json.length());
     request->send(response);
 }
 
@@ -451,40 +1082,226 @@ void YuboxLoRaWANConfigClass::_routeHandler_yuboxAPI_lorawanconfigjson_GET(Async
 {
     YUBOX_RUN_AUTH(request);
 
-    AsyncResponseStream *response = request->beginResponseStream("application/json");
-#if ARDUINOJSON_VERSION_MAJOR <= 6
-    DynamicJsonDocument json_doc(JSON_OBJECT_SIZE(10));
-#else
-    JsonDocument json_doc;
-#endif
+    char json_buf[LORAWAN_CONFIG_JSON_LEN];
+    YuboxLoRaWANJSONWriter json(json_buf, sizeof(json_buf));
 
-    json_doc["region"] = (unsigned int)_lw_region;
-    String s_default_devEUI = _bin2str(_lw_default_devEUI, sizeof(_lw_default_devEUI));
-    String s_devEUI = _lw_confExists ? _bin2str(_lw_devEUI, sizeof(_lw_devEUI)) : s_default_devEUI;
-    String s_appEUI = _lw_confExists ? _bin2str(_lw_appEUI, sizeof(_lw_appEUI)) : "";
-    String s_appKey = _lw_confExists ? _bin2str(_lw_appKey, sizeof(_lw_appKey)) : "";
-    json_doc["deviceEUI_ESP32"] = s_default_devEUI.c_str();
-    json_doc["deviceEUI"] = s_devEUI.c_str();
-    json_doc["appEUI"] = s_appEUI.c_str();
-    json_doc["appKey"] = s_appKey.c_str();
-    json_doc["subband"] = _lw_subband;
-    switch (lmh_join_status_get()) {
-    case LMH_RESET:     json_doc["join"] = "RESET"; break;
-    case LMH_SET:       json_doc["join"] = "SET"; break;
-    case LMH_ONGOING:   json_doc["join"] = "ONGOING"; break;
-    case LMH_FAILED:    json_doc["join"] = "FAILED"; break;
-    }
-    json_doc["tx_duty_sec"] = getRequestedTXDutyCycle();
+    json.beginObject();
+    json.fieldUInt("region", (unsigned int)_lw_region);
+    json.fieldHex("deviceEUI_ESP32", _lw_default_devEUI, sizeof(_lw_default_devEUI));
+    if (_lw_confExists) {
+        json.fieldHex("deviceEUI", _lw_devEUI, sizeof(_lw_devEUI));
+        json.fieldHex("appEUI", _lw_appEUI, sizeof(_lw_appEUI));
+        json.fieldHex("appKey", _lw_appKey, sizeof(_lw_appKey));
+    } else {
+        json.fieldHex("deviceEUI", _lw_default_devEUI, sizeof(_lw_default_devEUI));
+        json.fieldStr("appEUI", "");
+        json.fieldStr("appKey", "");
+    }
+    json.fieldUInt("subband", _lw_subband);
+    json.fieldBool("subband_scan", _lw_subband_scan);
+    json.fieldUInt("subband_active", _lw_subband_active);
+    json.fieldUInt("devclass", (unsigned int)_lw_devclass);
+    json.fieldUInt("devclass_active", (unsigned int)_lw_devclass_active);
+    json.fieldBool("adr", _lw_adr);
+    json.fieldInt("datarate", _lw_datarate);
+    json.fieldInt("txpower", _lw_txpower);
+    json.fieldUInt("join_trials", _lw_jointrials);
+    json.fieldBool("dr_policy", _lw_dr_policy);
+    json.fieldInt("datarate_start", _lw_datarate_start);
+    if (isJoined())
+        json.fieldInt("datarate_active", _getCurrentDatarate());
+    else json.fieldNull("datarate_active");
+    json.fieldStr("join", joinStatusName(lmh_join_status_get()));
+    json.fieldUInt("tx_duty_sec", getRequestedTXDutyCycle());
 
     if (_tx_waiting_confirm)
-        json_doc["confirmtx_start"] = _ts_confirmTX_start;
-    else json_doc["confirmtx_start"] = (const char *)NULL;
+        json.fieldUInt("confirmtx_start", _ts_confirmTX_start);
+    else json.fieldNull("confirmtx_start");
 
     if (_tx_conf_display)
-        json_doc["txconf_retries"] = _tx_conf_num_retries;
-    else json_doc["txconf_retries"] = (const char *)NULL;
+        json.fieldUInt("txconf_retries", _tx_conf_num_retries);
+    else json.fieldNull("txconf_retries");
+
+    uint32_t t = millis();
+    uint32_t left = _dutyBudget.remaining(t);
+    uint32_t wait = _dutyBudget.delayFor(t, _last_airtime_ms);
+    uint32_t txduty_min = _dutyBudget.minIntervalSec(_last_airtime_ms);
+    json.key("duty");
+    json.beginObject();
+    json.fieldUInt("limit_permille", _dutyBudget.getLimitPermille());
+    json.fieldUInt("window_sec", _dutyBudget.getWindowMs() / 1000);
+    json.fieldBool("enforce", _duty_enforce);
+    json.fieldUInt("airtime_last_ms", _last_airtime_ms);
+    json.fieldUInt("airtime_total_ms", _dutyBudget.total());
+    json.fieldUInt("airtime_baseline_ms", _airtime_baseline_ms);
+    json.fieldUInt("airtime_app_ms", _airtime_app_ms);
+    json.fieldInt("airtime_saved_ms", getAirtimeSaved());
+    json.fieldUInt("used_ms", _dutyBudget.used(t));
+    if (left == UINT32_MAX) json.fieldNull("left_ms"); else json.fieldUInt("left_ms", left);
+    json.fieldTS("tx_next", (wait == 0 || wait == UINT32_MAX) ? 0 : t + wait);
+    json.fieldUInt("txduty_min_sec", txduty_min);
+    json.fieldBool("txduty_ok", _tx_duty_sec >= txduty_min);
+    json.endObject();
+
+    yuboxlorawan_link_stats_t st;
+    json.key("link");
+    if (_linkStats.compute(st)) {
+        json.beginObject();
+        json.fieldUInt("count", st.count);
+        json.fieldUInt("total", st.total);
+        json.fieldTS("ts", st.ts_last);
+
+        const struct { const char * k; const yuboxlorawan_link_metric_t * m; } lm[] = {
+            { "rssi", &(st.rssi) },
+            { "snr", &(st.snr) },
+        };
+        for (auto i = 0; i < 2; i++) {
+            json.key(lm[i].k);
+            json.beginObject();
+            json.fieldInt("last", lm[i].m->last);
+            json.fieldInt("min", lm[i].m->min);
+            json.fieldInt("max", lm[i].m->max);
+            json.fieldInt("avg", lm[i].m->mean);
+            json.fieldInt("p10", lm[i].m->p10);
+            json.fieldInt("p50", lm[i].m->p50);
+            json.fieldInt("p90", lm[i].m->p90);
+            json.endObject();
+        }
+        json.endObject();
+    } else {
+        json.valueNull();
+    }
+    json.endObject();
+
+    if (json.overflow()) log_e("Buffer de %u bytes insuficiente para JSON de configuración", sizeof(json_buf));
+
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+    response->write((const uint8_t *)json.c_str(), json.length());
+    request->send(response);
+}
+
+void YuboxLoRaWANConfigClass::_routeHandler_yuboxAPI_lorawanmetricsjson_GET(AsyncWebServerRequest * request)
+{
+    YUBOX_RUN_AUTH(request);
+
+    char json_buf[LORAWAN_METRICS_JSON_LEN];
+    YuboxLoRaWANJSONWriter json(json_buf, sizeof(json_buf));
+
+    json.beginObject();
+    json.fieldUInt("ts", millis());
+
+    json.key("counters");
+    json.beginObject();
+    for (auto i = 0; i < YBX_LW_MET_MAX; i++) {
+        json.fieldUInt(yuboxlorawan_metric_names[i], _metrics.get((yuboxlorawan_metric_t)i));
+    }
+    json.fieldUInt("fcnt_writes", _num_fcnt_writes);
+    json.fieldUInt("fcnt_writes_avoided", _num_fcnt_writes_avoided);
+    json.fieldUInt("txq_sent", _uplinkQueue.getNumSent());
+    json.fieldUInt("txq_dropped", _uplinkQueue.getNumDropped());
+    json.fieldUInt("ev_dropped", _radioEvents.getNumDropped());
+    json.fieldUInt("airtime_ms", _dutyBudget.total());
+    json.fieldUInt("airtime_baseline_ms", _airtime_baseline_ms);
+    json.fieldUInt("airtime_app_ms", _airtime_app_ms);
+    json.fieldUInt("frag_tx", _num_frag_tx);
+    json.fieldUInt("frag_rx", _reassembler.getNumComplete());
+    json.fieldUInt("frag_rx_discarded", _reassembler.getNumDiscarded());
+    json.fieldUInt("log_written", _flashLog.getNumWritten());
+    json.fieldUInt("log_done", _flashLog.getNumDone());
+    json.fieldUInt("log_lost", _flashLog.getNumLost());
+    json.fieldUInt("log_corrupt", _flashLog.getNumCorrupt());
+    json.fieldUInt("log_mark_fail", _flashLog.getNumMarkFailures());
+    json.endObject();
+
+    json.key("gauges");
+    json.beginObject();
+    json.fieldUInt("txq_depth", _uplinkQueue.depth());
+    json.fieldUInt("txq_max_depth", _uplinkQueue.getMaxDepth());
+    json.fieldUInt("log_pending", _flashLog.getNumPending());
+    json.endObject();
+
+    json.key("histograms");
+    json.beginObject();
+    for (auto i = 0; i < YBX_LW_HIST_MAX; i++) {
+        const yuboxlorawan_histogram_data_t * h = _metrics.histogram((yuboxlorawan_histogram_t)i);
+
+        json.key(yuboxlorawan_histogram_names[i]);
+        json.beginObject();
+        json.key("le");
+        json.beginArray();
+        for (auto j = 0; j < YUBOX_LORAWAN_HIST_BUCKETS - 1; j++) json.valueUInt(yuboxlorawan_histogram_bounds[i][j]);
+        json.valueNull();
+        json.endArray();
+        json.key("buckets");
+        json.beginArray();
+        for (auto j = 0; j < YUBOX_LORAWAN_HIST_BUCKETS; j++) json.valueUInt(h->buckets[j]);
+        json.endArray();
+        json.fieldUInt("count", h->count);
+        json.fieldUInt64("sum", h->sum);
+        json.fieldUInt("max", h->max);
+        json.endObject();
+    }
+    json.endObject();
+    json.endObject();
+
+    if (json.overflow()) {
+        // Nunca se entrega un JSON truncado
+        log_e("Buffer de %u bytes insuficiente para JSON de métricas", sizeof(json_buf));
+        request->send(500, "application/json", "{\"success\":false,\"msg\":\"JSON de métricas excede el buffer\"}");
+        return;
+    }
+
+    AsyncResponseStream *response = request->beginResponseStream("application/json");
+    response->write((const uint8_t *)json.c_str(), json.length());
+    request->send(response);
+}
+
+void YuboxLoRaWANConfigClass::_routeHandler_yuboxAPI_lorawanmetrics_GET(AsyncWebServerRequest * request)
+{
+    YUBOX_RUN_AUTH(request);
+
+    // Formato de exposición de texto de Prometheus
+    AsyncResponseStream *response = request->beginResponseStream("text/plain; version=0.0.4");
+
+    for (auto i = 0; i < YBX_LW_MET_MAX; i++) {
+        response->printf("# TYPE yubox_lorawan_%s_total counter\n", yuboxlorawan_metric_names[i]);
+        response->printf("yubox_lorawan_%s_total %u\n", yuboxlorawan_metric_names[i], _metrics.get((yuboxlorawan_metric_t)i));
+    }
+    response->printf("# TYPE yubox_lorawan_fcnt_writes_total counter\nyubox_lorawan_fcnt_writes_total %u\n", _num_fcnt_writes);
+    response->printf("# TYPE yubox_lorawan_fcnt_writes_avoided_total counter\nyubox_lorawan_fcnt_writes_avoided_total %u\n", _num_fcnt_writes_avoided);
+    response->printf("# TYPE yubox_lorawan_txq_sent_total counter\nyubox_lorawan_txq_sent_total %u\n", _uplinkQueue.getNumSent());
+    response->printf("# TYPE yubox_lorawan_txq_dropped_total counter\nyubox_lorawan_txq_dropped_total %u\n", _uplinkQueue.getNumDropped());
+    response->printf("# TYPE yubox_lorawan_ev_dropped_total counter\nyubox_lorawan_ev_dropped_total %u\n", _radioEvents.getNumDropped());
+    response->printf("# TYPE yubox_lorawan_airtime_ms_total counter\nyubox_lorawan_airtime_ms_total %u\n", _dutyBudget.total());
+    response->printf("# TYPE yubox_lorawan_airtime_baseline_ms_total counter\nyubox_lorawan_airtime_baseline_ms_total %u\n", _airtime_baseline_ms);
+    response->printf("# TYPE yubox_lorawan_airtime_app_ms_total counter\nyubox_lorawan_airtime_app_ms_total %u\n", _airtime_app_ms);
+    response->printf("# TYPE yubox_lorawan_frag_tx_total counter\nyubox_lorawan_frag_tx_total %u\n", _num_frag_tx);
+    response->printf("# TYPE yubox_lorawan_frag_rx_total counter\nyubox_lorawan_frag_rx_total %u\n", _reassembler.getNumComplete());
+    response->printf("# TYPE yubox_lorawan_frag_rx_discarded_total counter\nyubox_lorawan_frag_rx_discarded_total %u\n", _reassembler.getNumDiscarded());
+    response->printf("# TYPE yubox_lorawan_log_written_total counter\nyubox_lorawan_log_written_total %u\n", _flashLog.getNumWritten());
+    response->printf("# TYPE yubox_lorawan_log_done_total counter\nyubox_lorawan_log_done_total %u\n", _flashLog.getNumDone());
+    response->printf("# TYPE yubox_lorawan_log_lost_total counter\nyubox_lorawan_log_lost_total %u\n", _flashLog.getNumLost());
+    response->printf("# TYPE yubox_lorawan_log_corrupt_total counter\nyubox_lorawan_log_corrupt_total %u\n", _flashLog.getNumCorrupt());
+    response->printf("# TYPE yubox_lorawan_log_mark_fail_total counter\nyubox_lorawan_log_mark_fail_total %u\n", _flashLog.getNumMarkFailures());
+    response->printf("# TYPE yubox_lorawan_txq_depth gauge\nyubox_lorawan_txq_depth %u\n", _uplinkQueue.depth());
+    response->printf("# TYPE yubox_lorawan_log_pending gauge\nyubox_lorawan_log_pending %u\n", _flashLog.getNumPending());
+
+    for (auto i = 0; i < YBX_LW_HIST_MAX; i++) {
+        const yuboxlorawan_histogram_data_t * h = _metrics.histogram((yuboxlorawan_histogram_t)i);
+        const char * name = yuboxlorawan_histogram_names[i];
+
+        // Prometheus espera cubetas acumulativas
+        uint32_t acc = 0;
+        response->printf("# TYPE yubox_lorawan_%s histogram\n", name);
+        for (auto j = 0; j < YUBOX_LORAWAN_HIST_BUCKETS - 1; j++) {
+            acc += h->buckets[j];
+            response->printf("yubox_lorawan_%s_bucket{le=\"%u\"} %u\n", name, yuboxlorawan_histogram_bounds[i][j], acc);
+        }
+        response->printf("yubox_lorawan_%s_bucket{le=\"+Inf\"} %u\n", name, h->count);
+        response->printf("yubox_lorawan_%s_sum %llu\n", name, (unsigned long long)h->sum);
+        response->printf("yubox_lorawan_%s_count %u\n", name, h->count);
+    }
 
-    serializeJson(json_doc, *response);
     request->send(response);
 }
 
@@ -499,6 +1316,13 @@ void YuboxLoRaWANConfigClass::_routeHandler_yuboxAPI_lorawanconfigjson_POST(Asyn
 
     uint8_t n_region = (uint8_t)_lw_region;
     uint8_t n_subband = _lw_subband;
+    uint8_t n_subband_scan = _lw_subband_scan ? 1 : 0;
+    uint8_t n_devclass = (uint8_t)_lw_devclass;
+    uint8_t n_adr = _lw_adr ? 1 : 0;
+    int8_t n_datarate = _lw_datarate;
+    int8_t n_txpower = _lw_txpower;
+    uint8_t n_join_trials = _lw_jointrials;
+    uint8_t n_dr_policy = _lw_dr_policy ? 1 : 0;
     uint8_t n_deviceEUI[8];
     uint8_t n_appEUI[8];
     uint8_t n_appKey[16];
@@ -518,6 +1342,48 @@ void YuboxLoRaWANConfigClass::_routeHandler_yuboxAPI_lorawanconfigjson_POST(Asyn
         responseMsg = "Sub-banda no está en rango requerido para región";
     }
 
+    YBX_ASSIGN_NUM_FROM_POST(subband_scan, "Búsqueda de sub-banda", "%hhu", YBX_POST_VAR_NONEMPTY, n_subband_scan)
+    if (!clientError && n_subband_scan > 1) {
+        clientError = true;
+        responseMsg = "Búsqueda de sub-banda debe ser 0 o 1";
+    }
+
+    YBX_ASSIGN_NUM_FROM_POST(devclass, "Clase de dispositivo", "%hhu", YBX_POST_VAR_NONEMPTY, n_devclass)
+    if (!clientError && n_devclass != CLASS_A && n_devclass != CLASS_C) {
+        clientError = true;
+        responseMsg = "Clase de dispositivo debe ser 0 (A) o 2 (C)";
+    }
+
+    YBX_ASSIGN_NUM_FROM_POST(adr, "ADR", "%hhu", YBX_POST_VAR_NONEMPTY, n_adr)
+    if (!clientError && n_adr > 1) {
+        clientError = true;
+        responseMsg = "ADR debe ser 0 o 1";
+    }
+
+    YBX_ASSIGN_NUM_FROM_POST(datarate, "Datarate inicial", "%hhd", YBX_POST_VAR_NONEMPTY, n_datarate)
+    if (!clientError && !_isValidUplinkDatarate((LoRaMacRegion_t)n_region, n_datarate)) {
+        clientError = true;
+        responseMsg = "Datarate inicial no es un datarate de uplink válido para región";
+    }
+
+    YBX_ASSIGN_NUM_FROM_POST(txpower, "Potencia de transmisión", "%hhd", YBX_POST_VAR_NONEMPTY, n_txpower)
+    if (!clientError && !(n_txpower >= 0 && n_txpower <= LORAWAN_TXPOWER_MAX_INDEX)) {
+        clientError = true;
+        responseMsg = "Índice de potencia de transmisión fuera de rango";
+    }
+
+    YBX_ASSIGN_NUM_FROM_POST(join_trials, "Intentos por join", "%hhu", YBX_POST_VAR_NONEMPTY, n_join_trials)
+    if (!clientError && !(n_join_trials >= 1 && n_join_trials <= LORAWAN_JOINREQ_MAX_TRIALS)) {
+        clientError = true;
+        responseMsg = "Intentos por join debe estar entre 1 y 48";
+    }
+
+    YBX_ASSIGN_NUM_FROM_POST(dr_policy, "Datarate según margen", "%hhu", YBX_POST_VAR_NONEMPTY, n_dr_policy)
+    if (!clientError && n_dr_policy > 1) {
+        clientError = true;
+        responseMsg = "Datarate según margen debe ser 0 o 1";
+    }
+
     String hexParam;
 #define LWPARAM_SCAN(P, R) \
     hexParam.clear();\
@@ -572,23 +1438,59 @@ void YuboxLoRaWANConfigClass::_routeHandler_yuboxAPI_lorawanconfigjson_POST(Asyn
 
         _tx_conf_num_retries = n_tx_conf_num_retries;
 
-        if (!paramIguales) serverError = !_saveCredentialsToNVRAM();
-        if (serverError) {
-            responseMsg = "No se pueden guardar valores LoRaWAN";
-        } else if (!setRequestedTXDutyCycle(n_tx_duty_sec)) {
-            serverError = true;
-            responseMsg = "No se puede guardar intervalo de transmisión deseado";
-        } else if (!_saveConfirmedTXRetries()) {
+        if (!paramIguales) {
+            // Cuando se guardan nuevas claves, se debe asumir que las claves de sesión se invalidan,
+            // y la sub-banda encontrada corresponde a la red anterior
+            _clearSessionKeys();
+            _lw_subband_cached = 0;
+        }
+
+        bool txdutyChanged = (n_tx_duty_sec != _tx_duty_sec);
+        _tx_duty_sec = n_tx_duty_sec;
+        _lw_subband_scan = (n_subband_scan != 0);
+
+        DeviceClass_t old_devclass = _lw_devclass;
+        _lw_devclass = (DeviceClass_t)n_devclass;
+
+        bool txparamsChanged = ((n_adr != 0) != _lw_adr || n_datarate != _lw_datarate
+            || n_txpower != _lw_txpower || (n_dr_policy != 0) != _lw_dr_policy);
+
+        // La MAC recibe los intentos por join sólo en lmh_init()
+        bool jointrialsChanged = (n_join_trials != _lw_jointrials);
+        bool old_adr = _lw_adr, old_dr_policy = _lw_dr_policy;
+        int8_t old_datarate = _lw_datarate, old_txpower = _lw_txpower;
+        uint8_t old_jointrials = _lw_jointrials;
+        _lw_adr = (n_adr != 0);
+        _lw_datarate = n_datarate;
+        _lw_txpower = n_txpower;
+        _lw_jointrials = n_join_trials;
+        _lw_dr_policy = (n_dr_policy != 0);
+
+        // Todos los parámetros se guardan en una sola escritura
+        bool confExisted = _lw_confExists;
+        _lw_confExists = true;
+        if (!_saveStateToNVRAM()) {
+            _lw_confExists = confExisted;
+            _lw_devclass = old_devclass;
+            _lw_adr = old_adr;
+            _lw_datarate = old_datarate;
+            _lw_txpower = old_txpower;
+            _lw_jointrials = old_jointrials;
+            _lw_dr_policy = old_dr_policy;
             serverError = true;
-            responseMsg = "No se puede guardar reintentos de transmisión confirmada";
+            responseMsg = "No se pueden guardar valores LoRaWAN";
         } else {
-            if (_lw_confExists && paramIguales) {
+            if (txdutyChanged) _tx_duty_sec_changed = true;
+            if (_lw_devclass != _lw_devclass_active) _devclass_apply = true;
+            if (txparamsChanged) _txparams_apply = true;
+            if (confExisted && paramIguales && !(txparamsChanged && !_lw_adr)
+                && !(jointrialsChanged && !isJoined())) {
                 log_d("Parámetros de red no han cambiado, se omite reinicialización");
             } else {
                 log_d("Parámetros de red han cambiado, se requiere inicialización");
                 _lw_needsInit = true;
+                _rtc_restore_pending = false;
             }
-            _lw_confExists = true;
         }
     }
 
@@ -619,87 +1521,244 @@ void YuboxLoRaWANConfigClass::_routeHandler_yuboxAPI_lorawanresetconn_POST(Async
     YBX_STD_RESPONSE
 }
 
-String YuboxLoRaWANConfigClass::_bin2str(uint8_t * p, size_t n)
+bool YuboxLoRaWANConfigClass::_str2bin(const char * s, uint8_t * p, size_t n)
+{
+    return yuboxlorawan_hex2bin(s, p, n);
+}
+
+void YuboxLoRaWANConfigClass::_saveSubBandCached(void)
 {
-    String s = "";
+    if (!_lw_subband_scan || _lw_subband_active == _lw_subband_cached) return;
 
-    while (n > 0) {
-        char buf[4];
-        sprintf(buf, "%02x", *p);
-        s += buf;
-        n--; p++;
+    uint8_t old_cached = _lw_subband_cached;
+    _lw_subband_cached = _lw_subband_active;
+    if (_saveStateToNVRAM()) {
+        log_i("Sub-banda %u guardada para próximos intentos de join", _lw_subband_active);
+    } else {
+        _lw_subband_cached = old_cached;
     }
+}
+
+void YuboxLoRaWANConfigClass::_rotateSubBand(void)
+{
+    if (!_lw_subband_scan || !_lw_useOTAA) return;
 
-    return s;
+    uint8_t max_sb = _getMaxLoRaWANRegionSubchannel(_lw_region);
+    if (max_sb <= 1) return;
+
+    uint8_t next_sb = (_lw_subband_active % max_sb) + 1;
+    if (!lmh_setSubBandChannels(next_sb)) {
+        log_e("lmh_setSubBandChannels(%d) failed, se mantiene sub-banda %d", next_sb, _lw_subband_active);
+        return;
+    }
+    log_i("Búsqueda de sub-banda: se cambia de sub-banda %d a %d", _lw_subband_active, next_sb);
+    _lw_subband_active = next_sb;
 }
 
-bool YuboxLoRaWANConfigClass::_str2bin(const char * s, uint8_t * p, size_t n)
+bool YuboxLoRaWANConfigClass::setRequestedTXDutyCycle(uint32_t n_txduty)
 {
-    while (n > 0) {
-        char buf[4];
-        unsigned int x;
+    if (n_txduty <= 0) return false;
+    if (n_txduty != _tx_duty_sec) {
+        uint32_t old_txduty = _tx_duty_sec;
 
-        if (s[0] == '\0') return false; buf[0] = s[0];
-        if (s[1] == '\0') return false; buf[1] = s[1];
-        buf[2] = '\0';
-        if (sscanf(buf, "%x", &x) < 1) return false;
-        *p = (uint8_t)x;
+        _tx_duty_sec = n_txduty;
+        if (!_saveStateToNVRAM()) {
+            _tx_duty_sec = old_txduty;
+            return false;
+        }
+        _tx_duty_sec_changed = true;
+    }
+    return true;
+}
 
-        n--; p++; s += 2;
+bool YuboxLoRaWANConfigClass::setDeviceClass(DeviceClass_t c)
+{
+    if (c != CLASS_A && c != CLASS_C) return false;
+    if (c != _lw_devclass) {
+        DeviceClass_t old_devclass = _lw_devclass;
+
+        _lw_devclass = c;
+        if (!_saveStateToNVRAM()) {
+            _lw_devclass = old_devclass;
+            return false;
+        }
     }
+    if (_lw_devclass != _lw_devclass_active) _devclass_apply = true;
     return true;
 }
 
-bool YuboxLoRaWANConfigClass::_saveCredentialsToNVRAM(void)
+bool YuboxLoRaWANConfigClass::setTXParams(bool adr, int8_t datarate, int8_t txpower)
 {
-    bool ok = true;
-    Preferences nvram;
-    nvram.begin(_ns_nvram_yuboxframework_lorawan, false);
+    if (!_isValidUplinkDatarate(_lw_region, datarate)) return false;
+    if (txpower < 0 || txpower > LORAWAN_TXPOWER_MAX_INDEX) return false;
+    if (adr == _lw_adr && datarate == _lw_datarate && txpower == _lw_txpower) return true;
+
+    bool old_adr = _lw_adr;
+    int8_t old_datarate = _lw_datarate;
+    int8_t old_txpower = _lw_txpower;
+
+    _lw_adr = adr;
+    _lw_datarate = datarate;
+    _lw_txpower = txpower;
+    if (!_saveStateToNVRAM()) {
+        _lw_adr = old_adr;
+        _lw_datarate = old_datarate;
+        _lw_txpower = old_txpower;
+        return false;
+    }
+
+    // Sin ADR, lmh_send() usa el datarate indicado a lmh_init()
+    if (_lw_adr) {
+        _txparams_apply = true;
+    } else {
+        _lw_needsInit = true;
+        _rtc_restore_pending = false;
+    }
+    return true;
+}
 
-    if (ok && !nvram.putUChar("region", (uint8_t)_lw_region)) ok = false;
-    if (ok && !nvram.putUChar("subband", _lw_subband)) ok = false;
-    if (ok && !nvram.putBytes("devEUI", _lw_devEUI, sizeof(_lw_devEUI))) ok = false;
-    if (ok && !nvram.putBytes("appEUI", _lw_appEUI, sizeof(_lw_appEUI))) ok = false;
-    if (ok && !nvram.putBytes("appKey", _lw_appKey, sizeof(_lw_appKey))) ok = false;
+bool YuboxLoRaWANConfigClass::setJoinTrials(uint8_t n)
+{
+    if (n < 1 || n > LORAWAN_JOINREQ_MAX_TRIALS) return false;
+    if (n == _lw_jointrials) return true;
 
-    // Cuando se guardan nuevas claves, se debe asumir que las claves de sesión se invalidan
-    _destroySessionKeys(nvram);
+    uint8_t old_jointrials = _lw_jointrials;
+    _lw_jointrials = n;
+    if (!_saveStateToNVRAM()) {
+        _lw_jointrials = old_jointrials;
+        return false;
+    }
 
-    nvram.end();
-    return ok;
+    // Sin sesión se reinicializa para que el siguiente intento use el valor
+    // nuevo; con sesión, se aplica en el próximo join, que pasa por lmh_init()
+    if (!isJoined()) {
+        _lw_needsInit = true;
+        _rtc_restore_pending = false;
+    }
+    return true;
 }
 
-bool YuboxLoRaWANConfigClass::_saveConfirmedTXRetries(void)
+bool YuboxLoRaWANConfigClass::setDatarateFromMargin(bool on)
 {
-    bool ok = true;
-    Preferences nvram;
-    nvram.begin(_ns_nvram_yuboxframework_lorawan, false);
+    if (on == _lw_dr_policy) return true;
 
-    if (_tx_conf_display) {
-        if (ok && !nvram.putUInt("txconfretries", _tx_conf_num_retries)) ok = false;
+    _lw_dr_policy = on;
+    if (!_saveStateToNVRAM()) {
+        _lw_dr_policy = !on;
+        return false;
     }
+    if (_lw_adr) {
+        _txparams_apply = true;
+    } else {
+        _lw_needsInit = true;
+        _rtc_restore_pending = false;
+    }
+    return true;
+}
 
-    nvram.end();
-    return ok;
+bool YuboxLoRaWANConfigClass::_isValidUplinkDatarate(LoRaMacRegion_t region, int8_t dr)
+{
+    // Los datarates desde DR8 son sólo de downlink en las regiones que los definen
+    if (dr < 0 || dr >= 8) return false;
+    return yuboxlorawan_dr_tables[_getLoRaWANRegionDRTable(region)][dr].bw_khz != 0;
 }
 
-bool YuboxLoRaWANConfigClass::setRequestedTXDutyCycle(uint32_t n_txduty)
+int8_t YuboxLoRaWANConfigClass::_getStartingDatarate(void)
 {
-    if (n_txduty <= 0) return false;
-    if (n_txduty != _tx_duty_sec) {
-        Preferences nvram;
-        nvram.begin(_ns_nvram_yuboxframework_lorawan, false);
+    int16_t rssi_avg, snr_avg;
+
+    if (!_lw_dr_policy || !_linkStats.mean(rssi_avg, snr_avg)) return _lw_datarate;
+
+    /* El SNR mínimo de demodulación LoRa es -20 dB en SF12 y sube 2.5 dB por
+     * cada SF menor. Se asume que el enlace es recíproco, así que el SNR de los
+     * downlinks estima el SNR de los uplinks en el gateway. Sólo se consideran
+     * los datarates de 125 kHz, que comparten el piso de ruido medido. */
+    const yuboxlorawan_dr_mod_t * t = yuboxlorawan_dr_tables[_getLoRaWANRegionDRTable(_lw_region)];
+    int8_t dr = _lw_datarate;
+    for (int8_t d = 7; d > _lw_datarate; d--) {
+        if (t[d].sf == 0 || t[d].bw_khz != 125) continue;
+
+        int32_t req_x10 = -200 + 25 * (12 - (int32_t)t[d].sf) + 10 * LORAWAN_DR_POLICY_MARGIN_DB;
+        if (10 * (int32_t)snr_avg >= req_x10) {
+            dr = d;
+            break;
+        }
+    }
 
-        if (!nvram.putUInt("txduty", n_txduty)) return false;
+    return dr;
+}
 
-        _tx_duty_sec = n_txduty;
-        _tx_duty_sec_changed = true;
+void YuboxLoRaWANConfigClass::_setStartingDatarate(void)
+{
+    // Se cuenta la subida sólo aquí, donde el datarate se entrega a la MAC
+    _lw_datarate_start = _getStartingDatarate();
+    if (_lw_datarate_start != _lw_datarate) {
+        log_d("SNR promedio permite iniciar en DR%d en lugar de DR%d", _lw_datarate_start, _lw_datarate);
+        _metrics.inc(YBX_LW_MET_DR_POLICY_RAISE);
     }
-    return true;
+}
+
+void YuboxLoRaWANConfigClass::_applyTXParams(void)
+{
+    MibRequestConfirm_t mibReq;
+
+    _txparams_apply = false;
+    _setStartingDatarate();
+
+    memset(&mibReq, 0, sizeof(MibRequestConfirm_t));
+    mibReq.Type = MIB_ADR;
+    mibReq.Param.AdrEnable = _lw_adr;
+    LoRaMacMibSetRequestConfirm(&mibReq);
+
+    // Con ADR activo la MAC parte de este datarate, sin ADR lmh_send() lo impone
+    memset(&mibReq, 0, sizeof(MibRequestConfirm_t));
+    mibReq.Type = MIB_CHANNELS_DATARATE;
+    mibReq.Param.ChannelsDatarate = _lw_datarate_start;
+    if (LoRaMacMibSetRequestConfirm(&mibReq) != LORAMAC_STATUS_OK) {
+        log_w("No se puede fijar datarate DR%d", _lw_datarate_start);
+    }
+
+    memset(&mibReq, 0, sizeof(MibRequestConfirm_t));
+    mibReq.Type = MIB_CHANNELS_TX_POWER;
+    mibReq.Param.ChannelsTxPower = _lw_txpower;
+    if (LoRaMacMibSetRequestConfirm(&mibReq) != LORAMAC_STATUS_OK) {
+        log_w("No se puede fijar potencia de transmisión TX_POWER_%d", _lw_txpower);
+    }
+
+    log_d("Parámetros de TX: ADR %s, DR%d, TX_POWER_%d", _lw_adr ? "SÍ" : "NO", _lw_datarate_start, _lw_txpower);
+}
+
+void YuboxLoRaWANConfigClass::_applyDeviceClass(void)
+{
+    _devclass_apply = false;
+    if (!isJoined() || _lw_devclass == _lw_devclass_active) return;
+
+    log_i("Solicitando cambio a clase %c...", "ABC"[_lw_devclass]);
+    if (lmh_class_request(_lw_devclass) != LMH_SUCCESS) {
+        log_e("lmh_class_request(%c) failed", "ABC"[_lw_devclass]);
+    }
+}
+
+void YuboxLoRaWANConfigClass::_class_handler(DeviceClass_t c)
+{
+    _lw_devclass_active = c;
+
+    // Un cambio ordenado por la red se conserva también luego del siguiente join
+    if (c != _lw_devclass && (c == CLASS_A || c == CLASS_C)) {
+        DeviceClass_t old_devclass = _lw_devclass;
+
+        log_i("Red cambió clase de dispositivo a %c, se guarda", "ABC"[c]);
+        _lw_devclass = c;
+        if (!_saveStateToNVRAM()) _lw_devclass = old_devclass;
+    }
+
+    _sendActivityEventJSON();
 }
 
 void YuboxLoRaWANConfigClass::update(void)
 {
+    _flashLog.update(millis());
+
     if (!_lw_confExists) return;
 
     if (_tx_duty_sec_changed) {
@@ -709,10 +1768,23 @@ void YuboxLoRaWANConfigClass::update(void)
 
     if (!_lorahw_init) return;
 
+    // Eventos de sesión anterior se procesan antes de una posible reinicialización
+    _consumerTask = xTaskGetCurrentTaskHandle();
+    _processRadioEvents();
+    if (_devclass_switched >= 0) {
+        DeviceClass_t c = (DeviceClass_t)_devclass_switched;
+        _devclass_switched = -1;
+        _class_handler(c);
+    }
+    if (_devclass_apply && !_lw_needsInit) _applyDeviceClass();
+    if (_txparams_apply && !_lw_needsInit && isJoined()) _applyTXParams();
+
     if (_lw_needsInit) {
         _lw_needsInit = false;
-        _tx_waiting_confirm = false;
-        _ts_confirmTX_start = 0;
+        _resetJoinRetry();
+
+        // Un uplink confirmado en curso no sobrevive a la nueva sesión
+        if (_tx_waiting_confirm) _finishConfirm(false);
         _num_confirmTX_OK = 0;
         _num_confirmTX_FAIL = 0;
         _ts_lastDownlinkActivity = 0;
@@ -725,51 +1797,269 @@ void YuboxLoRaWANConfigClass::update(void)
         lmh_setAppSKey(_lw_AppSKey);
         lmh_setDevAddr(_lw_DevAddr);
 
+        _setStartingDatarate();
         lmh_param_t lora_param_init = {
-            LORAWAN_ADR_ON,
-            LORAWAN_DEFAULT_DATARATE,
+            _lw_adr,
+            _lw_datarate_start,
             LORAWAN_PUBLIC_NETWORK,
             //LORAWAN_PRIVAT_NETWORK,
-            JOINREQ_NBTRIALS,
-            LORAWAN_DEFAULT_TX_POWER,
+            _lw_jointrials,
+            _lw_txpower,
             LORAWAN_DUTYCYCLE_OFF
         };
 
+        // El historial de tiempo en aire se conserva entre sesiones de la misma región
+        if (!_duty_custom && _dutyBudget.getLimitPermille() != _getLoRaWANRegionDutyPermille(_lw_region)) {
+            _dutyBudget.configure(_getLoRaWANRegionDutyPermille(_lw_region), 1000UL * LORAWAN_DUTY_DEFAULT_WINDOW_SEC);
+        }
+
+        if (_rtc_restore_pending) {
+            // Sesión reanudada: se continúa con el datarate y sub-banda previos
+            lora_param_init.adr_enable = _rtcResume.adr ? LORAWAN_ADR_ON : LORAWAN_ADR_OFF;
+            lora_param_init.tx_data_rate = _rtcResume.datarate;
+            lora_param_init.tx_power = _rtcResume.txpower;
+        } else {
+            // Con búsqueda de sub-banda, se empieza por la última que funcionó
+            _lw_subband_active = (_lw_subband_scan && _lw_subband_cached != 0) ? _lw_subband_cached : _lw_subband;
+        }
+
         log_d("Para esta unión a la red LoRaWAN %s se usará OTAA...", _lw_useOTAA ? "SÍ" : "NO");
+        _activeInstance = this;
+        _devclass_switched = -1;
+        _lw_devclass_active = CLASS_A;
         uint32_t err_code = lmh_init(&_lora_callbacks, lora_param_init, _lw_useOTAA, CLASS_A, _lw_region);
         if (err_code != 0) {
             log_e("lmh_init failed - %d", err_code);
             _joinfail_handler();
-        } else if (!lmh_setSubBandChannels(_lw_subband)) {
-            log_e("lmh_setSubBandChannels(%d) failed. Wrong sub band requested?", _lw_subband);
+        } else if (!lmh_setSubBandChannels(_lw_subband_active)) {
+            log_e("lmh_setSubBandChannels(%d) failed. Wrong sub band requested?", _lw_subband_active);
             _joinfail_handler();
         } else {
             log_i("Starting join LoRaWAN network (region %s subband %d)...",
-                _getLoRaWANRegionName(_lw_region), _lw_subband);
+                _getLoRaWANRegionName(_lw_region), _lw_subband_active);
             lmh_join();
             _joinstart_handler();
         }
+
+        _flushActivityEventJSON();
     } else {
         // En versión 2.0.0+ el proceso de IRQ se mueve a tarea separada
         //Radio.IrqProcess();
+
+        // Contadores pendientes de escribir por tiempo transcurrido
+        if (_fcnt_commit_maxsec > 0 && _frameCountersPending()
+            && millis() - _ts_fcnt_lastCommit >= 1000 * _fcnt_commit_maxsec
+            && lmh_join_status_get() == LMH_SET) {
+            _saveFrameCounters();
+        }
+
+        // Reintento de join programado luego de fallo
+        if (_join_retry_pending && millis() - _ts_join_retry_start >= _join_retry_delay) {
+            _join_retry_pending = false;
+            log_i("Reintentando join LoRaWAN (intento %u)...", _join_attempt + 1);
+            lmh_join();
+            _joinstart_handler();
+        }
+
+        if (_reassembler.expire(millis())) {
+            log_w("Tiempo agotado para reensamblar mensaje fragmentado, se descarta");
+        }
+
+        if (_confirm_retry_pending && millis() - _ts_confirm_retry_start >= _confirm_retry_delay) {
+            _retryConfirmed();
+        }
+
+        _drainUplinkQueue();
+        _replayFlashLog();
+        _flushActivityEventJSON();
+    }
+}
+
+uint32_t YuboxLoRaWANConfigClass::_backoffRandom(void)
+{
+    // xorshift32, suficiente para dispersar reintentos
+    uint32_t x = _backoff_rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    _backoff_rng = x;
+    return x;
+}
+
+void YuboxLoRaWANConfigClass::_resetJoinRetry(void)
+{
+    _join_attempt = 0;
+    _join_retry_pending = false;
+    _ts_join_retry_start = 0;
+    _join_retry_delay = 0;
+}
+
+void YuboxLoRaWANConfigClass::_scheduleJoinRetry(void)
+{
+    _join_attempt++;
+    if (_join_retry_budget > 0 && _join_attempt >= _join_retry_budget) {
+        log_e("Join LoRaWAN falló %u veces, se abandonan reintentos", _join_attempt);
+        _join_retry_pending = false;
+        return;
+    }
+
+    // Espera base duplicada por cada fallo, con saturación en el máximo
+    uint32_t d = _join_backoff_base_ms;
+    for (uint32_t i = 1; i < _join_attempt && d < _join_backoff_max_ms; i++) {
+        d = (d > _join_backoff_max_ms / 2) ? _join_backoff_max_ms : (d << 1);
+    }
+    if (d > _join_backoff_max_ms) d = _join_backoff_max_ms;
+
+    // Variación aleatoria uniforme en [d/2, d]
+    if (d > 1) d = d / 2 + _backoffRandom() % (d / 2 + 1);
+
+    _join_retry_pending = true;
+    _ts_join_retry_start = millis();
+    _join_retry_delay = d;
+    log_w("Join LoRaWAN falló (%u fallos consecutivos), reintento en %u ms", _join_attempt, d);
+}
+
+bool YuboxLoRaWANConfigClass::setJoinBackoff(uint32_t base_ms, uint32_t max_ms, uint32_t budget)
+{
+    if (max_ms < base_ms) return false;
+
+    _join_backoff_base_ms = base_ms;
+    _join_backoff_max_ms = max_ms;
+    _join_retry_budget = budget;
+    return true;
+}
+
+void YuboxLoRaWANConfigClass::restartJoin(void)
+{
+    if (!_lorahw_init || _lw_needsInit) return;
+    if (lmh_join_status_get() == LMH_SET) return;
+
+    _join_attempt = 0;
+    _join_retry_pending = true;
+    _ts_join_retry_start = millis();
+    _join_retry_delay = 0;
+    _sendActivityEventJSON();
+}
+
+bool YuboxLoRaWANConfigClass::_postRadioEvent(yuboxlorawan_radio_event_type_t t, bool result, uint8_t port, uint8_t * p, uint8_t n, int16_t rssi, int8_t snr)
+{
+    if ((t == YBX_LW_RADIO_JOINED || t == YBX_LW_RADIO_JOINFAIL)
+        && _consumerTask != NULL && xTaskGetCurrentTaskHandle() == _consumerTask) {
+        _localEvents |= (1 << t);
+        return true;
+    }
+
+    yuboxlorawan_radio_event_t * ev = _radioEvents.reserve();
+    if (ev == NULL) return false;
+
+    if (p == NULL || n > sizeof(ev->payload)) n = 0;
+
+    ev->type = t;
+    ev->result = result;
+    ev->port = port;
+    ev->len = n;
+    ev->rssi = rssi;
+    ev->snr = snr;
+    ev->ts = micros();
+    if (n > 0) memcpy(ev->payload, p, n);
+    _radioEvents.commit();
+    return true;
+}
+
+void YuboxLoRaWANConfigClass::_processRadioEvents(void)
+{
+    yuboxlorawan_radio_event_t * ev;
+
+    while (NULL != (ev = _radioEvents.peek())) {
+        switch (ev->type) {
+        case YBX_LW_RADIO_JOINED:
+            _join_handler();
+            break;
+        case YBX_LW_RADIO_JOINFAIL:
+            _joinfail_handler();
+            if (!_lw_needsInit) {
+                _rotateSubBand();
+                _scheduleJoinRetry();
+            }
+            break;
+        case YBX_LW_RADIO_RX:
+            _metrics.record((_lw_devclass_active == CLASS_C) ? YBX_LW_HIST_RX_DISPATCH_C_US : YBX_LW_HIST_RX_DISPATCH_A_US,
+                micros() - ev->ts);
+            _rx_handler(ev->port, ev->payload, ev->len, ev->rssi, ev->snr);
+            break;
+        case YBX_LW_RADIO_TX_CONFIRM:
+            _tx_confirmed_result(ev->result);
+            break;
+        }
+        _radioEvents.release();
+    }
+
+    // Eventos publicados desde la propia tarea de update(), luego del anillo
+    uint8_t local = _localEvents;
+    _localEvents = 0;
+    if (local & (1 << YBX_LW_RADIO_JOINED)) _join_handler();
+    if (local & (1 << YBX_LW_RADIO_JOINFAIL)) {
+        _joinfail_handler();
+        if (!_lw_needsInit) {
+            _rotateSubBand();
+            _scheduleJoinRetry();
+        }
     }
 }
 
 void YuboxLoRaWANConfigClass::_sendActivityEventJSON(void)
 {
-    if (_pEvents != NULL && _pEvents->count() > 0) {
-        String json_str = _reportActivityJSON();
-        _pEvents->send(json_str.c_str());
+    // El envío efectivo ocurre en update() vía _flushActivityEventJSON()
+    _status_dirty = true;
+}
+
+void YuboxLoRaWANConfigClass::_flushActivityEventJSON(void)
+{
+    if (!_status_dirty) return;
+    if (_pEvents == NULL || _pEvents->count() <= 0) {
+        // Al conectarse un cliente nuevo se le envía el estado completo
+        _status_dirty = false;
+        _ts_status_lastFull = 0;
+        return;
     }
+
+    uint32_t t = millis();
+    if (_ts_status_lastSent != 0 && t - _ts_status_lastSent < _status_min_interval_ms) return;
+
+    // Si los clientes no consumen los eventos anteriores, se sigue agrupando
+    if (_pEvents->avgPacketsWaiting() > LORAWAN_STATUS_MAX_QUEUED) return;
+
+    uint32_t v[YBX_LW_ST_MAX];
+    _collectActivityStatus(v);
+
+    /* Un cliente lento puede perder eventos delta si se llena su cola interna,
+     * así que periódicamente se envía el estado completo para resincronizar. */
+    bool full = (_ts_status_lastFull == 0 || t - _ts_status_lastFull >= LORAWAN_STATUS_FULL_INTERVAL_MS);
+    if (!full && 0 == memcmp(v, _statusSent, sizeof(v))) {
+        _status_dirty = false;
+        return;
+    }
+
+    char json_buf[LORAWAN_STATUS_JSON_LEN];
+    _reportActivityJSON(json_buf, sizeof(json_buf), v, full ? NULL : _statusSent);
+    _pEvents->send(json_buf);
+
+    memcpy(_statusSent, v, sizeof(v));
+    _ts_status_lastSent = t;
+    if (full) _ts_status_lastFull = t;
+    _status_dirty = false;
 }
 
 void YuboxLoRaWANConfigClass::_joinstart_handler(void)
 {
+    _metrics.inc(YBX_LW_MET_JOIN_ATTEMPTS);
+    _ts_join_start = millis();
     _sendActivityEventJSON();
 }
 
 void YuboxLoRaWANConfigClass::_joinfail_handler(void)
 {
+    _metrics.inc(YBX_LW_MET_JOIN_FAIL);
     _sendActivityEventJSON();
 }
 
@@ -778,27 +2068,267 @@ bool YuboxLoRaWANConfigClass::isJoined(void)
     return (_lorahw_init && (LMH_SET == lmh_join_status_get()));
 }
 
-bool YuboxLoRaWANConfigClass::send(uint8_t * p, uint8_t n, bool is_txconfirmed)
+bool YuboxLoRaWANConfigClass::send(uint8_t * p, uint8_t n, bool is_txconfirmed, uint8_t port)
+{
+    if (!_lorahw_init) return false;
+    if (!_lw_confExists || _lw_needsInit) return false;
+    if (!LORAWAN_PORT_IS_USER(port)) return false;
+
+    if (lmh_join_status_get() != LMH_SET) return false;
+    if (!_dutyAllows(n)) return false;
+
+    return (_sendFrame(p, n, is_txconfirmed, port) == LMH_SUCCESS);
+}
+
+bool YuboxLoRaWANConfigClass::send(const yuboxlorawan_segment_t * segs, size_t nsegs, bool is_txconfirmed, uint8_t port)
 {
     if (!_lorahw_init) return false;
     if (!_lw_confExists || _lw_needsInit) return false;
+    if (!LORAWAN_PORT_IS_USER(port)) return false;
 
     if (lmh_join_status_get() != LMH_SET) return false;
 
+    size_t n = yuboxlorawan_segments_len(segs, nsegs);
+    uint8_t maxlen = getMaxPayloadSize();
+    if (n > maxlen) {
+        log_w("Payload de %u bytes excede máximo de %u bytes para datarate actual", n, maxlen);
+        return false;
+    }
+    if (!_dutyAllows((uint8_t)n)) return false;
+
+    n = yuboxlorawan_segments_gather(_txBuffer, segs, nsegs);
+    return (_sendFrame(_txBuffer, (uint8_t)n, is_txconfirmed, port) == LMH_SUCCESS);
+}
+
+int8_t YuboxLoRaWANConfigClass::_getCurrentDatarate(void)
+{
+    MibRequestConfirm_t mibReq;
+
+    memset(&mibReq, 0, sizeof(MibRequestConfirm_t));
+    mibReq.Type = MIB_CHANNELS_DATARATE;
+    LoRaMacMibGetRequestConfirm(&mibReq);
+    return mibReq.Param.ChannelsDatarate;
+}
+
+uint32_t YuboxLoRaWANConfigClass::getTimeOnAir(uint8_t n)
+{
+    if (!_lorahw_init || lmh_join_status_get() != LMH_SET) return 0;
+
+    int8_t dr = _getCurrentDatarate();
+    if (dr < 0) return 0;
+    return (yuboxlorawan_airtime_us(_getLoRaWANRegionDRTable(_lw_region), dr, n) + 999) / 1000;
+}
+
+uint32_t YuboxLoRaWANConfigClass::getNextTXDelay(uint8_t n)
+{
+    return _dutyBudget.delayFor(millis(), getTimeOnAir(n));
+}
+
+bool YuboxLoRaWANConfigClass::_dutyAllows(uint8_t n)
+{
+    if (!_duty_enforce || !_dutyBudget.limited()) return true;
+
+    uint32_t wait = getNextTXDelay(n);
+    if (wait == 0) return true;
+    log_v("Uplink de %u bytes excede presupuesto de ciclo de trabajo, espera de %u ms", n, wait);
+    return false;
+}
+
+bool YuboxLoRaWANConfigClass::setDutyCycleLimit(uint32_t permille, uint32_t window_sec, bool enforce)
+{
+    if (permille > 1000 || window_sec < 1) return false;
+
+    _duty_custom = true;
+    _duty_enforce = enforce && (permille > 0);
+    if (permille != _dutyBudget.getLimitPermille() || 1000 * window_sec != _dutyBudget.getWindowMs()) {
+        _dutyBudget.configure(permille, 1000 * window_sec);
+    }
+    return true;
+}
+
+uint8_t YuboxLoRaWANConfigClass::getMaxPayloadSize(void)
+{
+    if (!_lorahw_init || lmh_join_status_get() != LMH_SET) return 0;
+
+    LoRaMacTxInfo_t txInfo;
+    memset(&txInfo, 0, sizeof(LoRaMacTxInfo_t));
+    LoRaMacQueryTxPossible(0, &txInfo);
+    return txInfo.MaxPossiblePayload;
+}
+
+bool YuboxLoRaWANConfigClass::enqueue(const yuboxlorawan_segment_t * segs, size_t nsegs, bool is_txconfirmed, yuboxlorawan_priority_t prio, uint8_t port)
+{
+    if (!LORAWAN_PORT_IS_USER(port)) return false;
+    if (!_uplinkQueue.push(prio, port, is_txconfirmed, segs, nsegs)) {
+        log_w("Cola de uplink llena o payload demasiado grande, se descarta mensaje");
+        return false;
+    }
+    return true;
+}
+
+bool YuboxLoRaWANConfigClass::enqueueLarge(const uint8_t * p, size_t n, bool is_txconfirmed, yuboxlorawan_priority_t prio, uint8_t port)
+{
+    if (!LORAWAN_PORT_IS_USER(port)) return false;
+    if (p == NULL && n > 0) return false;
+
+    /* Los fragmentos ya encolados no se rehacen si ADR baja el datarate. Antes
+     * del join no se conoce el datarate, y se usa el mínimo de la región. */
+    uint8_t maxlen = isJoined() ? getMaxPayloadSize() : _getLoRaWANRegionMinPayload(_lw_region);
+    if (_lw_adr && maxlen > _getLoRaWANRegionMinPayload(_lw_region)) maxlen = _getLoRaWANRegionMinPayload(_lw_region);
+    if (n <= maxlen) return enqueue((uint8_t *)p, (uint8_t)n, is_txconfirmed, prio, port);
+
+    uint8_t cnt = yuboxlorawan_frag_count(n, maxlen);
+    if (cnt == 0) {
+        log_w("Mensaje de %u bytes no puede fragmentarse con payload máximo de %u bytes", n, maxlen);
+        return false;
+    }
+    if (prio >= YBX_LW_PRIO_MAX) prio = YBX_LW_PRIO_NORMAL;
+    if (_uplinkQueue.available(prio) < cnt) {
+        log_w("Cola de uplink sin espacio para %u fragmentos, se descarta mensaje de %u bytes", cnt, n);
+        return false;
+    }
+
+    _frag_msgid++;
+    for (uint8_t i = 0; i < cnt; i++) {
+        yuboxlorawan_uplink_t * m = _uplinkQueue.reserve(prio, YUBOX_LORAWAN_FRAG_PORT, is_txconfirmed);
+        m->len = yuboxlorawan_frag_build(m->payload, _frag_msgid, i, cnt, port, p, n, maxlen);
+    }
+    _num_frag_tx++;
+    log_d("Mensaje de %u bytes encolado como %u fragmentos (ID %u)", n, cnt, _frag_msgid);
+    return true;
+}
+
+bool YuboxLoRaWANConfigClass::enqueue(uint8_t * p, uint8_t n, bool is_txconfirmed, yuboxlorawan_priority_t prio, uint8_t port)
+{
+    if (!LORAWAN_PORT_IS_USER(port)) return false;
+    if (!_uplinkQueue.push(prio, port, is_txconfirmed, p, n)) {
+        log_w("Cola de uplink llena o payload demasiado grande (%u bytes), se descarta mensaje", n);
+        return false;
+    }
+    return true;
+}
+
+bool YuboxLoRaWANConfigClass::enqueuePersistent(uint8_t * p, uint8_t n, bool is_txconfirmed, uint8_t port)
+{
+    if (!LORAWAN_PORT_IS_USER(port)) return false;
+    if (n > YUBOX_LORAWAN_MAX_PAYLOAD) return false;
+    if (!_flashLog.ready()) return enqueue(p, n, is_txconfirmed, YBX_LW_PRIO_NORMAL, port);
+
+    if (!_flashLog.append(port, is_txconfirmed, p, n, millis())) {
+        log_e("No se puede agregar uplink de %u bytes al log en flash", n);
+        return false;
+    }
+    return true;
+}
+
+void YuboxLoRaWANConfigClass::_drainUplinkQueue(void)
+{
+    if (_uplinkQueue.empty()) return;
+    if (!_lw_confExists || _lw_needsInit) return;
+    if (lmh_join_status_get() != LMH_SET) return;
+
+    // No se mezclan transmisiones mientras se espera confirmación de otra
+    if (_tx_waiting_confirm) return;
+
+    uint32_t t = millis();
+    if (_ts_uplinkQueue_lastTry != 0 && t - _ts_uplinkQueue_lastTry < LORAWAN_APP_UPLINK_QUEUE_RETRY_MS) return;
+    _ts_uplinkQueue_lastTry = t;
+
+    yuboxlorawan_uplink_t * m = _uplinkQueue.front();
+
+    // Un mensaje que ya no cabe (p.ej. luego de bajar datarate por ADR) bloquearía la cola
+    uint8_t maxlen = getMaxPayloadSize();
+    if (m->len > maxlen) {
+        log_w("Mensaje en cola de %u bytes excede máximo actual de %u bytes, se descarta", m->len, maxlen);
+        _uplinkQueue.drop();
+        return;
+    }
+
+    if (!_dutyAllows(m->len)) return;
+    if (_sendFrame(m->payload, m->len, m->confirmed, m->port, true) == LMH_SUCCESS) {
+        _uplinkQueue.pop();
+    } else if (++(m->attempts) >= LORAWAN_APP_UPLINK_QUEUE_MAX_ATTEMPTS) {
+        log_w("Mensaje en cola falló %u intentos de envío, se descarta", m->attempts);
+        _uplinkQueue.drop();
+    } else {
+        log_v("MAC ocupado o sin enlace, mensaje permanece en cola (%u pendientes)", _uplinkQueue.depth());
+    }
+}
+
+void YuboxLoRaWANConfigClass::_replayFlashLog(void)
+{
+    if (!_flashLog.ready() || _flashLog.getNumPending() == 0) return;
+    if (!_lw_confExists || _lw_needsInit) return;
+    if (lmh_join_status_get() != LMH_SET) return;
+
+    // La cola en RAM tiene precedencia, y un registro confirmado se reproduce
+    // sólo cuando el anterior ya tiene resultado
+    if (_log_inflight || _tx_waiting_confirm || !_uplinkQueue.empty()) return;
+
+    // Se comparte el espaciado de intentos con la cola en RAM
+    uint32_t t = millis();
+    if (_ts_uplinkQueue_lastTry != 0 && t - _ts_uplinkQueue_lastTry < LORAWAN_APP_UPLINK_QUEUE_RETRY_MS) return;
+    if (_ts_log_lastTry != 0 && t - _ts_log_lastTry < _log_retry_delay) return;
+    _ts_uplinkQueue_lastTry = t;
+    _ts_log_lastTry = t;
+    _log_retry_delay = LORAWAN_LOG_REPLAY_INTERVAL_MS;
+
+    yuboxlorawan_uplink_t m;
+    uint32_t seq;
+    if (!_flashLog.peek(m, seq)) return;
+
+    // Como en la cola en RAM, un registro que no cabe en el datarate actual no
+    // debe bloquear al resto del log: se pasa fragmentado a la cola en RAM, o
+    // se descarta si no puede fragmentarse
+    if (m.len > getMaxPayloadSize()) {
+        if (enqueueLarge(m.payload, m.len, m.confirmed, YBX_LW_PRIO_NORMAL, m.port)) {
+            log_w("Registro %u del log (%u bytes) excede payload máximo de %u bytes, se envía fragmentado",
+                seq, m.len, getMaxPayloadSize());
+            _flashLog.markDone(seq);
+        } else {
+            log_w("Registro %u del log (%u bytes) excede payload máximo de %u bytes, se descarta",
+                seq, m.len, getMaxPayloadSize());
+            _flashLog.markLost(seq);
+        }
+        return;
+    }
+    if (!_dutyAllows(m.len)) return;
+    if (_sendFrame(m.payload, m.len, m.confirmed, m.port, true) != LMH_SUCCESS) {
+        log_v("MAC ocupado o sin enlace, registro %u permanece en log (%u pendientes)", seq, _flashLog.getNumPending());
+        return;
+    }
+
+    if (m.confirmed) {
+        _log_inflight = true;
+        _log_inflight_seq = seq;
+    } else {
+        _flashLog.markDone(seq);
+    }
+}
+
+lmh_error_status YuboxLoRaWANConfigClass::_sendFrame(uint8_t * p, uint8_t n, bool is_txconfirmed, uint8_t port, bool queued)
+{
     if (p == NULL) n = 0;
-    lmh_app_data_t m_lora_app_data = {p, n, LORAWAN_APP_PORT, 0, 0};
+    lmh_app_data_t m_lora_app_data = {p, n, port, 0, 0};
+
+    // El datarate puede cambiar por ADR luego del envío
+    uint32_t airtime = getTimeOnAir(n);
 
+    uint32_t t_send = micros();
     lmh_error_status main_err = lmh_send(&m_lora_app_data, is_txconfirmed ? LMH_CONFIRMED_MSG : LMH_UNCONFIRMED_MSG);
+    _metrics.record(YBX_LW_HIST_SEND_US, micros() - t_send);
 
     _saveFrameCounters();
 
     if (main_err != LMH_SUCCESS) {
         uint32_t t = millis();
+        _metrics.inc(YBX_LW_MET_TX_FAIL);
         _ts_ultimoTX_FAIL = t;
-        if (_ts_errorAfterJoin == 0) _ts_errorAfterJoin = t;
+        if (!queued && _ts_errorAfterJoin == 0) _ts_errorAfterJoin = t;
 
-        if (t - _ts_errorAfterJoin >= 90 * 1000) {
+        if (!queued && t - _ts_errorAfterJoin >= 90 * 1000) {
             log_w("No hay transmisión exitosa luego de timeout, se reintenta join...");
+            _metrics.inc(YBX_LW_MET_REJOIN_TIMEOUT);
             _ts_errorAfterJoin = 0;
             _lw_needsInit = true;
 
@@ -816,12 +2346,40 @@ bool YuboxLoRaWANConfigClass::send(uint8_t * p, uint8_t n, bool is_txconfirmed)
             m_lora_app_data.port = LORAWAN_APP_PORT;
             m_lora_app_data.buffsize = 0;
             lmh_error_status recv_err = lmh_send(&m_lora_app_data, LMH_UNCONFIRMED_MSG);
+            _metrics.inc(YBX_LW_MET_TX_PROBE);
+            if (recv_err == LMH_SUCCESS) _dutyBudget.record(millis(), getTimeOnAir(0));
         }
     } else {
+        _metrics.inc(YBX_LW_MET_TX_OK);
         _ts_errorAfterJoin = 0;
         _ts_ultimoTX_OK = millis();
 
+        // millis() cuenta desde el arranque, incluyendo el despertar de sueño profundo
+        if (_ts_boot_tx == 0) {
+            _ts_boot_tx = _ts_ultimoTX_OK;
+            _metrics.record(YBX_LW_HIST_BOOT_TX_MS, _ts_boot_tx);
+        }
+
+        _last_airtime_ms = airtime;
+        _dutyBudget.record(_ts_ultimoTX_OK, airtime);
+        if (airtime > 0) {
+            _airtime_baseline_ms += (yuboxlorawan_airtime_us(_getLoRaWANRegionDRTable(_lw_region), _lw_datarate, n) + 999) / 1000;
+            _airtime_app_ms += airtime;
+        }
+
         if (is_txconfirmed) {
+            if (p != _confirmMsg.payload) {
+                // Un uplink confirmado nuevo reemplaza al que esperaba retransmisión
+                if (_tx_waiting_confirm) _finishConfirm(false);
+
+                _confirmMsg.port = port;
+                _confirmMsg.confirmed = true;
+                _confirmMsg.len = n;
+                if (n > 0) memcpy(_confirmMsg.payload, p, n);
+                _confirm_attempts = 0;
+            }
+            _confirm_attempts++;
+            _confirm_retry_pending = false;
             _tx_waiting_confirm = true;
             _ts_confirmTX_start = _ts_ultimoTX_OK;
         }
@@ -829,91 +2387,135 @@ bool YuboxLoRaWANConfigClass::send(uint8_t * p, uint8_t n, bool is_txconfirmed)
 
     _sendActivityEventJSON();
 
-    return (main_err == LMH_SUCCESS);
+    return main_err;
 }
 
 yuboxlorawan_event_id_t YuboxLoRaWANConfigClass::onJoin(YuboxLoRaWAN_join_func_cb cbJ)
 {
-  if (!cbJ) return 0;
-
-  YuboxLoRaWAN_rx_List_t n_evHandler;
-  n_evHandler.event_type = YBX_LW_NETJOIN;
-  //n_evHandler.j_cb = NULL;
-  n_evHandler.j_fcb = cbJ;
-  cbRXList.push_back(n_evHandler);
-  return n_evHandler.id;
+  return _cbJoinList.add(cbJ);
 }
 
 void YuboxLoRaWANConfigClass::removeJoin(yuboxlorawan_event_id_t id)
 {
-  for (auto i = 0; i < cbRXList.size(); i++) {
-    YuboxLoRaWAN_rx_List_t entry = cbRXList[i];
-    if (entry.event_type == YBX_LW_NETJOIN && entry.id == id) cbRXList.erase(cbRXList.begin() + i);
-  }
+  _cbJoinList.remove(id);
 }
 
 yuboxlorawan_event_id_t YuboxLoRaWANConfigClass::onRX(YuboxLoRaWAN_rx_func_cb cbRX)
+{
+  return onRX(LORAWAN_APP_PORT, cbRX);
+}
+
+yuboxlorawan_event_id_t YuboxLoRaWANConfigClass::onRX(uint8_t port, YuboxLoRaWAN_rx_func_cb cbRX)
 {
   if (!cbRX) return 0;
 
-  YuboxLoRaWAN_rx_List_t n_evHandler;
-  n_evHandler.event_type = YBX_LW_RX;
-  //n_evHandler.rx_cb = NULL;
-  n_evHandler.rx_fcb = cbRX;
-  cbRXList.push_back(n_evHandler);
-  return n_evHandler.id;
+  return onRX(port, port, [cbRX](uint8_t, uint8_t * p, size_t n) {
+    // Un mensaje reensamblado puede exceder la longitud que acepta el callback
+    if (n > 255) return;
+    cbRX(p, (uint8_t)n);
+  });
+}
+
+yuboxlorawan_event_id_t YuboxLoRaWANConfigClass::onRX(uint8_t port_min, uint8_t port_max, YuboxLoRaWAN_rxport_func_cb cbRX)
+{
+  if (port_min < LORAWAN_PORT_MIN) port_min = LORAWAN_PORT_MIN;
+  if (port_max > LORAWAN_PORT_MAX) port_max = LORAWAN_PORT_MAX;
+  if (port_min > port_max) return 0;
+  if (port_min == YUBOX_LORAWAN_FRAG_PORT && port_max == YUBOX_LORAWAN_FRAG_PORT) return 0;
+
+  yuboxlorawan_event_id_t id = _cbRXList.add(cbRX, (((uint16_t)port_min) << 8) | port_max);
+  _rebuildRXPortMap();
+  return id;
 }
 
 void YuboxLoRaWANConfigClass::removeRX(yuboxlorawan_event_id_t id)
 {
-  for (auto i = 0; i < cbRXList.size(); i++) {
-    YuboxLoRaWAN_rx_List_t entry = cbRXList[i];
-    if (entry.event_type == YBX_LW_RX && entry.id == id) cbRXList.erase(cbRXList.begin() + i);
-  }
+  _cbRXList.remove(id);
+  _rebuildRXPortMap();
 }
 
-yuboxlorawan_event_id_t YuboxLoRaWANConfigClass::onTXDuty(YuboxLoRaWAN_txdutychange_func_cb cb)
+yuboxlorawan_event_id_t YuboxLoRaWANConfigClass::onRXInfo(uint8_t port_min, uint8_t port_max, YuboxLoRaWAN_rxinfo_func_cb cbRX)
 {
-  if (!cb) return 0;
+  if (port_min < LORAWAN_PORT_MIN) port_min = LORAWAN_PORT_MIN;
+  if (port_max > LORAWAN_PORT_MAX) port_max = LORAWAN_PORT_MAX;
+  if (port_min > port_max) return 0;
+  if (port_min == YUBOX_LORAWAN_FRAG_PORT && port_max == YUBOX_LORAWAN_FRAG_PORT) return 0;
+
+  yuboxlorawan_event_id_t id = _cbRXInfoList.add(cbRX, (((uint16_t)port_min) << 8) | port_max);
+  _rebuildRXPortMap();
+  return id;
+}
+
+void YuboxLoRaWANConfigClass::removeRXInfo(yuboxlorawan_event_id_t id)
+{
+  _cbRXInfoList.remove(id);
+  _rebuildRXPortMap();
+}
+
+void YuboxLoRaWANConfigClass::_rebuildRXPortMap(void)
+{
+  uint8_t m[sizeof(_rxPortMap)];
+
+  auto mark = [&m](uint16_t tag) {
+    for (unsigned int port = (tag >> 8); port <= (tag & 0xFF); port++) m[port >> 3] |= (1 << (port & 7));
+  };
+
+  memset(m, 0, sizeof(m));
+  _cbRXList.forEachTag(mark);
+  _cbRXInfoList.forEachTag(mark);
+  memcpy(_rxPortMap, m, sizeof(_rxPortMap));
+}
 
-  YuboxLoRaWAN_rx_List_t n_evHandler;
-  n_evHandler.event_type = YBX_LW_TXDUTY_CHANGE;
-  //n_evHandler.txd_cb = NULL;
-  n_evHandler.txd_fcb = cb;
-  cbRXList.push_back(n_evHandler);
-  return n_evHandler.id;
+bool YuboxLoRaWANConfigClass::_rx_port_wanted(uint8_t port)
+{
+  if (port == YUBOX_LORAWAN_FRAG_PORT) return true;
+  return (_rxPortMap[port >> 3] & (1 << (port & 7))) != 0;
+}
+
+yuboxlorawan_event_id_t YuboxLoRaWANConfigClass::onTXDuty(YuboxLoRaWAN_txdutychange_func_cb cb)
+{
+  return _cbTXDutyList.add(cb);
 }
 
 void YuboxLoRaWANConfigClass::removeTXDuty(yuboxlorawan_event_id_t id)
 {
-  for (auto i = 0; i < cbRXList.size(); i++) {
-    YuboxLoRaWAN_rx_List_t entry = cbRXList[i];
-    if (entry.event_type == YBX_LW_TXDUTY_CHANGE && entry.id == id) cbRXList.erase(cbRXList.begin() + i);
-  }
+  _cbTXDutyList.remove(id);
 }
 
 yuboxlorawan_event_id_t YuboxLoRaWANConfigClass::onTXConfirm(YuboxLoRaWAN_txconfirm_func_cb cb)
 {
   if (!cb) return 0;
 
-  YuboxLoRaWAN_rx_List_t n_evHandler;
-  n_evHandler.event_type = YBX_LW_TX_CONFIRM;
-  //n_evHandler.txc_cb = NULL;
-  n_evHandler.txc_fcb = cb;
-  cbRXList.push_back(n_evHandler);
-  return n_evHandler.id;
+  return _cbTXConfirmList.add([cb](bool r, uint32_t) { cb(r); });
+}
+
+yuboxlorawan_event_id_t YuboxLoRaWANConfigClass::onTXConfirm(YuboxLoRaWAN_txconfirmresult_func_cb cb)
+{
+  return _cbTXConfirmList.add(cb);
 }
 
 void YuboxLoRaWANConfigClass::removeTXConfirm(yuboxlorawan_event_id_t id)
 {
-  for (auto i = 0; i < cbRXList.size(); i++) {
-    YuboxLoRaWAN_rx_List_t entry = cbRXList[i];
-    if (entry.event_type == YBX_LW_TX_CONFIRM && entry.id == id) cbRXList.erase(cbRXList.begin() + i);
-  }
+  _cbTXConfirmList.remove(id);
 }
 
 void YuboxLoRaWANConfigClass::_join_handler(void)
 {
+    _resetJoinRetry();
+    _saveSubBandCached();
+
+    // El log en flash se reproduce desde el primer update() luego del join
+    _ts_log_lastTry = 0;
+    _log_retry_delay = LORAWAN_LOG_REPLAY_INTERVAL_MS;
+    if (_flashLog.getNumPending() > 0) {
+        log_i("Se reproducirán %u uplinks pendientes del log en flash", _flashLog.getNumPending());
+    }
+    _metrics.inc(YBX_LW_MET_JOIN_OK);
+    if (_ts_join_start != 0) {
+        _metrics.record(YBX_LW_HIST_JOIN_MS, millis() - _ts_join_start);
+        _ts_join_start = 0;
+    }
+
     if (_lw_useOTAA) {
         // Luego de negociar OTAA, se disponen de claves de sesión que deben ser guardadas
         MibRequestConfirm_t mibReq;
@@ -938,53 +2540,89 @@ void YuboxLoRaWANConfigClass::_join_handler(void)
 
         _lw_useOTAA = false;
 
-        // Guardar inmediatamente en NVRAM...
-        bool ok = true;
-        Preferences nvram;
-        nvram.begin(_ns_nvram_yuboxframework_lorawan, false);
+        // Guardar inmediatamente en NVRAM, junto con los contadores iniciales...
+        _fcnt_UpLinkCommitted = _lw_UpLinkCounter;
+        _fcnt_DownLinkCommitted = _lw_DownLinkCounter;
+        _ts_fcnt_lastCommit = millis();
+        _ts_lastDownlinkActivity = millis();
 
-        if (ok && !nvram.putBytes("NwkSKey", _lw_NwkSKey, sizeof(_lw_NwkSKey))) ok = false;
-        if (ok && !nvram.putBytes("AppSKey", _lw_AppSKey, sizeof(_lw_AppSKey))) ok = false;
-        if (ok && !nvram.putUInt("devaddr", _lw_DevAddr)) ok = false;
+        if (_saveStateToNVRAM()) log_d("Claves de sesión negociadas por OTAA fueron guardadas");
 
-        if (!ok) _destroySessionKeys(nvram);
+        _applyTXParams();
+    } else if (_rtc_restore_pending) {
+        MibRequestConfirm_t mibReq;
 
-        if (ok) log_d("Claves de sesión negociadas por OTAA fueron guardadas");
-        _ts_lastDownlinkActivity = millis();
+        _rtc_restore_pending = false;
+        log_d("Restaurando desde RTC contadores UpLink=%u DownLink=%u y DR%d",
+            _lw_UpLinkCounter, _lw_DownLinkCounter, _rtcResume.datarate);
+
+        // Los contadores en RTC son exactos, no hace falta saltar la ventana
+        memset(&mibReq, 0, sizeof(MibRequestConfirm_t));
+        mibReq.Type = MIB_UPLINK_COUNTER;
+        mibReq.Param.UpLinkCounter = _lw_UpLinkCounter;
+        LoRaMacMibSetRequestConfirm(&mibReq);
+
+        memset(&mibReq, 0, sizeof(MibRequestConfirm_t));
+        mibReq.Type = MIB_DOWNLINK_COUNTER;
+        mibReq.Param.DownLinkCounter = _lw_DownLinkCounter;
+        LoRaMacMibSetRequestConfirm(&mibReq);
+
+        memset(&mibReq, 0, sizeof(MibRequestConfirm_t));
+        mibReq.Type = MIB_CHANNELS_DATARATE;
+        mibReq.Param.ChannelsDatarate = _rtcResume.datarate;
+        LoRaMacMibSetRequestConfirm(&mibReq);
+
+        memset(&mibReq, 0, sizeof(MibRequestConfirm_t));
+        mibReq.Type = MIB_CHANNELS_TX_POWER;
+        mibReq.Param.ChannelsTxPower = _rtcResume.txpower;
+        LoRaMacMibSetRequestConfirm(&mibReq);
     } else {
         MibRequestConfirm_t mibReq;
 
-        log_d("Restaurando contadores UpLink=%u DownLink=%u", _lw_UpLinkCounter, _lw_DownLinkCounter);
+        log_d("Restaurando contadores UpLink=%u DownLink=%u (ventana de escritura %u)",
+            _lw_UpLinkCounter, _lw_DownLinkCounter, _fcnt_commit_window);
 
+        /* Con escritura por lotes, el contador real de uplink puede haber avanzado
+         * hasta _fcnt_commit_window tramas más allá del valor guardado. Se salta
+         * la ventana completa para nunca reusar un contador. El contador de
+         * downlink no se adelanta porque lo impone el servidor de red. */
         memset(&mibReq, 0, sizeof(MibRequestConfirm_t));
         mibReq.Type = MIB_UPLINK_COUNTER;
-        mibReq.Param.UpLinkCounter = _lw_UpLinkCounter + 1;
+        mibReq.Param.UpLinkCounter = _lw_UpLinkCounter + _fcnt_commit_window;
         LoRaMacMibSetRequestConfirm(&mibReq);
 
         memset(&mibReq, 0, sizeof(MibRequestConfirm_t));
         mibReq.Type = MIB_DOWNLINK_COUNTER;
         mibReq.Param.DownLinkCounter = _lw_DownLinkCounter + 1;
         LoRaMacMibSetRequestConfirm(&mibReq);
+
+        _applyTXParams();
     }
 
+    // El join siempre ocurre en clase A, se restaura la clase configurada
+    _applyDeviceClass();
+
     _sendActivityEventJSON();
 
-    for (auto i = 0; i < cbRXList.size(); i++) {
-        YuboxLoRaWAN_rx_List_t entry = cbRXList[i];
-        if (entry.event_type == YBX_LW_NETJOIN) {
-            entry.j_fcb();
-        }
-    }
+    _cbJoinList.dispatch();
 }
 
-void YuboxLoRaWANConfigClass::_rx_handler(uint8_t * p, uint8_t n)
+void YuboxLoRaWANConfigClass::_rx_handler(uint8_t port, uint8_t * p, uint8_t n, int16_t rssi, int8_t snr)
 {
     _ts_ultimoRX = millis();
     _ts_lastDownlinkActivity = _ts_ultimoRX;
-    for (auto i = 0; i < cbRXList.size(); i++) {
-        YuboxLoRaWAN_rx_List_t entry = cbRXList[i];
-        if (entry.event_type == YBX_LW_RX) {
-            entry.rx_fcb(p, n);
+    _metrics.inc(YBX_LW_MET_RX);
+    _linkStats.add(rssi, snr, _ts_ultimoRX);
+
+    if (port != YUBOX_LORAWAN_FRAG_PORT) {
+        _dispatchRX(port, p, n, rssi, snr);
+    } else if (_reassembler.add(p, n, _ts_ultimoRX)) {
+        // Mensaje completo, se entrega en su puerto original
+        if (!LORAWAN_PORT_IS_USER(_reassembler.port())) {
+            log_w("Mensaje fragmentado con puerto original %u inválido, se descarta", _reassembler.port());
+        } else {
+            log_d("Mensaje fragmentado de %u bytes reensamblado en puerto %u", _reassembler.length(), _reassembler.port());
+            _dispatchRX(_reassembler.port(), _reassembler.data(), _reassembler.length(), rssi, snr);
         }
     }
 
@@ -993,40 +2631,109 @@ void YuboxLoRaWANConfigClass::_rx_handler(uint8_t * p, uint8_t n)
     _saveFrameCounters();
 }
 
+void YuboxLoRaWANConfigClass::_dispatchRX(uint8_t port, uint8_t * p, size_t n, int16_t rssi, int8_t snr)
+{
+    auto portMatch = [port](uint16_t tag) {
+        return (port >= (tag >> 8) && port <= (tag & 0xFF));
+    };
+    _cbRXList.dispatchIf(portMatch, port, p, n);
+
+    yuboxlorawan_rxinfo_t info = { port, p, n, rssi, snr };
+    _cbRXInfoList.dispatchIf(portMatch, info);
+}
+
 void YuboxLoRaWANConfigClass::_txdutychange_handler(void)
 {
-    for (auto i = 0; i < cbRXList.size(); i++) {
-        YuboxLoRaWAN_rx_List_t entry = cbRXList[i];
-        if (entry.event_type == YBX_LW_TXDUTY_CHANGE) {
-            entry.txd_fcb();
-        }
-    }
+    _cbTXDutyList.dispatch();
 }
 
 void YuboxLoRaWANConfigClass::_tx_confirmed_result(bool r)
 {
+    if (_tx_waiting_confirm && _ts_confirmTX_start != 0) {
+        _metrics.record(YBX_LW_HIST_CONFIRM_MS, millis() - _ts_confirmTX_start);
+    }
+
+    if (!r && _tx_waiting_confirm && !_confirm_retry_pending
+        && _confirm_attempts > 0 && _confirm_attempts <= _tx_conf_num_retries) {
+        _metrics.inc(YBX_LW_MET_CONFIRMTX_RETRY);
+        _scheduleConfirmRetry();
+        _sendActivityEventJSON();
+        return;
+    }
+
+    _finishConfirm(r);
+}
+
+void YuboxLoRaWANConfigClass::_scheduleConfirmRetry(void)
+{
+    // Espera duplicada por cada intento fallido, con variación aleatoria en [d/2, d]
+    uint32_t d = LORAWAN_CONFIRM_RETRY_BASE_MS;
+    for (uint32_t i = 1; i < _confirm_attempts && d < LORAWAN_CONFIRM_RETRY_MAX_MS; i++) d <<= 1;
+    if (d > LORAWAN_CONFIRM_RETRY_MAX_MS) d = LORAWAN_CONFIRM_RETRY_MAX_MS;
+    d = d / 2 + _backoffRandom() % (d / 2 + 1);
+
+    _confirm_retry_pending = true;
+    _ts_confirm_retry_start = millis();
+    _confirm_retry_delay = d;
+    log_w("TX confirmada sin confirmación (intento %u de %u), se retransmite en %u ms",
+        _confirm_attempts, _tx_conf_num_retries + 1, d);
+}
+
+void YuboxLoRaWANConfigClass::_retryConfirmed(void)
+{
+    if (!_lw_confExists || _lw_needsInit) return;
+
+    if (lmh_join_status_get() == LMH_SET && _dutyAllows(_confirmMsg.len)
+        && _sendFrame(_confirmMsg.payload, _confirmMsg.len, true, _confirmMsg.port) == LMH_SUCCESS) {
+        log_i("Uplink confirmado retransmitido (intento %u de %u)", _confirm_attempts, _tx_conf_num_retries + 1);
+        return;
+    }
+
+    // MAC ocupado o sin enlace: se reintenta más tarde sin contar el intento
+    _ts_confirm_retry_start = millis();
+    _confirm_retry_delay = LORAWAN_APP_UPLINK_QUEUE_RETRY_MS;
+}
+
+void YuboxLoRaWANConfigClass::_finishConfirm(bool r)
+{
+    uint32_t attempts = _confirm_attempts;
+
+    if (_log_inflight) {
+        // Sin confirmación el registro permanece pendiente en el log, y se
+        // espera más antes de volver a intentarlo
+        _log_inflight = false;
+        if (r) {
+            _flashLog.markDone(_log_inflight_seq);
+        } else {
+            _ts_log_lastTry = millis();
+            _log_retry_delay = LORAWAN_LOG_REPLAY_BACKOFF_MS;
+        }
+    }
+
     _tx_waiting_confirm = false;
     _ts_confirmTX_start = 0;
+    _confirm_retry_pending = false;
+    _confirm_attempts = 0;
     if (r) {
         _ts_lastDownlinkActivity = millis();
         _num_confirmTX_OK++;
+        _metrics.inc(YBX_LW_MET_CONFIRMTX_OK);
     } else {
         _num_confirmTX_FAIL++;
+        _metrics.inc(YBX_LW_MET_CONFIRMTX_FAIL);
     }
 
     _sendActivityEventJSON();
 
-    for (auto i = 0; i < cbRXList.size(); i++) {
-        YuboxLoRaWAN_rx_List_t entry = cbRXList[i];
-        if (entry.event_type == YBX_LW_TX_CONFIRM) {
-            entry.txc_fcb(r);
-        }
-    }
+    _cbTXConfirmList.dispatch(r, attempts);
 }
 
 static void lorawan_confirm_class_handler(DeviceClass_t Class)
 {
+    YuboxLoRaWANConfigClass * lw = YuboxLoRaWANConfigClass::_activeInstance;
+
     log_i("switch to class %c done", "ABC"[Class]);
+    if (lw != NULL) lw->_devclass_switched = (int8_t)Class;
 
     // Informs the server that switch has occurred ASAP
     lmh_app_data_t m_lora_app_data = {NULL, 0, 0, 0, 0};
@@ -1035,45 +2742,72 @@ static void lorawan_confirm_class_handler(DeviceClass_t Class)
     lmh_send(&m_lora_app_data, LMH_UNCONFIRMED_MSG);
 }
 
+/*
+ * Los siguientes callbacks corren en la tarea de IRQ de SX126x-Arduino. Para no
+ * retrasar el procesamiento de radio, NO deben invocar callbacks de aplicación,
+ * escribir a NVRAM ni generar JSON. Sólo copian el evento al anillo que se
+ * despacha en update() desde la tarea de la aplicación.
+ *
+ * lmh_callback_t no lleva puntero de contexto, así que los eventos se
+ * entregan a la instancia que inicializó la MAC por última vez.
+ */
 static void lorawan_has_joined_handler(void)
 {
-    lmh_class_request(CLASS_A);
-    YuboxLoRaWANConf._join_handler();
+    YuboxLoRaWANConfigClass * lw = YuboxLoRaWANConfigClass::_activeInstance;
+
+    if (lw == NULL || !lw->_postRadioEvent(YBX_LW_RADIO_JOINED)) {
+        log_e("Anillo de eventos de radio lleno, se pierde evento de join");
+    }
 }
 
 static void lorawan_join_failed_handler(void)
 {
-    log_w("OVER_THE_AIR_ACTIVATION failed! Retrying...");
-    YuboxLoRaWANConf._joinfail_handler();
-    lmh_join();
-    YuboxLoRaWANConf._joinstart_handler();
+    YuboxLoRaWANConfigClass * lw = YuboxLoRaWANConfigClass::_activeInstance;
+
+    log_w("OVER_THE_AIR_ACTIVATION failed!");
+    if (lw == NULL || !lw->_postRadioEvent(YBX_LW_RADIO_JOINFAIL)) {
+        // Sin evento no habrá reintento desde update(), se reintenta aquí mismo
+        lmh_join();
+    }
 }
 
 static void lorawan_rx_handler(lmh_app_data_t *app_data)
 {
-    switch (app_data->port) {
-    case 3: // Port 3 switches the class
+    YuboxLoRaWANConfigClass * lw = YuboxLoRaWANConfigClass::_activeInstance;
+    if (lw == NULL) return;
+
+    if (app_data->port == 3) {
+        // Port 3 switches the class
         if (app_data->buffsize == 1) {
             switch (app_data->buffer[0]) {
             case 0: lmh_class_request(CLASS_A); break;
-            case 1: lmh_class_request(CLASS_B); break;
+            case 1: log_w("Clase B no soportada, se ignora"); break;
             case 2: lmh_class_request(CLASS_C); break;
             default: break;
             }
         }
-        break;
-    case LORAWAN_APP_PORT:
-        YuboxLoRaWANConf._rx_handler(app_data->buffer, app_data->buffsize);
-        break;
-    default:
-        break;
+        return;
+    }
+
+    /* El downlink en un puerto sin callbacks instalados no se copia, pero igual
+     * se publica el evento para registrar RSSI/SNR del enlace. El SNR llega de
+     * la MAC como entero con signo en dB, almacenado en un campo uint8_t. */
+    bool wanted = lw->_rx_port_wanted(app_data->port);
+    if (!lw->_postRadioEvent(YBX_LW_RADIO_RX, false, app_data->port,
+        wanted ? app_data->buffer : NULL, wanted ? app_data->buffsize : 0,
+        app_data->rssi, (int8_t)app_data->snr)) {
+        log_e("Anillo de eventos de radio lleno, se pierde downlink de %u bytes", app_data->buffsize);
     }
 }
 
 static void lorawan_confirmed_tx_result(bool result)
 {
+    YuboxLoRaWANConfigClass * lw = YuboxLoRaWANConfigClass::_activeInstance;
+
     log_v("RESULTADO DE CONFIRMED TX ES %s", result ? "OK": "FAIL");
-    YuboxLoRaWANConf._tx_confirmed_result(result);
+    if (lw == NULL || !lw->_postRadioEvent(YBX_LW_RADIO_TX_CONFIRM, result)) {
+        log_e("Anillo de eventos de radio lleno, se pierde resultado de TX confirmada");
+    }
 }
 
 YuboxLoRaWANConfigClass YuboxLoRaWANConf;
\ No newline at end of file
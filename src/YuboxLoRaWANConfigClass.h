@@ -13,13 +13,64 @@
 
 #include <functional>
 
+#include "YuboxLoRaWANCallbackList.h"
+#include "YuboxLoRaWANUplinkQueue.h"
+#include "YuboxLoRaWANEventRing.h"
+#include "YuboxLoRaWANMetrics.h"
+#include "YuboxLoRaWANLinkStats.h"
+#include "YuboxLoRaWANAirtime.h"
+#include "YuboxLoRaWANFragment.h"
+#include "YuboxLoRaWANEncoders.h"
+#include "YuboxLoRaWANFlashLog.h"
+#include "YuboxLoRaWANRTCSession.h"
+#include "YuboxLoRaWANNVRAMState.h"
+
 typedef std::function<void (void) > YuboxLoRaWAN_join_func_cb;
 typedef std::function<void (uint8_t *, uint8_t) > YuboxLoRaWAN_rx_func_cb;
+typedef std::function<void (uint8_t, uint8_t *, size_t) > YuboxLoRaWAN_rxport_func_cb;
+typedef std::function<void (const yuboxlorawan_rxinfo_t &) > YuboxLoRaWAN_rxinfo_func_cb;
 typedef std::function<void (void) > YuboxLoRaWAN_txdutychange_func_cb;
 typedef std::function<void (bool) > YuboxLoRaWAN_txconfirm_func_cb;
+typedef std::function<void (bool, uint32_t) > YuboxLoRaWAN_txconfirmresult_func_cb;
 
 typedef size_t yuboxlorawan_event_id_t;
 
+// Campos reportados en el evento de estado /yubox-api/lorawan/status
+typedef enum {
+  YBX_LW_ST_JOIN = 0,
+  YBX_LW_ST_TX_OK,
+  YBX_LW_ST_TX_FAIL,
+  YBX_LW_ST_RX,
+  YBX_LW_ST_NUM_CONFIRMTX_OK,
+  YBX_LW_ST_NUM_CONFIRMTX_FAIL,
+  YBX_LW_ST_CONFIRMTX_START,
+  YBX_LW_ST_FCNT_WRITES,
+  YBX_LW_ST_FCNT_WRITES_AVOIDED,
+  YBX_LW_ST_TXQ_DEPTH,
+  YBX_LW_ST_TXQ_DROPPED,
+  YBX_LW_ST_EV_DROPPED,
+  YBX_LW_ST_RSSI,
+  YBX_LW_ST_SNR,
+  YBX_LW_ST_RSSI_AVG,
+  YBX_LW_ST_SNR_AVG,
+  YBX_LW_ST_JOIN_ATTEMPT,
+  YBX_LW_ST_JOIN_NEXT,
+  YBX_LW_ST_SUBBAND,
+  YBX_LW_ST_AIRTIME_LEFT,
+  YBX_LW_ST_TX_NEXT,
+  YBX_LW_ST_DEVCLASS,
+
+  YBX_LW_ST_MAX
+} yuboxlorawan_status_field_t;
+
+/*
+ * Los callbacks y la configuración viven en cada instancia, pero sólo UNA
+ * instancia puede manejar la radio a la vez: la MAC de SX126x-Arduino es única
+ * por proceso, los eventos de radio se entregan a _activeInstance, y la copia
+ * de sesión en memoria RTC (ver prepareDeepSleep()) es una sola por firmware.
+ * Varias instancias vivas en el mismo firmware se pisarían la sesión. Fuera de
+ * las pruebas en el host, usar únicamente YuboxLoRaWANConf.
+ */
 class YuboxLoRaWANConfigClass
 {
 private:
@@ -31,6 +82,40 @@ private:
   // Sub-banda a usar para conexión inicial a red
   uint8_t _lw_subband;
 
+  // Con búsqueda de sub-banda activa, cada fallo de join rota a la siguiente
+  // sub-banda válida de la región. La sub-banda con la que se logró el join se
+  // guarda en NVRAM y se usa primero en el siguiente arranque.
+  bool _lw_subband_scan;
+  uint8_t _lw_subband_cached;
+  uint8_t _lw_subband_active;
+
+  // Clase de dispositivo configurada, que se guarda en NVRAM y se solicita
+  // luego de cada join, y clase en la que se encuentra la MAC. El join se
+  // realiza siempre en clase A. Un cambio de clase ordenado por la red en el
+  // puerto 3 también se guarda como clase configurada.
+  DeviceClass_t _lw_devclass;
+  DeviceClass_t _lw_devclass_active;
+  bool _devclass_apply;
+
+  // Parámetros de transmisión guardados en NVRAM. El datarate configurado es
+  // el punto de partida luego de cada join; con _lw_dr_policy activo se parte
+  // del datarate más rápido que permite el margen de SNR de los downlinks
+  // recientes, si es mayor. La potencia es el índice TX_POWER_x de la región.
+  bool _lw_adr;
+  int8_t _lw_datarate;
+  int8_t _lw_txpower;
+  uint8_t _lw_jointrials;
+  bool _lw_dr_policy;
+  int8_t _lw_datarate_start;
+  bool _txparams_apply;
+
+  // Tiempo en aire que habrían usado los uplinks exitosos en el datarate
+  // configurado, para comparar con el tiempo en aire real
+  uint32_t _airtime_baseline_ms;
+
+  // Tiempo en aire real de esos mismos uplinks, sin tramas MAC ni sondeos
+  uint32_t _airtime_app_ms;
+
   // Identificador sacado de MAC de ESP32, convertido en EUI
   uint8_t _lw_default_devEUI[8];
 
@@ -51,6 +136,19 @@ private:
   uint32_t _lw_UpLinkCounter;
   uint32_t _lw_DownLinkCounter;
 
+  // Persistencia por lotes de contadores de trama. Los contadores sólo se
+  // escriben a NVRAM cuando han avanzado _fcnt_commit_window tramas desde la
+  // última escritura, o cuando han pasado _fcnt_commit_maxsec segundos con
+  // cambios pendientes, o en flushFrameCounters(). Al restaurar la sesión, el
+  // contador de uplink se adelanta en _fcnt_commit_window para no reusarlo.
+  uint32_t _fcnt_commit_window;
+  uint32_t _fcnt_commit_maxsec;
+  uint32_t _fcnt_UpLinkCommitted;
+  uint32_t _fcnt_DownLinkCommitted;
+  uint32_t _ts_fcnt_lastCommit;
+  uint32_t _num_fcnt_writes;
+  uint32_t _num_fcnt_writes_avoided;
+
   // Se establece bandera a VERDADERO luego de inicio exitoso de hardware LoRaWAN
   bool _lorahw_init;
 
@@ -64,6 +162,27 @@ private:
 
   AsyncEventSource * _pEvents;
 
+  // Un registro separado por cada tipo de evento
+  YuboxLoRaWANCallbackList<YuboxLoRaWAN_join_func_cb> _cbJoinList;
+  YuboxLoRaWANCallbackList<YuboxLoRaWAN_rxport_func_cb> _cbRXList;
+  YuboxLoRaWANCallbackList<YuboxLoRaWAN_rxinfo_func_cb> _cbRXInfoList;
+  YuboxLoRaWANCallbackList<YuboxLoRaWAN_txdutychange_func_cb> _cbTXDutyList;
+  YuboxLoRaWANCallbackList<YuboxLoRaWAN_txconfirmresult_func_cb> _cbTXConfirmList;
+
+  // Mapa de bits de puertos FPort con al menos un callback de RX instalado. La
+  // etiqueta de cada callback de RX o RXInfo es (puerto_min << 8) | puerto_max.
+  uint8_t _rxPortMap[32];
+  void _rebuildRXPortMap(void);
+
+  // Los eventos de estado se agrupan: cada actividad sólo marca el estado como
+  // modificado, y update() envía a lo sumo un evento cada _status_min_interval_ms
+  // con sólo los campos que cambiaron desde el último evento enviado.
+  bool _status_dirty;
+  uint32_t _status_min_interval_ms;
+  uint32_t _ts_status_lastSent;
+  uint32_t _ts_status_lastFull;
+  uint32_t _statusSent[YBX_LW_ST_MAX];
+
   // Timestamps de últimas actividades LoRaWAN
   uint32_t _ts_ultimoTX_OK;
   uint32_t _ts_ultimoTX_FAIL;
@@ -88,37 +207,159 @@ private:
   // Número de veces que se reintentará la transmisión confirmada luego de fallo
   uint32_t _tx_conf_num_retries;
 
+  // Cola de mensajes pendientes de transmitir, despachada desde update()
+  YuboxLoRaWANUplinkQueue _uplinkQueue;
+  uint32_t _ts_uplinkQueue_lastTry;
+
+  // Buffer para ensamblar envíos scatter-gather. lmh_send() copia el payload
+  // al buffer de la MAC antes de regresar, así que puede reusarse de inmediato.
+  uint8_t _txBuffer[YUBOX_LORAWAN_MAX_PAYLOAD];
+
+  // Reintentos de join luego de fallo. Cada reintento espera el doble que el
+  // anterior, desde _join_backoff_base_ms hasta _join_backoff_max_ms, más una
+  // variación aleatoria para que los nodos de una misma red no se sincronicen
+  // luego de una caída del gateway. Con _join_retry_budget distinto de 0 se
+  // abandona el join luego de ese número de fallos consecutivos.
+  uint32_t _join_backoff_base_ms;
+  uint32_t _join_backoff_max_ms;
+  uint32_t _join_retry_budget;
+  uint32_t _join_attempt;
+  bool _join_retry_pending;
+  uint32_t _ts_join_retry_start;
+  uint32_t _join_retry_delay;
+  uint32_t _backoff_rng;
+
+  // Copia del último uplink confirmado, para retransmitirlo hasta
+  // _tx_conf_num_retries veces si no se recibe confirmación. El resultado se
+  // reporta a la aplicación una sola vez, luego del último intento.
+  yuboxlorawan_uplink_t _confirmMsg;
+  uint32_t _confirm_attempts;
+  bool _confirm_retry_pending;
+  uint32_t _ts_confirm_retry_start;
+  uint32_t _confirm_retry_delay;
+
+  // Contadores e histogramas de actividad, expuestos en /yubox-api/lorawan/metrics
+  YuboxLoRaWANMetrics _metrics;
+  uint32_t _ts_join_start;
+
+  // Fragmentación de mensajes mayores al payload máximo del datarate actual,
+  // en el puerto YUBOX_LORAWAN_FRAG_PORT
+  YuboxLoRaWANReassembler _reassembler;
+  uint8_t _frag_msgid;
+  uint32_t _num_frag_tx;
+
+  // RSSI/SNR de los downlinks más recientes
+  YuboxLoRaWANLinkStats _linkStats;
+
+  // Tiempo en aire de uplinks sobre una ventana deslizante. La MAC corre con
+  // LORAWAN_DUTYCYCLE_OFF, así que el límite regional sólo se aplica si
+  // _duty_enforce está activo. Sin límite configurado por la aplicación
+  // (_duty_custom), se usa el límite por omisión de la región.
+  YuboxLoRaWANDutyBudget _dutyBudget;
+  bool _duty_custom;
+  bool _duty_enforce;
+  uint32_t _last_airtime_ms;
+
+  // Log en flash de uplinks que deben sobrevivir a reinicios y caídas de la
+  // red. Se reproduce en orden, un registro a la vez, luego de unirse a la red.
+  // Un registro confirmado sólo se marca despachado al recibir confirmación.
+  YuboxLoRaWANFlashLog _flashLog;
+  bool _log_inflight;
+  uint32_t _log_inflight_seq;
+  uint32_t _ts_log_lastTry;
+  uint32_t _log_retry_delay;
+
+  // Reanudación desde sueño profundo con la copia en memoria RTC. El estado
+  // de MAC guardado se aplica luego del join ABP que sigue a la reanudación.
+  bool _rtc_resumed;
+  bool _rtc_restore_pending;
+  yuboxlorawan_rtc_session_t _rtcResume;
+
+  // millis() del primer uplink exitoso desde el arranque, 0 si no hay todavía
+  uint32_t _ts_boot_tx;
+
+  // Eventos recibidos desde la tarea de IRQ de radio, pendientes de procesar
+  // en la tarea de la aplicación desde update()
+  YuboxLoRaWANEventRing _radioEvents;
+
+  // Tarea que corre update(), único consumidor del anillo. En ABP lmh_join()
+  // invoca el callback de join en la misma llamada, desde update(); esos
+  // eventos sin payload se marcan en _localEvents (un bit por tipo) en lugar
+  // de publicarse en el anillo, que admite un solo productor.
+  TaskHandle_t _consumerTask;
+  uint8_t _localEvents;
+
   void _loadSavedCredentialsFromNVRAM(void);
-  bool _saveCredentialsToNVRAM(void);
+  bool _loadStateFromNVRAM(Preferences &);
+  void _loadLegacyKeysFromNVRAM(Preferences &);
+  bool _saveStateToNVRAM(void);
+  bool _loadSessionFromRTC(void);
   void _clearSessionKeys(void);
-  void _destroySessionKeys(Preferences &);
 
-  bool _saveConfirmedTXRetries(void);
+  void _saveSubBandCached(void);
+  void _rotateSubBand(void);
+
+  void _applyDeviceClass(void);
+  void _class_handler(DeviceClass_t);
+
+  bool _isValidUplinkDatarate(LoRaMacRegion_t, int8_t);
+  int8_t _getStartingDatarate(void);
+  void _setStartingDatarate(void);
+  void _applyTXParams(void);
 
-  void _saveFrameCounters(Preferences &);
-  void _saveFrameCounters(void);
+
+  void _readFrameCounters(void);
+  void _commitFrameCounters(void);
+  bool _saveFrameCountersToNVRAM(void);
+  void _saveFrameCounters(bool force = false);
+  bool _frameCountersPending(void);
 
   bool _isValidLoRaWANRegion(uint8_t);
   uint8_t _getMaxLoRaWANRegionSubchannel(LoRaMacRegion_t);
   const char * _getLoRaWANRegionName(LoRaMacRegion_t);
+  yuboxlorawan_drtable_t _getLoRaWANRegionDRTable(LoRaMacRegion_t);
+  uint32_t _getLoRaWANRegionDutyPermille(LoRaMacRegion_t);
+  uint8_t _getLoRaWANRegionMinPayload(LoRaMacRegion_t);
+  int8_t _getCurrentDatarate(void);
+  bool _dutyAllows(uint8_t);
 
   void _setupHTTPRoutes(AsyncWebServer &);
 
   void _sendActivityEventJSON(void);
-  String _reportActivityJSON(void);
+  void _flushActivityEventJSON(void);
+  void _collectActivityStatus(uint32_t *);
+  size_t _reportActivityJSON(char *, size_t, const uint32_t *, const uint32_t * prev = NULL);
 
   void _routeHandler_yuboxAPI_lorawan_status_onConnect(AsyncEventSourceClient *);
   void _routeHandler_yuboxAPI_lorawanconfigjson_GET(AsyncWebServerRequest *);
   void _routeHandler_yuboxAPI_lorawanconfigjson_POST(AsyncWebServerRequest *);
   void _routeHandler_yuboxAPI_lorawanregionsjson_GET(AsyncWebServerRequest *);
   void _routeHandler_yuboxAPI_lorawanresetconn_POST(AsyncWebServerRequest *);
+  void _routeHandler_yuboxAPI_lorawanmetricsjson_GET(AsyncWebServerRequest *);
+  void _routeHandler_yuboxAPI_lorawanmetrics_GET(AsyncWebServerRequest *);
 
-  String _bin2str(uint8_t *, size_t);
   bool _str2bin(const char *, uint8_t *, size_t);
 
   void _txdutychange_handler(void);
+
+  // Con queued = true, un fallo no cuenta para el reintento de join por
+  // timeout: la cola reintenta por sí sola cada LORAWAN_APP_UPLINK_QUEUE_RETRY_MS
+  lmh_error_status _sendFrame(uint8_t *, uint8_t, bool, uint8_t, bool queued = false);
+  void _drainUplinkQueue(void);
+  void _replayFlashLog(void);
+
+  void _processRadioEvents(void);
+
+  uint32_t _backoffRandom(void);
+  void _scheduleJoinRetry(void);
+  void _resetJoinRetry(void);
+
+  void _scheduleConfirmRetry(void);
+  void _retryConfirmed(void);
+  void _finishConfirm(bool);
 public:
   YuboxLoRaWANConfigClass(void);
+  ~YuboxLoRaWANConfigClass();
   bool begin(AsyncWebServer & srv, bool displayTxConf = false);
 
   // Función a llamar regularmente para procesar eventos de radio
@@ -127,43 +368,239 @@ public:
   // Verificar si efectivamente ya se ha unido a red LoRaWAN
   bool isJoined(void);
 
-  // Verificar si se está todavía esperando la confirmación de una transmisión confirmada
+  // Verificar si se está todavía esperando la confirmación de una transmisión
+  // confirmada, incluyendo la espera antes de una retransmisión
   bool isWaitingConfirmation(void) { return _tx_waiting_confirm; }
 
+  // Número de transmisiones realizadas del uplink confirmado en curso
+  uint32_t getConfirmAttempts(void) { return _confirm_attempts; }
+
+  // Guardar configuración, sesión y estado de MAC en memoria RTC, escribir el
+  // log en flash pendiente y dormir la radio. Llamar justo antes de
+  // esp_deep_sleep_start() para que el siguiente despertar pueda transmitir
+  // sin leer NVS ni repetir el join. La cola de uplink en RAM y un uplink
+  // confirmado en espera NO se conservan.
+  bool prepareDeepSleep(void);
+
+  // Verificar si la sesión actual se reanudó desde memoria RTC
+  bool isResumedFromRTC(void) { return _rtc_resumed; }
+
+  // Milisegundos desde el arranque hasta el primer uplink exitoso, 0 si no hay todavía
+  uint32_t getBootToTX(void) { return _ts_boot_tx; }
+
   // Destruir las claves de sesión y volver a empezar el join
   void destroySessionKeys(void);
 
+  // Configurar reintentos de join. Con budget=0 se reintenta indefinidamente.
+  bool setJoinBackoff(uint32_t base_ms, uint32_t max_ms, uint32_t budget = 0);
+  uint32_t getJoinBackoffBase(void) { return _join_backoff_base_ms; }
+  uint32_t getJoinBackoffMax(void) { return _join_backoff_max_ms; }
+  uint32_t getJoinRetryBudget(void) { return _join_retry_budget; }
+
+  // Número de fallos de join consecutivos, y millis() del próximo reintento
+  // (0 si no hay reintento programado)
+  uint32_t getJoinAttempt(void) { return _join_attempt; }
+  uint32_t getNextJoinAttempt(void) { return _join_retry_pending ? _ts_join_retry_start + _join_retry_delay : 0; }
+
+  // Búsqueda automática de sub-banda en fallo de join, y sub-banda en uso
+  bool getSubBandScan(void) { return _lw_subband_scan; }
+  uint8_t getActiveSubBand(void) { return _lw_subband_active; }
+
+  // Clase de dispositivo a solicitar luego del join (CLASS_A o CLASS_C). Si ya
+  // se está unido a la red, el cambio se aplica en el siguiente update(). La
+  // biblioteca SX126x-Arduino no implementa clase B.
+  bool setDeviceClass(DeviceClass_t);
+  DeviceClass_t getDeviceClass(void) { return _lw_devclass; }
+  DeviceClass_t getActiveDeviceClass(void) { return _lw_devclass_active; }
+
+  // Parámetros de transmisión: ADR, datarate inicial (DR de uplink válido en
+  // la región) y potencia como índice TX_POWER_x. Se guardan en NVRAM. Con
+  // ADR activo, se aplican de inmediato y la red ajusta a partir de ellos;
+  // sin ADR, un cambio de datarate reinicia la sesión.
+  bool setTXParams(bool adr, int8_t datarate, int8_t txpower);
+  bool getADR(void) { return _lw_adr; }
+  int8_t getDatarate(void) { return _lw_datarate; }
+  int8_t getTXPower(void) { return _lw_txpower; }
+
+  // Número de intentos de cada join, entre 1 y 48. Sin sesión activa se
+  // reinicializa la MAC de inmediato; con sesión, aplica al próximo join.
+  bool setJoinTrials(uint8_t);
+  uint8_t getJoinTrials(void) { return _lw_jointrials; }
+
+  // Elegir el datarate inicial a partir del margen de SNR de los downlinks
+  // recientes, en lugar de empezar siempre en el datarate configurado
+  bool setDatarateFromMargin(bool);
+  bool getDatarateFromMargin(void) { return _lw_dr_policy; }
+  int8_t getStartingDatarate(void) { return _lw_datarate_start; }
+
+  // Tiempo en aire ahorrado (negativo si se gastó más) respecto de enviar los
+  // mismos uplinks en el datarate configurado, en milisegundos
+  int32_t getAirtimeSaved(void) { return (int32_t)(_airtime_baseline_ms - _airtime_app_ms); }
+
+  // Reintentar join de inmediato, reiniciando la cuenta de fallos. Útil luego
+  // de agotar los reintentos permitidos.
+  void restartJoin(void);
+
   // Instalar callback para aviso de unión exitosa a LoRaWAN
   yuboxlorawan_event_id_t onJoin(YuboxLoRaWAN_join_func_cb cbRX);
   void removeJoin(yuboxlorawan_event_id_t id);
 
-  // Instalar callback para recepción de datos LoRaWAN
+  // Instalar callback para recepción de datos LoRaWAN. Sin puerto indicado, se
+  // reciben sólo los datos en LORAWAN_APP_PORT. Con rango de puertos, el
+  // callback recibe el puerto FPort en el que llegaron los datos. Los mensajes
+  // fragmentados se entregan ya reensamblados en su puerto original, y sólo a
+  // callbacks con longitud size_t si exceden 255 bytes. El puerto
+  // YUBOX_LORAWAN_FRAG_PORT (222) está reservado para fragmentos: nunca se
+  // entrega a callbacks, y un rango que lo incluye lo omite.
   yuboxlorawan_event_id_t onRX(YuboxLoRaWAN_rx_func_cb cbRX);
+  yuboxlorawan_event_id_t onRX(uint8_t port, YuboxLoRaWAN_rx_func_cb cbRX);
+  yuboxlorawan_event_id_t onRX(uint8_t port_min, uint8_t port_max, YuboxLoRaWAN_rxport_func_cb cbRX);
   void removeRX(yuboxlorawan_event_id_t id);
 
+  // Instalar callback para recepción de datos LoRaWAN junto con RSSI y SNR
+  // del downlink, en el rango de puertos indicado.
+  yuboxlorawan_event_id_t onRXInfo(uint8_t port_min, uint8_t port_max, YuboxLoRaWAN_rxinfo_func_cb cbRX);
+  void removeRXInfo(yuboxlorawan_event_id_t id);
+
   // Instalar callback para cambio de duración de TX DUTY requerido
   yuboxlorawan_event_id_t onTXDuty(YuboxLoRaWAN_txdutychange_func_cb cb);
   void removeTXDuty(yuboxlorawan_event_id_t id);
 
-  // Instalar callback para confirmación de éxito o fallo de TX confirmado
+  // Instalar callback para confirmación de éxito o fallo de TX confirmado. El
+  // callback se invoca una sola vez por mensaje, luego de agotar los reintentos
+  // configurados, y opcionalmente recibe el número de transmisiones realizadas.
   yuboxlorawan_event_id_t onTXConfirm(YuboxLoRaWAN_txconfirm_func_cb cb);
+  yuboxlorawan_event_id_t onTXConfirm(YuboxLoRaWAN_txconfirmresult_func_cb cb);
   void removeTXConfirm(yuboxlorawan_event_id_t cb);
 
   uint32_t getRequestedTXDutyCycle(void) { return _tx_duty_sec; }
   bool setRequestedTXDutyCycle(uint32_t);
 
-  // Enviar datos una vez confirmado que hay enlace a red
-  bool send(uint8_t * p, uint8_t n, bool is_txconfirmed = false);
+  // Enviar datos una vez confirmado que hay enlace a red. El puerto FPort
+  // debe estar en el rango 1..223, excepto YUBOX_LORAWAN_FRAG_PORT, que
+  // también se rechaza en enqueue(), enqueueLarge() y enqueuePersistent().
+  bool send(uint8_t * p, uint8_t n, bool is_txconfirmed = false, uint8_t port = LORAWAN_APP_PORT);
+
+  // Enviar datos ensamblados a partir de varios segmentos. La longitud total se
+  // valida contra el máximo payload del datarate actual antes de copiar.
+  bool send(const yuboxlorawan_segment_t * segs, size_t nsegs, bool is_txconfirmed = false, uint8_t port = LORAWAN_APP_PORT);
+
+  // Máximo payload permitido por el datarate actual, 0 si no se ha unido a red
+  uint8_t getMaxPayloadSize(void);
+
+  // Tiempo en aire en milisegundos de un uplink con n bytes de payload en el
+  // datarate actual, 0 si no se ha unido a red
+  uint32_t getTimeOnAir(uint8_t n);
+
+  // Límite de ciclo de trabajo en milésimas sobre una ventana en segundos. Con
+  // permille=0 no hay límite. Si enforce es verdadero, send() y la cola de
+  // uplink no transmiten mientras el uplink exceda el presupuesto restante.
+  bool setDutyCycleLimit(uint32_t permille, uint32_t window_sec = 3600, bool enforce = false);
+  uint32_t getDutyCycleLimit(void) { return _dutyBudget.getLimitPermille(); }
+
+  // Tiempo en aire restante en la ventana actual en milisegundos, UINT32_MAX sin límite
+  uint32_t getDutyCycleRemaining(void) { return _dutyBudget.remaining(millis()); }
+
+  // Milisegundos hasta que un uplink de n bytes puede transmitirse sin exceder
+  // el presupuesto, 0 si puede transmitirse ya
+  uint32_t getNextTXDelay(uint8_t n);
+
+  // Tiempo en aire acumulado de uplinks desde el arranque, en milisegundos
+  uint32_t getTotalAirtime(void) { return _dutyBudget.total(); }
+
+  // Encolar datos para envío en cuanto la red lo permita. El payload se copia
+  // a la cola, así que el buffer puede reusarse inmediatamente. Devuelve falso
+  // sólo si el mensaje se descarta por cola llena o payload demasiado grande.
+  // Un mensaje encolado también se descarta, y se cuenta en
+  // getUplinkQueueNumDropped(), si al despacharlo excede getMaxPayloadSize()
+  // o si la MAC lo rechaza LORAWAN_APP_UPLINK_QUEUE_MAX_ATTEMPTS veces.
+  bool enqueue(uint8_t * p, uint8_t n, bool is_txconfirmed = false, yuboxlorawan_priority_t prio = YBX_LW_PRIO_NORMAL, uint8_t port = LORAWAN_APP_PORT);
+  bool enqueue(const yuboxlorawan_segment_t * segs, size_t nsegs, bool is_txconfirmed = false, yuboxlorawan_priority_t prio = YBX_LW_PRIO_NORMAL, uint8_t port = LORAWAN_APP_PORT);
+
+  // Encolar un mensaje de hasta YUBOX_LORAWAN_FRAG_MAX_MSG bytes. Si excede el
+  // payload máximo del datarate actual, se divide en fragmentos que se envían
+  // en el puerto YUBOX_LORAWAN_FRAG_PORT con el puerto original en el
+  // encabezado. Requiere unión a la red para conocer el payload máximo, y
+  // espacio en la cola para todos los fragmentos. Con ADR activo, el tamaño
+  // se limita al payload del datarate más bajo de la región, para que los
+  // fragmentos encolados sigan cabiendo si la red baja el datarate.
+  bool enqueueLarge(const uint8_t * p, size_t n, bool is_txconfirmed = false, yuboxlorawan_priority_t prio = YBX_LW_PRIO_NORMAL, uint8_t port = LORAWAN_APP_PORT);
+
+  // Guardar un uplink en el log de flash (partición YUBOX_LORAWAN_LOG_PARTITION_LABEL)
+  // para enviarlo aunque el dispositivo se reinicie antes de unirse a la red.
+  // Sin la partición, equivale a enqueue() con prioridad normal.
+  bool enqueuePersistent(uint8_t * p, uint8_t n, bool is_txconfirmed = false, uint8_t port = LORAWAN_APP_PORT);
+
+  // Escribir a flash los registros del log que estén todavía en RAM. Llamar
+  // antes de reiniciar o apagar el dispositivo.
+  bool flushPersistent(void) { return _flashLog.ready() ? _flashLog.flush() : false; }
+
+  bool hasPersistentLog(void) { return _flashLog.ready(); }
+  uint32_t getPersistentPending(void) { return _flashLog.getNumPending(); }
+  uint32_t getPersistentNumLost(void) { return _flashLog.getNumLost(); }
+
+  void setUplinkQueuePolicy(yuboxlorawan_queue_policy_t policy) { _uplinkQueue.setPolicy(policy); }
+  uint32_t getUplinkQueueDepth(void) { return _uplinkQueue.depth(); }
+  uint32_t getUplinkQueueMaxDepth(void) { return _uplinkQueue.getMaxDepth(); }
+  uint32_t getUplinkQueueNumSent(void) { return _uplinkQueue.getNumSent(); }
+  uint32_t getUplinkQueueNumDropped(void) { return _uplinkQueue.getNumDropped(); }
+  void clearUplinkQueue(void) { _uplinkQueue.clear(); }
 
   uint32_t getNumTxConfRetries(void) { return _tx_conf_num_retries; }
 
   uint32_t getLastDownlinkActivity(void) { return _ts_lastDownlinkActivity; }
 
+  // Estadísticas de RSSI/SNR de los últimos downlinks, para decidir datarate o
+  // intervalo de transmisión sin consultar al servidor de red. Devuelve falso
+  // si todavía no se ha recibido ningún downlink.
+  bool getLinkStats(yuboxlorawan_link_stats_t & st) { return _linkStats.compute(st); }
+  void clearLinkStats(void) { _linkStats.clear(); }
+
+  // Intervalo mínimo entre eventos de estado enviados a los navegadores. Toda
+  // actividad dentro del intervalo se agrupa en un solo evento.
+  uint32_t getStatusEventInterval(void) { return _status_min_interval_ms; }
+  void setStatusEventInterval(uint32_t ms) { _status_min_interval_ms = ms; }
+
+  // Métricas de actividad desde el arranque
+  YuboxLoRaWANMetrics & getMetrics(void) { return _metrics; }
+
+  // Número de eventos de radio descartados por no haberse llamado a update()
+  // con suficiente frecuencia
+  uint32_t getNumRadioEventsDropped(void) { return _radioEvents.getNumDropped(); }
+
+  // Configurar persistencia por lotes de contadores de trama. Con nframes=1
+  // se escribe en cada trama (comportamiento original). Con maxsec=0 no hay
+  // escritura por tiempo transcurrido.
+  uint32_t getFrameCounterCommitWindow(void) { return _fcnt_commit_window; }
+  uint32_t getFrameCounterCommitMaxSec(void) { return _fcnt_commit_maxsec; }
+  bool setFrameCounterCommitWindow(uint32_t nframes, uint32_t maxsec = 0);
+
+  // Escribir inmediatamente los contadores pendientes. Llamar antes de
+  // reiniciar o apagar el dispositivo. Devuelve falso si no hay sesión activa.
+  bool flushFrameCounters(void);
+
+  uint32_t getNumFrameCounterWrites(void) { return _num_fcnt_writes; }
+  uint32_t getNumFrameCounterWritesAvoided(void) { return _num_fcnt_writes_avoided; }
+  uint32_t getNumFrameCounterWriteFailures(void) { return _metrics.get(YBX_LW_MET_FCNT_WRITE_FAIL); }
+
   // NO LLAMAR DESDE CÓDIGO LAS SIGUIENTES FUNCIONES
+
+  // Instancia que recibe los eventos de radio. La MAC de SX126x-Arduino es
+  // única por proceso, así que sólo una instancia a la vez la maneja: la que
+  // ejecutó lmh_init() por última vez desde update().
+  static YuboxLoRaWANConfigClass * _activeInstance;
+
+  // Clase confirmada por la MAC, escrita desde el callback de cambio de clase
+  // (tarea de IRQ o la propia tarea de la aplicación), -1 si no hay cambio
+  volatile int8_t _devclass_switched;
+
+  bool _postRadioEvent(yuboxlorawan_radio_event_type_t, bool result = false, uint8_t port = 0, uint8_t * p = NULL, uint8_t n = 0, int16_t rssi = 0, int8_t snr = 0);
   void _joinstart_handler(void);
   void _join_handler(void);
   void _joinfail_handler(void);
-  void _rx_handler(uint8_t *, uint8_t);
+  bool _rx_port_wanted(uint8_t);
+  void _rx_handler(uint8_t, uint8_t *, uint8_t, int16_t, int8_t);
+  void _dispatchRX(uint8_t, uint8_t *, size_t, int16_t, int8_t);
   void _tx_confirmed_result(bool);
 };
 
@@ -0,0 +1,316 @@
+#ifndef _YUBOX_LORAWAN_ENCODERS_H_
+#define _YUBOX_LORAWAN_ENCODERS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/*
+ * Codificadores de payload para telemetría compacta, que escriben directamente
+ * sobre un buffer provisto por el llamador sin asignación dinámica. Toda
+ * operación de escritura valida el espacio disponible antes de escribir: si no
+ * cabe el dato completo, el buffer queda sin cambios y se devuelve falso.
+ */
+
+// --- Cayenne LPP ---------------------------------------------------------
+
+typedef enum {
+  YBX_LPP_DIGITAL_INPUT   = 0,    // 1 byte, sin signo
+  YBX_LPP_DIGITAL_OUTPUT  = 1,    // 1 byte, sin signo
+  YBX_LPP_ANALOG_INPUT    = 2,    // 2 bytes, con signo, 0.01
+  YBX_LPP_ANALOG_OUTPUT   = 3,    // 2 bytes, con signo, 0.01
+  YBX_LPP_LUMINOSITY      = 101,  // 2 bytes, sin signo, 1 lux
+  YBX_LPP_PRESENCE        = 102,  // 1 byte, sin signo
+  YBX_LPP_TEMPERATURE     = 103,  // 2 bytes, con signo, 0.1 °C
+  YBX_LPP_RELATIVE_HUMIDITY = 104,  // 1 byte, sin signo, 0.5 %
+  YBX_LPP_ACCELEROMETER   = 113,  // 3 x 2 bytes, con signo, 0.001 G
+  YBX_LPP_BAROMETRIC_PRESSURE = 115,  // 2 bytes, sin signo, 0.1 hPa
+  YBX_LPP_GYROMETER       = 134,  // 3 x 2 bytes, con signo, 0.01 °/s
+  YBX_LPP_GPS             = 136   // 3 x 3 bytes, con signo, 0.0001 ° / 0.0001 ° / 0.01 m
+} yuboxlorawan_lpp_type_t;
+
+// Número de valores de un tipo, 0 si el tipo no es conocido
+constexpr uint8_t yuboxlorawan_lpp_nvals(uint8_t t)
+{
+  return (t == YBX_LPP_ACCELEROMETER || t == YBX_LPP_GYROMETER || t == YBX_LPP_GPS) ? 3
+    : (t == YBX_LPP_DIGITAL_INPUT || t == YBX_LPP_DIGITAL_OUTPUT || t == YBX_LPP_ANALOG_INPUT
+      || t == YBX_LPP_ANALOG_OUTPUT || t == YBX_LPP_LUMINOSITY || t == YBX_LPP_PRESENCE
+      || t == YBX_LPP_TEMPERATURE || t == YBX_LPP_RELATIVE_HUMIDITY || t == YBX_LPP_BAROMETRIC_PRESSURE) ? 1
+    : 0;
+}
+
+// Bytes por valor de un tipo
+constexpr uint8_t yuboxlorawan_lpp_valsize(uint8_t t)
+{
+  return (t == YBX_LPP_GPS) ? 3
+    : (t == YBX_LPP_DIGITAL_INPUT || t == YBX_LPP_DIGITAL_OUTPUT || t == YBX_LPP_PRESENCE
+      || t == YBX_LPP_RELATIVE_HUMIDITY) ? 1
+    : 2;
+}
+
+// Bytes de datos (sin canal ni tipo) de un tipo
+constexpr uint8_t yuboxlorawan_lpp_size(uint8_t t)
+{
+  return yuboxlorawan_lpp_nvals(t) * yuboxlorawan_lpp_valsize(t);
+}
+
+// Si los valores del tipo se interpretan con signo
+constexpr bool yuboxlorawan_lpp_signed(uint8_t t)
+{
+  return (t == YBX_LPP_ANALOG_INPUT || t == YBX_LPP_ANALOG_OUTPUT || t == YBX_LPP_TEMPERATURE
+    || t == YBX_LPP_ACCELEROMETER || t == YBX_LPP_GYROMETER || t == YBX_LPP_GPS);
+}
+
+// Divisor para convertir el valor crudo del índice i en unidades físicas
+constexpr uint32_t yuboxlorawan_lpp_divisor(uint8_t t, uint8_t i = 0)
+{
+  return (t == YBX_LPP_ANALOG_INPUT || t == YBX_LPP_ANALOG_OUTPUT || t == YBX_LPP_GYROMETER) ? 100
+    : (t == YBX_LPP_TEMPERATURE || t == YBX_LPP_BAROMETRIC_PRESSURE) ? 10
+    : (t == YBX_LPP_RELATIVE_HUMIDITY) ? 2
+    : (t == YBX_LPP_ACCELEROMETER) ? 1000
+    : (t == YBX_LPP_GPS) ? ((i < 2) ? 10000 : 100)
+    : 1;
+}
+
+class YuboxLoRaWANCayenneLPP
+{
+private:
+  uint8_t * _buf;
+  size_t _cap;
+  size_t _len;
+
+  static int32_t _round(float v, uint32_t div)
+  {
+    float x = v * div;
+    return (int32_t)((x < 0) ? (x - 0.5f) : (x + 0.5f));
+  }
+
+  static void _putval(uint8_t * p, int32_t v, uint8_t size)
+  {
+    for (int8_t i = size - 1; i >= 0; i--) {
+      p[i] = (uint8_t)(v & 0xFF);
+      v >>= 8;
+    }
+  }
+
+public:
+  YuboxLoRaWANCayenneLPP(uint8_t * buf, size_t cap) : _buf(buf), _cap(cap), _len(0) {}
+
+  void reset(void) { _len = 0; }
+  uint8_t * getBuffer(void) { return _buf; }
+  size_t length(void) { return _len; }
+  size_t available(void) { return _cap - _len; }
+
+  // Agregar valores crudos (ya escalados) de un tipo. Los valores fuera de
+  // rango se truncan al ancho del campo.
+  bool addRaw(uint8_t ch, uint8_t type, const int32_t * v)
+  {
+    uint8_t nv = yuboxlorawan_lpp_nvals(type);
+    if (nv == 0) return false;
+
+    uint8_t vs = yuboxlorawan_lpp_valsize(type);
+    size_t need = 2 + (size_t)nv * vs;
+    if (need > _cap - _len) return false;
+
+    uint8_t * p = _buf + _len;
+    *p++ = ch;
+    *p++ = type;
+    for (uint8_t i = 0; i < nv; i++, p += vs) _putval(p, v[i], vs);
+    _len += need;
+    return true;
+  }
+
+  bool addRaw(uint8_t ch, uint8_t type, int32_t v) { return addRaw(ch, type, &v); }
+
+  bool addDigitalInput(uint8_t ch, uint8_t v) { return addRaw(ch, YBX_LPP_DIGITAL_INPUT, v); }
+  bool addDigitalOutput(uint8_t ch, uint8_t v) { return addRaw(ch, YBX_LPP_DIGITAL_OUTPUT, v); }
+  bool addAnalogInput(uint8_t ch, float v) { return addRaw(ch, YBX_LPP_ANALOG_INPUT, _round(v, 100)); }
+  bool addAnalogOutput(uint8_t ch, float v) { return addRaw(ch, YBX_LPP_ANALOG_OUTPUT, _round(v, 100)); }
+  bool addLuminosity(uint8_t ch, uint16_t lux) { return addRaw(ch, YBX_LPP_LUMINOSITY, lux); }
+  bool addPresence(uint8_t ch, uint8_t v) { return addRaw(ch, YBX_LPP_PRESENCE, v); }
+  bool addTemperature(uint8_t ch, float celsius) { return addRaw(ch, YBX_LPP_TEMPERATURE, _round(celsius, 10)); }
+  bool addRelativeHumidity(uint8_t ch, float rh) { return addRaw(ch, YBX_LPP_RELATIVE_HUMIDITY, _round(rh, 2)); }
+  bool addBarometricPressure(uint8_t ch, float hpa) { return addRaw(ch, YBX_LPP_BAROMETRIC_PRESSURE, _round(hpa, 10)); }
+
+  bool addAccelerometer(uint8_t ch, float x, float y, float z)
+  {
+    int32_t v[3] = { _round(x, 1000), _round(y, 1000), _round(z, 1000) };
+    return addRaw(ch, YBX_LPP_ACCELEROMETER, v);
+  }
+
+  bool addGyrometer(uint8_t ch, float x, float y, float z)
+  {
+    int32_t v[3] = { _round(x, 100), _round(y, 100), _round(z, 100) };
+    return addRaw(ch, YBX_LPP_GYROMETER, v);
+  }
+
+  bool addGPS(uint8_t ch, float lat, float lon, float alt_m)
+  {
+    int32_t v[3] = { _round(lat, 10000), _round(lon, 10000), _round(alt_m, 100) };
+    return addRaw(ch, YBX_LPP_GPS, v);
+  }
+};
+
+typedef struct YuboxLoRaWAN_lpp_field
+{
+  uint8_t channel;
+  uint8_t type;
+  uint8_t nvals;
+  int32_t raw[3];
+} yuboxlorawan_lpp_field_t;
+
+// Recorrido de un payload Cayenne LPP, un campo a la vez
+class YuboxLoRaWANCayenneLPPReader
+{
+private:
+  const uint8_t * _buf;
+  size_t _len;
+  size_t _pos;
+  bool _error;
+
+public:
+  YuboxLoRaWANCayenneLPPReader(const uint8_t * buf, size_t len) : _buf(buf), _len(len), _pos(0), _error(false) {}
+
+  // Devuelve falso al terminar el payload, o ante un tipo desconocido o
+  // un campo truncado (en cuyo caso error() es verdadero)
+  bool next(yuboxlorawan_lpp_field_t & f)
+  {
+    if (_error || _pos >= _len) return false;
+    if (_len - _pos < 2) {
+      _error = true;
+      return false;
+    }
+
+    f.channel = _buf[_pos];
+    f.type = _buf[_pos + 1];
+    f.nvals = yuboxlorawan_lpp_nvals(f.type);
+    uint8_t vs = yuboxlorawan_lpp_valsize(f.type);
+    bool sgn = yuboxlorawan_lpp_signed(f.type);
+    if (f.nvals == 0 || _len - _pos - 2 < (size_t)f.nvals * vs) {
+      _error = true;
+      return false;
+    }
+
+    const uint8_t * p = _buf + _pos + 2;
+    for (uint8_t i = 0; i < f.nvals; i++, p += vs) {
+      uint32_t u = 0;
+      for (uint8_t j = 0; j < vs; j++) u = (u << 8) | p[j];
+      // Extensión de signo desde el ancho del campo
+      if (sgn && (u & (1UL << (8 * vs - 1)))) u |= ~((1UL << (8 * vs)) - 1);
+      f.raw[i] = (int32_t)u;
+    }
+    _pos += 2 + (size_t)f.nvals * vs;
+    return true;
+  }
+
+  // Valor del índice i del campo, en unidades físicas
+  static float value(const yuboxlorawan_lpp_field_t & f, uint8_t i = 0)
+  {
+    return (float)f.raw[i] / yuboxlorawan_lpp_divisor(f.type, i);
+  }
+
+  bool error(void) { return _error; }
+};
+
+// --- Series de tiempo delta + zig-zag + varint ----------------------------
+
+constexpr uint32_t yuboxlorawan_zigzag_encode(int32_t v)
+{
+  return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+constexpr int32_t yuboxlorawan_zigzag_decode(uint32_t u)
+{
+  return (int32_t)((u >> 1) ^ (~(u & 1) + 1));
+}
+
+// Bytes que ocupa u como varint LEB128 (1 a 5)
+constexpr uint8_t yuboxlorawan_varint_len(uint32_t u)
+{
+  return (u < (1UL << 7)) ? 1 : (u < (1UL << 14)) ? 2 : (u < (1UL << 21)) ? 3 : (u < (1UL << 28)) ? 4 : 5;
+}
+
+/*
+ * Empaquetado de una serie de enteros de 32 bits: el primer valor se codifica
+ * completo y cada siguiente como diferencia respecto al anterior, en zig-zag
+ * y varint. Las diferencias usan aritmética módulo 2^32, así que cualquier
+ * secuencia se decodifica exactamente. Una serie con variaciones pequeñas
+ * ocupa 1 byte por muestra.
+ */
+class YuboxLoRaWANDeltaPacker
+{
+private:
+  uint8_t * _buf;
+  size_t _cap;
+  size_t _len;
+  uint32_t _count;
+  uint32_t _prev;
+
+public:
+  YuboxLoRaWANDeltaPacker(uint8_t * buf, size_t cap) : _buf(buf), _cap(cap), _len(0), _count(0), _prev(0) {}
+
+  void reset(void) { _len = 0; _count = 0; _prev = 0; }
+
+  bool add(int32_t v)
+  {
+    uint32_t d = (uint32_t)v - _prev;
+    uint32_t u = yuboxlorawan_zigzag_encode((int32_t)d);
+    uint8_t n = yuboxlorawan_varint_len(u);
+    if (n > _cap - _len) return false;
+
+    uint8_t * p = _buf + _len;
+    while (u >= 0x80) {
+      *p++ = (uint8_t)(u | 0x80);
+      u >>= 7;
+    }
+    *p = (uint8_t)u;
+
+    _len += n;
+    _prev = (uint32_t)v;
+    _count++;
+    return true;
+  }
+
+  uint8_t * getBuffer(void) { return _buf; }
+  size_t length(void) { return _len; }
+  uint32_t count(void) { return _count; }
+};
+
+class YuboxLoRaWANDeltaUnpacker
+{
+private:
+  const uint8_t * _buf;
+  size_t _len;
+  size_t _pos;
+  uint32_t _prev;
+  bool _error;
+
+public:
+  YuboxLoRaWANDeltaUnpacker(const uint8_t * buf, size_t len) : _buf(buf), _len(len), _pos(0), _prev(0), _error(false) {}
+
+  // Devuelve falso al terminar la serie, o ante un varint truncado o de más
+  // de 5 bytes (en cuyo caso error() es verdadero)
+  bool next(int32_t & v)
+  {
+    if (_error || _pos >= _len) return false;
+
+    uint32_t u = 0;
+    for (uint8_t shift = 0; ; shift += 7) {
+      if (_pos >= _len || shift > 28) {
+        _error = true;
+        return false;
+      }
+      uint8_t b = _buf[_pos++];
+      u |= (uint32_t)(b & 0x7F) << shift;
+      if (!(b & 0x80)) break;
+    }
+
+    _prev += (uint32_t)yuboxlorawan_zigzag_decode(u);
+    v = (int32_t)_prev;
+    return true;
+  }
+
+  bool error(void) { return _error; }
+};
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef _YUBOX_LORAWAN_EVENT_RING_H_
+#define _YUBOX_LORAWAN_EVENT_RING_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+
+// Número de eventos de radio que pueden quedar pendientes. DEBE ser potencia de 2.
+#ifndef YUBOX_LORAWAN_EVENT_RING_LEN
+#define YUBOX_LORAWAN_EVENT_RING_LEN 8
+#endif
+
+// Máximo payload de aplicación LoRaWAN en cualquier región y datarate
+#ifndef YUBOX_LORAWAN_MAX_PAYLOAD
+#define YUBOX_LORAWAN_MAX_PAYLOAD 242
+#endif
+
+typedef enum {
+  YBX_LW_RADIO_JOINED = 0,
+  YBX_LW_RADIO_JOINFAIL = 1,
+  YBX_LW_RADIO_RX = 2,
+  YBX_LW_RADIO_TX_CONFIRM = 3
+} yuboxlorawan_radio_event_type_t;
+
+typedef struct YuboxLoRaWAN_radio_event
+{
+  uint8_t type;
+  bool result;
+  uint8_t port;
+  uint8_t len;
+  int16_t rssi;
+  int8_t snr;
+  uint32_t ts;        // micros() al publicar el evento
+  uint8_t payload[YUBOX_LORAWAN_MAX_PAYLOAD];
+} yuboxlorawan_radio_event_t;
+
+/*
+ * Anillo de un solo productor y un solo consumidor, sin bloqueos ni asignación
+ * dinámica. El productor es la tarea de IRQ de SX126x-Arduino, que llena los
+ * eventos desde los callbacks de radio. El consumidor es update(), que corre en
+ * la tarea de la aplicación. Si el anillo está lleno, el evento nuevo se
+ * descarta y se cuenta, para nunca bloquear la tarea de radio.
+ */
+class YuboxLoRaWANEventRing
+{
+private:
+  static_assert((YUBOX_LORAWAN_EVENT_RING_LEN & (YUBOX_LORAWAN_EVENT_RING_LEN - 1)) == 0,
+    "YUBOX_LORAWAN_EVENT_RING_LEN debe ser potencia de 2");
+
+  yuboxlorawan_radio_event_t _events[YUBOX_LORAWAN_EVENT_RING_LEN];
+
+  // _head sólo lo modifica el consumidor, _tail sólo el productor
+  std::atomic<uint32_t> _head;
+  std::atomic<uint32_t> _tail;
+  std::atomic<uint32_t> _num_dropped;
+
+public:
+  YuboxLoRaWANEventRing(void) : _head(0), _tail(0), _num_dropped(0) {}
+
+  // PRODUCTOR: obtener espacio para el siguiente evento, o NULL si está lleno
+  yuboxlorawan_radio_event_t * reserve(void)
+  {
+    uint32_t tail = _tail.load(std::memory_order_relaxed);
+    if (tail - _head.load(std::memory_order_acquire) >= YUBOX_LORAWAN_EVENT_RING_LEN) {
+      _num_dropped.fetch_add(1, std::memory_order_relaxed);
+      return NULL;
+    }
+    return &(_events[tail & (YUBOX_LORAWAN_EVENT_RING_LEN - 1)]);
+  }
+
+  // PRODUCTOR: publicar el evento obtenido con reserve()
+  void commit(void)
+  {
+    _tail.store(_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  // CONSUMIDOR: evento más antiguo pendiente, o NULL si no hay eventos
+  yuboxlorawan_radio_event_t * peek(void)
+  {
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    if (head == _tail.load(std::memory_order_acquire)) return NULL;
+    return &(_events[head & (YUBOX_LORAWAN_EVENT_RING_LEN - 1)]);
+  }
+
+  // CONSUMIDOR: liberar el evento devuelto por peek(), luego de procesarlo
+  void release(void)
+  {
+    _head.store(_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  uint32_t pending(void)
+  {
+    return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+  }
+
+  uint32_t getNumDropped(void) { return _num_dropped.load(std::memory_order_relaxed); }
+};
+
+#endif
@@ -0,0 +1,351 @@
+#include <Arduino.h>
+
+#include "YuboxLoRaWANFlashLog.h"
+
+YuboxLoRaWANFlashLog::YuboxLoRaWANFlashLog(void)
+{
+    _part = NULL;
+    _nsec = 0;
+    _seq = 1;
+    _wsec = 0;
+    _wbase = 0;
+    _wlen = 0;
+    _wcount = 0;
+    _ts_wfirst = 0;
+    _rsec = 0;
+    _roff = 0;
+    _rvalid = false;
+    _num_pending = 0;
+    _num_written = 0;
+    _num_done = 0;
+    _num_lost = 0;
+    _num_corrupt = 0;
+    _num_mark_fail = 0;
+}
+
+uint16_t YuboxLoRaWANFlashLog::_crc(const yuboxlorawan_log_hdr_t & h, const uint8_t * p)
+{
+    // CRC-16/CCITT-FALSE sobre los campos inmutables del encabezado y el payload
+    uint8_t fixed[8] = {
+        h.magic, (uint8_t)(h.flags & YBX_LOG_F_UNCONFIRMED), h.port, h.len,
+        (uint8_t)(h.seq), (uint8_t)(h.seq >> 8), (uint8_t)(h.seq >> 16), (uint8_t)(h.seq >> 24)
+    };
+    uint16_t crc = 0xFFFF;
+    for (uint32_t i = 0; i < sizeof(fixed) + h.len; i++) {
+        crc ^= ((uint16_t)((i < sizeof(fixed)) ? fixed[i] : p[i - sizeof(fixed)])) << 8;
+        for (auto j = 0; j < 8; j++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+    }
+    return crc;
+}
+
+bool YuboxLoRaWANFlashLog::_readHdr(uint32_t sec, uint32_t off, yuboxlorawan_log_hdr_t & h)
+{
+    if (off + sizeof(h) > YUBOX_LORAWAN_LOG_SECTOR) return false;
+    return (esp_partition_read(_part, _addr(sec, off), &h, sizeof(h)) == ESP_OK);
+}
+
+bool YuboxLoRaWANFlashLog::_checkRecord(uint32_t sec, uint32_t off, const yuboxlorawan_log_hdr_t & h, uint8_t * p)
+{
+    uint8_t buf[YUBOX_LORAWAN_LOG_PAGE];
+
+    if (h.magic != YBX_LOG_MAGIC) return false;
+    if (off + _recSize(h.len) > YUBOX_LORAWAN_LOG_SECTOR) return false;
+    if (p == NULL) p = buf;
+    if (h.len > 0 && esp_partition_read(_part, _addr(sec, off) + sizeof(h), p, h.len) != ESP_OK) return false;
+    return (_crc(h, p) == h.crc);
+}
+
+/*
+ * Recorrer los registros de un sector desde el inicio. Devuelve el
+ * desplazamiento donde puede escribirse el siguiente registro, o el tamaño de
+ * sector si el sector contiene datos no reconocidos y no puede extenderse.
+ */
+uint32_t YuboxLoRaWANFlashLog::_sectorEnd(uint32_t sec, uint32_t * maxseq, uint32_t * npending)
+{
+    uint32_t off = 0;
+    yuboxlorawan_log_hdr_t h;
+
+    while (off + sizeof(h) <= YUBOX_LORAWAN_LOG_SECTOR) {
+        if (!_readHdr(sec, off, h)) return YUBOX_LORAWAN_LOG_SECTOR;
+        if (h.magic == 0xFF) return off;
+        if (h.magic != YBX_LOG_MAGIC) return YUBOX_LORAWAN_LOG_SECTOR;
+
+        uint32_t sz = _recSize(h.len);
+        if (off + sz > YUBOX_LORAWAN_LOG_SECTOR) return YUBOX_LORAWAN_LOG_SECTOR;
+
+        // Un registro con CRC inválido (escritura interrumpida) no aporta
+        // secuencia, pero cuenta como pendiente hasta que la lectura lo salte
+        if (maxseq != NULL && (int32_t)(h.seq - *maxseq) > 0 && _checkRecord(sec, off, h)) *maxseq = h.seq;
+        if (npending != NULL && (h.flags & YBX_LOG_F_PENDING)) (*npending)++;
+        off += sz;
+    }
+    return off;
+}
+
+bool YuboxLoRaWANFlashLog::begin(const char * label)
+{
+    _part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    if (_part == NULL) return false;
+
+    _nsec = _part->size / YUBOX_LORAWAN_LOG_SECTOR;
+    if (_nsec < 2) {
+        log_e("Partición %s demasiado pequeña para log de uplinks (%u bytes)", label, _part->size);
+        _part = NULL;
+        return false;
+    }
+
+    // El sector más reciente es el de mayor secuencia en su primer registro
+    bool found = false;
+    uint32_t headsec = 0;
+    uint32_t headseq = 0;
+    for (uint32_t s = 0; s < _nsec; s++) {
+        yuboxlorawan_log_hdr_t h;
+        if (!_readHdr(s, 0, h)) continue;
+        if (h.magic == 0xFF) continue;
+        if (h.magic != YBX_LOG_MAGIC) {
+            // Datos ajenos al log, por ejemplo de un uso anterior de la partición
+            esp_partition_erase_range(_part, _addr(s, 0), YUBOX_LORAWAN_LOG_SECTOR);
+            continue;
+        }
+        if (!_checkRecord(s, 0, h)) continue;
+        if (!found || (int32_t)(h.seq - headseq) > 0) {
+            found = true;
+            headsec = s;
+            headseq = h.seq;
+        }
+    }
+
+    _wlen = 0;
+    _wcount = 0;
+    _rvalid = false;
+    _num_pending = 0;
+    if (!found) {
+        _seq = 1;
+        _wsec = 0;
+        _wbase = 0;
+        _rsec = 0;
+        _roff = 0;
+        return true;
+    }
+
+    uint32_t maxseq = headseq;
+    _wsec = headsec;
+    _wbase = _sectorEnd(headsec, &maxseq, NULL);
+    _seq = maxseq + 1;
+
+    // El sector más antiguo es el primero con datos luego del más reciente
+    uint32_t oldest = headsec;
+    for (uint32_t i = 1; i < _nsec; i++) {
+        uint32_t s = (headsec + i) % _nsec;
+        yuboxlorawan_log_hdr_t h;
+        if (_readHdr(s, 0, h) && h.magic == YBX_LOG_MAGIC) {
+            oldest = s;
+            break;
+        }
+    }
+    for (uint32_t s = oldest; ; s = (s + 1) % _nsec) {
+        _sectorEnd(s, NULL, &_num_pending);
+        if (s == headsec) break;
+    }
+
+    _rsec = oldest;
+    _roff = 0;
+    _seekPending();
+
+    log_i("Log de uplinks en flash: %u sectores, %u registros pendientes, secuencia %u",
+        _nsec, _num_pending, _seq);
+    return true;
+}
+
+// Avanzar la lectura hasta el siguiente registro válido y pendiente en flash
+bool YuboxLoRaWANFlashLog::_seekPending(void)
+{
+    _rvalid = false;
+    while (true) {
+        if (_rsec == _wsec && _roff >= _wbase) {
+            _roff = _wbase;
+            return false;
+        }
+
+        yuboxlorawan_log_hdr_t h;
+        if (!_readHdr(_rsec, _roff, h) || h.magic != YBX_LOG_MAGIC
+            || _roff + _recSize(h.len) > YUBOX_LORAWAN_LOG_SECTOR) {
+            // Fin de los datos del sector
+            if (_rsec == _wsec) {
+                _roff = _wbase;
+                return false;
+            }
+            _rsec = (_rsec + 1) % _nsec;
+            _roff = 0;
+            continue;
+        }
+
+        if (h.flags & YBX_LOG_F_PENDING) {
+            if (_checkRecord(_rsec, _roff, h)) {
+                _rhdr = h;
+                _rvalid = true;
+                return true;
+            }
+            _num_corrupt++;
+            _num_pending--;
+        }
+        _roff += _recSize(h.len);
+    }
+}
+
+/*
+ * Iniciar la escritura en el sector siguiente. Si el sector contiene
+ * registros todavía pendientes, éstos se pierden al borrarlo.
+ */
+bool YuboxLoRaWANFlashLog::_advanceSector(void)
+{
+    uint32_t next = (_wsec + 1) % _nsec;
+    uint32_t lost = 0;
+
+    // Sólo cuentan los pendientes desde la posición de lectura
+    if (_rsec == next) {
+        yuboxlorawan_log_hdr_t h;
+        uint32_t off = _roff;
+        while (_readHdr(next, off, h) && h.magic == YBX_LOG_MAGIC
+            && off + _recSize(h.len) <= YUBOX_LORAWAN_LOG_SECTOR) {
+            if (h.flags & YBX_LOG_F_PENDING) lost++;
+            off += _recSize(h.len);
+        }
+        _rsec = (next + 1) % _nsec;
+        _roff = 0;
+        _rvalid = false;
+    }
+    if (lost > 0) {
+        log_w("Log de uplinks lleno, se sobrescriben %u registros pendientes", lost);
+        _num_pending -= lost;
+        _num_lost += lost;
+    }
+
+    if (esp_partition_erase_range(_part, _addr(next, 0), YUBOX_LORAWAN_LOG_SECTOR) != ESP_OK) {
+        log_e("No se puede borrar sector %u del log de uplinks", next);
+        return false;
+    }
+    _wsec = next;
+    _wbase = 0;
+    return true;
+}
+
+bool YuboxLoRaWANFlashLog::append(uint8_t port, bool confirmed, const uint8_t * p, uint8_t n, uint32_t now)
+{
+    if (_part == NULL) return false;
+    if (p == NULL) n = 0;
+
+    uint32_t sz = _recSize(n);
+    if (sz > YUBOX_LORAWAN_LOG_PAGE) return false;
+
+    if (_wbase + _wlen + sz > YUBOX_LORAWAN_LOG_SECTOR) {
+        if (!flush() || !_advanceSector()) return false;
+    } else if (_wlen + sz > YUBOX_LORAWAN_LOG_PAGE) {
+        if (!flush()) return false;
+    }
+
+    yuboxlorawan_log_hdr_t h;
+    h.magic = YBX_LOG_MAGIC;
+    h.flags = confirmed ? (0xFF & ~YBX_LOG_F_UNCONFIRMED) : 0xFF;
+    h.port = port;
+    h.len = n;
+    h.seq = _seq;
+    h.reserved = 0xFFFF;
+    h.crc = _crc(h, p);
+
+    uint8_t * r = _wbuf + _wlen;
+    memcpy(r, &h, sizeof(h));
+    if (n > 0) memcpy(r + sizeof(h), p, n);
+    memset(r + sizeof(h) + n, 0xFF, sz - sizeof(h) - n);
+
+    if (_wcount == 0) _ts_wfirst = now;
+    _wlen += sz;
+    _wcount++;
+    _seq++;
+    _num_pending++;
+    _num_written++;
+    return true;
+}
+
+bool YuboxLoRaWANFlashLog::flush(void)
+{
+    if (_part == NULL) return false;
+    if (_wlen == 0) return true;
+
+    esp_err_t err = esp_partition_write(_part, _addr(_wsec, _wbase), _wbuf, _wlen);
+    if (err != ESP_OK) {
+        // La zona pudo quedar parcialmente escrita, no se reusa
+        log_e("Fallo al escribir log de uplinks (%d), se pierden %u registros", err, _wcount);
+        _num_pending -= _wcount;
+        _num_lost += _wcount;
+    }
+    _wbase += _wlen;
+    _wlen = 0;
+    _wcount = 0;
+    return (err == ESP_OK);
+}
+
+void YuboxLoRaWANFlashLog::update(uint32_t now)
+{
+    if (_wcount > 0 && now - _ts_wfirst >= YUBOX_LORAWAN_LOG_FLUSH_MS) flush();
+}
+
+bool YuboxLoRaWANFlashLog::peek(yuboxlorawan_uplink_t & m, uint32_t & seq)
+{
+    if (_part == NULL || _num_pending == 0) return false;
+
+    if (!_rvalid) {
+        // Los registros todavía en RAM se leen desde flash como los demás
+        if (_wcount > 0 && _rsec == _wsec && _roff >= _wbase) flush();
+        if (!_seekPending()) return false;
+    }
+
+    if (!_checkRecord(_rsec, _roff, _rhdr, m.payload)) {
+        _num_corrupt++;
+        _num_pending--;
+        _roff += _recSize(_rhdr.len);
+        _rvalid = false;
+        return false;
+    }
+    m.port = _rhdr.port;
+    m.confirmed = !(_rhdr.flags & YBX_LOG_F_UNCONFIRMED);
+    m.len = _rhdr.len;
+    seq = _rhdr.seq;
+    return true;
+}
+
+/*
+ * Programar a 0 el bit de pendiente del registro leído, sin borrar el sector, y
+ * avanzar la lectura. Si la escritura falla, el registro queda terminado en RAM
+ * pero pendiente en flash, y se reproduce otra vez luego de reiniciar.
+ */
+bool YuboxLoRaWANFlashLog::_clearPending(void)
+{
+    uint8_t f = _rhdr.flags & ~YBX_LOG_F_PENDING;
+    esp_err_t err = esp_partition_write(_part, _addr(_rsec, _roff) + offsetof(yuboxlorawan_log_hdr_t, flags), &f, 1);
+    if (err != ESP_OK) {
+        log_e("No se puede marcar registro %u del log de uplinks (%d), se repetirá al reiniciar", _rhdr.seq, err);
+        _num_mark_fail++;
+    }
+
+    _num_pending--;
+    _roff += _recSize(_rhdr.len);
+    _rvalid = false;
+    return (err == ESP_OK);
+}
+
+bool YuboxLoRaWANFlashLog::markDone(uint32_t seq)
+{
+    if (_part == NULL || !_rvalid || _rhdr.seq != seq) return false;
+
+    _num_done++;
+    return _clearPending();
+}
+
+bool YuboxLoRaWANFlashLog::markLost(uint32_t seq)
+{
+    if (_part == NULL || !_rvalid || _rhdr.seq != seq) return false;
+
+    _num_lost++;
+    return _clearPending();
+}
@@ -0,0 +1,139 @@
+#ifndef _YUBOX_LORAWAN_FLASH_LOG_H_
+#define _YUBOX_LORAWAN_FLASH_LOG_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <esp_partition.h>
+
+#include "YuboxLoRaWANUplinkQueue.h"
+
+// Etiqueta de la partición de datos (subtipo cualquiera) que guarda el log.
+// Si la tabla de particiones no la define, el log queda desactivado.
+#ifndef YUBOX_LORAWAN_LOG_PARTITION_LABEL
+#define YUBOX_LORAWAN_LOG_PARTITION_LABEL "lorawanlog"
+#endif
+
+// Tamaño del buffer en RAM que se escribe a flash en una sola operación
+#ifndef YUBOX_LORAWAN_LOG_PAGE
+#define YUBOX_LORAWAN_LOG_PAGE 256
+#endif
+
+// Tiempo máximo que un registro permanece en el buffer RAM sin escribirse
+#ifndef YUBOX_LORAWAN_LOG_FLUSH_MS
+#define YUBOX_LORAWAN_LOG_FLUSH_MS 5000
+#endif
+
+#define YUBOX_LORAWAN_LOG_SECTOR 4096
+
+/*
+ * Encabezado de cada registro en flash, seguido del payload y de relleno
+ * hasta múltiplo de 4 bytes. Un registro nunca cruza un límite de sector.
+ * Las banderas usan la propiedad de la flash NOR de que un bit sólo puede
+ * pasar de 1 a 0 sin borrar el sector: la marca de registro despachado se
+ * escribe sobre el mismo byte, y el CRC no la cubre.
+ */
+typedef struct __attribute__((packed)) YuboxLoRaWAN_log_hdr
+{
+  uint8_t magic;
+  uint8_t flags;
+  uint8_t port;
+  uint8_t len;
+  uint32_t seq;
+  uint16_t crc;
+  uint16_t reserved;
+} yuboxlorawan_log_hdr_t;
+
+#define YBX_LOG_MAGIC 0xA5
+#define YBX_LOG_F_UNCONFIRMED 0x01    // 1 si el uplink no es confirmado, fijado al escribir
+#define YBX_LOG_F_PENDING 0x02        // 1 mientras el uplink no se ha despachado
+
+/*
+ * Log circular de uplinks pendientes sobre una partición de flash cruda. Los
+ * registros nuevos se acumulan en un buffer RAM de YUBOX_LORAWAN_LOG_PAGE
+ * bytes que se escribe completo, así que la flash recibe una escritura por
+ * página y no una por registro. Al llenarse la partición se borra el sector
+ * más antiguo, perdiendo los registros que aún estuvieran pendientes. El
+ * orden de lectura es el orden de escritura, también luego de reiniciar.
+ */
+class YuboxLoRaWANFlashLog
+{
+private:
+  const esp_partition_t * _part;
+  uint32_t _nsec;
+
+  // Próximo número de secuencia a asignar
+  uint32_t _seq;
+
+  // Escritura: sector actual y desplazamiento donde empieza el buffer RAM
+  uint32_t _wsec;
+  uint32_t _wbase;
+  uint8_t _wbuf[YUBOX_LORAWAN_LOG_PAGE];
+  uint32_t _wlen;
+  uint32_t _wcount;
+  uint32_t _ts_wfirst;
+
+  // Lectura: posición del registro pendiente más antiguo
+  uint32_t _rsec;
+  uint32_t _roff;
+  bool _rvalid;
+  yuboxlorawan_log_hdr_t _rhdr;
+
+  uint32_t _num_pending;
+  uint32_t _num_written;
+  uint32_t _num_done;
+  uint32_t _num_lost;
+  uint32_t _num_corrupt;
+  uint32_t _num_mark_fail;
+
+  static uint32_t _recSize(uint8_t len) { return (sizeof(yuboxlorawan_log_hdr_t) + len + 3) & ~3UL; }
+  static uint16_t _crc(const yuboxlorawan_log_hdr_t &, const uint8_t *);
+
+  uint32_t _addr(uint32_t sec, uint32_t off) { return sec * YUBOX_LORAWAN_LOG_SECTOR + off; }
+  bool _readHdr(uint32_t sec, uint32_t off, yuboxlorawan_log_hdr_t &);
+  bool _checkRecord(uint32_t sec, uint32_t off, const yuboxlorawan_log_hdr_t &, uint8_t * p = NULL);
+  uint32_t _sectorEnd(uint32_t sec, uint32_t * maxseq, uint32_t * npending);
+  bool _advanceSector(void);
+  bool _seekPending(void);
+  bool _clearPending(void);
+
+public:
+  YuboxLoRaWANFlashLog(void);
+
+  // Localizar la partición y recuperar el estado del log. Devuelve falso si no
+  // existe la partición.
+  bool begin(const char * label = YUBOX_LORAWAN_LOG_PARTITION_LABEL);
+  bool ready(void) { return _part != NULL; }
+
+  // Agregar un uplink al log. Queda en RAM hasta el siguiente flush().
+  bool append(uint8_t port, bool confirmed, const uint8_t * p, uint8_t n, uint32_t now);
+
+  // Escribir a flash los registros acumulados en RAM
+  bool flush(void);
+
+  // Escribir a flash si el registro más antiguo en RAM excede YUBOX_LORAWAN_LOG_FLUSH_MS
+  void update(uint32_t now);
+
+  // Copiar el registro pendiente más antiguo a m, y devolver su secuencia en
+  // seq. Devuelve falso si no hay registros pendientes.
+  bool peek(yuboxlorawan_uplink_t & m, uint32_t & seq);
+
+  // Marcar como despachado el registro pendiente más antiguo, si su secuencia
+  // es seq (el registro pudo haberse perdido por sobrescritura mientras tanto).
+  // Devuelve falso también si falla la escritura de la marca en flash.
+  bool markDone(uint32_t seq);
+
+  // Como markDone(), pero el registro se descarta sin despachar y se cuenta
+  // como perdido
+  bool markLost(uint32_t seq);
+
+  uint32_t getNumPending(void) { return _num_pending; }
+  uint32_t getNumWritten(void) { return _num_written; }
+  uint32_t getNumDone(void) { return _num_done; }
+  uint32_t getNumLost(void) { return _num_lost; }
+  uint32_t getNumCorrupt(void) { return _num_corrupt; }
+  uint32_t getNumMarkFailures(void) { return _num_mark_fail; }
+  uint32_t getCapacity(void) { return _nsec * YUBOX_LORAWAN_LOG_SECTOR; }
+};
+
+#endif
@@ -0,0 +1,205 @@
+#ifndef _YUBOX_LORAWAN_FRAGMENT_H_
+#define _YUBOX_LORAWAN_FRAGMENT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Puerto FPort reservado para fragmentos, en ambas direcciones
+#ifndef YUBOX_LORAWAN_FRAG_PORT
+#define YUBOX_LORAWAN_FRAG_PORT 222
+#endif
+
+// Tamaño máximo de un mensaje fragmentado, y memoria usada para reensamblar
+#ifndef YUBOX_LORAWAN_FRAG_MAX_MSG
+#define YUBOX_LORAWAN_FRAG_MAX_MSG 1024
+#endif
+
+// Tiempo máximo para recibir todos los fragmentos de un mensaje downlink
+#ifndef YUBOX_LORAWAN_FRAG_TIMEOUT_MS
+#define YUBOX_LORAWAN_FRAG_TIMEOUT_MS 600000UL
+#endif
+
+/*
+ * Cada fragmento lleva un encabezado de 3 bytes seguido de los datos:
+ *   byte 0: ID de mensaje, igual en todos los fragmentos del mensaje
+ *   byte 1: índice del fragmento (4 bits altos) y número de fragmentos - 1 (4 bits bajos)
+ *   byte 2: FPort del mensaje original
+ * Todos los fragmentos excepto el último llevan la misma cantidad de datos.
+ */
+#define YUBOX_LORAWAN_FRAG_HEADER 3
+#define YUBOX_LORAWAN_FRAG_MAX_COUNT 16
+
+// Número de fragmentos necesarios para n bytes con fragmentos de máximo
+// maxpayload bytes (incluyendo encabezado), o 0 si no es posible.
+inline uint8_t yuboxlorawan_frag_count(size_t n, uint8_t maxpayload)
+{
+  if (maxpayload <= YUBOX_LORAWAN_FRAG_HEADER || n == 0 || n > YUBOX_LORAWAN_FRAG_MAX_MSG) return 0;
+
+  size_t fraglen = maxpayload - YUBOX_LORAWAN_FRAG_HEADER;
+  size_t cnt = (n + fraglen - 1) / fraglen;
+  return (cnt > YUBOX_LORAWAN_FRAG_MAX_COUNT) ? 0 : (uint8_t)cnt;
+}
+
+// Escribir el fragmento idx en dst, que debe tener al menos maxpayload bytes.
+// Devuelve la longitud total del fragmento.
+inline uint8_t yuboxlorawan_frag_build(uint8_t * dst, uint8_t msgid, uint8_t idx, uint8_t cnt, uint8_t port,
+  const uint8_t * p, size_t n, uint8_t maxpayload)
+{
+  size_t fraglen = maxpayload - YUBOX_LORAWAN_FRAG_HEADER;
+  size_t off = (size_t)idx * fraglen;
+  size_t len = (off + fraglen <= n) ? fraglen : n - off;
+
+  dst[0] = msgid;
+  dst[1] = (uint8_t)((idx << 4) | ((cnt - 1) & 0x0F));
+  dst[2] = port;
+  memcpy(dst + YUBOX_LORAWAN_FRAG_HEADER, p + off, len);
+  return (uint8_t)(YUBOX_LORAWAN_FRAG_HEADER + len);
+}
+
+/*
+ * Reensamblado de UN mensaje downlink fragmentado a la vez, en un buffer fijo
+ * de YUBOX_LORAWAN_FRAG_MAX_MSG bytes. Un fragmento de un ID de mensaje
+ * distinto descarta el mensaje incompleto en curso. El último fragmento puede
+ * llegar antes que los demás: se guarda al final del buffer hasta conocer la
+ * longitud de los fragmentos intermedios.
+ */
+class YuboxLoRaWANReassembler
+{
+private:
+  uint8_t _buf[YUBOX_LORAWAN_FRAG_MAX_MSG];
+  bool _active;
+  uint8_t _msgid;
+  uint8_t _cnt;
+  uint8_t _port;
+  uint16_t _have;
+  uint16_t _fraglen;
+  uint16_t _lastlen;
+  bool _lastAtTail;
+  uint32_t _ts_start;
+
+  uint32_t _num_complete;
+  uint32_t _num_discarded;
+
+  void _discard(void)
+  {
+    if (_active) _num_discarded++;
+    _active = false;
+  }
+
+  // Mover el último fragmento desde el final del buffer a su posición definitiva
+  bool _placeLast(void)
+  {
+    size_t off = (size_t)(_cnt - 1) * _fraglen;
+    if (off + _lastlen > sizeof(_buf)) return false;
+    memmove(_buf + off, _buf + sizeof(_buf) - _lastlen, _lastlen);
+    _lastAtTail = false;
+    return true;
+  }
+
+public:
+  YuboxLoRaWANReassembler(void) : _active(false), _num_complete(0), _num_discarded(0) {}
+
+  // Agregar un fragmento recibido (con encabezado). Devuelve verdadero cuando
+  // el mensaje queda completo; el mensaje está disponible vía data()/length()/port()
+  // hasta el siguiente fragmento.
+  bool add(const uint8_t * f, size_t n, uint32_t now)
+  {
+    if (n < YUBOX_LORAWAN_FRAG_HEADER) {
+      _num_discarded++;
+      return false;
+    }
+
+    uint8_t msgid = f[0];
+    uint8_t idx = f[1] >> 4;
+    uint8_t cnt = (f[1] & 0x0F) + 1;
+    uint8_t port = f[2];
+    const uint8_t * d = f + YUBOX_LORAWAN_FRAG_HEADER;
+    size_t len = n - YUBOX_LORAWAN_FRAG_HEADER;
+
+    if (idx >= cnt) {
+      _num_discarded++;
+      return false;
+    }
+
+    if (!_active || msgid != _msgid || cnt != _cnt || port != _port) {
+      _discard();
+      _active = true;
+      _msgid = msgid;
+      _cnt = cnt;
+      _port = port;
+      _have = 0;
+      _fraglen = 0;
+      _lastlen = 0;
+      _lastAtTail = false;
+      _ts_start = now;
+    }
+
+    // Fragmento repetido, por ejemplo por retransmisión del servidor
+    if (_have & (1 << idx)) return false;
+
+    bool isLast = (idx == cnt - 1);
+    if (!isLast) {
+      if (_fraglen == 0) {
+        if (len == 0 || (size_t)(cnt - 1) * len > sizeof(_buf)) {
+          _discard();
+          return false;
+        }
+        _fraglen = len;
+      } else if (len != _fraglen) {
+        _discard();
+        return false;
+      }
+      memcpy(_buf + (size_t)idx * _fraglen, d, len);
+      if (_lastAtTail && !_placeLast()) {
+        _discard();
+        return false;
+      }
+    } else {
+      if (len > sizeof(_buf)) {
+        _discard();
+        return false;
+      }
+      _lastlen = len;
+      if (_fraglen == 0 && cnt > 1) {
+        memcpy(_buf + sizeof(_buf) - len, d, len);
+        _lastAtTail = true;
+      } else {
+        size_t off = (size_t)(cnt - 1) * _fraglen;
+        if (off + len > sizeof(_buf)) {
+          _discard();
+          return false;
+        }
+        memcpy(_buf + off, d, len);
+      }
+    }
+    _have |= (1 << idx);
+
+    if (_have != (uint16_t)((1UL << cnt) - 1)) return false;
+
+    _active = false;
+    _num_complete++;
+    return true;
+  }
+
+  // Descartar el mensaje incompleto si pasó el tiempo máximo. Devuelve
+  // verdadero si se descartó.
+  bool expire(uint32_t now, uint32_t timeout = YUBOX_LORAWAN_FRAG_TIMEOUT_MS)
+  {
+    if (!_active || now - _ts_start < timeout) return false;
+    _discard();
+    return true;
+  }
+
+  bool pending(void) { return _active; }
+
+  // Mensaje completo más reciente
+  uint8_t * data(void) { return _buf; }
+  size_t length(void) { return (size_t)(_cnt - 1) * _fraglen + _lastlen; }
+  uint8_t port(void) { return _port; }
+
+  uint32_t getNumComplete(void) { return _num_complete; }
+  uint32_t getNumDiscarded(void) { return _num_discarded; }
+};
+
+#endif
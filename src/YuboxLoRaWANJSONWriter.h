@@ -0,0 +1,211 @@
+#ifndef _YUBOX_LORAWAN_JSON_WRITER_H_
+#define _YUBOX_LORAWAN_JSON_WRITER_H_
+
+#include <stdint.h>
+#include <string.h>
+
+// Tabla de valores de dígitos hexadecimales, -1 si el caracter no es hexadecimal
+static const int8_t yuboxlorawan_hexval_table[256] = {
+#define YBX_HX_16 -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1
+  YBX_HX_16, YBX_HX_16, YBX_HX_16,
+  0, 1, 2, 3, 4, 5, 6, 7, 8, 9,-1,-1,-1,-1,-1,-1,
+ -1,10,11,12,13,14,15,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+  YBX_HX_16,
+ -1,10,11,12,13,14,15,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+  YBX_HX_16, YBX_HX_16, YBX_HX_16, YBX_HX_16,
+  YBX_HX_16, YBX_HX_16, YBX_HX_16, YBX_HX_16, YBX_HX_16
+#undef YBX_HX_16
+};
+
+static const char yuboxlorawan_hexdigits[] = "0123456789abcdef";
+
+// Codificar n bytes como 2n dígitos hexadecimales en minúsculas, terminados en \0.
+// El buffer de destino debe tener al menos 2n+1 bytes.
+inline void yuboxlorawan_bin2hex(const uint8_t * p, size_t n, char * s)
+{
+  while (n > 0) {
+    *s++ = yuboxlorawan_hexdigits[*p >> 4];
+    *s++ = yuboxlorawan_hexdigits[*p & 0x0F];
+    n--; p++;
+  }
+  *s = '\0';
+}
+
+// Decodificar exactamente 2n dígitos hexadecimales a n bytes. Devuelve falso si
+// la cadena es más corta o contiene caracteres no hexadecimales.
+inline bool yuboxlorawan_hex2bin(const char * s, uint8_t * p, size_t n)
+{
+  while (n > 0) {
+    int8_t hi = yuboxlorawan_hexval_table[(uint8_t)s[0]];
+    if (hi < 0) return false;   // incluye \0
+    int8_t lo = yuboxlorawan_hexval_table[(uint8_t)s[1]];
+    if (lo < 0) return false;
+    *p = (uint8_t)((hi << 4) | lo);
+    n--; p++; s += 2;
+  }
+  return true;
+}
+
+/*
+ * Generador de JSON sobre un buffer de tamaño fijo provisto por el llamador,
+ * sin asignación dinámica de memoria. Si el buffer se llena, el resultado se
+ * trunca y overflow() devuelve verdadero; el buffer siempre queda terminado
+ * en \0.
+ */
+class YuboxLoRaWANJSONWriter
+{
+private:
+  char * _buf;
+  size_t _cap;
+  size_t _len;
+  bool _overflow;
+
+  // Bit N activo si ya se escribió algún elemento en el nivel de anidamiento N
+  uint32_t _hasElem;
+  uint8_t _depth;
+  bool _afterKey;
+
+  void _put(char c)
+  {
+    if (_len + 1 < _cap) {
+      _buf[_len++] = c;
+      _buf[_len] = '\0';
+    } else {
+      _overflow = true;
+    }
+  }
+
+  void _puts(const char * s) { while (*s) _put(*s++); }
+
+  // Separador antes de un nuevo elemento del contenedor actual
+  void _sep(void)
+  {
+    if (_afterKey) {
+      _afterKey = false;
+      return;
+    }
+    if (_hasElem & (1UL << _depth)) _put(',');
+    _hasElem |= (1UL << _depth);
+  }
+
+  void _open(char c)
+  {
+    _sep();
+    _put(c);
+    if (_depth < 31) _depth++;
+    _hasElem &= ~(1UL << _depth);
+  }
+
+  void _close(char c)
+  {
+    if (_depth > 0) _depth--;
+    _put(c);
+  }
+
+  void _quoted(const char * s)
+  {
+    _put('"');
+    for (; *s; s++) {
+      uint8_t c = (uint8_t)*s;
+      if (c == '"' || c == '\\') {
+        _put('\\'); _put(c);
+      } else if (c < 0x20) {
+        _puts("\\u00");
+        _put(yuboxlorawan_hexdigits[c >> 4]);
+        _put(yuboxlorawan_hexdigits[c & 0x0F]);
+      } else {
+        _put(c);
+      }
+    }
+    _put('"');
+  }
+
+  void _uint(uint32_t v)
+  {
+    char tmp[11];
+    uint8_t i = sizeof(tmp);
+    tmp[--i] = '\0';
+    do {
+      tmp[--i] = '0' + (v % 10);
+      v /= 10;
+    } while (v > 0);
+    _puts(tmp + i);
+  }
+
+  // Variante de 64 bits, aparte para no pagar la división de 64 bits en _uint()
+  void _uint64(uint64_t v)
+  {
+    char tmp[21];
+    uint8_t i = sizeof(tmp);
+    tmp[--i] = '\0';
+    do {
+      tmp[--i] = '0' + (v % 10);
+      v /= 10;
+    } while (v > 0);
+    _puts(tmp + i);
+  }
+
+public:
+  YuboxLoRaWANJSONWriter(char * buf, size_t cap)
+    : _buf(buf), _cap(cap), _len(0), _overflow(false), _hasElem(0), _depth(0), _afterKey(false)
+  {
+    if (_cap > 0) _buf[0] = '\0';
+  }
+
+  void beginObject(void) { _open('{'); }
+  void endObject(void) { _close('}'); }
+  void beginArray(void) { _open('['); }
+  void endArray(void) { _close(']'); }
+
+  void key(const char * k)
+  {
+    _sep();
+    _quoted(k);
+    _put(':');
+    _afterKey = true;
+  }
+
+  void valueNull(void) { _sep(); _puts("null"); }
+  void valueBool(bool v) { _sep(); _puts(v ? "true" : "false"); }
+  void valueUInt(uint32_t v) { _sep(); _uint(v); }
+  void valueUInt64(uint64_t v) { _sep(); _uint64(v); }
+  void valueInt(int32_t v)
+  {
+    _sep();
+    if (v < 0) {
+      _put('-');
+      _uint((uint32_t)(-(int64_t)v));
+    } else {
+      _uint((uint32_t)v);
+    }
+  }
+  void valueStr(const char * s) { if (s == NULL) { valueNull(); return; } _sep(); _quoted(s); }
+  void valueHex(const uint8_t * p, size_t n)
+  {
+    _sep();
+    _put('"');
+    for (size_t i = 0; i < n; i++) {
+      _put(yuboxlorawan_hexdigits[p[i] >> 4]);
+      _put(yuboxlorawan_hexdigits[p[i] & 0x0F]);
+    }
+    _put('"');
+  }
+
+  // Atajos para pares clave/valor dentro de un objeto
+  void fieldNull(const char * k) { key(k); valueNull(); }
+  void fieldBool(const char * k, bool v) { key(k); valueBool(v); }
+  void fieldUInt(const char * k, uint32_t v) { key(k); valueUInt(v); }
+  void fieldUInt64(const char * k, uint64_t v) { key(k); valueUInt64(v); }
+  void fieldInt(const char * k, int32_t v) { key(k); valueInt(v); }
+  void fieldStr(const char * k, const char * s) { key(k); valueStr(s); }
+  void fieldHex(const char * k, const uint8_t * p, size_t n) { key(k); valueHex(p, n); }
+
+  // Timestamp de millis(), o null si es 0 (actividad que nunca ha ocurrido)
+  void fieldTS(const char * k, uint32_t ts) { key(k); if (ts != 0) valueUInt(ts); else valueNull(); }
+
+  const char * c_str(void) { return _buf; }
+  size_t length(void) { return _len; }
+  bool overflow(void) { return _overflow; }
+};
+
+#endif
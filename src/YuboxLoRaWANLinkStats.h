@@ -0,0 +1,169 @@
+#ifndef _YUBOX_LORAWAN_LINK_STATS_H_
+#define _YUBOX_LORAWAN_LINK_STATS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Número de muestras de calidad de enlace (downlinks más recientes) retenidas
+#ifndef YUBOX_LORAWAN_LINK_STATS_LEN
+#define YUBOX_LORAWAN_LINK_STATS_LEN 16
+#endif
+
+// Calidad de radio de un downlink recibido
+typedef struct YuboxLoRaWAN_link_sample
+{
+  int16_t rssi;   // dBm
+  int8_t snr;     // dB
+  uint32_t ts;    // millis() al recibir
+} yuboxlorawan_link_sample_t;
+
+// Estadísticas de una magnitud sobre las muestras retenidas
+typedef struct YuboxLoRaWAN_link_metric
+{
+  int16_t last;
+  int16_t min;
+  int16_t max;
+  int16_t mean;   // redondeado al entero más cercano
+  int16_t p10;
+  int16_t p50;
+  int16_t p90;
+} yuboxlorawan_link_metric_t;
+
+typedef struct YuboxLoRaWAN_link_stats
+{
+  uint8_t count;      // muestras usadas para las estadísticas
+  uint32_t total;     // downlinks medidos desde el arranque
+  uint32_t ts_last;   // millis() de la muestra más reciente
+  yuboxlorawan_link_metric_t rssi;
+  yuboxlorawan_link_metric_t snr;
+} yuboxlorawan_link_stats_t;
+
+// Información de un downlink entregada a callbacks de onRXInfo()
+typedef struct YuboxLoRaWAN_rxinfo
+{
+  uint8_t port;
+  uint8_t * p;
+  size_t n;
+  int16_t rssi;
+  int8_t snr;
+} yuboxlorawan_rxinfo_t;
+
+/*
+ * Anillo de las últimas YUBOX_LORAWAN_LINK_STATS_LEN muestras de RSSI/SNR, sin
+ * asignación dinámica. Las estadísticas se calculan bajo demanda ordenando una
+ * copia de las muestras, lo cual es barato para el tamaño del anillo. Debe
+ * usarse desde la misma tarea que llama a update().
+ */
+class YuboxLoRaWANLinkStats
+{
+private:
+  yuboxlorawan_link_sample_t _samples[YUBOX_LORAWAN_LINK_STATS_LEN];
+  uint8_t _next;
+  uint8_t _count;
+  uint32_t _total;
+
+  // Índice de la muestra más reciente
+  uint8_t _lastIdx(void) { return (_next + YUBOX_LORAWAN_LINK_STATS_LEN - 1) % YUBOX_LORAWAN_LINK_STATS_LEN; }
+
+  static void _sort(int16_t * v, uint8_t n)
+  {
+    for (uint8_t i = 1; i < n; i++) {
+      int16_t x = v[i];
+      int16_t j = i - 1;
+      while (j >= 0 && v[j] > x) {
+        v[j + 1] = v[j];
+        j--;
+      }
+      v[j + 1] = x;
+    }
+  }
+
+  // Percentil por rango más cercano sobre valores ya ordenados
+  static int16_t _pct(const int16_t * v, uint8_t n, uint8_t pct)
+  {
+    uint16_t rank = ((uint16_t)pct * n + 99) / 100;
+    if (rank < 1) rank = 1;
+    return v[rank - 1];
+  }
+
+  static void _metric(yuboxlorawan_link_metric_t & m, int16_t * v, uint8_t n, int16_t last)
+  {
+    int32_t sum = 0;
+    for (uint8_t i = 0; i < n; i++) sum += v[i];
+    _sort(v, n);
+
+    m.last = last;
+    m.min = v[0];
+    m.max = v[n - 1];
+    m.mean = (int16_t)((sum >= 0) ? (sum + n / 2) / n : (sum - n / 2) / n);
+    m.p10 = _pct(v, n, 10);
+    m.p50 = _pct(v, n, 50);
+    m.p90 = _pct(v, n, 90);
+  }
+
+public:
+  YuboxLoRaWANLinkStats(void) { clear(); }
+
+  void clear(void)
+  {
+    memset(_samples, 0, sizeof(_samples));
+    _next = 0;
+    _count = 0;
+    _total = 0;
+  }
+
+  void add(int16_t rssi, int8_t snr, uint32_t ts)
+  {
+    _samples[_next].rssi = rssi;
+    _samples[_next].snr = snr;
+    _samples[_next].ts = ts;
+    _next = (_next + 1) % YUBOX_LORAWAN_LINK_STATS_LEN;
+    if (_count < YUBOX_LORAWAN_LINK_STATS_LEN) _count++;
+    _total++;
+  }
+
+  bool empty(void) { return _count == 0; }
+  uint8_t count(void) { return _count; }
+  uint32_t total(void) { return _total; }
+
+  // Muestra más reciente, o NULL si no hay muestras
+  const yuboxlorawan_link_sample_t * last(void) { return (_count > 0) ? &(_samples[_lastIdx()]) : NULL; }
+
+  // Calcular estadísticas sobre las muestras retenidas. Devuelve falso si no hay muestras.
+  bool compute(yuboxlorawan_link_stats_t & st)
+  {
+    memset(&st, 0, sizeof(st));
+    st.total = _total;
+    if (_count == 0) return false;
+
+    int16_t v[YUBOX_LORAWAN_LINK_STATS_LEN];
+    const yuboxlorawan_link_sample_t * l = last();
+
+    st.count = _count;
+    st.ts_last = l->ts;
+
+    for (uint8_t i = 0; i < _count; i++) v[i] = _samples[i].rssi;
+    _metric(st.rssi, v, _count, l->rssi);
+    for (uint8_t i = 0; i < _count; i++) v[i] = _samples[i].snr;
+    _metric(st.snr, v, _count, l->snr);
+    return true;
+  }
+
+  // Promedios redondeados de RSSI y SNR, más baratos que compute()
+  bool mean(int16_t & rssi, int16_t & snr)
+  {
+    if (_count == 0) return false;
+
+    int32_t sr = 0, ss = 0;
+    for (uint8_t i = 0; i < _count; i++) {
+      sr += _samples[i].rssi;
+      ss += _samples[i].snr;
+    }
+    rssi = (int16_t)((sr >= 0) ? (sr + _count / 2) / _count : (sr - _count / 2) / _count);
+    snr = (int16_t)((ss >= 0) ? (ss + _count / 2) / _count : (ss - _count / 2) / _count);
+    return true;
+  }
+};
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef _YUBOX_LORAWAN_METRICS_H_
+#define _YUBOX_LORAWAN_METRICS_H_
+
+#include <stdint.h>
+#include <string.h>
+
+// Contadores monotónicos. NO se reinician al reiniciar la sesión LoRaWAN.
+typedef enum {
+  YBX_LW_MET_JOIN_ATTEMPTS = 0,
+  YBX_LW_MET_JOIN_OK,
+  YBX_LW_MET_JOIN_FAIL,
+  YBX_LW_MET_TX_OK,
+  YBX_LW_MET_TX_FAIL,
+  YBX_LW_MET_TX_PROBE,
+  YBX_LW_MET_RX,
+  YBX_LW_MET_CONFIRMTX_OK,
+  YBX_LW_MET_CONFIRMTX_FAIL,
+  YBX_LW_MET_REJOIN_TIMEOUT,
+  YBX_LW_MET_CONFIRMTX_RETRY,
+  YBX_LW_MET_RTC_RESUME,
+  YBX_LW_MET_DR_POLICY_RAISE,
+  YBX_LW_MET_FCNT_WRITE_FAIL,
+
+  YBX_LW_MET_MAX
+} yuboxlorawan_metric_t;
+
+static const char * const yuboxlorawan_metric_names[YBX_LW_MET_MAX] = {
+  "join_attempts",
+  "join_ok",
+  "join_fail",
+  "tx_ok",
+  "tx_fail",
+  "tx_probe",
+  "rx",
+  "confirmtx_ok",
+  "confirmtx_fail",
+  "rejoin_timeout",
+  "confirmtx_retry",
+  "rtc_resume",
+  "dr_policy_raise",
+  "fcnt_write_fail",
+};
+
+// Histogramas de latencia
+typedef enum {
+  YBX_LW_HIST_JOIN_MS = 0,        // Desde inicio de join hasta unión exitosa
+  YBX_LW_HIST_CONFIRM_MS,         // Desde TX confirmada hasta resultado de confirmación
+  YBX_LW_HIST_SEND_US,            // Duración de la llamada a lmh_send()
+  YBX_LW_HIST_BOOT_TX_MS,         // Desde arranque o despertar hasta primer uplink exitoso
+  YBX_LW_HIST_RX_DISPATCH_A_US,   // Desde callback de radio hasta callback de aplicación, en clase A
+  YBX_LW_HIST_RX_DISPATCH_C_US,   // Desde callback de radio hasta callback de aplicación, en clase C
+
+  YBX_LW_HIST_MAX
+} yuboxlorawan_histogram_t;
+
+static const char * const yuboxlorawan_histogram_names[YBX_LW_HIST_MAX] = {
+  "join_duration_ms",
+  "confirm_latency_ms",
+  "send_duration_us",
+  "boot_to_tx_ms",
+  "rx_dispatch_a_us",
+  "rx_dispatch_c_us",
+};
+
+// Número de cubetas por histograma, incluyendo la cubeta final +Inf
+#define YUBOX_LORAWAN_HIST_BUCKETS 10
+
+// Límites superiores (inclusivos) de cada cubeta, excepto la final +Inf
+static const uint32_t yuboxlorawan_histogram_bounds[YBX_LW_HIST_MAX][YUBOX_LORAWAN_HIST_BUCKETS - 1] = {
+  { 2000, 4000, 6000, 8000, 10000, 20000, 30000, 60000, 120000 },
+  { 1000, 2000, 3000, 4000, 6000, 8000, 10000, 20000, 40000 },
+  { 50, 100, 200, 500, 1000, 2000, 5000, 10000, 50000 },
+  { 100, 200, 500, 1000, 2000, 5000, 10000, 30000, 60000 },
+  { 100, 500, 1000, 5000, 10000, 50000, 100000, 500000, 1000000 },
+  { 100, 500, 1000, 5000, 10000, 50000, 100000, 500000, 1000000 },
+};
+
+typedef struct YuboxLoRaWAN_histogram
+{
+  uint32_t buckets[YUBOX_LORAWAN_HIST_BUCKETS];
+  uint32_t count;
+  uint32_t max;
+  uint64_t sum;
+} yuboxlorawan_histogram_data_t;
+
+/*
+ * Métricas de actividad LoRaWAN. El registro de una muestra es O(número de
+ * cubetas) sin asignación dinámica, así que puede dejarse activo en producción.
+ */
+class YuboxLoRaWANMetrics
+{
+private:
+  uint32_t _counters[YBX_LW_MET_MAX];
+  yuboxlorawan_histogram_data_t _hist[YBX_LW_HIST_MAX];
+
+public:
+  YuboxLoRaWANMetrics(void)
+  {
+    memset(_counters, 0, sizeof(_counters));
+    memset(_hist, 0, sizeof(_hist));
+  }
+
+  void inc(yuboxlorawan_metric_t m) { if (m < YBX_LW_MET_MAX) _counters[m]++; }
+  uint32_t get(yuboxlorawan_metric_t m) { return (m < YBX_LW_MET_MAX) ? _counters[m] : 0; }
+
+  void record(yuboxlorawan_histogram_t h, uint32_t v)
+  {
+    if (h >= YBX_LW_HIST_MAX) return;
+
+    uint8_t i = 0;
+    while (i < YUBOX_LORAWAN_HIST_BUCKETS - 1 && v > yuboxlorawan_histogram_bounds[h][i]) i++;
+    _hist[h].buckets[i]++;
+    _hist[h].count++;
+    _hist[h].sum += v;
+    if (v > _hist[h].max) _hist[h].max = v;
+  }
+
+  const yuboxlorawan_histogram_data_t * histogram(yuboxlorawan_histogram_t h)
+  {
+    return (h < YBX_LW_HIST_MAX) ? &(_hist[h]) : NULL;
+  }
+};
+
+#endif
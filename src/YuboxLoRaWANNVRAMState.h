@@ -0,0 +1,106 @@
+#ifndef _YUBOX_LORAWAN_NVRAM_STATE_H_
+#define _YUBOX_LORAWAN_NVRAM_STATE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "YuboxLoRaWANRTCSession.h"
+
+// Clave NVS del registro único de configuración y sesión
+#define YUBOX_LORAWAN_NVRAM_STATE_KEY "state"
+
+// Clave NVS de los contadores de trama, escrita sin reescribir "state"
+#define YUBOX_LORAWAN_NVRAM_FCNT_KEY "fcnt"
+
+#define YUBOX_LORAWAN_NVRAM_MAGIC 0x59534C57UL    // "YSLW"
+#define YUBOX_LORAWAN_NVRAM_VERSION 1
+
+// Tamaño máximo aceptado al leer, para registros escritos por versiones futuras
+#define YUBOX_LORAWAN_NVRAM_MAX_SIZE 512
+
+#define YBX_NVRAM_F_CONF 0x01           // devEUI/appEUI/appKey válidos
+#define YBX_NVRAM_F_SESSION 0x02        // claves de sesión, devaddr y contadores válidos
+#define YBX_NVRAM_F_SUBBANDSCAN 0x04
+
+/*
+ * Registro de configuración y sesión LoRaWAN, escrito a NVS como un solo blob
+ * para que una pérdida de energía a mitad de la escritura no deje un estado
+ * mezclado. Los campos nuevos se agregan SIEMPRE al final: un registro más
+ * corto (versión anterior) se lee dejando los campos faltantes con su valor
+ * por omisión, y uno más largo (versión posterior) se lee truncado.
+ */
+typedef struct __attribute__((packed)) YuboxLoRaWAN_nvram_state
+{
+  // Encabezado, el CRC cubre desde flags hasta el final del registro
+  uint32_t magic;
+  uint16_t version;
+  uint16_t size;
+  uint32_t crc;
+
+  uint8_t flags;
+  uint8_t region;
+  uint8_t subband;
+  uint8_t subbandok;
+  uint8_t devEUI[8];
+  uint8_t appEUI[8];
+  uint8_t appKey[16];
+  uint32_t txduty;
+  uint32_t txconfretries;
+  uint32_t fcntwindow;
+  uint32_t fcntmaxsec;
+
+  uint8_t NwkSKey[16];
+  uint8_t AppSKey[16];
+  uint32_t devaddr;
+  uint32_t uplinkcnt;
+  uint32_t downlinkcnt;
+
+  uint8_t devclass;
+
+  uint8_t adr;
+  int8_t datarate;
+  int8_t txpower;
+  uint8_t jointrials;
+  uint8_t drpolicy;
+} yuboxlorawan_nvram_state_t;
+
+#define YUBOX_LORAWAN_NVRAM_HEADER offsetof(yuboxlorawan_nvram_state_t, flags)
+
+inline void yuboxlorawan_nvram_state_seal(yuboxlorawan_nvram_state_t & s)
+{
+  s.magic = YUBOX_LORAWAN_NVRAM_MAGIC;
+  s.version = YUBOX_LORAWAN_NVRAM_VERSION;
+  s.size = sizeof(s);
+  s.crc = yuboxlorawan_crc32((const uint8_t *)&s + YUBOX_LORAWAN_NVRAM_HEADER, sizeof(s) - YUBOX_LORAWAN_NVRAM_HEADER);
+}
+
+// Validar el blob leído y copiarlo sobre s, que debe venir ya inicializado
+// con valores por omisión. Devuelve falso si el blob no es válido.
+inline bool yuboxlorawan_nvram_state_decode(const uint8_t * buf, size_t n, yuboxlorawan_nvram_state_t & s)
+{
+  yuboxlorawan_nvram_state_t h;
+
+  if (n < YUBOX_LORAWAN_NVRAM_HEADER) return false;
+  memcpy(&h, buf, YUBOX_LORAWAN_NVRAM_HEADER);
+  if (h.magic != YUBOX_LORAWAN_NVRAM_MAGIC || h.size != n) return false;
+  if (h.crc != yuboxlorawan_crc32(buf + YUBOX_LORAWAN_NVRAM_HEADER, n - YUBOX_LORAWAN_NVRAM_HEADER)) return false;
+
+  memcpy(&s, buf, (n < sizeof(s)) ? n : sizeof(s));
+  return true;
+}
+
+/*
+ * Contadores de trama confirmados de la sesión con el devaddr indicado. Cada
+ * escritura periódica de contadores reescribe sólo este registro de 12 bytes
+ * en lugar del registro completo. Sólo se aplica al cargar si devaddr
+ * coincide con la sesión guardada en "state" y no retrocede sus contadores.
+ */
+typedef struct __attribute__((packed)) YuboxLoRaWAN_nvram_fcnt
+{
+  uint32_t devaddr;
+  uint32_t uplinkcnt;
+  uint32_t downlinkcnt;
+} yuboxlorawan_nvram_fcnt_t;
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef _YUBOX_LORAWAN_RTC_SESSION_H_
+#define _YUBOX_LORAWAN_RTC_SESSION_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define YUBOX_LORAWAN_RTC_MAGIC 0x59524C57UL    // "YRLW"
+#define YUBOX_LORAWAN_RTC_VERSION 3
+
+/*
+ * Copia de la configuración y sesión LoRaWAN en memoria RTC lenta, que
+ * sobrevive al sueño profundo pero no a un reinicio por energía. Permite
+ * reanudar la sesión sin leer NVS ni reiniciar contadores o datarate. Los
+ * contadores se guardan exactos, así que no hace falta saltar la ventana de
+ * escritura por lotes al reanudar.
+ */
+typedef struct YuboxLoRaWAN_rtc_session
+{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t size;
+
+  // Configuración que normalmente se lee de NVS
+  uint8_t devEUI[8];
+  uint8_t appEUI[8];
+  uint8_t appKey[16];
+  uint8_t region;
+  uint8_t subband;
+  uint8_t subband_scan;
+  uint8_t subband_cached;
+  uint8_t devclass;
+  uint8_t cfg_adr;
+  int8_t cfg_datarate;
+  int8_t cfg_txpower;
+  uint8_t jointrials;
+  uint8_t drpolicy;
+  uint32_t txduty;
+  uint32_t txconfretries;
+  uint32_t fcntwindow;
+  uint32_t fcntmaxsec;
+
+  // Sesión, válida sólo con has_session distinto de 0
+  uint8_t has_session;
+  uint8_t NwkSKey[16];
+  uint8_t AppSKey[16];
+  uint32_t DevAddr;
+  uint32_t UpLinkCounter;
+  uint32_t DownLinkCounter;
+  uint32_t UpLinkCommitted;
+  uint32_t DownLinkCommitted;
+
+  // Estado de MAC
+  uint8_t subband_active;
+  uint8_t adr;
+  int8_t datarate;
+  int8_t txpower;
+
+  uint32_t crc;
+} yuboxlorawan_rtc_session_t;
+
+// CRC-32 (IEEE 802.3) sin tabla, suficiente para el tamaño de la estructura
+inline uint32_t yuboxlorawan_crc32(const uint8_t * p, size_t n)
+{
+  uint32_t crc = 0xFFFFFFFFUL;
+  for (size_t i = 0; i < n; i++) {
+    crc ^= p[i];
+    for (uint8_t j = 0; j < 8; j++) crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+  }
+  return ~crc;
+}
+
+inline uint32_t yuboxlorawan_rtc_session_crc(const yuboxlorawan_rtc_session_t & s)
+{
+  return yuboxlorawan_crc32((const uint8_t *)&s, offsetof(yuboxlorawan_rtc_session_t, crc));
+}
+
+inline void yuboxlorawan_rtc_session_seal(yuboxlorawan_rtc_session_t & s)
+{
+  s.magic = YUBOX_LORAWAN_RTC_MAGIC;
+  s.version = YUBOX_LORAWAN_RTC_VERSION;
+  s.size = sizeof(s);
+  s.crc = yuboxlorawan_rtc_session_crc(s);
+}
+
+inline bool yuboxlorawan_rtc_session_valid(const yuboxlorawan_rtc_session_t & s)
+{
+  return s.magic == YUBOX_LORAWAN_RTC_MAGIC && s.version == YUBOX_LORAWAN_RTC_VERSION
+    && s.size == sizeof(s) && s.crc == yuboxlorawan_rtc_session_crc(s);
+}
+
+// Invalidar la copia, para que no se reuse con contadores viejos
+inline void yuboxlorawan_rtc_session_clear(yuboxlorawan_rtc_session_t & s)
+{
+  memset(&s, 0, sizeof(s));
+}
+
+#endif
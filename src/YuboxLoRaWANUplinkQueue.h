@@ -0,0 +1,218 @@
+#ifndef _YUBOX_LORAWAN_UPLINK_QUEUE_H_
+#define _YUBOX_LORAWAN_UPLINK_QUEUE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+// Número de mensajes que caben en la cola, POR CADA nivel de prioridad
+#ifndef YUBOX_LORAWAN_UPLINK_QUEUE_LEN
+#define YUBOX_LORAWAN_UPLINK_QUEUE_LEN 8
+#endif
+
+// Máximo payload de aplicación LoRaWAN en cualquier región y datarate
+#ifndef YUBOX_LORAWAN_MAX_PAYLOAD
+#define YUBOX_LORAWAN_MAX_PAYLOAD 242
+#endif
+
+typedef enum {
+  YBX_LW_PRIO_NORMAL = 0,
+  YBX_LW_PRIO_HIGH = 1,
+
+  YBX_LW_PRIO_MAX
+} yuboxlorawan_priority_t;
+
+typedef enum {
+  // Si la cola está llena, se rechaza el mensaje nuevo
+  YBX_LW_QUEUE_DROP_NEW = 0,
+  // Si la cola está llena, se sobrescribe el mensaje más antiguo
+  YBX_LW_QUEUE_DROP_OLDEST = 1
+} yuboxlorawan_queue_policy_t;
+
+// Segmento de payload para envío sin copia intermedia (scatter-gather)
+typedef struct YuboxLoRaWAN_segment
+{
+  const uint8_t * p;
+  uint8_t n;
+} yuboxlorawan_segment_t;
+
+// Longitud total de una lista de segmentos
+inline size_t yuboxlorawan_segments_len(const yuboxlorawan_segment_t * segs, size_t nsegs)
+{
+  size_t total = 0;
+  for (size_t i = 0; i < nsegs; i++) if (segs[i].p != NULL) total += segs[i].n;
+  return total;
+}
+
+// Copiar segmentos consecutivamente a dst. El llamador valida la longitud total.
+inline size_t yuboxlorawan_segments_gather(uint8_t * dst, const yuboxlorawan_segment_t * segs, size_t nsegs)
+{
+  size_t total = 0;
+  for (size_t i = 0; i < nsegs; i++) {
+    if (segs[i].p == NULL || segs[i].n == 0) continue;
+    memcpy(dst + total, segs[i].p, segs[i].n);
+    total += segs[i].n;
+  }
+  return total;
+}
+
+typedef struct YuboxLoRaWAN_uplink
+{
+  uint8_t port;
+  bool confirmed;
+  uint8_t len;
+  uint8_t attempts;   // intentos de despacho fallidos, sólo en la cola en RAM
+  uint8_t payload[YUBOX_LORAWAN_MAX_PAYLOAD];
+} yuboxlorawan_uplink_t;
+
+/*
+ * Cola de mensajes uplink de capacidad fija, sin asignación dinámica de memoria.
+ * Existe un anillo por cada nivel de prioridad, y siempre se despacha primero
+ * el mensaje más antiguo de la prioridad más alta. Esta cola NO es segura para
+ * uso concurrente: debe usarse desde la misma tarea que llama a update().
+ */
+class YuboxLoRaWANUplinkQueue
+{
+private:
+  yuboxlorawan_uplink_t _msgs[YBX_LW_PRIO_MAX][YUBOX_LORAWAN_UPLINK_QUEUE_LEN];
+  uint8_t _head[YBX_LW_PRIO_MAX];
+  uint8_t _count[YBX_LW_PRIO_MAX];
+
+  yuboxlorawan_queue_policy_t _policy;
+
+  uint32_t _num_enqueued;
+  uint32_t _num_sent;
+  uint32_t _num_dropped;
+  uint32_t _max_depth;
+
+  bool _removeFront(void)
+  {
+    for (int prio = YBX_LW_PRIO_MAX - 1; prio >= 0; prio--) {
+      if (_count[prio] > 0) {
+        _head[prio] = (_head[prio] + 1) % YUBOX_LORAWAN_UPLINK_QUEUE_LEN;
+        _count[prio]--;
+        return true;
+      }
+    }
+    return false;
+  }
+
+public:
+  YuboxLoRaWANUplinkQueue(void)
+  {
+    memset(_head, 0, sizeof(_head));
+    memset(_count, 0, sizeof(_count));
+    _policy = YBX_LW_QUEUE_DROP_NEW;
+    _num_enqueued = 0;
+    _num_sent = 0;
+    _num_dropped = 0;
+    _max_depth = 0;
+  }
+
+  void setPolicy(yuboxlorawan_queue_policy_t policy) { _policy = policy; }
+  yuboxlorawan_queue_policy_t getPolicy(void) { return _policy; }
+
+  // Reservar espacio para un mensaje nuevo, aplicando la política de cola llena.
+  // Devuelve NULL si el mensaje se descarta.
+  yuboxlorawan_uplink_t * reserve(yuboxlorawan_priority_t prio, uint8_t port, bool confirmed)
+  {
+    if (prio >= YBX_LW_PRIO_MAX) prio = YBX_LW_PRIO_NORMAL;
+
+    if (_count[prio] >= YUBOX_LORAWAN_UPLINK_QUEUE_LEN) {
+      _num_dropped++;
+      if (_policy != YBX_LW_QUEUE_DROP_OLDEST) return NULL;
+
+      // Se descarta el mensaje más antiguo de la misma prioridad
+      _head[prio] = (_head[prio] + 1) % YUBOX_LORAWAN_UPLINK_QUEUE_LEN;
+      _count[prio]--;
+    }
+
+    yuboxlorawan_uplink_t * m = &(_msgs[prio][(_head[prio] + _count[prio]) % YUBOX_LORAWAN_UPLINK_QUEUE_LEN]);
+    m->port = port;
+    m->confirmed = confirmed;
+    m->len = 0;
+    m->attempts = 0;
+    _count[prio]++;
+    _num_enqueued++;
+
+    uint32_t d = depth();
+    if (d > _max_depth) _max_depth = d;
+    return m;
+  }
+
+  bool push(yuboxlorawan_priority_t prio, uint8_t port, bool confirmed, const uint8_t * p, uint8_t n)
+  {
+    if (n > YUBOX_LORAWAN_MAX_PAYLOAD) {
+      _num_dropped++;
+      return false;
+    }
+
+    yuboxlorawan_uplink_t * m = reserve(prio, port, confirmed);
+    if (m == NULL) return false;
+    if (p != NULL && n > 0) memcpy(m->payload, p, n); else n = 0;
+    m->len = n;
+    return true;
+  }
+
+  // Ensamblar los segmentos directamente en la cola
+  bool push(yuboxlorawan_priority_t prio, uint8_t port, bool confirmed, const yuboxlorawan_segment_t * segs, size_t nsegs)
+  {
+    size_t n = yuboxlorawan_segments_len(segs, nsegs);
+    if (n > YUBOX_LORAWAN_MAX_PAYLOAD) {
+      _num_dropped++;
+      return false;
+    }
+
+    yuboxlorawan_uplink_t * m = reserve(prio, port, confirmed);
+    if (m == NULL) return false;
+    m->len = yuboxlorawan_segments_gather(m->payload, segs, nsegs);
+    return true;
+  }
+
+  // Mensaje a despachar a continuación, o NULL si la cola está vacía
+  yuboxlorawan_uplink_t * front(void)
+  {
+    for (int prio = YBX_LW_PRIO_MAX - 1; prio >= 0; prio--) {
+      if (_count[prio] > 0) return &(_msgs[prio][_head[prio]]);
+    }
+    return NULL;
+  }
+
+  // Quitar el mensaje devuelto por front(), luego de transmitirlo
+  void pop(void)
+  {
+    if (_removeFront()) _num_sent++;
+  }
+
+  // Descartar el mensaje devuelto por front() sin transmitirlo
+  void drop(void)
+  {
+    if (_removeFront()) _num_dropped++;
+  }
+
+  void clear(void)
+  {
+    memset(_head, 0, sizeof(_head));
+    memset(_count, 0, sizeof(_count));
+  }
+
+  bool empty(void) { return depth() == 0; }
+
+  uint32_t depth(void)
+  {
+    uint32_t d = 0;
+    for (int prio = 0; prio < YBX_LW_PRIO_MAX; prio++) d += _count[prio];
+    return d;
+  }
+
+  uint32_t depth(yuboxlorawan_priority_t prio) { return (prio < YBX_LW_PRIO_MAX) ? _count[prio] : 0; }
+
+  // Espacio libre en el anillo de la prioridad indicada
+  uint32_t available(yuboxlorawan_priority_t prio) { return (prio < YBX_LW_PRIO_MAX) ? YUBOX_LORAWAN_UPLINK_QUEUE_LEN - _count[prio] : 0; }
+
+  uint32_t getNumEnqueued(void) { return _num_enqueued; }
+  uint32_t getNumSent(void) { return _num_sent; }
+  uint32_t getNumDropped(void) { return _num_dropped; }
+  uint32_t getMaxDepth(void) { return _max_depth; }
+};
+
+#endif
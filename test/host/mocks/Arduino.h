@@ -0,0 +1,92 @@
+#ifndef _YUBOX_HOST_MOCK_ARDUINO_H_
+#define _YUBOX_HOST_MOCK_ARDUINO_H_
+
+/*
+ * Sustituto mínimo de Arduino.h para compilar la biblioteca en el host. El
+ * reloj es simulado: millis() y micros() sólo avanzan con mock_advance_ms() y
+ * mock_advance_us(), para que las pruebas sean deterministas.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include <string>
+#include <functional>
+
+uint32_t millis(void);
+uint32_t micros(void);
+void delay(uint32_t ms);
+
+void mock_advance_ms(uint32_t ms);
+void mock_advance_us(uint32_t us);
+void mock_set_us(uint64_t us);
+
+// Nivel máximo de bitácora mostrado: 0 nada, 1 errores ... 5 verbose
+extern int mock_log_level;
+void mock_log(int level, char tag, const char * fmt, ...) __attribute__((format(printf, 3, 4)));
+
+#define log_e(fmt, ...) mock_log(1, 'E', fmt, ##__VA_ARGS__)
+#define log_w(fmt, ...) mock_log(2, 'W', fmt, ##__VA_ARGS__)
+#define log_i(fmt, ...) mock_log(3, 'I', fmt, ##__VA_ARGS__)
+#define log_d(fmt, ...) mock_log(4, 'D', fmt, ##__VA_ARGS__)
+#define log_v(fmt, ...) mock_log(5, 'V', fmt, ##__VA_ARGS__)
+
+#define RTC_DATA_ATTR
+
+// FreeRTOS: cada hilo del host es una tarea distinta
+typedef void * TaskHandle_t;
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+
+static const int SS = 5;
+static const int SCK = 18;
+static const int MISO = 19;
+static const int MOSI = 23;
+
+class EspClass
+{
+public:
+  uint64_t efuseMac;
+
+  EspClass(void) : efuseMac(0x0000AABBCCDDEEFFULL) {}
+  uint64_t getEfuseMac(void) { return efuseMac; }
+};
+
+extern EspClass ESP;
+
+// Sólo las operaciones de String que usa la biblioteca
+class String
+{
+private:
+  std::string _s;
+
+public:
+  String(void) {}
+  String(const char * s) : _s(s ? s : "") {}
+  String(const std::string & s) : _s(s) {}
+
+  String & operator=(const char * s) { _s = s ? s : ""; return *this; }
+  String & operator+=(const char * s) { _s += s; return *this; }
+  String & operator+=(const String & s) { _s += s._s; return *this; }
+  String & operator+=(char c) { _s += c; return *this; }
+  String & operator+=(int v) { _s += std::to_string(v); return *this; }
+  String & operator+=(unsigned int v) { _s += std::to_string(v); return *this; }
+  String & operator+=(unsigned long v) { _s += std::to_string(v); return *this; }
+  bool operator==(const char * s) const { return _s == s; }
+
+  const char * c_str(void) const { return _s.c_str(); }
+  unsigned int length(void) const { return (unsigned int)_s.size(); }
+  bool isEmpty(void) const { return _s.empty(); }
+  void clear(void) { _s.clear(); }
+  void trim(void)
+  {
+    size_t a = _s.find_first_not_of(" \t\r\n");
+    size_t b = _s.find_last_not_of(" \t\r\n");
+    _s = (a == std::string::npos) ? std::string() : _s.substr(a, b - a + 1);
+  }
+};
+
+#endif
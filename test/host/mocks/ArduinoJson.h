@@ -0,0 +1,4 @@
+#ifndef _YUBOX_HOST_MOCK_ARDUINOJSON_H_
+#define _YUBOX_HOST_MOCK_ARDUINOJSON_H_
+// La biblioteca genera JSON con YuboxLoRaWANJSONWriter, no hace falta ArduinoJson
+#endif
@@ -0,0 +1,183 @@
+#ifndef _YUBOX_HOST_MOCK_ESPASYNCWEBSERVER_H_
+#define _YUBOX_HOST_MOCK_ESPASYNCWEBSERVER_H_
+
+/*
+ * Sustituto de ESPAsyncWebServer para el host. No hay red: las rutas se
+ * guardan en AsyncWebServer y una prueba las invoca con mock_request(), que
+ * deja el código, tipo y cuerpo de la respuesta en la petición.
+ */
+
+#include "Arduino.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+typedef enum {
+  HTTP_GET     = 0b00000001,
+  HTTP_POST    = 0b00000010,
+} WebRequestMethod;
+
+typedef uint8_t WebRequestMethodComposite;
+
+class AsyncWebParameter
+{
+private:
+  String _name;
+  String _value;
+  bool _isPost;
+
+public:
+  AsyncWebParameter(const char * name, const char * value, bool post) : _name(name), _value(value), _isPost(post) {}
+  const String & name(void) const { return _name; }
+  const String & value(void) const { return _value; }
+  bool isPost(void) const { return _isPost; }
+};
+
+class AsyncResponseStream
+{
+public:
+  std::string contentType;
+  std::string body;
+
+  AsyncResponseStream(const char * ct) : contentType(ct) {}
+
+  size_t write(const uint8_t * data, size_t len) { body.append((const char *)data, len); return len; }
+  size_t printf(const char * fmt, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class AsyncWebServerRequest
+{
+private:
+  std::vector<AsyncWebParameter> _params;
+
+public:
+  WebRequestMethodComposite method;
+  int code;
+  std::string contentType;
+  std::string body;
+
+  AsyncWebServerRequest(WebRequestMethodComposite m = HTTP_GET) : method(m), code(0) {}
+  ~AsyncWebServerRequest() {}
+
+  // Agregar parámetro de la petición, antes de invocar la ruta
+  void addParam(const char * name, const char * value, bool post = true) { _params.push_back(AsyncWebParameter(name, value, post)); }
+
+  bool hasParam(const char * name, bool post = false) const { return getParam(name, post) != NULL; }
+  AsyncWebParameter * getParam(const char * name, bool post = false) const
+  {
+    for (auto & p : _params) if (p.isPost() == post && p.name() == name) return const_cast<AsyncWebParameter *>(&p);
+    return NULL;
+  }
+
+  AsyncResponseStream * beginResponseStream(const char * ct) { return new AsyncResponseStream(ct); }
+  void send(AsyncResponseStream * r)
+  {
+    code = 200;
+    contentType = r->contentType;
+    body = r->body;
+    delete r;
+  }
+  void send(int c, const char * ct, const String & content)
+  {
+    code = c;
+    contentType = ct;
+    body = content.c_str();
+  }
+};
+
+typedef std::function<void (AsyncWebServerRequest *)> ArRequestHandlerFunction;
+
+class AsyncWebHandler
+{
+public:
+  virtual ~AsyncWebHandler() {}
+};
+
+class AsyncEventSourceClient
+{
+public:
+  std::vector<std::string> messages;
+
+  void send(const char * message, const char * event = NULL, uint32_t id = 0, uint32_t reconnect = 0)
+  {
+    messages.push_back(message);
+  }
+};
+
+typedef std::function<void (AsyncEventSourceClient *)> ArEventHandlerFunction;
+
+class AsyncEventSource : public AsyncWebHandler
+{
+private:
+  std::string _url;
+  ArEventHandlerFunction _connectcb;
+
+public:
+  std::vector<AsyncEventSourceClient *> clients;
+  size_t packetsWaiting;
+
+  AsyncEventSource(const char * url) : _url(url), packetsWaiting(0) {}
+
+  const char * url(void) const { return _url.c_str(); }
+  void onConnect(ArEventHandlerFunction cb) { _connectcb = cb; }
+  size_t count(void) const { return clients.size(); }
+  size_t avgPacketsWaiting(void) const { return packetsWaiting; }
+  void send(const char * message, const char * event = NULL, uint32_t id = 0, uint32_t reconnect = 0)
+  {
+    for (auto c : clients) c->send(message, event, id, reconnect);
+  }
+
+  // Conectar un cliente simulado, que recibe el evento de bienvenida
+  void mock_connect(AsyncEventSourceClient * c)
+  {
+    clients.push_back(c);
+    if (_connectcb) _connectcb(c);
+  }
+};
+
+class AsyncWebServer
+{
+private:
+  typedef struct {
+    std::string uri;
+    WebRequestMethodComposite method;
+    ArRequestHandlerFunction fn;
+  } route_t;
+
+  std::vector<route_t> _routes;
+  std::vector<AsyncWebHandler *> _handlers;
+
+public:
+  AsyncWebServer(uint16_t port = 80) {}
+
+  void on(const char * uri, WebRequestMethodComposite method, ArRequestHandlerFunction fn)
+  {
+    route_t r = { uri, method, fn };
+    _routes.push_back(r);
+  }
+  AsyncWebHandler & addHandler(AsyncWebHandler * h) { _handlers.push_back(h); return *h; }
+
+  // Invocar la ruta registrada. Devuelve falso si no existe.
+  bool mock_request(const char * uri, AsyncWebServerRequest & req)
+  {
+    for (auto & r : _routes) {
+      if (r.uri == uri && (r.method & req.method)) {
+        r.fn(&req);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  AsyncEventSource * mock_event_source(const char * url)
+  {
+    for (auto h : _handlers) {
+      AsyncEventSource * es = dynamic_cast<AsyncEventSource *>(h);
+      if (es != NULL && strcmp(es->url(), url) == 0) return es;
+    }
+    return NULL;
+  }
+};
+
+#endif
@@ -0,0 +1,304 @@
+#ifndef _YUBOX_HOST_MOCK_LORAWAN_ARDUINO_H_
+#define _YUBOX_HOST_MOCK_LORAWAN_ARDUINO_H_
+
+/*
+ * Sustituto de la API lmh_* de SX126x-Arduino para el host. Implementa una MAC
+ * falsa sin radio: lmh_send() registra cada trama en mock_lmh.sent, y las
+ * funciones mock_lmh_*() invocan los callbacks de lmh_callback_t tal como lo
+ * haría la tarea de IRQ de la biblioteca al recibir join, downlink o ACK.
+ * Los tipos y valores numéricos siguen a LoRaMacHelper.h y LoRaMac.h.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <deque>
+#include <functional>
+#include <vector>
+
+typedef enum {
+  LORAMAC_REGION_AS923 = 0,
+  LORAMAC_REGION_AU915,
+  LORAMAC_REGION_CN470,
+  LORAMAC_REGION_CN779,
+  LORAMAC_REGION_EU433,
+  LORAMAC_REGION_EU868,
+  LORAMAC_REGION_KR920,
+  LORAMAC_REGION_IN865,
+  LORAMAC_REGION_US915,
+  LORAMAC_REGION_AS923_2,
+  LORAMAC_REGION_AS923_3,
+  LORAMAC_REGION_AS923_4,
+  LORAMAC_REGION_RU864,
+} LoRaMacRegion_t;
+
+typedef enum {
+  CLASS_A = 0,
+  CLASS_B,
+  CLASS_C,
+} DeviceClass_t;
+
+typedef enum {
+  LMH_SUCCESS = 0,
+  LMH_BUSY = -1,
+  LMH_ERROR = -2,
+} lmh_error_status;
+
+typedef enum {
+  LMH_RESET = 0,
+  LMH_SET = 1,
+  LMH_ONGOING = 2,
+  LMH_FAILED = 3,
+} lmh_join_status;
+
+typedef enum {
+  LMH_UNCONFIRMED_MSG = 0,
+  LMH_CONFIRMED_MSG = 1,
+} lmh_confirm;
+
+#define DR_0 0
+#define DR_1 1
+#define DR_2 2
+#define DR_3 3
+#define DR_4 4
+#define DR_5 5
+#define DR_6 6
+#define DR_7 7
+
+#define TX_POWER_0 0
+
+#define LORAWAN_ADR_ON 1
+#define LORAWAN_ADR_OFF 0
+#define LORAWAN_PUBLIC_NETWORK true
+#define LORAWAN_PRIVAT_NETWORK false
+#define LORAWAN_DUTYCYCLE_ON true
+#define LORAWAN_DUTYCYCLE_OFF false
+#define LORAWAN_DEFAULT_DATARATE DR_3
+#define LORAWAN_DEFAULT_TX_POWER TX_POWER_0
+#define LORAWAN_APP_PORT 2
+
+typedef struct {
+  uint8_t * buffer;
+  uint8_t buffsize;
+  uint8_t port;
+  int16_t rssi;
+  uint8_t snr;
+} lmh_app_data_t;
+
+typedef struct {
+  uint8_t (*BoardGetBatteryLevel)(void);
+  void (*BoardGetUniqueId)(uint8_t * id);
+  uint32_t (*BoardGetRandomSeed)(void);
+  void (*lmh_RxData)(lmh_app_data_t * app_data);
+  void (*lmh_has_joined)(void);
+  void (*lmh_ConfirmClass)(DeviceClass_t Class);
+  void (*lmh_has_joined_failed)(void);
+  void (*lmh_unconf_finished)(void);
+  void (*lmh_conf_result)(bool result);
+} lmh_callback_t;
+
+typedef struct {
+  bool adr_enable;
+  int8_t tx_data_rate;
+  bool enable_public_network;
+  uint8_t nb_trials;
+  int8_t tx_power;
+  bool duty_cycle;
+} lmh_param_t;
+
+uint8_t BoardGetBatteryLevel(void);
+void BoardGetUniqueId(uint8_t * id);
+uint32_t BoardGetRandomSeed(void);
+
+lmh_error_status lmh_init(lmh_callback_t * callbacks, lmh_param_t lora_param, bool otaa, DeviceClass_t nodeClass = CLASS_A, LoRaMacRegion_t region = LORAMAC_REGION_AS923);
+void lmh_join(void);
+lmh_join_status lmh_join_status_get(void);
+lmh_error_status lmh_send(lmh_app_data_t * app_data, lmh_confirm is_tx_confirmed);
+lmh_error_status lmh_class_request(DeviceClass_t newClass);
+bool lmh_setSubBandChannels(uint8_t subBand);
+void lmh_setDevEui(uint8_t userDevEui[]);
+void lmh_setAppEui(uint8_t userAppEui[]);
+void lmh_setAppKey(uint8_t userAppKey[]);
+void lmh_setNwkSKey(uint8_t userNwkSKey[]);
+void lmh_setAppSKey(uint8_t userAppSKey[]);
+void lmh_setDevAddr(uint32_t userDevAddr);
+
+typedef enum {
+  LORAMAC_STATUS_OK = 0,
+  LORAMAC_STATUS_BUSY,
+  LORAMAC_STATUS_SERVICE_UNKNOWN,
+  LORAMAC_STATUS_PARAMETER_INVALID,
+  LORAMAC_STATUS_FREQUENCY_INVALID,
+  LORAMAC_STATUS_DATARATE_INVALID,
+  LORAMAC_STATUS_FREQ_AND_DR_INVALID,
+  LORAMAC_STATUS_NO_NETWORK_JOINED,
+  LORAMAC_STATUS_LENGTH_ERROR,
+} LoRaMacStatus_t;
+
+typedef enum {
+  MIB_DEVICE_CLASS,
+  MIB_NETWORK_JOINED,
+  MIB_ADR,
+  MIB_NET_ID,
+  MIB_DEV_ADDR,
+  MIB_NWK_SKEY,
+  MIB_APP_SKEY,
+  MIB_CHANNELS_DATARATE,
+  MIB_CHANNELS_TX_POWER,
+  MIB_UPLINK_COUNTER,
+  MIB_DOWNLINK_COUNTER,
+} Mib_t;
+
+typedef union {
+  DeviceClass_t Class;
+  bool IsNetworkJoined;
+  bool AdrEnable;
+  uint32_t NetID;
+  uint32_t DevAddr;
+  uint8_t * NwkSKey;
+  uint8_t * AppSKey;
+  int8_t ChannelsDatarate;
+  int8_t ChannelsTxPower;
+  uint32_t UpLinkCounter;
+  uint32_t DownLinkCounter;
+} MibParam_t;
+
+typedef struct {
+  Mib_t Type;
+  MibParam_t Param;
+} MibRequestConfirm_t;
+
+typedef enum {
+  MLME_JOIN,
+  MLME_LINK_CHECK,
+  MLME_TXCW,
+} Mlme_t;
+
+typedef struct {
+  Mlme_t Type;
+} MlmeReq_t;
+
+typedef struct {
+  uint8_t MaxPossiblePayload;
+  uint8_t CurrentPayloadSize;
+} LoRaMacTxInfo_t;
+
+LoRaMacStatus_t LoRaMacMibGetRequestConfirm(MibRequestConfirm_t * mibGet);
+LoRaMacStatus_t LoRaMacMibSetRequestConfirm(MibRequestConfirm_t * mibSet);
+LoRaMacStatus_t LoRaMacMlmeRequest(MlmeReq_t * mlmeRequest);
+LoRaMacStatus_t LoRaMacQueryTxPossible(uint8_t size, LoRaMacTxInfo_t * txInfo);
+
+#define SX1261_CHIP 1
+#define SX1262_CHIP 2
+
+typedef struct {
+  int CHIP_TYPE;
+  int PIN_LORA_RESET;
+  int PIN_LORA_NSS;
+  int PIN_LORA_SCLK;
+  int PIN_LORA_MISO;
+  int PIN_LORA_DIO_1;
+  int PIN_LORA_BUSY;
+  int PIN_LORA_MOSI;
+  int RADIO_TXEN;
+  int RADIO_RXEN;
+  bool USE_DIO2_ANT_SWITCH;
+  bool USE_DIO3_TCXO;
+  bool USE_DIO3_ANT_SWITCH;
+  bool USE_LDO;
+  bool USE_RXEN_ANT_PWR;
+} hw_config;
+
+uint32_t lora_hardware_init(hw_config hwConfig);
+uint32_t lora_hardware_re_init(hw_config hwConfig);
+
+struct mock_radio_t
+{
+  uint32_t num_sleep;
+  void Sleep(void) { num_sleep++; }
+  void IrqProcess(void) {}
+};
+
+extern mock_radio_t Radio;
+
+// Trama aceptada por lmh_send()
+typedef struct {
+  uint8_t port;
+  bool confirmed;
+  int8_t datarate;
+  uint32_t fcnt;
+  bool linkcheck;
+  uint32_t ts;
+  std::vector<uint8_t> data;
+} mock_lmh_frame_t;
+
+// Estado de la MAC falsa
+typedef struct {
+  lmh_callback_t * cb;
+  lmh_param_t param;
+  bool otaa;
+  DeviceClass_t devclass;
+  LoRaMacRegion_t region;
+  uint8_t subband;
+  lmh_join_status join_status;
+
+  uint8_t devEui[8];
+  uint8_t appEui[8];
+  uint8_t appKey[16];
+  uint8_t nwkSKey[16];
+  uint8_t appSKey[16];
+  uint32_t devAddr;
+
+  uint32_t upcnt;
+  uint32_t downcnt;
+  int8_t datarate;
+  int8_t txpower;
+  bool adr;
+  bool linkcheck_queued;
+  bool confirm_pending;
+
+  // Payload máximo por datarate, consultado por LoRaMacQueryTxPossible()
+  uint8_t max_payload[16];
+
+  uint32_t random_seed;
+  uint32_t hw_init_result;
+  bool init_fail;
+
+  uint32_t num_hw_init;
+  uint32_t num_init;
+  uint32_t num_join;
+  uint32_t num_class_req;
+  uint32_t num_linkcheck;
+
+  // Resultados a devolver por los siguientes lmh_send(), en orden
+  std::deque<lmh_error_status> send_results;
+
+  // lmh_send() devuelve LMH_BUSY mientras millis() < busy_until
+  uint32_t busy_until;
+
+  std::vector<mock_lmh_frame_t> sent;
+
+  // Ganchos para un servidor de red simulado: JoinRequest de OTAA emitido
+  // por lmh_join(), y trama aceptada por lmh_send()
+  std::function<void (void)> on_join_request;
+  std::function<void (const mock_lmh_frame_t &)> on_uplink;
+} mock_lmh_t;
+
+/*
+ * MAC en uso. Un simulador con varios dispositivos mantiene un mock_lmh_t por
+ * dispositivo y lo selecciona con mock_lmh_select() antes de correr su
+ * update() o entregarle eventos; NULL vuelve a la MAC por omisión.
+ */
+extern mock_lmh_t * mock_lmh_current;
+#define mock_lmh (*mock_lmh_current)
+
+void mock_lmh_select(mock_lmh_t * ctx);
+void mock_lmh_reset(void);
+
+// Eventos de radio, entregados por los callbacks de lmh_callback_t
+void mock_lmh_join_accept(uint32_t devaddr, const uint8_t * nwkskey, const uint8_t * appskey);
+void mock_lmh_join_fail(void);
+void mock_lmh_downlink(uint8_t port, const uint8_t * p, uint8_t n, int16_t rssi = -80, int8_t snr = 8);
+void mock_lmh_confirm(bool ack);
+
+#endif
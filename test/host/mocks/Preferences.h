@@ -0,0 +1,65 @@
+#ifndef _YUBOX_HOST_MOCK_PREFERENCES_H_
+#define _YUBOX_HOST_MOCK_PREFERENCES_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+/*
+ * NVS en memoria. Los valores de todos los espacios de nombres se guardan en
+ * un mapa global, así que persisten entre instancias de Preferences y entre
+ * objetos de la biblioteca creados por una misma prueba, como en el equipo.
+ */
+class Preferences
+{
+private:
+  std::string _ns;
+  bool _ro;
+  bool _open;
+
+  std::string _k(const char * key) const;
+  bool _get(const char * key, void * p, size_t n) const;
+  size_t _put(const char * key, const void * p, size_t n);
+
+public:
+  Preferences(void) : _ro(true), _open(false) {}
+
+  bool begin(const char * name, bool readOnly = false);
+  void end(void);
+
+  bool isKey(const char * key);
+  bool remove(const char * key);
+  bool clear(void);
+
+  size_t getBytesLength(const char * key);
+  size_t getBytes(const char * key, void * buf, size_t maxLen);
+  size_t putBytes(const char * key, const void * value, size_t len);
+
+  uint8_t getUChar(const char * key, uint8_t defaultValue = 0);
+  bool getBool(const char * key, bool defaultValue = false);
+  uint32_t getUInt(const char * key, uint32_t defaultValue = 0);
+
+  size_t putUChar(const char * key, uint8_t value) { return _put(key, &value, sizeof(value)); }
+  size_t putBool(const char * key, bool value) { uint8_t v = value ? 1 : 0; return _put(key, &v, sizeof(v)); }
+  size_t putUInt(const char * key, uint32_t value) { return _put(key, &value, sizeof(value)); }
+};
+
+// Estado de la NVS simulada
+typedef struct {
+  // Prefijo de todas las claves, para simular varios dispositivos
+  std::string device;
+  std::map<std::string, std::vector<uint8_t> > data;
+  bool fail_writes;           // Las escrituras fallan sin modificar nada
+  uint32_t num_writes;        // Escrituras exitosas
+  uint32_t bytes_written;     // Bytes escritos en escrituras exitosas
+  std::map<std::string, uint32_t> writes_per_key;
+} mock_nvs_t;
+
+extern mock_nvs_t mock_nvs;
+
+void mock_nvs_reset(void);
+
+#endif
@@ -0,0 +1,3 @@
+#ifndef _YUBOX_HOST_MOCK_SPI_H_
+#define _YUBOX_HOST_MOCK_SPI_H_
+#endif
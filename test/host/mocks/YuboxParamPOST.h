@@ -0,0 +1,45 @@
+#ifndef _YUBOX_HOST_MOCK_PARAMPOST_H_
+#define _YUBOX_HOST_MOCK_PARAMPOST_H_
+
+#include "ESPAsyncWebServer.h"
+
+#define YBX_POST_VAR_TRIM       0x01
+#define YBX_POST_VAR_BLANK      0x02
+#define YBX_POST_VAR_REQUIRED   0x04
+#define YBX_POST_VAR_NONEMPTY   0x08
+
+bool parseParamPOST(bool clientError, String & responseMsg, AsyncWebServerRequest * request,
+    uint8_t flags, const char * name, const char * desc, String & value);
+
+/*
+ * El número se lee con strtoll() y se asigna con conversión, en lugar de con
+ * sscanf() y el formato FMT: "%lu" escribe 8 bytes en un uint32_t en un host
+ * de 64 bits.
+ */
+#define YBX_ASSIGN_NUM_FROM_POST(NAME, DESC, FMT, FLAGS, VAR) \
+    if (!clientError) { \
+        String _numParam; \
+        clientError = parseParamPOST(clientError, responseMsg, request, (FLAGS) | YBX_POST_VAR_TRIM, #NAME, DESC, _numParam); \
+        if (!clientError && !_numParam.isEmpty()) { \
+            char * _numEnd; \
+            long long _numVal = strtoll(_numParam.c_str(), &_numEnd, 0); \
+            if (*_numEnd != '\0') { \
+                clientError = true; \
+                responseMsg = "Formato numérico inválido: " DESC; \
+            } else { \
+                VAR = (decltype(VAR))_numVal; \
+            } \
+        } \
+    }
+
+#define YBX_STD_RESPONSE \
+    { \
+        String _json = "{\"success\":"; \
+        _json += (clientError || serverError) ? "false" : "true"; \
+        _json += ",\"msg\":\""; \
+        _json += responseMsg; \
+        _json += "\"}"; \
+        request->send(clientError ? 400 : (serverError ? 500 : 200), "application/json", _json); \
+    }
+
+#endif
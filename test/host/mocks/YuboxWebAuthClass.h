@@ -0,0 +1,17 @@
+#ifndef _YUBOX_HOST_MOCK_WEBAUTH_H_
+#define _YUBOX_HOST_MOCK_WEBAUTH_H_
+
+#include "ESPAsyncWebServer.h"
+
+// En el host no hay autenticación: toda petición se acepta
+#define YUBOX_RUN_AUTH(request) do { (void)(request); } while (0)
+
+class YuboxWebAuthClass
+{
+public:
+  void addManagedHandler(AsyncWebHandler *) {}
+};
+
+extern YuboxWebAuthClass YuboxWebAuth;
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef _YUBOX_HOST_MOCK_ESP_PARTITION_H_
+#define _YUBOX_HOST_MOCK_ESP_PARTITION_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_INVALID_SIZE 0x104
+
+typedef enum {
+  ESP_PARTITION_TYPE_APP = 0x00,
+  ESP_PARTITION_TYPE_DATA = 0x01,
+} esp_partition_type_t;
+
+typedef enum {
+  ESP_PARTITION_SUBTYPE_ANY = 0xff,
+} esp_partition_subtype_t;
+
+typedef struct {
+  esp_partition_type_t type;
+  esp_partition_subtype_t subtype;
+  uint32_t address;
+  uint32_t size;
+  char label[17];
+} esp_partition_t;
+
+const esp_partition_t * esp_partition_find_first(esp_partition_type_t, esp_partition_subtype_t, const char * label);
+esp_err_t esp_partition_read(const esp_partition_t *, size_t src_offset, void * dst, size_t size);
+esp_err_t esp_partition_write(const esp_partition_t *, size_t dst_offset, const void * src, size_t size);
+esp_err_t esp_partition_erase_range(const esp_partition_t *, size_t offset, size_t size);
+
+// Crear (o con size=0, quitar) una partición en RAM con la etiqueta indicada.
+// La escritura sólo puede pasar bits de 1 a 0, como en la flash real.
+void mock_partition_create(const char * label, uint32_t size);
+
+// Memoria de la partición indicada, para inspeccionar o corromper registros
+uint8_t * mock_partition_data(const char * label);
+
+// Estado de la flash simulada, común a todas las particiones. Se reinicia al
+// crear una partición.
+typedef struct {
+  bool fail_writes;           // Las escrituras fallan sin modificar nada
+  uint32_t num_writes;        // Escrituras exitosas
+  uint32_t num_erases;        // Borrados exitosos
+} mock_flash_t;
+
+extern mock_flash_t mock_flash;
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef _YUBOX_HOST_MOCK_ESP_SLEEP_H_
+#define _YUBOX_HOST_MOCK_ESP_SLEEP_H_
+
+typedef enum {
+  ESP_SLEEP_WAKEUP_UNDEFINED = 0,
+  ESP_SLEEP_WAKEUP_ALL,
+  ESP_SLEEP_WAKEUP_EXT0,
+  ESP_SLEEP_WAKEUP_EXT1,
+  ESP_SLEEP_WAKEUP_TIMER,
+} esp_sleep_wakeup_cause_t;
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause(void);
+
+// Causa de despertar que devuelve esp_sleep_get_wakeup_cause()
+extern esp_sleep_wakeup_cause_t mock_wakeup_cause;
+
+#endif
@@ -0,0 +1,122 @@
+#include "Arduino.h"
+#include "esp_sleep.h"
+#include "esp_partition.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+EspClass ESP;
+
+static uint64_t mock_us = 0;
+int mock_log_level = 0;
+
+uint32_t millis(void) { return (uint32_t)(mock_us / 1000); }
+uint32_t micros(void) { return (uint32_t)mock_us; }
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    static thread_local char task;
+    return &task;
+}
+void delay(uint32_t ms) { mock_us += (uint64_t)ms * 1000; }
+
+void mock_advance_ms(uint32_t ms) { mock_us += (uint64_t)ms * 1000; }
+void mock_advance_us(uint32_t us) { mock_us += us; }
+void mock_set_us(uint64_t us) { mock_us = us; }
+
+void mock_log(int level, char tag, const char * fmt, ...)
+{
+    if (level > mock_log_level) return;
+
+    va_list ap;
+    va_start(ap, fmt);
+    fprintf(stderr, "[%10u][%c] ", millis(), tag);
+    vfprintf(stderr, fmt, ap);
+    fputc('\n', stderr);
+    va_end(ap);
+}
+
+esp_sleep_wakeup_cause_t mock_wakeup_cause = ESP_SLEEP_WAKEUP_UNDEFINED;
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause(void)
+{
+    return mock_wakeup_cause;
+}
+
+typedef struct {
+    esp_partition_t part;
+    std::vector<uint8_t> mem;
+} mock_partition_t;
+
+static std::map<std::string, mock_partition_t> mock_partitions;
+
+mock_flash_t mock_flash;
+
+void mock_partition_create(const char * label, uint32_t size)
+{
+    if (size == 0) {
+        mock_partitions.erase(label);
+        return;
+    }
+
+    mock_partition_t & p = mock_partitions[label];
+    memset(&p.part, 0, sizeof(p.part));
+    p.part.type = ESP_PARTITION_TYPE_DATA;
+    p.part.subtype = ESP_PARTITION_SUBTYPE_ANY;
+    p.part.size = size;
+    strncpy(p.part.label, label, sizeof(p.part.label) - 1);
+    p.mem.assign(size, 0xFF);
+
+    mock_flash.fail_writes = false;
+    mock_flash.num_writes = 0;
+    mock_flash.num_erases = 0;
+}
+
+uint8_t * mock_partition_data(const char * label)
+{
+    auto it = mock_partitions.find(label);
+    return (it == mock_partitions.end()) ? NULL : it->second.mem.data();
+}
+
+static mock_partition_t * mock_partition_get(const esp_partition_t * part)
+{
+    if (part == NULL) return NULL;
+    auto it = mock_partitions.find(part->label);
+    return (it == mock_partitions.end() || &(it->second.part) != part) ? NULL : &(it->second);
+}
+
+const esp_partition_t * esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t, const char * label)
+{
+    auto it = mock_partitions.find(label ? label : "");
+    if (it == mock_partitions.end() || it->second.part.type != type) return NULL;
+    return &(it->second.part);
+}
+
+esp_err_t esp_partition_read(const esp_partition_t * part, size_t off, void * dst, size_t size)
+{
+    mock_partition_t * p = mock_partition_get(part);
+    if (p == NULL || off + size > p->mem.size()) return ESP_ERR_INVALID_SIZE;
+    memcpy(dst, p->mem.data() + off, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t * part, size_t off, const void * src, size_t size)
+{
+    mock_partition_t * p = mock_partition_get(part);
+    if (p == NULL || off + size > p->mem.size()) return ESP_ERR_INVALID_SIZE;
+    if (mock_flash.fail_writes) return ESP_FAIL;
+    const uint8_t * s = (const uint8_t *)src;
+    for (size_t i = 0; i < size; i++) p->mem[off + i] &= s[i];
+    mock_flash.num_writes++;
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t * part, size_t off, size_t size)
+{
+    mock_partition_t * p = mock_partition_get(part);
+    if (p == NULL || off + size > p->mem.size()) return ESP_ERR_INVALID_SIZE;
+    memset(p->mem.data() + off, 0xFF, size);
+    mock_flash.num_erases++;
+    return ESP_OK;
+}
@@ -0,0 +1,256 @@
+#include <string.h>
+
+#include "Arduino.h"
+#include "LoRaWan-Arduino.h"
+
+static mock_lmh_t mock_lmh_default;
+mock_lmh_t * mock_lmh_current = &mock_lmh_default;
+mock_radio_t Radio;
+
+void mock_lmh_select(mock_lmh_t * ctx)
+{
+    mock_lmh_current = (ctx != NULL) ? ctx : &mock_lmh_default;
+}
+
+// Payload máximo de AU915 sin restricción de dwell time
+static const uint8_t mock_default_max_payload[16] = {
+  51, 51, 51, 115, 242, 242, 242, 0, 53, 129, 242, 242, 242, 242, 0, 0
+};
+
+void mock_lmh_reset(void)
+{
+    mock_lmh.cb = NULL;
+    memset(&mock_lmh.param, 0, sizeof(mock_lmh.param));
+    mock_lmh.otaa = true;
+    mock_lmh.devclass = CLASS_A;
+    mock_lmh.region = LORAMAC_REGION_AU915;
+    mock_lmh.subband = 0;
+    mock_lmh.join_status = LMH_RESET;
+    memset(mock_lmh.devEui, 0, sizeof(mock_lmh.devEui));
+    memset(mock_lmh.appEui, 0, sizeof(mock_lmh.appEui));
+    memset(mock_lmh.appKey, 0, sizeof(mock_lmh.appKey));
+    memset(mock_lmh.nwkSKey, 0, sizeof(mock_lmh.nwkSKey));
+    memset(mock_lmh.appSKey, 0, sizeof(mock_lmh.appSKey));
+    mock_lmh.devAddr = 0;
+    mock_lmh.upcnt = 0;
+    mock_lmh.downcnt = 0;
+    mock_lmh.datarate = LORAWAN_DEFAULT_DATARATE;
+    mock_lmh.txpower = LORAWAN_DEFAULT_TX_POWER;
+    mock_lmh.adr = true;
+    mock_lmh.linkcheck_queued = false;
+    mock_lmh.confirm_pending = false;
+    memcpy(mock_lmh.max_payload, mock_default_max_payload, sizeof(mock_lmh.max_payload));
+    mock_lmh.random_seed = 0x12345678;
+    mock_lmh.hw_init_result = 0;
+    mock_lmh.init_fail = false;
+    mock_lmh.num_hw_init = 0;
+    mock_lmh.num_init = 0;
+    mock_lmh.num_join = 0;
+    mock_lmh.num_class_req = 0;
+    mock_lmh.num_linkcheck = 0;
+    mock_lmh.send_results.clear();
+    mock_lmh.busy_until = 0;
+    mock_lmh.sent.clear();
+    mock_lmh.on_join_request = nullptr;
+    mock_lmh.on_uplink = nullptr;
+    Radio.num_sleep = 0;
+}
+
+uint8_t BoardGetBatteryLevel(void) { return 255; }
+
+void BoardGetUniqueId(uint8_t * id)
+{
+    for (int i = 0; i < 8; i++) id[i] = (uint8_t)(0xA0 + i);
+}
+
+uint32_t BoardGetRandomSeed(void) { return mock_lmh.random_seed; }
+
+uint32_t lora_hardware_init(hw_config)
+{
+    mock_lmh.num_hw_init++;
+    return mock_lmh.hw_init_result;
+}
+
+uint32_t lora_hardware_re_init(hw_config hwConfig)
+{
+    return lora_hardware_init(hwConfig);
+}
+
+lmh_error_status lmh_init(lmh_callback_t * callbacks, lmh_param_t lora_param, bool otaa, DeviceClass_t nodeClass, LoRaMacRegion_t region)
+{
+    mock_lmh.num_init++;
+    if (mock_lmh.init_fail) return LMH_ERROR;
+
+    mock_lmh.cb = callbacks;
+    mock_lmh.param = lora_param;
+    mock_lmh.otaa = otaa;
+    mock_lmh.devclass = nodeClass;
+    mock_lmh.region = region;
+    mock_lmh.join_status = LMH_RESET;
+    mock_lmh.upcnt = 0;
+    mock_lmh.downcnt = 0;
+    mock_lmh.datarate = lora_param.tx_data_rate;
+    mock_lmh.txpower = lora_param.tx_power;
+    mock_lmh.adr = lora_param.adr_enable;
+    mock_lmh.linkcheck_queued = false;
+    mock_lmh.confirm_pending = false;
+    return LMH_SUCCESS;
+}
+
+void lmh_join(void)
+{
+    mock_lmh.num_join++;
+    if (mock_lmh.otaa) {
+        mock_lmh.join_status = LMH_ONGOING;
+        if (mock_lmh.on_join_request) mock_lmh.on_join_request();
+        return;
+    }
+
+    // Como LoRaMacHelper.cpp: con ABP el join se completa dentro de lmh_join()
+    mock_lmh.join_status = LMH_SET;
+    if (mock_lmh.cb != NULL && mock_lmh.cb->lmh_has_joined != NULL) mock_lmh.cb->lmh_has_joined();
+}
+
+lmh_join_status lmh_join_status_get(void)
+{
+    return mock_lmh.join_status;
+}
+
+lmh_error_status lmh_send(lmh_app_data_t * app_data, lmh_confirm is_tx_confirmed)
+{
+    if (mock_lmh.join_status != LMH_SET) return LMH_ERROR;
+    if ((int32_t)(millis() - mock_lmh.busy_until) < 0) return LMH_BUSY;
+    if (!mock_lmh.send_results.empty()) {
+        lmh_error_status r = mock_lmh.send_results.front();
+        mock_lmh.send_results.pop_front();
+        if (r != LMH_SUCCESS) return r;
+    }
+    if (app_data->buffsize > mock_lmh.max_payload[mock_lmh.datarate & 0x0F]) return LMH_ERROR;
+
+    mock_lmh_frame_t f;
+    f.port = app_data->port;
+    f.confirmed = (is_tx_confirmed == LMH_CONFIRMED_MSG);
+    f.datarate = mock_lmh.datarate;
+    f.fcnt = mock_lmh.upcnt++;
+    f.linkcheck = mock_lmh.linkcheck_queued;
+    f.ts = millis();
+    if (app_data->buffsize > 0) f.data.assign(app_data->buffer, app_data->buffer + app_data->buffsize);
+    mock_lmh.sent.push_back(f);
+
+    mock_lmh.linkcheck_queued = false;
+    if (f.confirmed) mock_lmh.confirm_pending = true;
+    if (mock_lmh.on_uplink) mock_lmh.on_uplink(f);
+    return LMH_SUCCESS;
+}
+
+lmh_error_status lmh_class_request(DeviceClass_t newClass)
+{
+    mock_lmh.num_class_req++;
+    if (newClass == CLASS_B) return LMH_ERROR;
+
+    // Como LoRaMacHelper.cpp: el cambio a clase A o C se confirma de inmediato
+    mock_lmh.devclass = newClass;
+    if (mock_lmh.cb != NULL && mock_lmh.cb->lmh_ConfirmClass != NULL) mock_lmh.cb->lmh_ConfirmClass(newClass);
+    return LMH_SUCCESS;
+}
+
+bool lmh_setSubBandChannels(uint8_t subBand)
+{
+    if (subBand < 1 || subBand > 9) return false;
+    mock_lmh.subband = subBand;
+    return true;
+}
+
+void lmh_setDevEui(uint8_t userDevEui[]) { memcpy(mock_lmh.devEui, userDevEui, 8); }
+void lmh_setAppEui(uint8_t userAppEui[]) { memcpy(mock_lmh.appEui, userAppEui, 8); }
+void lmh_setAppKey(uint8_t userAppKey[]) { memcpy(mock_lmh.appKey, userAppKey, 16); }
+void lmh_setNwkSKey(uint8_t userNwkSKey[]) { memcpy(mock_lmh.nwkSKey, userNwkSKey, 16); }
+void lmh_setAppSKey(uint8_t userAppSKey[]) { memcpy(mock_lmh.appSKey, userAppSKey, 16); }
+void lmh_setDevAddr(uint32_t userDevAddr) { mock_lmh.devAddr = userDevAddr; }
+
+LoRaMacStatus_t LoRaMacMibGetRequestConfirm(MibRequestConfirm_t * mibGet)
+{
+    switch (mibGet->Type) {
+    case MIB_DEVICE_CLASS:      mibGet->Param.Class = mock_lmh.devclass; break;
+    case MIB_NETWORK_JOINED:    mibGet->Param.IsNetworkJoined = (mock_lmh.join_status == LMH_SET); break;
+    case MIB_ADR:               mibGet->Param.AdrEnable = mock_lmh.adr; break;
+    case MIB_DEV_ADDR:          mibGet->Param.DevAddr = mock_lmh.devAddr; break;
+    case MIB_NWK_SKEY:          mibGet->Param.NwkSKey = mock_lmh.nwkSKey; break;
+    case MIB_APP_SKEY:          mibGet->Param.AppSKey = mock_lmh.appSKey; break;
+    case MIB_CHANNELS_DATARATE: mibGet->Param.ChannelsDatarate = mock_lmh.datarate; break;
+    case MIB_CHANNELS_TX_POWER: mibGet->Param.ChannelsTxPower = mock_lmh.txpower; break;
+    case MIB_UPLINK_COUNTER:    mibGet->Param.UpLinkCounter = mock_lmh.upcnt; break;
+    case MIB_DOWNLINK_COUNTER:  mibGet->Param.DownLinkCounter = mock_lmh.downcnt; break;
+    default: return LORAMAC_STATUS_SERVICE_UNKNOWN;
+    }
+    return LORAMAC_STATUS_OK;
+}
+
+LoRaMacStatus_t LoRaMacMibSetRequestConfirm(MibRequestConfirm_t * mibSet)
+{
+    switch (mibSet->Type) {
+    case MIB_ADR:               mock_lmh.adr = mibSet->Param.AdrEnable; break;
+    case MIB_DEV_ADDR:          mock_lmh.devAddr = mibSet->Param.DevAddr; break;
+    case MIB_CHANNELS_DATARATE:
+        if (mibSet->Param.ChannelsDatarate < 0 || mibSet->Param.ChannelsDatarate > 15
+            || mock_lmh.max_payload[mibSet->Param.ChannelsDatarate] == 0) return LORAMAC_STATUS_PARAMETER_INVALID;
+        mock_lmh.datarate = mibSet->Param.ChannelsDatarate;
+        break;
+    case MIB_CHANNELS_TX_POWER: mock_lmh.txpower = mibSet->Param.ChannelsTxPower; break;
+    case MIB_UPLINK_COUNTER:    mock_lmh.upcnt = mibSet->Param.UpLinkCounter; break;
+    case MIB_DOWNLINK_COUNTER:  mock_lmh.downcnt = mibSet->Param.DownLinkCounter; break;
+    default: return LORAMAC_STATUS_SERVICE_UNKNOWN;
+    }
+    return LORAMAC_STATUS_OK;
+}
+
+LoRaMacStatus_t LoRaMacMlmeRequest(MlmeReq_t * mlmeRequest)
+{
+    if (mlmeRequest->Type != MLME_LINK_CHECK) return LORAMAC_STATUS_SERVICE_UNKNOWN;
+    if (mock_lmh.join_status != LMH_SET) return LORAMAC_STATUS_NO_NETWORK_JOINED;
+    mock_lmh.linkcheck_queued = true;
+    mock_lmh.num_linkcheck++;
+    return LORAMAC_STATUS_OK;
+}
+
+LoRaMacStatus_t LoRaMacQueryTxPossible(uint8_t size, LoRaMacTxInfo_t * txInfo)
+{
+    txInfo->MaxPossiblePayload = mock_lmh.max_payload[mock_lmh.datarate & 0x0F];
+    txInfo->CurrentPayloadSize = size;
+    return (size <= txInfo->MaxPossiblePayload) ? LORAMAC_STATUS_OK : LORAMAC_STATUS_LENGTH_ERROR;
+}
+
+void mock_lmh_join_accept(uint32_t devaddr, const uint8_t * nwkskey, const uint8_t * appskey)
+{
+    mock_lmh.devAddr = devaddr;
+    if (nwkskey != NULL) memcpy(mock_lmh.nwkSKey, nwkskey, 16);
+    if (appskey != NULL) memcpy(mock_lmh.appSKey, appskey, 16);
+    mock_lmh.upcnt = 0;
+    mock_lmh.downcnt = 0;
+    mock_lmh.join_status = LMH_SET;
+    if (mock_lmh.cb != NULL && mock_lmh.cb->lmh_has_joined != NULL) mock_lmh.cb->lmh_has_joined();
+}
+
+void mock_lmh_join_fail(void)
+{
+    mock_lmh.join_status = LMH_FAILED;
+    if (mock_lmh.cb != NULL && mock_lmh.cb->lmh_has_joined_failed != NULL) mock_lmh.cb->lmh_has_joined_failed();
+}
+
+void mock_lmh_downlink(uint8_t port, const uint8_t * p, uint8_t n, int16_t rssi, int8_t snr)
+{
+    uint8_t buf[256];
+
+    if (n > 0) memcpy(buf, p, n);
+    mock_lmh.downcnt++;
+
+    lmh_app_data_t app_data = { buf, n, port, rssi, (uint8_t)snr };
+    if (mock_lmh.cb != NULL && mock_lmh.cb->lmh_RxData != NULL) mock_lmh.cb->lmh_RxData(&app_data);
+}
+
+void mock_lmh_confirm(bool ack)
+{
+    if (ack) mock_lmh.downcnt++;
+    mock_lmh.confirm_pending = false;
+    if (mock_lmh.cb != NULL && mock_lmh.cb->lmh_conf_result != NULL) mock_lmh.cb->lmh_conf_result(ack);
+}
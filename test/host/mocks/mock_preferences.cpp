@@ -0,0 +1,111 @@
+#include <string.h>
+
+#include "Preferences.h"
+
+mock_nvs_t mock_nvs;
+
+void mock_nvs_reset(void)
+{
+    mock_nvs.device.clear();
+    mock_nvs.data.clear();
+    mock_nvs.fail_writes = false;
+    mock_nvs.num_writes = 0;
+    mock_nvs.bytes_written = 0;
+    mock_nvs.writes_per_key.clear();
+}
+
+std::string Preferences::_k(const char * key) const
+{
+    return mock_nvs.device + _ns + "/" + key;
+}
+
+bool Preferences::begin(const char * name, bool readOnly)
+{
+    _ns = name;
+    _ro = readOnly;
+    _open = true;
+    return true;
+}
+
+void Preferences::end(void)
+{
+    _open = false;
+}
+
+bool Preferences::_get(const char * key, void * p, size_t n) const
+{
+    auto it = mock_nvs.data.find(_k(key));
+    if (!_open || it == mock_nvs.data.end() || it->second.size() != n) return false;
+    memcpy(p, it->second.data(), n);
+    return true;
+}
+
+size_t Preferences::_put(const char * key, const void * p, size_t n)
+{
+    if (!_open || _ro || mock_nvs.fail_writes) return 0;
+
+    const uint8_t * b = (const uint8_t *)p;
+    mock_nvs.data[_k(key)] = std::vector<uint8_t>(b, b + n);
+    mock_nvs.num_writes++;
+    mock_nvs.bytes_written += n;
+    mock_nvs.writes_per_key[key]++;
+    return n;
+}
+
+bool Preferences::isKey(const char * key)
+{
+    return _open && mock_nvs.data.count(_k(key)) > 0;
+}
+
+bool Preferences::remove(const char * key)
+{
+    if (!_open || _ro || mock_nvs.fail_writes) return false;
+    return mock_nvs.data.erase(_k(key)) > 0;
+}
+
+bool Preferences::clear(void)
+{
+    if (!_open || _ro || mock_nvs.fail_writes) return false;
+    std::string prefix = mock_nvs.device + _ns + "/";
+    for (auto it = mock_nvs.data.begin(); it != mock_nvs.data.end(); ) {
+        if (it->first.compare(0, prefix.size(), prefix) == 0) it = mock_nvs.data.erase(it); else ++it;
+    }
+    return true;
+}
+
+size_t Preferences::getBytesLength(const char * key)
+{
+    auto it = mock_nvs.data.find(_k(key));
+    return (_open && it != mock_nvs.data.end()) ? it->second.size() : 0;
+}
+
+size_t Preferences::getBytes(const char * key, void * buf, size_t maxLen)
+{
+    auto it = mock_nvs.data.find(_k(key));
+    if (!_open || it == mock_nvs.data.end() || it->second.size() > maxLen) return 0;
+    memcpy(buf, it->second.data(), it->second.size());
+    return it->second.size();
+}
+
+size_t Preferences::putBytes(const char * key, const void * value, size_t len)
+{
+    return _put(key, value, len);
+}
+
+uint8_t Preferences::getUChar(const char * key, uint8_t defaultValue)
+{
+    uint8_t v;
+    return _get(key, &v, sizeof(v)) ? v : defaultValue;
+}
+
+bool Preferences::getBool(const char * key, bool defaultValue)
+{
+    uint8_t v;
+    return _get(key, &v, sizeof(v)) ? (v != 0) : defaultValue;
+}
+
+uint32_t Preferences::getUInt(const char * key, uint32_t defaultValue)
+{
+    uint32_t v;
+    return _get(key, &v, sizeof(v)) ? v : defaultValue;
+}
@@ -0,0 +1,44 @@
+#include "ESPAsyncWebServer.h"
+#include "YuboxWebAuthClass.h"
+#include "YuboxParamPOST.h"
+
+YuboxWebAuthClass YuboxWebAuth;
+
+size_t AsyncResponseStream::printf(const char * fmt, ...)
+{
+    char tmp[512];
+    va_list ap;
+
+    va_start(ap, fmt);
+    int n = vsnprintf(tmp, sizeof(tmp), fmt, ap);
+    va_end(ap);
+    if (n < 0) return 0;
+    if ((size_t)n >= sizeof(tmp)) n = sizeof(tmp) - 1;
+    body.append(tmp, n);
+    return n;
+}
+
+bool parseParamPOST(bool clientError, String & responseMsg, AsyncWebServerRequest * request,
+    uint8_t flags, const char * name, const char * desc, String & value)
+{
+    if (clientError) return true;
+
+    AsyncWebParameter * p = request->getParam(name, true);
+    if (p == NULL) {
+        if (flags & YBX_POST_VAR_REQUIRED) {
+            responseMsg = "Se requiere ";
+            responseMsg += (desc != NULL) ? desc : name;
+            return true;
+        }
+        return false;
+    }
+
+    value = p->value();
+    if (flags & YBX_POST_VAR_TRIM) value.trim();
+    if (value.isEmpty() && (flags & YBX_POST_VAR_NONEMPTY)) {
+        responseMsg = "Valor vacío para ";
+        responseMsg += (desc != NULL) ? desc : name;
+        return true;
+    }
+    return false;
+}
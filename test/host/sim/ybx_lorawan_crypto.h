@@ -0,0 +1,193 @@
+#ifndef _YUBOX_HOST_LORAWAN_CRYPTO_H_
+#define _YUBOX_HOST_LORAWAN_CRYPTO_H_
+
+/*
+ * Criptografía de LoRaWAN 1.0.x para el simulador de servidor de red: AES-128
+ * (sólo cifrado, FIPS-197), AES-CMAC (RFC 4493), derivación de claves de
+ * sesión OTAA, MIC de tramas y cifrado de FRMPayload. Es una implementación
+ * directa sin tablas T ni protección contra canales laterales, sólo para
+ * pruebas en el host.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+static const uint8_t ybx_aes_sbox[256] = {
+  0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+  0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+  0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+  0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+  0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+  0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+  0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+  0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+  0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+  0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+  0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+  0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+  0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+  0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+  0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+  0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+};
+
+static inline uint8_t ybx_aes_xtime(uint8_t x) { return (uint8_t)((x << 1) ^ ((x & 0x80) ? 0x1b : 0x00)); }
+
+// Cifrar un bloque de 16 bytes con AES-128. in y out pueden ser el mismo buffer.
+inline void ybx_aes128_encrypt(const uint8_t key[16], const uint8_t in[16], uint8_t out[16])
+{
+  uint8_t rk[176];
+  uint8_t s[16];
+  uint8_t rcon = 0x01;
+
+  memcpy(rk, key, 16);
+  for (int i = 16; i < 176; i += 4) {
+    uint8_t t[4] = { rk[i - 4], rk[i - 3], rk[i - 2], rk[i - 1] };
+    if (i % 16 == 0) {
+      uint8_t u = t[0];
+      t[0] = ybx_aes_sbox[t[1]] ^ rcon;
+      t[1] = ybx_aes_sbox[t[2]];
+      t[2] = ybx_aes_sbox[t[3]];
+      t[3] = ybx_aes_sbox[u];
+      rcon = ybx_aes_xtime(rcon);
+    }
+    for (int j = 0; j < 4; j++) rk[i + j] = rk[i - 16 + j] ^ t[j];
+  }
+
+  for (int i = 0; i < 16; i++) s[i] = in[i] ^ rk[i];
+  for (int round = 1; round <= 10; round++) {
+    uint8_t t[16];
+
+    // SubBytes + ShiftRows, con el estado en orden de columnas
+    for (int c = 0; c < 4; c++) {
+      for (int r = 0; r < 4; r++) t[4 * c + r] = ybx_aes_sbox[s[4 * ((c + r) % 4) + r]];
+    }
+    // MixColumns, excepto en la última ronda
+    if (round < 10) {
+      for (int c = 0; c < 4; c++) {
+        uint8_t * a = t + 4 * c;
+        uint8_t x = a[0] ^ a[1] ^ a[2] ^ a[3];
+        uint8_t a0 = a[0];
+        a[0] ^= x ^ ybx_aes_xtime(a[0] ^ a[1]);
+        a[1] ^= x ^ ybx_aes_xtime(a[1] ^ a[2]);
+        a[2] ^= x ^ ybx_aes_xtime(a[2] ^ a[3]);
+        a[3] ^= x ^ ybx_aes_xtime(a[3] ^ a0);
+      }
+    }
+    for (int i = 0; i < 16; i++) s[i] = t[i] ^ rk[16 * round + i];
+  }
+  memcpy(out, s, 16);
+}
+
+// AES-CMAC de 16 bytes (RFC 4493)
+inline void ybx_aes128_cmac(const uint8_t key[16], const uint8_t * msg, size_t n, uint8_t mac[16])
+{
+  uint8_t l[16], k1[16], k2[16], x[16], y[16];
+  const uint8_t zero[16] = { 0 };
+
+  ybx_aes128_encrypt(key, zero, l);
+  for (int i = 0; i < 16; i++) k1[i] = (uint8_t)((l[i] << 1) | ((i < 15) ? (l[i + 1] >> 7) : 0));
+  if (l[0] & 0x80) k1[15] ^= 0x87;
+  for (int i = 0; i < 16; i++) k2[i] = (uint8_t)((k1[i] << 1) | ((i < 15) ? (k1[i + 1] >> 7) : 0));
+  if (k1[0] & 0x80) k2[15] ^= 0x87;
+
+  size_t nblk = (n + 15) / 16;
+  bool complete = (n > 0 && n % 16 == 0);
+  if (nblk == 0) nblk = 1;
+
+  memset(x, 0, sizeof(x));
+  for (size_t b = 0; b < nblk; b++) {
+    const uint8_t * m = msg + 16 * b;
+    if (b + 1 < nblk) {
+      for (int i = 0; i < 16; i++) y[i] = x[i] ^ m[i];
+    } else if (complete) {
+      for (int i = 0; i < 16; i++) y[i] = x[i] ^ m[i] ^ k1[i];
+    } else {
+      size_t rem = n - 16 * b;
+      for (size_t i = 0; i < 16; i++) {
+        uint8_t v = (i < rem) ? m[i] : ((i == rem) ? 0x80 : 0x00);
+        y[i] = x[i] ^ v ^ k2[i];
+      }
+    }
+    ybx_aes128_encrypt(key, y, x);
+  }
+  memcpy(mac, x, 16);
+}
+
+#define YBX_LW_DIR_UP 0
+#define YBX_LW_DIR_DOWN 1
+
+// NwkSKey = aes128(AppKey, 0x01 | AppNonce | NetID | DevNonce | pad), AppSKey con 0x02
+inline void ybx_lw_derive_session_keys(const uint8_t appkey[16], uint32_t appnonce, uint32_t netid, uint16_t devnonce,
+  uint8_t nwkskey[16], uint8_t appskey[16])
+{
+  uint8_t b[16];
+
+  memset(b, 0, sizeof(b));
+  b[1] = appnonce & 0xFF;
+  b[2] = (appnonce >> 8) & 0xFF;
+  b[3] = (appnonce >> 16) & 0xFF;
+  b[4] = netid & 0xFF;
+  b[5] = (netid >> 8) & 0xFF;
+  b[6] = (netid >> 16) & 0xFF;
+  b[7] = devnonce & 0xFF;
+  b[8] = (devnonce >> 8) & 0xFF;
+
+  b[0] = 0x01;
+  ybx_aes128_encrypt(appkey, b, nwkskey);
+  b[0] = 0x02;
+  ybx_aes128_encrypt(appkey, b, appskey);
+}
+
+// MIC de 4 bytes de JoinRequest o JoinAccept: CMAC(AppKey, mensaje) truncado
+inline uint32_t ybx_lw_join_mic(const uint8_t appkey[16], const uint8_t * msg, size_t n)
+{
+  uint8_t mac[16];
+  ybx_aes128_cmac(appkey, msg, n, mac);
+  return (uint32_t)mac[0] | ((uint32_t)mac[1] << 8) | ((uint32_t)mac[2] << 16) | ((uint32_t)mac[3] << 24);
+}
+
+// Bloque A_i o B_0 de LoRaWAN 1.0.x
+inline void ybx_lw_block(uint8_t b[16], uint8_t first, uint8_t dir, uint32_t devaddr, uint32_t fcnt, uint8_t last)
+{
+  memset(b, 0, 16);
+  b[0] = first;
+  b[5] = dir;
+  b[6] = devaddr & 0xFF;
+  b[7] = (devaddr >> 8) & 0xFF;
+  b[8] = (devaddr >> 16) & 0xFF;
+  b[9] = (devaddr >> 24) & 0xFF;
+  b[10] = fcnt & 0xFF;
+  b[11] = (fcnt >> 8) & 0xFF;
+  b[12] = (fcnt >> 16) & 0xFF;
+  b[13] = (fcnt >> 24) & 0xFF;
+  b[15] = last;
+}
+
+// MIC de trama de datos: CMAC(NwkSKey, B0 | MHDR..FRMPayload) truncado
+inline uint32_t ybx_lw_data_mic(const uint8_t nwkskey[16], uint8_t dir, uint32_t devaddr, uint32_t fcnt, const uint8_t * msg, size_t n)
+{
+  uint8_t buf[16 + 256];
+  uint8_t mac[16];
+
+  if (n > 256) return 0;
+  ybx_lw_block(buf, 0x49, dir, devaddr, fcnt, (uint8_t)n);
+  memcpy(buf + 16, msg, n);
+  ybx_aes128_cmac(nwkskey, buf, 16 + n, mac);
+  return (uint32_t)mac[0] | ((uint32_t)mac[1] << 8) | ((uint32_t)mac[2] << 16) | ((uint32_t)mac[3] << 24);
+}
+
+// Cifrar o descifrar FRMPayload (la operación es la misma) con AppSKey
+inline void ybx_lw_payload_crypt(const uint8_t key[16], uint8_t dir, uint32_t devaddr, uint32_t fcnt, const uint8_t * in, uint8_t * out, size_t n)
+{
+  uint8_t a[16], s[16];
+
+  for (size_t i = 0; i < n; i += 16) {
+    ybx_lw_block(a, 0x01, dir, devaddr, fcnt, (uint8_t)(i / 16 + 1));
+    ybx_aes128_encrypt(key, a, s);
+    for (size_t j = 0; j < 16 && i + j < n; j++) out[i + j] = in[i + j] ^ s[j];
+  }
+}
+
+#endif
@@ -0,0 +1,725 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <esp_sleep.h>
+
+#include "ybx_lorawan_crypto.h"
+#include "ybx_sim.h"
+
+// Retardos de clase A según LoRaWAN Regional Parameters
+#define YBX_SIM_RECEIVE_DELAY1_MS       1000
+#define YBX_SIM_RECEIVE_DELAY2_MS       2000
+#define YBX_SIM_JOIN_ACCEPT_DELAY1_MS   5000
+#define YBX_SIM_JOIN_ACCEPT_DELAY2_MS   6000
+
+// Margen tras la apertura de RX2 en que la MAC da por perdida la respuesta
+#define YBX_SIM_RX_TIMEOUT_MS           100
+
+// Datarate de RX2 en AU915
+#define YBX_SIM_RX2_DR                  8
+
+#define YBX_SIM_MHDR_JOIN_REQUEST   0x00
+#define YBX_SIM_MHDR_JOIN_ACCEPT    0x20
+#define YBX_SIM_MHDR_UNCONF_UP      0x40
+#define YBX_SIM_MHDR_UNCONF_DOWN    0x60
+#define YBX_SIM_MHDR_CONF_UP        0x80
+
+#define YBX_SIM_FCTRL_ADR   0x80
+#define YBX_SIM_FCTRL_ACK   0x20
+
+// Comando MAC LinkCheckReq en FOpts
+#define YBX_SIM_CID_LINK_CHECK  0x02
+
+static void _put_le16(std::vector<uint8_t> & v, uint16_t x)
+{
+    v.push_back(x & 0xFF);
+    v.push_back((x >> 8) & 0xFF);
+}
+
+static void _put_le32(std::vector<uint8_t> & v, uint32_t x)
+{
+    for (int i = 0; i < 4; i++) v.push_back((x >> (8 * i)) & 0xFF);
+}
+
+static uint32_t _get_le(const uint8_t * p, int n)
+{
+    uint32_t x = 0;
+    for (int i = n - 1; i >= 0; i--) x = (x << 8) | p[i];
+    return x;
+}
+
+static void _hex(char * s, const uint8_t * p, size_t n)
+{
+    for (size_t i = 0; i < n; i++) sprintf(s + 2 * i, "%02X", p[i]);
+}
+
+// Reconstruir contador de 32 bits a partir de los 16 bits de la trama
+static uint32_t _fcnt32(uint32_t last, uint16_t fcnt16)
+{
+    uint32_t f = (last & 0xFFFF0000UL) | fcnt16;
+    if (f < last) f += 0x10000UL;
+    return f;
+}
+
+void ybx_sim_default_config(ybx_sim_config_t & cfg)
+{
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.num_devices = 1;
+    cfg.duration_ms = 60000;
+    cfg.step_ms = 100;
+    cfg.tx_interval_ms = 10000;
+    cfg.payload_len = 12;
+    cfg.backhaul_ms = 50;
+    cfg.channels = 8;
+    cfg.join_spread_ms = 1000;
+    cfg.seed = 0xC0FFEE;
+}
+
+uint32_t ybx_sim_percentile(std::vector<uint32_t> v, uint32_t pct)
+{
+    if (v.empty()) return 0;
+    std::sort(v.begin(), v.end());
+    size_t rank = (v.size() * pct + 99) / 100;
+    if (rank == 0) rank = 1;
+    return v[rank - 1];
+}
+
+YbxSimNetwork::YbxSimNetwork(const ybx_sim_config_t & cfg)
+  : _cfg(cfg), _ev_order(0), _air_base(0), _netid(0x000013), _appnonce(0x000100)
+{
+    if (_cfg.step_ms == 0) _cfg.step_ms = 100;
+    if (_cfg.payload_len < 8) _cfg.payload_len = 8;
+    if (_cfg.channels == 0) _cfg.channels = 1;
+    _rng = _cfg.seed ? _cfg.seed : 1;
+    if (_cfg.gw_duty_permille > 0) _gwDuty.configure(_cfg.gw_duty_permille, 3600000UL);
+
+    report = ybx_sim_report_t();
+
+    mock_nvs_reset();
+    mock_set_us(1000000ULL);
+    mock_wakeup_cause = ESP_SLEEP_WAKEUP_UNDEFINED;
+    _t0 = millis();
+
+    for (uint32_t i = 0; i < _cfg.num_devices; i++) {
+        sim_device_t * d = new sim_device_t();
+        _devs.push_back(d);
+
+        char s[40];
+        snprintf(s, sizeof(s), "dev%u:", i);
+        d->nvs = s;
+
+        // Credenciales únicas, provistas por igual al dispositivo y al servidor
+        for (int j = 0; j < 8; j++) d->ns.devEUI[j] = (j < 4) ? (uint8_t)(0x70 + j) : (uint8_t)(i >> (8 * (7 - j)));
+        for (int j = 0; j < 16; j++) d->ns.appKey[j] = (uint8_t)(0x5A + 31 * i + 17 * j);
+        d->ns.joined = false;
+        d->ns.fcnt_up_valid = false;
+
+        d->ts_start = _t0 + ((_cfg.join_spread_ms > 0) ? _rand() % _cfg.join_spread_ms : 0);
+        d->started = false;
+        d->joined = false;
+        d->devnonce = (uint16_t)_rand();
+        d->join_attempt = 0;
+        d->confirm_fcnt = 0;
+        d->next_tx = 0;
+        d->seq = 0;
+
+        _select(i);
+        mock_lmh_reset();
+        d->mac.random_seed = _rand();
+        d->mac.on_join_request = [this, i]() { _macJoinRequest(i); };
+        d->mac.on_uplink = [this, i](const mock_lmh_frame_t & f) { _macUplink(i, f); };
+
+        d->srv = new AsyncWebServer();
+        d->lw = new YuboxLoRaWANConfigClass();
+        d->lw->begin(*(d->srv));
+        d->lw->onRX(1, 199, [this, i](uint8_t port, uint8_t * p, size_t n) {
+            report.downlinks_received++;
+            _devs[i]->rx.push_back(std::make_pair(port, std::vector<uint8_t>(p, p + n)));
+        });
+        d->lw->onTXConfirm([this](bool ok) {
+            if (ok) report.confirm_ok++; else report.confirm_fail++;
+        });
+
+        char deveui[17], appkey[33], txduty[12];
+        _hex(deveui, d->ns.devEUI, 8);
+        _hex(appkey, d->ns.appKey, 16);
+        snprintf(txduty, sizeof(txduty), "%u", std::max(10U, _cfg.tx_interval_ms / 1000));
+
+        AsyncWebServerRequest req(HTTP_POST);
+        req.addParam("region", "1", true);
+        req.addParam("subband", "2", true);
+        req.addParam("deviceEUI", deveui, true);
+        req.addParam("appEUI", "", true);
+        req.addParam("appKey", appkey, true);
+        req.addParam("tx_duty_sec", txduty, true);
+        d->srv->mock_request("/yubox-api/lorawan/config.json", req);
+        if (req.code != 200) log_e("dispositivo %u no aceptó la configuración: %s", i, req.body.c_str());
+
+        _deselect();
+    }
+}
+
+YbxSimNetwork::~YbxSimNetwork()
+{
+    for (uint32_t i = 0; i < _devs.size(); i++) {
+        _select(i);
+        delete _devs[i]->lw;
+        delete _devs[i]->srv;
+        _deselect();
+        delete _devs[i];
+    }
+}
+
+uint32_t YbxSimNetwork::_rand(void)
+{
+    // xorshift64
+    _rng ^= _rng << 13;
+    _rng ^= _rng >> 7;
+    _rng ^= _rng << 17;
+    return (uint32_t)(_rng >> 16);
+}
+
+void YbxSimNetwork::_select(uint32_t i)
+{
+    sim_device_t & d = *(_devs[i]);
+    mock_lmh_select(&d.mac);
+    mock_nvs.device = d.nvs;
+    if (d.lw != NULL) YuboxLoRaWANConfigClass::_activeInstance = d.lw;
+}
+
+void YbxSimNetwork::_deselect(void)
+{
+    mock_lmh_select(NULL);
+    mock_nvs.device.clear();
+}
+
+void YbxSimNetwork::_schedule(ev_t & ev)
+{
+    ev.order = _ev_order++;
+    _events.push(ev);
+}
+
+uint32_t YbxSimNetwork::_airtime_ms(int8_t dr, uint8_t phylen)
+{
+    uint16_t n = (phylen > YUBOX_LORAWAN_PHY_OVERHEAD) ? phylen - YUBOX_LORAWAN_PHY_OVERHEAD : 0;
+    uint32_t us = yuboxlorawan_airtime_us(YBX_LW_DRT_AU915, (uint8_t)dr, n);
+    return (us + 999) / 1000;
+}
+
+// Registrar una trama de subida en el aire y marcar colisiones con las
+// tramas que se traslapan en el mismo canal y datarate. Devuelve su índice.
+uint32_t YbxSimNetwork::_airStart(uint32_t t_end, uint32_t airtime, int8_t dr)
+{
+    air_t a;
+    a.t_start = t_end - airtime;
+    a.t_end = t_end;
+    a.channel = (uint8_t)(_rand() % _cfg.channels);
+    a.dr = dr;
+    a.collided = false;
+
+    // Las tramas terminadas antes del inicio de ésta ya no pueden traslaparse,
+    // salvo que sigan pendientes de llegar al servidor
+    while (!_air.empty() && (int32_t)(a.t_start - _air.front().t_end) > (int32_t)(_cfg.backhaul_ms + 60000)) {
+        _air.pop_front();
+        _air_base++;
+    }
+
+    if (_cfg.collisions) {
+        for (auto & o : _air) {
+            if (o.channel != a.channel || o.dr != a.dr) continue;
+            if ((int32_t)(o.t_start - a.t_end) < 0 && (int32_t)(a.t_start - o.t_end) < 0) {
+                o.collided = true;
+                a.collided = true;
+            }
+        }
+    }
+
+    _air.push_back(a);
+    return _air_base + _air.size() - 1;
+}
+
+// JoinRequest emitido por lmh_join() de la MAC del dispositivo i
+void YbxSimNetwork::_macJoinRequest(uint32_t i)
+{
+    sim_device_t & d = *(_devs[i]);
+
+    d.devnonce = (uint16_t)_rand();
+    d.join_attempt++;
+    report.join_requests++;
+
+    std::vector<uint8_t> phy;
+    phy.push_back(YBX_SIM_MHDR_JOIN_REQUEST);
+    for (int j = 7; j >= 0; j--) phy.push_back(d.mac.appEui[j]);
+    for (int j = 7; j >= 0; j--) phy.push_back(d.mac.devEui[j]);
+    _put_le16(phy, d.devnonce);
+    _put_le32(phy, ybx_lw_join_mic(d.mac.appKey, phy.data(), phy.size()));
+
+    uint32_t now = millis();
+    uint32_t t_end = now + _airtime_ms(d.mac.datarate, phy.size());
+
+    ev_t ev;
+    ev.dev = i;
+    ev.t_end = t_end;
+    ev.fcnt = d.join_attempt;
+    ev.confirmed = false;
+    ev.air = _airStart(t_end, t_end - now, d.mac.datarate);
+    if (_lost(_cfg.loss_up_permille)) {
+        ev.type = EV_JOIN_FAIL;
+        ev.t = t_end + YBX_SIM_JOIN_ACCEPT_DELAY2_MS + YBX_SIM_RX_TIMEOUT_MS;
+    } else {
+        ev.type = EV_JOIN_REQUEST;
+        ev.t = t_end + _cfg.backhaul_ms;
+        ev.phy = phy;
+    }
+    _schedule(ev);
+}
+
+// Trama de datos aceptada por lmh_send() de la MAC del dispositivo i
+void YbxSimNetwork::_macUplink(uint32_t i, const mock_lmh_frame_t & f)
+{
+    sim_device_t & d = *(_devs[i]);
+
+    std::vector<uint8_t> phy;
+    phy.push_back(f.confirmed ? YBX_SIM_MHDR_CONF_UP : YBX_SIM_MHDR_UNCONF_UP);
+    _put_le32(phy, d.mac.devAddr);
+    phy.push_back((d.mac.adr ? YBX_SIM_FCTRL_ADR : 0) | (f.linkcheck ? 1 : 0));
+    _put_le16(phy, (uint16_t)f.fcnt);
+    if (f.linkcheck) phy.push_back(YBX_SIM_CID_LINK_CHECK);
+    phy.push_back(f.port);
+    if (!f.data.empty()) {
+        std::vector<uint8_t> enc(f.data.size());
+        const uint8_t * key = (f.port == 0) ? d.mac.nwkSKey : d.mac.appSKey;
+        ybx_lw_payload_crypt(key, YBX_LW_DIR_UP, d.mac.devAddr, f.fcnt, f.data.data(), enc.data(), enc.size());
+        phy.insert(phy.end(), enc.begin(), enc.end());
+    }
+    _put_le32(phy, ybx_lw_data_mic(d.mac.nwkSKey, YBX_LW_DIR_UP, d.mac.devAddr, f.fcnt, phy.data(), phy.size()));
+
+    report.frames_tx++;
+
+    uint32_t now = millis();
+    uint32_t airtime = _airtime_ms(f.datarate, phy.size());
+    uint32_t t_end = now + airtime;
+
+    // La MAC queda ocupada hasta cerrar RX2, y más si impone ciclo de trabajo
+    d.mac.busy_until = t_end + YBX_SIM_RECEIVE_DELAY2_MS + YBX_SIM_RX_TIMEOUT_MS;
+    if (_cfg.mac_duty_permille > 0) {
+        uint32_t off = (uint32_t)(((uint64_t)airtime * 1000) / _cfg.mac_duty_permille);
+        if ((int32_t)(now + off - d.mac.busy_until) > 0) d.mac.busy_until = now + off;
+    }
+    if (f.confirmed) d.confirm_fcnt = f.fcnt;
+
+    ev_t ev;
+    ev.dev = i;
+    ev.t_end = t_end;
+    ev.fcnt = f.fcnt;
+    ev.confirmed = f.confirmed;
+    ev.air = _airStart(t_end, airtime, f.datarate);
+    if (_lost(_cfg.loss_up_permille)) {
+        report.frames_lost++;
+        if (!f.confirmed) return;
+        ev.type = EV_CONFIRM_FAIL;
+        ev.t = t_end + YBX_SIM_RECEIVE_DELAY2_MS + YBX_SIM_RX_TIMEOUT_MS;
+    } else {
+        ev.type = EV_UPLINK;
+        ev.t = t_end + _cfg.backhaul_ms;
+        ev.phy = phy;
+    }
+    _schedule(ev);
+}
+
+void YbxSimNetwork::_nsJoinRequest(ev_t & ev)
+{
+    ev_t fail;
+    fail.type = EV_JOIN_FAIL;
+    fail.dev = ev.dev;
+    fail.fcnt = ev.fcnt;
+    fail.t_end = ev.t_end;
+    fail.confirmed = false;
+    fail.air = 0;
+    fail.t = ev.t_end + YBX_SIM_JOIN_ACCEPT_DELAY2_MS + YBX_SIM_RX_TIMEOUT_MS;
+
+    if (ev.air >= _air_base && _air[ev.air - _air_base].collided) {
+        report.frames_collided++;
+        _schedule(fail);
+        return;
+    }
+
+    // Búsqueda del dispositivo por DevEUI, como lo haría el servidor
+    const std::vector<uint8_t> & phy = ev.phy;
+    uint8_t deveui[8];
+    for (int j = 0; j < 8; j++) deveui[j] = phy[16 - j];
+    sim_device_t * d = NULL;
+    for (auto * c : _devs) if (memcmp(c->ns.devEUI, deveui, 8) == 0) { d = c; break; }
+    if (d == NULL || ybx_lw_join_mic(d->ns.appKey, phy.data(), 19) != _get_le(phy.data() + 19, 4)) {
+        report.join_mic_fail++;
+        _schedule(fail);
+        return;
+    }
+    ns_device_t & ns = d->ns;
+
+    uint16_t devnonce = (uint16_t)_get_le(phy.data() + 17, 2);
+    if (std::find(ns.nonces.begin(), ns.nonces.end(), devnonce) != ns.nonces.end()) {
+        report.join_nonce_replay++;
+        _schedule(fail);
+        return;
+    }
+    ns.nonces.push_back(devnonce);
+
+    uint32_t appnonce = (_appnonce++) & 0xFFFFFF;
+    ns.joined = true;
+    ns.devAddr = 0x26000000UL | (ev.dev + 1);
+    ybx_lw_derive_session_keys(ns.appKey, appnonce, _netid, devnonce, ns.nwkSKey, ns.appSKey);
+    ns.fcnt_up = 0;
+    ns.fcnt_up_valid = false;
+    ns.fcnt_down = 0;
+    ns.seen.clear();
+
+    // El JoinAccept real va cifrado con AppKey; aquí sólo lleva MIC
+    std::vector<uint8_t> acc;
+    acc.push_back(YBX_SIM_MHDR_JOIN_ACCEPT);
+    for (int j = 0; j < 3; j++) acc.push_back((appnonce >> (8 * j)) & 0xFF);
+    for (int j = 0; j < 3; j++) acc.push_back((_netid >> (8 * j)) & 0xFF);
+    _put_le32(acc, ns.devAddr);
+    acc.push_back(0x00);    // DLSettings
+    acc.push_back(0x01);    // RxDelay
+    _put_le32(acc, ybx_lw_join_mic(ns.appKey, acc.data(), acc.size()));
+
+    uint32_t ready = ev.t + _cfg.backhaul_ms;
+    uint32_t t_win;
+    int8_t dr;
+    if ((int32_t)(ready - (ev.t_end + YBX_SIM_JOIN_ACCEPT_DELAY1_MS)) <= 0) {
+        t_win = ev.t_end + YBX_SIM_JOIN_ACCEPT_DELAY1_MS;
+        dr = std::min(_devs[ev.dev]->mac.datarate + 8, 13);
+    } else if ((int32_t)(ready - (ev.t_end + YBX_SIM_JOIN_ACCEPT_DELAY2_MS)) <= 0) {
+        t_win = ev.t_end + YBX_SIM_JOIN_ACCEPT_DELAY2_MS;
+        dr = YBX_SIM_RX2_DR;
+    } else {
+        report.downlinks_late++;
+        _schedule(fail);
+        return;
+    }
+    uint32_t airtime = _airtime_ms(dr, acc.size());
+    if (_gwDuty.limited() && _gwDuty.delayFor(t_win, airtime) != 0) {
+        report.downlinks_gw_duty++;
+        _schedule(fail);
+        return;
+    }
+    _gwDuty.record(t_win, airtime);
+    if (_lost(_cfg.loss_down_permille)) {
+        _schedule(fail);
+        return;
+    }
+
+    ev_t acc_ev = fail;
+    acc_ev.type = EV_JOIN_ACCEPT;
+    acc_ev.t = t_win + airtime;
+    acc_ev.phy = acc;
+    _schedule(acc_ev);
+}
+
+void YbxSimNetwork::_devJoinAccept(ev_t & ev)
+{
+    sim_device_t & d = *(_devs[ev.dev]);
+    if (d.mac.join_status != LMH_ONGOING || ev.fcnt != d.join_attempt) return;
+
+    const std::vector<uint8_t> & acc = ev.phy;
+    size_t n = acc.size() - 4;
+    if (ybx_lw_join_mic(d.mac.appKey, acc.data(), n) != _get_le(acc.data() + n, 4)) {
+        report.downlink_mic_fail++;
+        mock_lmh_join_fail();
+        return;
+    }
+
+    // Derivación de claves del lado del dispositivo, con su propia AppKey
+    uint32_t appnonce = _get_le(acc.data() + 1, 3);
+    uint32_t netid = _get_le(acc.data() + 4, 3);
+    uint32_t devaddr = _get_le(acc.data() + 7, 4);
+    uint8_t nwk[16], app[16];
+    ybx_lw_derive_session_keys(d.mac.appKey, appnonce, netid, d.devnonce, nwk, app);
+    if (memcmp(nwk, d.ns.nwkSKey, 16) != 0 || memcmp(app, d.ns.appSKey, 16) != 0) report.key_mismatch++;
+
+    report.join_accepts++;
+    mock_lmh_join_accept(devaddr, nwk, app);
+    if (!d.joined) {
+        d.joined = true;
+        report.devices_joined++;
+        report.join_ms.push_back(ev.t - d.ts_start);
+        d.next_tx = ev.t + ((_cfg.tx_interval_ms > 0) ? _rand() % _cfg.tx_interval_ms : 0);
+    }
+}
+
+void YbxSimNetwork::_nsUplink(ev_t & ev)
+{
+    sim_device_t & d = *(_devs[ev.dev]);
+    ns_device_t & ns = d.ns;
+    const std::vector<uint8_t> & phy = ev.phy;
+
+    ev_t fail;
+    fail.type = EV_CONFIRM_FAIL;
+    fail.dev = ev.dev;
+    fail.fcnt = ev.fcnt;
+    fail.t_end = ev.t_end;
+    fail.confirmed = true;
+    fail.air = 0;
+    fail.t = ev.t_end + YBX_SIM_RECEIVE_DELAY2_MS + YBX_SIM_RX_TIMEOUT_MS;
+
+    if (ev.air >= _air_base && _air[ev.air - _air_base].collided) {
+        report.frames_collided++;
+        if (ev.confirmed) _schedule(fail);
+        return;
+    }
+
+    uint32_t devaddr = _get_le(phy.data() + 1, 4);
+    uint8_t fctrl = phy[5];
+    uint16_t fcnt16 = (uint16_t)_get_le(phy.data() + 6, 2);
+    size_t pos = 8 + (fctrl & 0x0F);
+    size_t n = phy.size() - 4;
+    uint32_t fcnt = ns.fcnt_up_valid ? _fcnt32(ns.fcnt_up, fcnt16) : fcnt16;
+
+    if (!ns.joined || devaddr != ns.devAddr
+        || ybx_lw_data_mic(ns.nwkSKey, YBX_LW_DIR_UP, devaddr, fcnt, phy.data(), n) != _get_le(phy.data() + n, 4)) {
+        report.mic_fail++;
+        if (ev.confirmed) _schedule(fail);
+        return;
+    }
+    if (ns.fcnt_up_valid && fcnt <= ns.fcnt_up) {
+        report.fcnt_replay++;
+        if (ev.confirmed) _schedule(fail);
+        return;
+    }
+    ns.fcnt_up = fcnt;
+    ns.fcnt_up_valid = true;
+    report.frames_rx++;
+
+    // Payload de aplicación: secuencia y marca de tiempo en los primeros 8 bytes
+    if (pos < n) {
+        uint8_t port = phy[pos];
+        std::vector<uint8_t> data(n - pos - 1);
+        const uint8_t * key = (port == 0) ? ns.nwkSKey : ns.appSKey;
+        if (!data.empty()) ybx_lw_payload_crypt(key, YBX_LW_DIR_UP, devaddr, fcnt, phy.data() + pos + 1, data.data(), data.size());
+        if (port == LORAWAN_APP_PORT && data.size() >= 8) {
+            uint32_t seq = _get_le(data.data(), 4);
+            uint32_t ts = _get_le(data.data() + 4, 4);
+            if (ns.seen.size() <= seq) ns.seen.resize(seq + 1, false);
+            if (ns.seen[seq]) {
+                report.duplicates++;
+            } else {
+                ns.seen[seq] = true;
+                report.delivered++;
+                report.delivered_bytes += data.size();
+                report.latency_ms.push_back(ev.t - ts);
+            }
+        }
+    }
+
+    bool has_data = !ns.downlinks.empty();
+    if (!ev.confirmed && !has_data) return;
+
+    // Respuesta en RX1 si la latencia del enlace lo permite, si no en RX2
+    uint32_t ready = ev.t + _cfg.backhaul_ms;
+    uint32_t t_win;
+    int8_t dr;
+    if ((int32_t)(ready - (ev.t_end + YBX_SIM_RECEIVE_DELAY1_MS)) <= 0) {
+        t_win = ev.t_end + YBX_SIM_RECEIVE_DELAY1_MS;
+        dr = std::min(d.mac.datarate + 8, 13);
+    } else if ((int32_t)(ready - (ev.t_end + YBX_SIM_RECEIVE_DELAY2_MS)) <= 0) {
+        t_win = ev.t_end + YBX_SIM_RECEIVE_DELAY2_MS;
+        dr = YBX_SIM_RX2_DR;
+    } else {
+        report.downlinks_late++;
+        if (ev.confirmed) _schedule(fail);
+        return;
+    }
+
+    std::vector<uint8_t> dn;
+    dn.push_back(YBX_SIM_MHDR_UNCONF_DOWN);
+    _put_le32(dn, devaddr);
+    dn.push_back(ev.confirmed ? YBX_SIM_FCTRL_ACK : 0);
+    _put_le16(dn, (uint16_t)ns.fcnt_down);
+    if (has_data) {
+        const std::vector<uint8_t> & data = ns.downlinks.front().second;
+        dn.push_back(ns.downlinks.front().first);
+        std::vector<uint8_t> enc(data.size());
+        if (!data.empty()) ybx_lw_payload_crypt(ns.appSKey, YBX_LW_DIR_DOWN, devaddr, ns.fcnt_down, data.data(), enc.data(), enc.size());
+        dn.insert(dn.end(), enc.begin(), enc.end());
+    }
+    _put_le32(dn, ybx_lw_data_mic(ns.nwkSKey, YBX_LW_DIR_DOWN, devaddr, ns.fcnt_down, dn.data(), dn.size()));
+
+    uint32_t airtime = _airtime_ms(dr, dn.size());
+    if (_gwDuty.limited() && _gwDuty.delayFor(t_win, airtime) != 0) {
+        report.downlinks_gw_duty++;
+        if (ev.confirmed) _schedule(fail);
+        return;
+    }
+    _gwDuty.record(t_win, airtime);
+    ns.fcnt_down++;
+    if (ev.confirmed) report.acks_sent++;
+    if (has_data) {
+        report.downlinks_sent++;
+        ns.downlinks.pop_front();
+    }
+
+    if (_lost(_cfg.loss_down_permille)) {
+        if (ev.confirmed) {
+            report.acks_lost++;
+            _schedule(fail);
+        }
+        return;
+    }
+
+    ev_t dn_ev = fail;
+    dn_ev.type = EV_DOWNLINK;
+    dn_ev.confirmed = ev.confirmed;
+    dn_ev.t = t_win + airtime;
+    dn_ev.phy = dn;
+    _schedule(dn_ev);
+}
+
+void YbxSimNetwork::_devDownlink(ev_t & ev)
+{
+    sim_device_t & d = *(_devs[ev.dev]);
+    const std::vector<uint8_t> & dn = ev.phy;
+
+    uint32_t devaddr = _get_le(dn.data() + 1, 4);
+    uint8_t fctrl = dn[5];
+    uint32_t fcnt = _fcnt32(d.mac.downcnt, (uint16_t)_get_le(dn.data() + 6, 2));
+    size_t n = dn.size() - 4;
+    bool ack = (fctrl & YBX_SIM_FCTRL_ACK) != 0;
+
+    if (devaddr != d.mac.devAddr
+        || ybx_lw_data_mic(d.mac.nwkSKey, YBX_LW_DIR_DOWN, devaddr, fcnt, dn.data(), n) != _get_le(dn.data() + n, 4)) {
+        report.downlink_mic_fail++;
+        if (ack && d.mac.confirm_pending && d.confirm_fcnt == ev.fcnt) mock_lmh_confirm(false);
+        return;
+    }
+
+    if (ack && d.mac.confirm_pending && d.confirm_fcnt == ev.fcnt) mock_lmh_confirm(true);
+    if (n > 8) {
+        uint8_t port = dn[8];
+        uint8_t data[256];
+        ybx_lw_payload_crypt(d.mac.appSKey, YBX_LW_DIR_DOWN, devaddr, fcnt, dn.data() + 9, data, n - 9);
+        mock_lmh_downlink(port, data, n - 9);
+    }
+    d.mac.downcnt = fcnt + 1;
+}
+
+void YbxSimNetwork::_appTick(uint32_t i, uint32_t now)
+{
+    sim_device_t & d = *(_devs[i]);
+    if (!d.joined || _cfg.tx_interval_ms == 0) return;
+    if ((int32_t)(now - d.next_tx) < 0) return;
+    d.next_tx += _cfg.tx_interval_ms;
+
+    uint8_t buf[256];
+    for (uint32_t j = 0; j < _cfg.payload_len; j++) buf[j] = (uint8_t)(i + j);
+    for (int j = 0; j < 4; j++) buf[j] = (d.seq >> (8 * j)) & 0xFF;
+    for (int j = 0; j < 4; j++) buf[4 + j] = (now >> (8 * j)) & 0xFF;
+
+    bool confirmed = (_cfg.confirmed_every > 0 && d.seq % _cfg.confirmed_every == 0);
+    d.seq++;
+    if (d.lw->enqueue(buf, _cfg.payload_len, confirmed)) {
+        report.app_enqueued++;
+    } else {
+        report.app_rejected++;
+    }
+}
+
+void YbxSimNetwork::update(uint32_t i)
+{
+    _select(i);
+    _devs[i]->lw->update();
+    _deselect();
+}
+
+void YbxSimNetwork::queueDownlink(uint32_t i, uint8_t port, const uint8_t * p, uint8_t n)
+{
+    report.downlinks_queued++;
+    _devs[i]->ns.downlinks.push_back(std::make_pair(port, std::vector<uint8_t>(p, p + n)));
+}
+
+void YbxSimNetwork::run(uint32_t ms)
+{
+    if (ms == 0) ms = _cfg.duration_ms;
+    uint32_t end = millis() + ms;
+
+    while ((int32_t)(millis() - end) < 0) {
+        uint32_t next = millis() + _cfg.step_ms;
+
+        // Eventos de radio y de red hasta el siguiente paso, en orden
+        while (!_events.empty() && (int32_t)(_events.top().t - next) <= 0) {
+            ev_t ev = _events.top();
+            _events.pop();
+            if ((int32_t)(ev.t - millis()) > 0) mock_set_us((uint64_t)ev.t * 1000);
+
+            _select(ev.dev);
+            sim_device_t & d = *(_devs[ev.dev]);
+            switch (ev.type) {
+            case EV_JOIN_REQUEST:
+                _nsJoinRequest(ev);
+                break;
+            case EV_JOIN_ACCEPT:
+                _devJoinAccept(ev);
+                break;
+            case EV_JOIN_FAIL:
+                if (d.mac.join_status == LMH_ONGOING && ev.fcnt == d.join_attempt) mock_lmh_join_fail();
+                break;
+            case EV_UPLINK:
+                _nsUplink(ev);
+                break;
+            case EV_DOWNLINK:
+                _devDownlink(ev);
+                break;
+            case EV_CONFIRM_FAIL:
+                if (d.mac.confirm_pending && d.confirm_fcnt == ev.fcnt) mock_lmh_confirm(false);
+                break;
+            }
+            _deselect();
+        }
+
+        mock_set_us((uint64_t)next * 1000);
+        for (uint32_t i = 0; i < _devs.size(); i++) {
+            sim_device_t & d = *(_devs[i]);
+            if (!d.started) {
+                if ((int32_t)(next - d.ts_start) < 0) continue;
+                d.started = true;
+            }
+            _select(i);
+            _appTick(i, next);
+            d.lw->update();
+            _deselect();
+        }
+    }
+    report.sim_ms = millis() - _t0;
+}
+
+void YbxSimNetwork::printReport(FILE * f, const char * title)
+{
+    double sec = report.sim_ms / 1000.0;
+    double expected = report.app_enqueued;
+
+    fprintf(f, "=== %s ===\n", title);
+    fprintf(f, "dispositivos: %u (unidos %u), tiempo simulado %.1f s\n", (unsigned)_devs.size(), report.devices_joined, sec);
+    fprintf(f, "join: %u solicitudes, %u aceptados, %u MIC inválido, %u DevNonce repetido, %u claves distintas\n",
+        report.join_requests, report.join_accepts, report.join_mic_fail, report.join_nonce_replay, report.key_mismatch);
+    fprintf(f, "join ms: p50 %u p90 %u max %u\n",
+        ybx_sim_percentile(report.join_ms, 50), ybx_sim_percentile(report.join_ms, 90), ybx_sim_percentile(report.join_ms, 100));
+    fprintf(f, "uplinks: %u encolados, %u rechazados, %u tramas, %u perdidas, %u colisiones, %u MIC inválido, %u FCnt repetido\n",
+        report.app_enqueued, report.app_rejected, report.frames_tx, report.frames_lost, report.frames_collided,
+        report.mic_fail, report.fcnt_replay);
+    fprintf(f, "entregados: %u únicos (%.1f%%), %u duplicados\n",
+        report.delivered, (expected > 0) ? 100.0 * report.delivered / expected : 0.0, report.duplicates);
+    fprintf(f, "throughput: %.2f msg/s, %.1f B/s\n",
+        (sec > 0) ? report.delivered / sec : 0.0, (sec > 0) ? report.delivered_bytes / sec : 0.0);
+    fprintf(f, "latencia ms: p50 %u p90 %u p99 %u max %u\n",
+        ybx_sim_percentile(report.latency_ms, 50), ybx_sim_percentile(report.latency_ms, 90),
+        ybx_sim_percentile(report.latency_ms, 99), ybx_sim_percentile(report.latency_ms, 100));
+    fprintf(f, "confirmados: %u OK, %u fallidos, %u ACK enviados, %u ACK perdidos\n",
+        report.confirm_ok, report.confirm_fail, report.acks_sent, report.acks_lost);
+    fprintf(f, "downlinks: %u encolados, %u enviados, %u recibidos, %u por ciclo de trabajo, %u tardíos, %u MIC inválido\n",
+        report.downlinks_queued, report.downlinks_sent, report.downlinks_received,
+        report.downlinks_gw_duty, report.downlinks_late, report.downlink_mic_fail);
+}
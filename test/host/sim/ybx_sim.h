@@ -0,0 +1,228 @@
+#ifndef _YUBOX_HOST_SIM_H_
+#define _YUBOX_HOST_SIM_H_
+
+/*
+ * Servidor de red LoRaWAN simulado para pruebas de extremo a extremo en el
+ * host. Cada dispositivo es una instancia completa de YuboxLoRaWANConfigClass,
+ * configurada por su ruta HTTP, con su propia MAC falsa (mock_lmh_t) y su
+ * propio espacio en la NVS simulada. La MAC falsa emite tramas LoRaWAN 1.0.x
+ * reales: JoinRequest/JoinAccept con MIC, derivación OTAA de NwkSKey/AppSKey
+ * a ambos lados, y tramas de datos con FRMPayload cifrado y MIC que el
+ * servidor verifica.
+ *
+ * El tiempo es simulado: run() avanza el reloj de millis() en pasos de
+ * step_ms, entrega en orden los eventos pendientes (fin de transmisión,
+ * ventanas RX1/RX2, JoinAccept) y corre update() de cada dispositivo. Se
+ * simula pérdida independiente en subida y bajada, latencia del enlace
+ * gateway-servidor, ciclo de trabajo del gateway para downlinks, ciclo de
+ * trabajo por dispositivo aplicado en la MAC, y opcionalmente colisiones ALOHA
+ * por canal y datarate.
+ *
+ * Sólo se simula clase A: los downlinks inyectados esperan el siguiente
+ * uplink del dispositivo. El JoinAccept viaja sin cifrar (sólo con MIC).
+ */
+
+#include <stdint.h>
+
+#include <deque>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "YuboxLoRaWANConfigClass.h"
+
+typedef struct {
+  uint32_t num_devices;
+  uint32_t duration_ms;         // tiempo simulado total de run()
+  uint32_t step_ms;             // intervalo entre llamadas a update()
+  uint32_t tx_interval_ms;      // intervalo entre uplinks de aplicación de cada dispositivo
+  uint8_t payload_len;          // payload de aplicación, al menos 8 bytes
+  uint32_t confirmed_every;     // 1 de cada n uplinks es confirmado, 0 ninguno
+  uint32_t loss_up_permille;    // pérdida de tramas de subida
+  uint32_t loss_down_permille;  // pérdida de tramas de bajada
+  uint32_t backhaul_ms;         // latencia gateway <-> servidor de red, en cada sentido
+  uint32_t gw_duty_permille;    // ciclo de trabajo del gateway para downlinks, 0 sin límite
+  uint32_t mac_duty_permille;   // ciclo de trabajo por dispositivo impuesto por la MAC, 0 sin límite
+  bool collisions;              // colisiones entre tramas del mismo canal y datarate
+  uint8_t channels;             // canales de uplink para las colisiones
+  uint32_t join_spread_ms;      // dispersión aleatoria del arranque de los dispositivos
+  uint32_t seed;
+} ybx_sim_config_t;
+
+void ybx_sim_default_config(ybx_sim_config_t & cfg);
+
+// Resultados acumulados de la simulación
+typedef struct {
+  uint32_t sim_ms;
+
+  uint32_t join_requests;
+  uint32_t join_accepts;
+  uint32_t join_mic_fail;
+  uint32_t join_nonce_replay;
+  uint32_t devices_joined;
+  uint32_t key_mismatch;          // claves de sesión distintas entre dispositivo y servidor
+  std::vector<uint32_t> join_ms;  // tiempo desde el arranque hasta el join
+
+  uint32_t app_enqueued;          // uplinks aceptados por enqueue()
+  uint32_t app_rejected;          // uplinks rechazados por enqueue()
+  uint32_t frames_tx;             // tramas de datos transmitidas (incluye retransmisiones)
+  uint32_t frames_lost;           // perdidas en el aire
+  uint32_t frames_collided;
+  uint32_t frames_rx;             // recibidas por el servidor con MIC válido
+  uint32_t mic_fail;
+  uint32_t fcnt_replay;
+  uint32_t delivered;             // uplinks de aplicación únicos recibidos
+  uint32_t duplicates;            // uplinks de aplicación recibidos más de una vez
+  uint64_t delivered_bytes;
+  std::vector<uint32_t> latency_ms;   // desde enqueue() hasta la llegada al servidor
+
+  uint32_t acks_sent;
+  uint32_t acks_lost;
+  uint32_t confirm_ok;            // resultados de onTXConfirm() en los dispositivos
+  uint32_t confirm_fail;
+
+  uint32_t downlinks_queued;
+  uint32_t downlinks_sent;
+  uint32_t downlinks_received;    // entregados a callbacks de onRX()
+  uint32_t downlinks_gw_duty;     // no enviados por ciclo de trabajo del gateway
+  uint32_t downlinks_late;        // no enviados por latencia mayor a RX2
+  uint32_t downlink_mic_fail;     // rechazados por el dispositivo
+} ybx_sim_report_t;
+
+class YbxSimNetwork
+{
+public:
+  // Estado del dispositivo en el servidor de red
+  typedef struct {
+    uint8_t devEUI[8];
+    uint8_t appKey[16];
+    std::vector<uint16_t> nonces;
+    bool joined;
+    uint32_t devAddr;
+    uint8_t nwkSKey[16];
+    uint8_t appSKey[16];
+    uint32_t fcnt_up;
+    bool fcnt_up_valid;
+    uint32_t fcnt_down;
+    std::deque<std::pair<uint8_t, std::vector<uint8_t> > > downlinks;
+    std::vector<bool> seen;
+  } ns_device_t;
+
+  // Dispositivo simulado
+  typedef struct {
+    YuboxLoRaWANConfigClass * lw;
+    AsyncWebServer * srv;
+    mock_lmh_t mac;
+    std::string nvs;
+    uint32_t ts_start;
+    bool started;
+    bool joined;
+    uint16_t devnonce;        // DevNonce del último JoinRequest
+    uint32_t join_attempt;    // para descartar eventos de un intento anterior
+    uint32_t confirm_fcnt;    // contador de la última trama confirmada
+    uint32_t next_tx;
+    uint32_t seq;
+    std::vector<std::pair<uint8_t, std::vector<uint8_t> > > rx;
+    ns_device_t ns;
+  } sim_device_t;
+
+private:
+  typedef enum {
+    EV_JOIN_REQUEST,    // JoinRequest llega al servidor
+    EV_JOIN_ACCEPT,     // JoinAccept llega al dispositivo
+    EV_JOIN_FAIL,       // la MAC agota la espera del JoinAccept
+    EV_UPLINK,          // trama de datos llega al servidor
+    EV_DOWNLINK,        // trama de bajada llega al dispositivo en RX1/RX2
+    EV_CONFIRM_FAIL,    // la MAC agota RX2 sin ACK
+  } ev_type_t;
+
+  typedef struct {
+    uint32_t t;
+    uint64_t order;
+    ev_type_t type;
+    uint32_t dev;
+    uint32_t air;       // índice en _air para resolver colisiones
+    uint32_t t_end;     // fin de la transmisión de subida
+    uint32_t fcnt;      // contador de la trama, o número de intento de join
+    bool confirmed;
+    std::vector<uint8_t> phy;
+  } ev_t;
+
+  struct ev_later
+  {
+    bool operator()(const ev_t & a, const ev_t & b) const { return (a.t != b.t) ? a.t > b.t : a.order > b.order; }
+  };
+
+  // Trama de subida en el aire
+  typedef struct {
+    uint32_t t_start;
+    uint32_t t_end;
+    uint8_t channel;
+    int8_t dr;
+    bool collided;
+  } air_t;
+
+  ybx_sim_config_t _cfg;
+  std::vector<sim_device_t *> _devs;
+  std::priority_queue<ev_t, std::vector<ev_t>, ev_later> _events;
+  uint64_t _ev_order;
+  std::deque<air_t> _air;
+  uint32_t _air_base;
+  YuboxLoRaWANDutyBudget _gwDuty;
+  uint64_t _rng;
+  uint32_t _netid;
+  uint32_t _appnonce;
+  uint32_t _t0;
+
+  uint32_t _rand(void);
+  bool _lost(uint32_t permille) { return permille > 0 && (_rand() % 1000) < permille; }
+
+  void _select(uint32_t i);
+  void _deselect(void);
+  void _schedule(ev_t & ev);
+  uint32_t _airtime_ms(int8_t dr, uint8_t phylen);
+  uint32_t _airStart(uint32_t t_end, uint32_t airtime, int8_t dr);
+
+  void _macJoinRequest(uint32_t i);
+  void _macUplink(uint32_t i, const mock_lmh_frame_t & f);
+
+  void _nsJoinRequest(ev_t & ev);
+  void _devJoinAccept(ev_t & ev);
+  void _nsUplink(ev_t & ev);
+  void _devDownlink(ev_t & ev);
+
+  void _appTick(uint32_t i, uint32_t now);
+
+public:
+  ybx_sim_report_t report;
+
+  YbxSimNetwork(const ybx_sim_config_t & cfg);
+  ~YbxSimNetwork();
+
+  uint32_t size(void) { return _devs.size(); }
+
+  // Parámetros de pérdida, latencia y ciclo de trabajo, modificables entre
+  // llamadas a run()
+  ybx_sim_config_t & config(void) { return _cfg; }
+
+  // Dispositivo i. Deja seleccionadas su MAC y su NVS, para que los métodos
+  // de la instancia que consultan lmh_* respondan por él fuera de run().
+  sim_device_t & device(uint32_t i) { _select(i); return *(_devs[i]); }
+
+  // Correr update() de un dispositivo fuera de run(), con su MAC seleccionada
+  void update(uint32_t i);
+
+  // Encolar un downlink en el servidor, enviado tras el siguiente uplink
+  void queueDownlink(uint32_t i, uint8_t port, const uint8_t * p, uint8_t n);
+
+  // Avanzar la simulación ms milisegundos (duration_ms si es 0)
+  void run(uint32_t ms = 0);
+
+  // Imprimir throughput, latencias y contadores
+  void printReport(FILE * f, const char * title);
+};
+
+// Percentil por rango más cercano, 0 si no hay muestras
+uint32_t ybx_sim_percentile(std::vector<uint32_t> v, uint32_t pct);
+
+#endif
@@ -0,0 +1,117 @@
+#include "ybx_test.h"
+
+#include "YuboxLoRaWANAirtime.h"
+
+// Valores de referencia de la calculadora de Semtech (AN1200.13) para 10 bytes
+// de payload de aplicación, PHYPayload de 23 bytes
+YBX_TEST(airtime_eu868_reference)
+{
+  YBX_CHECK_EQ(yuboxlorawan_airtime_us(YBX_LW_DRT_EU868, 5, 10), 61696);
+  YBX_CHECK_EQ(yuboxlorawan_airtime_us(YBX_LW_DRT_EU868, 0, 10), 1482752);
+}
+
+// Tabla de referencia para el mismo PHYPayload de 23 bytes en cada SF y ancho
+// de banda, incluida la optimización de datarate bajo de SF11/SF12 a 125 kHz
+YBX_TEST(airtime_reference_table)
+{
+  static const struct {
+    yuboxlorawan_drtable_t t;
+    uint8_t dr;
+    uint32_t us;
+  } ref[] = {
+    { YBX_LW_DRT_EU868, 0, 1482752 },   // SF12/125
+    { YBX_LW_DRT_EU868, 1,  823296 },   // SF11/125
+    { YBX_LW_DRT_EU868, 2,  370688 },   // SF10/125
+    { YBX_LW_DRT_EU868, 3,  205824 },   // SF9/125
+    { YBX_LW_DRT_EU868, 4,  113152 },   // SF8/125
+    { YBX_LW_DRT_EU868, 5,   61696 },   // SF7/125
+    { YBX_LW_DRT_EU868, 6,   30848 },   // SF7/250
+    { YBX_LW_DRT_US915, 0,  370688 },   // SF10/125
+    { YBX_LW_DRT_US915, 4,   28288 },   // SF8/500
+    { YBX_LW_DRT_AU915, 0, 1482752 },   // SF12/125
+    { YBX_LW_DRT_AU915, 3,  205824 },   // SF9/125
+    { YBX_LW_DRT_AU915, 6,   28288 },   // SF8/500
+  };
+  for (auto & r : ref) YBX_CHECK_EQ(yuboxlorawan_airtime_us(r.t, r.dr, 10), r.us);
+}
+
+YBX_TEST(airtime_undefined_datarate)
+{
+  YBX_CHECK_EQ(yuboxlorawan_airtime_us(YBX_LW_DRT_US915, 5, 10), 0);
+  YBX_CHECK_EQ(yuboxlorawan_airtime_us(YBX_LW_DRT_EU868, YUBOX_LORAWAN_DR_MAX, 10), 0);
+  YBX_CHECK_EQ(yuboxlorawan_airtime_us(YBX_LW_DRT_MAX, 0, 10), 0);
+}
+
+YBX_TEST(airtime_fsk)
+{
+  // (5 + 3 + 1 + 23 + 2) bytes a 50 kbps
+  YBX_CHECK_EQ(yuboxlorawan_airtime_us(YBX_LW_DRT_EU868, 7, 10), 34 * 8 * 20);
+}
+
+YBX_TEST(duty_unlimited)
+{
+  YuboxLoRaWANDutyBudget d;
+
+  d.record(0, 1000);
+  YBX_CHECK(!d.limited());
+  YBX_CHECK_EQ(d.remaining(0), UINT32_MAX);
+  YBX_CHECK_EQ(d.delayFor(0, 1000000), 0);
+  YBX_CHECK_EQ(d.total(), 1000);
+  YBX_CHECK_EQ(d.minIntervalSec(1000), 0);
+}
+
+YBX_TEST(duty_budget)
+{
+  YuboxLoRaWANDutyBudget d;
+
+  // 1% de 3600 s = 36 s por ventana
+  d.configure(10, 3600000UL);
+  YBX_CHECK_EQ(d.budget(), 36000);
+  d.record(1000, 30000);
+  YBX_CHECK_EQ(d.used(1000), 30000);
+  YBX_CHECK_EQ(d.remaining(1000), 6000);
+  YBX_CHECK_EQ(d.delayFor(1000, 6000), 0);
+  YBX_CHECK(d.delayFor(1000, 6001) > 0);
+  YBX_CHECK_EQ(d.delayFor(1000, 36001), UINT32_MAX);
+  YBX_CHECK_EQ(d.minIntervalSec(1000), 100);
+}
+
+YBX_TEST(duty_window_edge)
+{
+  YuboxLoRaWANDutyBudget d;
+
+  // Ventana de 60 s en cubetas de 1 s, 600 ms de presupuesto
+  d.configure(10, 60000UL);
+  YBX_CHECK_EQ(d.budget(), 600);
+  d.record(500, 600);
+
+  // La ventana (0, 60000] todavía contiene la transmisión en 500
+  YBX_CHECK_EQ(d.used(60000), 600);
+  YBX_CHECK_EQ(d.remaining(60000), 0);
+  YBX_CHECK_EQ(d.delayFor(60000, 1), 1000);
+
+  // Desde 30 s, la cubeta 0 sale por completo de la ventana en 61 s
+  YBX_CHECK_EQ(d.delayFor(30000, 1), 31000);
+
+  // Se cuenta de forma conservadora hasta el final de su cubeta más la ventana
+  YBX_CHECK_EQ(d.used(60999), 600);
+  YBX_CHECK_EQ(d.used(61000), 0);
+  YBX_CHECK_EQ(d.delayFor(61000, 600), 0);
+}
+
+YBX_TEST(duty_window_slots)
+{
+  YuboxLoRaWANDutyBudget d;
+
+  // Las épocas 0 y 60 están vigentes a la vez y no comparten cubeta
+  d.configure(10, 60000UL);
+  d.record(500, 100);
+  d.record(60500, 200);
+  YBX_CHECK_EQ(d.used(60500), 300);
+  YBX_CHECK_EQ(d.used(61000), 200);
+
+  // La época 61 reutiliza la cubeta de la 0, ya vencida
+  d.record(61500, 50);
+  YBX_CHECK_EQ(d.used(61500), 250);
+  YBX_CHECK_EQ(d.total(), 350);
+}
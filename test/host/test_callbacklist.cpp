@@ -0,0 +1,136 @@
+#include "ybx_test.h"
+#include "ybx_bench.h"
+
+#include <functional>
+#include <vector>
+
+#include "YuboxLoRaWANCallbackList.h"
+
+typedef std::function<void (uint8_t *, uint8_t) > rx_fn_t;
+
+YBX_TEST(cblist_add_remove)
+{
+  YuboxLoRaWANCallbackList<rx_fn_t> l;
+  int a = 0, b = 0;
+
+  size_t ia = l.add([&](uint8_t *, uint8_t n) { a += n; });
+  size_t ib = l.add([&](uint8_t *, uint8_t n) { b += n; });
+  YBX_CHECK(ia != 0 && ib != 0 && ia != ib);
+  YBX_CHECK_EQ(l.add(rx_fn_t()), 0);
+
+  l.dispatch((uint8_t *)NULL, (uint8_t)2);
+  YBX_CHECK_EQ(a, 2);
+  YBX_CHECK_EQ(b, 2);
+
+  // Un ID removido no borra a la entrada que reusa su posición
+  l.remove(ia);
+  size_t ic = l.add([&](uint8_t *, uint8_t n) { a += 10 * n; });
+  YBX_CHECK(ic != ia);
+  l.remove(ia);
+  l.dispatch((uint8_t *)NULL, (uint8_t)1);
+  YBX_CHECK_EQ(a, 12);
+  YBX_CHECK_EQ(b, 3);
+}
+
+YBX_TEST(cblist_mutation_during_dispatch)
+{
+  YuboxLoRaWANCallbackList<rx_fn_t> l;
+  int calls_self = 0, calls_late = 0, calls_new = 0;
+  size_t id_self = 0, id_late = 0;
+
+  // El primero se remueve a sí mismo, remueve al tercero y agrega uno nuevo
+  id_self = l.add([&](uint8_t *, uint8_t) {
+    calls_self++;
+    l.remove(id_self);
+    l.remove(id_late);
+    l.add([&](uint8_t *, uint8_t) { calls_new++; });
+  });
+  l.add([&](uint8_t *, uint8_t) {});
+  id_late = l.add([&](uint8_t *, uint8_t) { calls_late++; });
+
+  l.dispatch((uint8_t *)NULL, (uint8_t)0);
+  YBX_CHECK_EQ(calls_self, 1);
+  YBX_CHECK_EQ(calls_late, 0);
+  YBX_CHECK_EQ(calls_new, 0);
+
+  l.dispatch((uint8_t *)NULL, (uint8_t)0);
+  YBX_CHECK_EQ(calls_self, 1);
+  YBX_CHECK_EQ(calls_new, 1);
+}
+
+// Entrada del registro compartido anterior: cuatro std::function por entrada
+// aunque sólo una se usa, recorrida copiando cada entrada por valor
+typedef struct {
+  size_t id;
+  uint8_t event_type;
+  std::function<void (void) > j_fcb;
+  rx_fn_t rx_fcb;
+  std::function<void (uint32_t) > txd_fcb;
+  std::function<void (bool, uint8_t) > txc_fcb;
+} legacy_entry_t;
+
+YBX_TEST(cblist_bench_dispatch_and_ram)
+{
+  // 4 callbacks por cada uno de 4 tipos de evento; la captura de 3 punteros
+  // no cabe en el almacenamiento interno de std::function
+  const unsigned int N = 4;
+  volatile uint32_t sink = 0;
+  uint32_t k1 = 1, k2 = 2;
+  auto mk = [&]() { return [&sink, &k1, &k2](uint8_t *, uint8_t n) { sink = sink + n + k1 + k2; }; };
+
+  std::vector<legacy_entry_t> legacy;
+  ybx_alloc_scope legacy_ram;
+  for (unsigned int i = 0; i < 4 * N; i++) {
+    legacy_entry_t e;
+    e.id = i + 1;
+    e.event_type = i % 4;
+    if (e.event_type == 1) e.rx_fcb = mk();
+    else if (e.event_type == 0) e.j_fcb = [&sink]() { sink = sink + 1; };
+    else if (e.event_type == 2) e.txd_fcb = [&sink](uint32_t) { sink = sink + 1; };
+    else e.txc_fcb = [&sink](bool, uint8_t) { sink = sink + 1; };
+    legacy.push_back(e);
+  }
+  uint64_t legacy_bytes = legacy_ram.bytes();
+
+  YuboxLoRaWANCallbackList<rx_fn_t> rx;
+  YuboxLoRaWANCallbackList<std::function<void (void) > > j;
+  YuboxLoRaWANCallbackList<std::function<void (uint32_t) > > txd;
+  YuboxLoRaWANCallbackList<std::function<void (bool, uint8_t) > > txc;
+  ybx_alloc_scope list_ram;
+  for (unsigned int i = 0; i < N; i++) {
+    rx.add(mk());
+    j.add([&sink]() { sink = sink + 1; });
+    txd.add([&sink](uint32_t) { sink = sink + 1; });
+    txc.add([&sink](bool, uint8_t) { sink = sink + 1; });
+  }
+  uint64_t list_bytes = list_ram.bytes();
+
+  uint8_t buf[4] = { 0 };
+  const uint32_t iters = 20000;
+
+  ybx_alloc_scope legacy_allocs;
+  double legacy_ns = ybx_bench_ns(iters, [&]() {
+    for (size_t i = 0; i < legacy.size(); i++) {
+      legacy_entry_t e = legacy[i];
+      if (e.event_type == 1 && e.rx_fcb) e.rx_fcb(buf, 4);
+    }
+  });
+  double legacy_per_op = (double)legacy_allocs.count() / iters;
+  double legacy_bytes_op = (double)legacy_allocs.bytes() / iters;
+
+  ybx_alloc_scope list_allocs;
+  double list_ns = ybx_bench_ns(iters, [&]() { rx.dispatch(buf, (uint8_t)4); });
+  double list_per_op = (double)list_allocs.count() / iters;
+  double list_bytes_op = (double)list_allocs.bytes() / iters;
+
+  printf("Registro de callbacks, %u por tipo de evento:\n", N);
+  printf("  sizeof entrada anterior %u bytes, heap vector compartido %llu bytes, heap 4 registros %llu bytes\n",
+    (unsigned int)sizeof(legacy_entry_t), (unsigned long long)legacy_bytes, (unsigned long long)list_bytes);
+  ybx_bench_report("despacho RX, vector compartido con copia", legacy_ns, legacy_per_op, legacy_bytes_op);
+  ybx_bench_report("despacho RX, YuboxLoRaWANCallbackList", list_ns, list_per_op, list_bytes_op);
+
+  // Copiar la entrada copia su std::function con captura en heap
+  YBX_CHECK(legacy_per_op >= N);
+  YBX_CHECK_EQ(list_allocs.count(), 0);
+  YBX_CHECK(list_bytes < legacy_bytes);
+}
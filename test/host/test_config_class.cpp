@@ -0,0 +1,584 @@
+#include "ybx_test.h"
+#include "ybx_lw_fixture.h"
+
+#include "YuboxLoRaWANNVRAMState.h"
+
+#include <esp_partition.h>
+
+#include <thread>
+
+YBX_TEST(class_begin_without_config)
+{
+  YbxLWFixture f;
+
+  YBX_CHECK(f.begun);
+  YBX_CHECK_EQ(mock_lmh.num_hw_init, 1);
+  f.run();
+  YBX_CHECK_EQ(mock_lmh.num_init, 0);
+  YBX_CHECK(!f.lw->isJoined());
+  YBX_CHECK(!f.lw->send((uint8_t *)"x", 1));
+}
+
+YBX_TEST(class_config_post_validation)
+{
+  YbxLWFixture f;
+
+  YBX_CHECK_EQ(f.configure({ { "region", "99" } }), 400);
+  YBX_CHECK_EQ(f.configure({ { "appKey", "0001" } }), 400);
+  YBX_CHECK_EQ(f.configure({ { "tx_duty_sec", "5" } }), 400);
+  YBX_CHECK(mock_nvs.data.empty());
+
+  YBX_CHECK_EQ(f.configure({ { "tx_duty_sec", "60" } }), 200);
+  YBX_CHECK_EQ(f.lw->getRequestedTXDutyCycle(), 60);
+  YBX_CHECK(mock_nvs.data.count("YUBOX/LoRaWAN/" YUBOX_LORAWAN_NVRAM_STATE_KEY) == 1);
+
+  std::string body;
+  YBX_CHECK_EQ(f.get("/yubox-api/lorawan/config.json", &body), 200);
+  YBX_CHECK_STR(body.c_str(), "\"deviceEUI\":\"0011223344556677\"");
+  YBX_CHECK_STR(body.c_str(), "\"subband\":2");
+}
+
+YBX_TEST(class_otaa_join_and_uplink)
+{
+  YbxLWFixture f;
+  int joined = 0;
+
+  f.lw->onJoin([&]() { joined++; });
+  YBX_CHECK_EQ(f.configure(), 200);
+  f.run();
+  YBX_CHECK_EQ(mock_lmh.num_init, 1);
+  YBX_CHECK(mock_lmh.otaa);
+  YBX_CHECK_EQ(mock_lmh.region, LORAMAC_REGION_AU915);
+  YBX_CHECK_EQ(mock_lmh.subband, 2);
+  YBX_CHECK(memcmp(mock_lmh.appKey, "\x00\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0A\x0B\x0C\x0D\x0E\x0F", 16) == 0);
+
+  mock_lmh_join_accept(YBX_TEST_DEVADDR, ybx_test_nwkskey, ybx_test_appskey);
+  // El evento de join se procesa en update(), no en el callback de radio
+  YBX_CHECK_EQ(joined, 0);
+  f.run();
+  YBX_CHECK_EQ(joined, 1);
+  YBX_CHECK(f.lw->isJoined());
+
+  uint8_t data[4] = { 1, 2, 3, 4 };
+  size_t nsent = mock_lmh.sent.size();
+  YBX_CHECK(f.lw->send(data, sizeof(data), false, 7));
+  YBX_CHECK_EQ(mock_lmh.sent.size(), nsent + 1);
+  YBX_CHECK_EQ(mock_lmh.sent.back().port, 7);
+  YBX_CHECK(mock_lmh.sent.back().data == std::vector<uint8_t>(data, data + 4));
+  YBX_CHECK(!f.lw->send(data, sizeof(data), false, 0));
+  YBX_CHECK(!f.lw->send(data, sizeof(data), false, 224));
+  YBX_CHECK(f.lw->getTotalAirtime() > 0);
+}
+
+YBX_TEST(class_downlink_dispatch)
+{
+  YbxLWFixture f;
+  std::vector<uint8_t> got;
+  uint8_t gotport = 0;
+  int16_t gotrssi = 0;
+
+  f.configure();
+  YBX_CHECK(f.join());
+  f.lw->onRX(10, 20, [&](uint8_t port, uint8_t * p, size_t n) { gotport = port; got.assign(p, p + n); });
+  f.lw->onRXInfo(10, 20, [&](const yuboxlorawan_rxinfo_t & i) { gotrssi = i.rssi; });
+
+  const uint8_t d[3] = { 9, 8, 7 };
+  mock_lmh_downlink(30, d, 3);
+  f.run();
+  YBX_CHECK(got.empty());
+
+  mock_lmh_downlink(15, d, 3, -97, 5);
+  YBX_CHECK(got.empty());
+  f.run();
+  YBX_CHECK_EQ(gotport, 15);
+  YBX_CHECK(got == std::vector<uint8_t>(d, d + 3));
+  YBX_CHECK_EQ(gotrssi, -97);
+
+  yuboxlorawan_link_stats_t st;
+  YBX_CHECK(f.lw->getLinkStats(st));
+  YBX_CHECK_EQ(st.total, 2);
+}
+
+YBX_TEST(class_confirmed_uplink)
+{
+  YbxLWFixture f;
+  int results = 0;
+  bool lastok = false;
+  uint32_t lastattempts = 0;
+
+  f.configure();
+  YBX_CHECK(f.join());
+  f.lw->onTXConfirm([&](bool ok, uint32_t attempts) { results++; lastok = ok; lastattempts = attempts; });
+
+  uint8_t data[2] = { 5, 6 };
+  YBX_CHECK(f.lw->send(data, sizeof(data), true));
+  YBX_CHECK(mock_lmh.sent.back().confirmed);
+  YBX_CHECK(f.lw->isWaitingConfirmation());
+
+  mock_lmh_confirm(true);
+  f.run();
+  YBX_CHECK_EQ(results, 1);
+  YBX_CHECK(lastok);
+  YBX_CHECK_EQ(lastattempts, 1);
+  YBX_CHECK(!f.lw->isWaitingConfirmation());
+}
+
+YBX_TEST(class_session_restored_after_reboot)
+{
+  uint32_t upcnt;
+
+  {
+    YbxLWFixture f;
+    f.configure();
+    YBX_CHECK(f.join());
+    uint8_t data[1] = { 1 };
+    for (int i = 0; i < 3; i++) YBX_CHECK(f.lw->send(data, 1));
+    upcnt = mock_lmh.upcnt;
+    YBX_CHECK(f.lw->flushFrameCounters());
+  }
+
+  // Segunda instancia con la misma NVS: ABP con las claves negociadas
+  YbxLWFixture f(false);
+  f.run(2);
+  YBX_CHECK(!mock_lmh.otaa);
+  YBX_CHECK_EQ(mock_lmh.devAddr, YBX_TEST_DEVADDR);
+  YBX_CHECK(memcmp(mock_lmh.nwkSKey, ybx_test_nwkskey, 16) == 0);
+  YBX_CHECK(f.lw->isJoined());
+  YBX_CHECK(mock_lmh.upcnt >= upcnt);
+}
+
+YBX_TEST(class_metrics_routes)
+{
+  YbxLWFixture f;
+  std::string body;
+
+  f.configure();
+  YBX_CHECK(f.join());
+  f.lw->send((uint8_t *)"abc", 3);
+
+  YBX_CHECK_EQ(f.get("/yubox-api/lorawan/metrics.json", &body), 200);
+  YBX_CHECK_EQ(body[0], '{');
+  YBX_CHECK_STR(body.c_str(), "\"txq_sent\"");
+  YBX_CHECK_EQ(f.get("/yubox-api/lorawan/metrics", &body), 200);
+  YBX_CHECK_STR(body.c_str(), "# TYPE yubox_lorawan_");
+  YBX_CHECK_EQ(f.get("/yubox-api/lorawan/regions.json", &body), 200);
+  YBX_CHECK_STR(body.c_str(), "\"name\"");
+}
+
+YBX_TEST(class_status_events)
+{
+  YbxLWFixture f;
+  AsyncEventSourceClient c;
+
+  f.configure();
+  AsyncEventSource * es = f.srv.mock_event_source("/yubox-api/lorawan/status");
+  YBX_CHECK(es != NULL);
+  if (es == NULL) return;
+  es->mock_connect(&c);
+  YBX_CHECK_EQ(c.messages.size(), 1);
+  YBX_CHECK_STR(c.messages[0].c_str(), "\"join\"");
+
+  YBX_CHECK(f.join());
+  f.run(1, 1000);
+  YBX_CHECK(c.messages.size() > 1);
+  YBX_CHECK_STR(c.messages.back().c_str(), "\"SET\"");
+}
+
+YBX_TEST(class_queue_drops_unsendable_head)
+{
+  YbxLWFixture f;
+
+  f.configure();
+  YBX_CHECK(f.join());
+
+  // Cabeza que ya no cabe en el datarate actual: se descarta sin bloquear la cola
+  uint8_t big[100];
+  memset(big, 0x55, sizeof(big));
+  uint8_t small[2] = { 1, 2 };
+  YBX_CHECK(f.lw->enqueue(big, sizeof(big)));
+  YBX_CHECK(f.lw->enqueue(small, sizeof(small)));
+  mock_lmh.max_payload[mock_lmh.datarate] = 51;
+  size_t nsent = mock_lmh.sent.size();
+  f.run(3, 1000);
+  YBX_CHECK_EQ(f.lw->getUplinkQueueNumDropped(), 1);
+  YBX_CHECK_EQ(f.lw->getUplinkQueueDepth(), 0);
+  YBX_CHECK_EQ(mock_lmh.sent.size(), nsent + 1);
+  YBX_CHECK(mock_lmh.sent.back().data == std::vector<uint8_t>(small, small + 2));
+}
+
+YBX_TEST(class_queue_retries_do_not_rejoin)
+{
+  YbxLWFixture f;
+
+  f.configure();
+  YBX_CHECK(f.join());
+  uint32_t ninit = mock_lmh.num_init;
+
+  // La MAC rechaza todo envío por más de 90 s: la cola descarta el mensaje
+  // luego de sus intentos, pero no fuerza un nuevo join
+  uint8_t data[2] = { 1, 2 };
+  YBX_CHECK(f.lw->enqueue(data, sizeof(data)));
+  mock_lmh.busy_until = millis() + 400000;
+  f.run(120, 1000);
+  YBX_CHECK_EQ(f.lw->getUplinkQueueNumDropped(), 1);
+  YBX_CHECK_EQ(f.lw->getUplinkQueueDepth(), 0);
+  YBX_CHECK_EQ(mock_lmh.num_init, ninit);
+  YBX_CHECK(f.lw->isJoined());
+
+  // Un envío directo sí cuenta para el reintento de join
+  YBX_CHECK(!f.lw->send(data, sizeof(data)));
+  f.run(95, 1000);
+  YBX_CHECK(!f.lw->send(data, sizeof(data)));
+  f.run();
+  YBX_CHECK_EQ(mock_lmh.num_init, ninit + 1);
+}
+
+YBX_TEST(class_enqueue_large_survives_adr_downgrade)
+{
+  YbxLWFixture f;
+
+  f.configure();
+  YBX_CHECK(f.join());
+  YBX_CHECK(f.lw->getADR());
+  YBX_CHECK_EQ(f.lw->getMaxPayloadSize(), 115);
+
+  // Con ADR los fragmentos se dimensionan para el DR0 de AU915, no para DR3
+  uint8_t msg[300];
+  for (size_t i = 0; i < sizeof(msg); i++) msg[i] = (uint8_t)i;
+  YBX_CHECK(f.lw->enqueueLarge(msg, sizeof(msg), false, YBX_LW_PRIO_NORMAL, 5));
+  YBX_CHECK_EQ(f.lw->getUplinkQueueDepth(), 7);
+
+  // La red baja a DR0 antes del despacho: todos los fragmentos siguen cabiendo
+  mock_lmh.datarate = DR_0;
+  size_t nsent = mock_lmh.sent.size();
+  f.run(20, 1000);
+  YBX_CHECK_EQ(f.lw->getUplinkQueueNumDropped(), 0);
+  YBX_CHECK_EQ(mock_lmh.sent.size(), nsent + 7);
+  for (size_t i = nsent; i < mock_lmh.sent.size(); i++) {
+    YBX_CHECK_EQ(mock_lmh.sent[i].port, YUBOX_LORAWAN_FRAG_PORT);
+    YBX_CHECK(mock_lmh.sent[i].data.size() <= 51);
+  }
+}
+
+YBX_TEST(class_enqueue_large_before_join)
+{
+  YbxLWFixture f;
+
+  f.configure({ { "adr", "0" } });
+  f.run();
+  YBX_CHECK(!f.lw->isJoined());
+  YBX_CHECK_EQ(f.lw->getMaxPayloadSize(), 0);
+
+  // Sin join, un mensaje corto se encola entero y uno largo se fragmenta al mínimo
+  uint8_t msg[120];
+  for (size_t i = 0; i < sizeof(msg); i++) msg[i] = (uint8_t)i;
+  YBX_CHECK(f.lw->enqueueLarge(msg, 20, false, YBX_LW_PRIO_NORMAL, 5));
+  YBX_CHECK_EQ(f.lw->getUplinkQueueDepth(), 1);
+  YBX_CHECK(f.lw->enqueueLarge(msg, sizeof(msg), false, YBX_LW_PRIO_NORMAL, 5));
+  YBX_CHECK_EQ(f.lw->getUplinkQueueDepth(), 4);
+
+  size_t nsent = mock_lmh.sent.size();
+  YBX_CHECK(f.join());
+  f.run(20, 1000);
+  YBX_CHECK_EQ(mock_lmh.sent.size(), nsent + 4);
+  YBX_CHECK_EQ(f.lw->getUplinkQueueNumDropped(), 0);
+}
+
+YBX_TEST(class_replay_oversize_record)
+{
+  mock_partition_create("lorawanlog", 4 * 4096);
+  {
+    YbxLWFixture f;
+
+    f.configure({ { "adr", "0" } });
+    YBX_CHECK(f.join());
+    YBX_CHECK(f.lw->hasPersistentLog());
+
+    // Luego de persistirse los registros, el datarate baja y el primero ya no cabe
+    uint8_t big[100], small[4] = { 1, 2, 3, 4 };
+    memset(big, 0xAB, sizeof(big));
+    YBX_CHECK(f.lw->enqueuePersistent(big, sizeof(big), false, 5));
+    YBX_CHECK(f.lw->enqueuePersistent(small, sizeof(small), false, 6));
+    memset(mock_lmh.max_payload, 0, sizeof(mock_lmh.max_payload));
+    mock_lmh.max_payload[mock_lmh.datarate & 0x0F] = 51;
+
+    // El primero se reenvía fragmentado y no bloquea al segundo
+    size_t nsent = mock_lmh.sent.size();
+    f.run(60, 1000);
+    YBX_CHECK_EQ(f.lw->getPersistentPending(), 0);
+    YBX_CHECK_EQ(f.lw->getPersistentNumLost(), 0);
+    size_t nfrag = 0, nsmall = 0;
+    for (size_t i = nsent; i < mock_lmh.sent.size(); i++) {
+      YBX_CHECK(mock_lmh.sent[i].data.size() > 0);
+      if (mock_lmh.sent[i].port == YUBOX_LORAWAN_FRAG_PORT) nfrag++;
+      if (mock_lmh.sent[i].port == 6) nsmall++;
+    }
+    YBX_CHECK(nfrag >= 2);
+    YBX_CHECK_EQ(nsmall, 1);
+
+    // Si no puede fragmentarse en la cola, se descarta como perdido
+    mock_lmh.max_payload[mock_lmh.datarate & 0x0F] = 12;
+    YBX_CHECK(f.lw->enqueuePersistent(big, sizeof(big), false, 5));
+    YBX_CHECK(f.lw->enqueuePersistent(small, sizeof(small), false, 6));
+    nsent = mock_lmh.sent.size();
+    f.run(60, 1000);
+    YBX_CHECK_EQ(f.lw->getPersistentPending(), 0);
+    YBX_CHECK_EQ(f.lw->getPersistentNumLost(), 1);
+    YBX_CHECK_EQ(mock_lmh.sent.size(), nsent + 1);
+    YBX_CHECK_EQ(mock_lmh.sent.back().port, 6);
+  }
+  mock_partition_create("lorawanlog", 0);
+}
+
+YBX_TEST(class_frag_port_reserved)
+{
+  YbxLWFixture f;
+  std::vector<uint8_t> ports;
+
+  f.configure();
+  YBX_CHECK(f.join());
+
+  uint8_t data[2] = { 1, 2 };
+  size_t nsent = mock_lmh.sent.size();
+  YBX_CHECK(!f.lw->send(data, sizeof(data), false, YUBOX_LORAWAN_FRAG_PORT));
+  YBX_CHECK(!f.lw->enqueue(data, sizeof(data), false, YBX_LW_PRIO_NORMAL, YUBOX_LORAWAN_FRAG_PORT));
+  YBX_CHECK(!f.lw->enqueueLarge(data, sizeof(data), false, YBX_LW_PRIO_NORMAL, YUBOX_LORAWAN_FRAG_PORT));
+  YBX_CHECK(!f.lw->enqueuePersistent(data, sizeof(data), false, YUBOX_LORAWAN_FRAG_PORT));
+  YBX_CHECK_EQ(mock_lmh.sent.size(), nsent);
+  YBX_CHECK_EQ(f.lw->getUplinkQueueDepth(), 0);
+
+  YBX_CHECK_EQ(f.lw->onRX(YUBOX_LORAWAN_FRAG_PORT, [](uint8_t *, uint8_t) {}), 0);
+  YBX_CHECK(f.lw->onRX(1, 223, [&](uint8_t port, uint8_t *, size_t) { ports.push_back(port); }) != 0);
+
+  // Un fragmento único que dice venir del puerto de fragmentos no se entrega
+  uint8_t frag[5] = { 7, 0x00, YUBOX_LORAWAN_FRAG_PORT, 0xAA, 0xBB };
+  mock_lmh_downlink(YUBOX_LORAWAN_FRAG_PORT, frag, sizeof(frag));
+  f.run();
+  YBX_CHECK(ports.empty());
+
+  // El mismo fragmento con un puerto de usuario sí se entrega reensamblado
+  frag[0] = 8;
+  frag[2] = 40;
+  mock_lmh_downlink(YUBOX_LORAWAN_FRAG_PORT, frag, sizeof(frag));
+  f.run();
+  YBX_CHECK_EQ(ports.size(), 1);
+  if (!ports.empty()) YBX_CHECK_EQ(ports[0], 40);
+}
+
+YBX_TEST(class_metrics_json_worst_case)
+{
+  YbxLWFixture f;
+  std::string body;
+
+  f.configure();
+  YBX_CHECK(f.join());
+  YBX_CHECK_EQ(f.get("/yubox-api/lorawan/metrics.json", &body), 200);
+
+  // Cada número en su ancho máximo: 20 dígitos para "sum", 10 para el resto
+  size_t worst = 0;
+  for (size_t i = 0; i < body.size(); ) {
+    if (body[i] < '0' || body[i] > '9') { worst++; i++; continue; }
+    size_t j = i;
+    while (j < body.size() && body[j] >= '0' && body[j] <= '9') j++;
+    worst += (i >= 6 && body.compare(i - 6, 6, "\"sum\":") == 0) ? 20 : 10;
+    i = j;
+  }
+  YBX_CHECK(worst < 3072);
+}
+
+YBX_TEST(class_fcnt_commit_write_failure)
+{
+  {
+    YbxLWFixture f;
+    f.configure();
+    YBX_CHECK(f.join());
+  }
+
+  // Sesión restaurada como ABP, donde cada envío escribe los contadores
+  YbxLWFixture f(false);
+  f.run(2);
+  YBX_CHECK(f.lw->isJoined());
+  uint32_t nwrites = f.lw->getNumFrameCounterWrites();
+
+  uint8_t data[1] = { 1 };
+  mock_nvs.fail_writes = true;
+  YBX_CHECK(f.lw->send(data, 1));
+  YBX_CHECK_EQ(f.lw->getNumFrameCounterWrites(), nwrites);
+  YBX_CHECK_EQ(f.lw->getNumFrameCounterWriteFailures(), 1);
+
+  std::string body;
+  YBX_CHECK_EQ(f.get("/yubox-api/lorawan/metrics.json", &body), 200);
+  YBX_CHECK_STR(body.c_str(), "\"fcnt_write_fail\":1");
+
+  // Los contadores siguen pendientes y se escriben en cuanto la NVS responde
+  mock_nvs.fail_writes = false;
+  YBX_CHECK(f.lw->flushFrameCounters());
+  YBX_CHECK_EQ(f.lw->getNumFrameCounterWrites(), nwrites + 1);
+  YBX_CHECK_EQ(f.lw->getNumFrameCounterWriteFailures(), 1);
+}
+
+YBX_TEST(class_fcnt_separate_key)
+{
+  {
+    YbxLWFixture f;
+    f.configure();
+    YBX_CHECK(f.join());
+  }
+
+  // Con la sesión restaurada, cada envío escribe sólo el registro corto "fcnt"
+  uint32_t upcnt;
+  {
+    YbxLWFixture f(false);
+    f.run(2);
+    YBX_CHECK(f.lw->isJoined());
+    uint32_t nstate = mock_nvs.writes_per_key["state"];
+    uint32_t nfcnt = mock_nvs.writes_per_key["fcnt"];
+    uint32_t nbytes = mock_nvs.bytes_written;
+
+    uint8_t data[1] = { 1 };
+    for (int i = 0; i < 3; i++) YBX_CHECK(f.lw->send(data, 1));
+    YBX_CHECK_EQ(mock_nvs.writes_per_key["state"], nstate);
+    YBX_CHECK_EQ(mock_nvs.writes_per_key["fcnt"], nfcnt + 3);
+    YBX_CHECK_EQ(mock_nvs.bytes_written - nbytes, 3 * sizeof(yuboxlorawan_nvram_fcnt_t));
+    upcnt = mock_lmh.upcnt;
+  }
+
+  // Al reiniciar se toman los contadores de "fcnt", más nuevos que los de "state"
+  {
+    YbxLWFixture f(false);
+    f.run(2);
+    YBX_CHECK(f.lw->isJoined());
+    YBX_CHECK(mock_lmh.upcnt >= upcnt);
+  }
+
+  // Un "fcnt" de otro devaddr se ignora
+  std::vector<uint8_t> & blob = mock_nvs.data["YUBOX/LoRaWAN/fcnt"];
+  YBX_CHECK_EQ(blob.size(), sizeof(yuboxlorawan_nvram_fcnt_t));
+  yuboxlorawan_nvram_fcnt_t fc;
+  memcpy(&fc, blob.data(), sizeof(fc));
+  fc.devaddr ^= 1;
+  fc.uplinkcnt = 1000000;
+  memcpy(blob.data(), &fc, sizeof(fc));
+
+  YbxLWFixture f(false);
+  f.run(2);
+  YBX_CHECK(f.lw->isJoined());
+  YBX_CHECK(mock_lmh.upcnt < 1000000);
+}
+
+YBX_TEST(class_dr_policy_raise_counted_when_applied)
+{
+  YbxLWFixture f;
+  std::string body;
+
+  f.configure();
+  YBX_CHECK(f.lw->setTXParams(true, 0, 0));
+  YBX_CHECK(f.lw->setDatarateFromMargin(true));
+  YBX_CHECK(f.join());
+
+  // Sin downlinks todavía no hay margen medido
+  YBX_CHECK_EQ(f.lw->getStartingDatarate(), 0);
+  YBX_CHECK_EQ(f.get("/yubox-api/lorawan/metrics.json", &body), 200);
+  YBX_CHECK_STR(body.c_str(), "\"dr_policy_raise\":0");
+
+  const uint8_t d[1] = { 1 };
+  for (int i = 0; i < 4; i++) {
+    mock_lmh_downlink(10, d, 1, -60, 10);
+    f.run();
+  }
+
+  // Reaplicar los parámetros de TX sube el datarate una sola vez
+  YBX_CHECK(f.lw->setDatarateFromMargin(false));
+  f.run();
+  YBX_CHECK(f.lw->setDatarateFromMargin(true));
+  f.run(5);
+  YBX_CHECK(f.lw->getStartingDatarate() > 0);
+  YBX_CHECK_EQ(f.get("/yubox-api/lorawan/metrics.json", &body), 200);
+  YBX_CHECK_STR(body.c_str(), "\"dr_policy_raise\":1");
+}
+
+YBX_TEST(class_airtime_saved_excludes_probes)
+{
+  YbxLWFixture f;
+
+  f.configure();
+  YBX_CHECK(f.join());
+
+  uint8_t data[4] = { 1, 2, 3, 4 };
+  YBX_CHECK(f.lw->send(data, sizeof(data)));
+  YBX_CHECK_EQ(f.lw->getAirtimeSaved(), 0);
+
+  // El envío fallido transmite un sondeo de longitud cero, que no es de aplicación
+  size_t nsent = mock_lmh.sent.size();
+  mock_lmh.send_results.push_back(LMH_ERROR);
+  YBX_CHECK(!f.lw->send(data, sizeof(data)));
+  YBX_CHECK_EQ(mock_lmh.sent.size(), nsent + 1);
+  YBX_CHECK_EQ(f.lw->getAirtimeSaved(), 0);
+}
+
+YBX_TEST(class_abp_join_not_posted_to_ring)
+{
+  {
+    YbxLWFixture f;
+    f.configure();
+    YBX_CHECK(f.join());
+  }
+
+  // Con ABP, lmh_join() entrega el join dentro de update(), en la tarea consumidora
+  YbxLWFixture f(false);
+  int joins = 0;
+  f.lw->onJoin([&]() { joins++; });
+  f.run(3);
+  YBX_CHECK(f.lw->isJoined());
+  YBX_CHECK_EQ(joins, 1);
+
+  // Desde otra tarea los eventos sí pasan por el anillo, y se descartan si está lleno
+  std::thread radio([&]() {
+    for (int i = 0; i <= YUBOX_LORAWAN_EVENT_RING_LEN; i++) f.lw->_postRadioEvent(YBX_LW_RADIO_TX_CONFIRM, true);
+  });
+  radio.join();
+  YBX_CHECK_EQ(f.lw->getNumRadioEventsDropped(), 1);
+
+  // Desde la tarea de update() un join no ocupa el anillo lleno
+  YBX_CHECK(f.lw->_postRadioEvent(YBX_LW_RADIO_JOINED));
+  YBX_CHECK_EQ(f.lw->getNumRadioEventsDropped(), 1);
+  f.run();
+  YBX_CHECK_EQ(joins, 2);
+}
+
+YBX_TEST(class_fcnt_window_write_failure_not_counted)
+{
+  {
+    YbxLWFixture f;
+    f.configure();
+    YBX_CHECK(f.join());
+    YBX_CHECK(f.lw->setFrameCounterCommitWindow(10, 0));
+  }
+
+  // Antes de restaurar la sesión, reducir la ventana adelanta el contador guardado
+  YbxLWFixture f(false);
+  uint32_t nwrites = f.lw->getNumFrameCounterWrites();
+  mock_nvs.fail_writes = true;
+  YBX_CHECK(!f.lw->setFrameCounterCommitWindow(1, 0));
+  YBX_CHECK_EQ(f.lw->getNumFrameCounterWrites(), nwrites);
+
+  mock_nvs.fail_writes = false;
+  YBX_CHECK(f.lw->setFrameCounterCommitWindow(1, 0));
+  YBX_CHECK_EQ(f.lw->getNumFrameCounterWrites(), nwrites + 1);
+}
+
+YBX_TEST(class_join_trials_apply_before_join)
+{
+  YbxLWFixture f;
+
+  YBX_CHECK_EQ(f.configure({ { "join_trials", "3" } }), 200);
+  f.run();
+  YBX_CHECK_EQ(mock_lmh.param.nb_trials, 3);
+  uint32_t ninit = mock_lmh.num_init;
+
+  // Sin sesión, cambiar sólo los intentos reinicializa la MAC con el valor nuevo
+  YBX_CHECK_EQ(f.configure({ { "join_trials", "8" } }), 200);
+  f.run();
+  YBX_CHECK_EQ(mock_lmh.num_init, ninit + 1);
+  YBX_CHECK_EQ(mock_lmh.param.nb_trials, 8);
+}
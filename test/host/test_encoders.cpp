@@ -0,0 +1,252 @@
+#include "ybx_test.h"
+#include "ybx_bench.h"
+
+#include "YuboxLoRaWANEncoders.h"
+
+YBX_TEST(lpp_encode_reference)
+{
+  // Ejemplos de la especificación Cayenne LPP
+  uint8_t buf[32];
+  YuboxLoRaWANCayenneLPP lpp(buf, sizeof(buf));
+
+  YBX_CHECK(lpp.addTemperature(3, 27.2f));
+  YBX_CHECK(lpp.addTemperature(5, 25.5f));
+  const uint8_t t2[] = { 0x03, 0x67, 0x01, 0x10, 0x05, 0x67, 0x00, 0xFF };
+  YBX_CHECK_EQ(lpp.length(), sizeof(t2));
+  YBX_CHECK(memcmp(buf, t2, sizeof(t2)) == 0);
+
+  lpp.reset();
+  YBX_CHECK(lpp.addAccelerometer(6, 1.234f, -1.234f, 0.0f));
+  const uint8_t acc[] = { 0x06, 0x71, 0x04, 0xD2, 0xFB, 0x2E, 0x00, 0x00 };
+  YBX_CHECK_EQ(lpp.length(), sizeof(acc));
+  YBX_CHECK(memcmp(buf, acc, sizeof(acc)) == 0);
+
+  lpp.reset();
+  YBX_CHECK(lpp.addGPS(1, 42.3519f, -87.9094f, 10.0f));
+  const uint8_t gps[] = { 0x01, 0x88, 0x06, 0x76, 0x5F, 0xF2, 0x96, 0x0A, 0x00, 0x03, 0xE8 };
+  YBX_CHECK_EQ(lpp.length(), sizeof(gps));
+  YBX_CHECK(memcmp(buf, gps, sizeof(gps)) == 0);
+}
+
+YBX_TEST(lpp_encode_bounds)
+{
+  uint8_t buf[5];
+  YuboxLoRaWANCayenneLPP lpp(buf, sizeof(buf));
+
+  YBX_CHECK(lpp.addTemperature(1, 20.0f));
+  YBX_CHECK_EQ(lpp.available(), 1);
+
+  // Un campo que no cabe completo no modifica el buffer
+  buf[4] = 0xAA;
+  YBX_CHECK(!lpp.addDigitalInput(2, 1));
+  YBX_CHECK_EQ(lpp.length(), 4);
+  YBX_CHECK_EQ(buf[4], 0xAA);
+
+  YBX_CHECK(!lpp.addRaw(1, 200, 0));
+}
+
+YBX_TEST(lpp_decode_roundtrip)
+{
+  uint8_t buf[64];
+  YuboxLoRaWANCayenneLPP lpp(buf, sizeof(buf));
+
+  YBX_CHECK(lpp.addDigitalInput(1, 200));
+  YBX_CHECK(lpp.addTemperature(2, -12.3f));
+  YBX_CHECK(lpp.addRelativeHumidity(3, 64.5f));
+  YBX_CHECK(lpp.addBarometricPressure(4, 1013.2f));
+  YBX_CHECK(lpp.addGyrometer(5, -327.68f, 0.01f, 327.67f));
+  YBX_CHECK(lpp.addGPS(6, -2.1894f, -79.8891f, -12.5f));
+
+  YuboxLoRaWANCayenneLPPReader rd(buf, lpp.length());
+  yuboxlorawan_lpp_field_t f;
+
+  YBX_CHECK(rd.next(f));
+  YBX_CHECK_EQ(f.channel, 1);
+  YBX_CHECK_EQ(f.type, YBX_LPP_DIGITAL_INPUT);
+  YBX_CHECK_EQ(f.raw[0], 200);
+
+  YBX_CHECK(rd.next(f));
+  YBX_CHECK_EQ(f.type, YBX_LPP_TEMPERATURE);
+  YBX_CHECK_EQ(f.raw[0], -123);
+  YBX_CHECK(YuboxLoRaWANCayenneLPPReader::value(f) < -12.29f && YuboxLoRaWANCayenneLPPReader::value(f) > -12.31f);
+
+  YBX_CHECK(rd.next(f));
+  YBX_CHECK_EQ(f.raw[0], 129);
+
+  YBX_CHECK(rd.next(f));
+  YBX_CHECK_EQ(f.raw[0], 10132);
+
+  // Valores extremos de 16 bits con signo
+  YBX_CHECK(rd.next(f));
+  YBX_CHECK_EQ(f.nvals, 3);
+  YBX_CHECK_EQ(f.raw[0], -32768);
+  YBX_CHECK_EQ(f.raw[1], 1);
+  YBX_CHECK_EQ(f.raw[2], 32767);
+
+  // Extensión de signo desde 24 bits
+  YBX_CHECK(rd.next(f));
+  YBX_CHECK_EQ(f.raw[0], -21894);
+  YBX_CHECK_EQ(f.raw[1], -798891);
+  YBX_CHECK_EQ(f.raw[2], -1250);
+
+  YBX_CHECK(!rd.next(f));
+  YBX_CHECK(!rd.error());
+}
+
+YBX_TEST(lpp_decode_malformed)
+{
+  yuboxlorawan_lpp_field_t f;
+
+  // Campo truncado
+  const uint8_t trunc[] = { 0x01, 0x67, 0x01 };
+  YuboxLoRaWANCayenneLPPReader r1(trunc, sizeof(trunc));
+  YBX_CHECK(!r1.next(f));
+  YBX_CHECK(r1.error());
+
+  // Tipo desconocido detiene el recorrido luego del primer campo válido
+  const uint8_t unk[] = { 0x01, 0x00, 0x05, 0x02, 0xC8, 0x00 };
+  YuboxLoRaWANCayenneLPPReader r2(unk, sizeof(unk));
+  YBX_CHECK(r2.next(f));
+  YBX_CHECK_EQ(f.raw[0], 5);
+  YBX_CHECK(!r2.next(f));
+  YBX_CHECK(r2.error());
+  YBX_CHECK(!r2.next(f));
+
+  // Sólo el canal, sin tipo
+  const uint8_t lone[] = { 0x01 };
+  YuboxLoRaWANCayenneLPPReader r3(lone, sizeof(lone));
+  YBX_CHECK(!r3.next(f));
+  YBX_CHECK(r3.error());
+
+  // Payload vacío no es error
+  YuboxLoRaWANCayenneLPPReader r4(lone, 0);
+  YBX_CHECK(!r4.next(f));
+  YBX_CHECK(!r4.error());
+}
+
+YBX_TEST(zigzag_varint)
+{
+  static_assert(yuboxlorawan_zigzag_encode(0) == 0, "zigzag 0");
+  static_assert(yuboxlorawan_zigzag_encode(-1) == 1, "zigzag -1");
+  static_assert(yuboxlorawan_zigzag_encode(1) == 2, "zigzag 1");
+  static_assert(yuboxlorawan_zigzag_encode(INT32_MIN) == UINT32_MAX, "zigzag min");
+  static_assert(yuboxlorawan_varint_len(127) == 1 && yuboxlorawan_varint_len(128) == 2, "varint 7 bits");
+  static_assert(yuboxlorawan_varint_len(UINT32_MAX) == 5, "varint 32 bits");
+
+  const int32_t v[] = { 0, 1, -1, 63, -64, 64, INT32_MAX, INT32_MIN };
+  for (int32_t x : v) YBX_CHECK_EQ(yuboxlorawan_zigzag_decode(yuboxlorawan_zigzag_encode(x)), x);
+}
+
+YBX_TEST(delta_roundtrip)
+{
+  const int32_t series[] = { 2150, 2151, 2149, 2149, 2200, -5, INT32_MAX, INT32_MIN, 0 };
+  const size_t n = sizeof(series) / sizeof(series[0]);
+  uint8_t buf[64];
+  YuboxLoRaWANDeltaPacker pk(buf, sizeof(buf));
+
+  for (size_t i = 0; i < n; i++) YBX_CHECK(pk.add(series[i]));
+  YBX_CHECK_EQ(pk.count(), n);
+
+  // 2150 en 2 bytes, luego +1, -2 y 0 en un byte cada uno
+  YBX_CHECK_EQ(buf[0], 0xCC);
+  YBX_CHECK_EQ(buf[1], 0x21);
+  YBX_CHECK_EQ(buf[2], 0x02);
+  YBX_CHECK_EQ(buf[3], 0x03);
+  YBX_CHECK_EQ(buf[4], 0x00);
+
+  YuboxLoRaWANDeltaUnpacker up(buf, pk.length());
+  int32_t x;
+  for (size_t i = 0; i < n; i++) {
+    YBX_CHECK(up.next(x));
+    YBX_CHECK_EQ(x, series[i]);
+  }
+  YBX_CHECK(!up.next(x));
+  YBX_CHECK(!up.error());
+}
+
+YBX_TEST(delta_bounds_and_malformed)
+{
+  uint8_t buf[3];
+  YuboxLoRaWANDeltaPacker pk(buf, sizeof(buf));
+
+  YBX_CHECK(pk.add(1000));
+  YBX_CHECK_EQ(pk.length(), 2);
+  YBX_CHECK(!pk.add(1000 + 100));
+  YBX_CHECK_EQ(pk.length(), 2);
+  YBX_CHECK_EQ(pk.count(), 1);
+  YBX_CHECK(pk.add(1001));
+  YBX_CHECK_EQ(pk.length(), 3);
+
+  int32_t x;
+
+  // Varint truncado al final
+  const uint8_t trunc[] = { 0x02, 0x80 };
+  YuboxLoRaWANDeltaUnpacker u1(trunc, sizeof(trunc));
+  YBX_CHECK(u1.next(x));
+  YBX_CHECK_EQ(x, 1);
+  YBX_CHECK(!u1.next(x));
+  YBX_CHECK(u1.error());
+
+  // Varint de más de 5 bytes
+  const uint8_t longv[] = { 0x80, 0x80, 0x80, 0x80, 0x80, 0x01 };
+  YuboxLoRaWANDeltaUnpacker u2(longv, sizeof(longv));
+  YBX_CHECK(!u2.next(x));
+  YBX_CHECK(u2.error());
+}
+
+YBX_TEST(encoders_bench)
+{
+  // Serie de temperatura en centésimas de grado, con variaciones pequeñas
+  const uint32_t nsamples = 48;
+  int32_t series[nsamples];
+  uint32_t seed = 12345;
+  int32_t t = 2150;
+  for (uint32_t i = 0; i < nsamples; i++) {
+    seed = seed * 1103515245 + 12345;
+    t += (int32_t)((seed >> 16) % 21) - 10;
+    series[i] = t;
+  }
+
+  uint8_t buf[242];
+  const uint32_t iters = 20000;
+  volatile size_t sink = 0;
+
+  YuboxLoRaWANDeltaPacker pk(buf, sizeof(buf));
+  for (uint32_t i = 0; i < nsamples; i++) YBX_CHECK(pk.add(series[i]));
+  size_t delta_len = pk.length();
+
+  YuboxLoRaWANCayenneLPP lpp(buf, sizeof(buf));
+  uint32_t lpp_samples = 0;
+  while (lpp_samples < nsamples && lpp.addRaw(1, YBX_LPP_ANALOG_INPUT, series[lpp_samples])) lpp_samples++;
+  size_t lpp_len = lpp.length();
+
+  ybx_alloc_scope allocs;
+  double delta_ns = ybx_bench_ns(iters, [&]() {
+    pk.reset();
+    for (uint32_t i = 0; i < nsamples; i++) pk.add(series[i]);
+    sink = sink + pk.length();
+  });
+  double undelta_ns = ybx_bench_ns(iters, [&]() {
+    YuboxLoRaWANDeltaUnpacker up(buf, delta_len);
+    int32_t x;
+    while (up.next(x)) sink = sink + x;
+  });
+  double lpp_ns = ybx_bench_ns(iters, [&]() {
+    lpp.reset();
+    for (uint32_t i = 0; i < lpp_samples; i++) lpp.addRaw(1, YBX_LPP_ANALOG_INPUT, series[i]);
+    sink = sink + lpp.length();
+  });
+  uint64_t nallocs = allocs.count();
+
+  printf("Serie de %u muestras de 32 bits:\n", nsamples);
+  printf("  delta+varint %u bytes (%.2f bytes/muestra), Cayenne LPP %u bytes (%.2f bytes/muestra), crudo %u bytes\n",
+    (unsigned int)delta_len, (double)delta_len / nsamples,
+    (unsigned int)lpp_len, (double)lpp_len / lpp_samples, (unsigned int)(nsamples * 4));
+  ybx_bench_report("codificar serie, delta+varint", delta_ns, 0, 0);
+  ybx_bench_report("decodificar serie, delta+varint", undelta_ns, 0, 0);
+  ybx_bench_report("codificar serie, Cayenne LPP", lpp_ns, 0, 0);
+
+  YBX_CHECK(delta_len <= nsamples + 1);
+  YBX_CHECK_EQ(lpp_len, lpp_samples * 4);
+  YBX_CHECK_EQ(nallocs, 0);
+}
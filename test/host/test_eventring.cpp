@@ -0,0 +1,63 @@
+#include "ybx_test.h"
+
+#include <thread>
+
+#include "YuboxLoRaWANEventRing.h"
+
+YBX_TEST(ring_fifo_and_overflow)
+{
+  YuboxLoRaWANEventRing r;
+
+  YBX_CHECK(r.peek() == NULL);
+  for (uint8_t i = 0; i < YUBOX_LORAWAN_EVENT_RING_LEN; i++) {
+    yuboxlorawan_radio_event_t * ev = r.reserve();
+    YBX_CHECK(ev != NULL);
+    ev->port = i;
+    r.commit();
+  }
+  YBX_CHECK(r.reserve() == NULL);
+  YBX_CHECK_EQ(r.getNumDropped(), 1);
+  YBX_CHECK_EQ(r.pending(), YUBOX_LORAWAN_EVENT_RING_LEN);
+
+  for (uint8_t i = 0; i < YUBOX_LORAWAN_EVENT_RING_LEN; i++) {
+    YBX_CHECK_EQ(r.peek()->port, i);
+    r.release();
+  }
+  YBX_CHECK(r.peek() == NULL);
+}
+
+// Productor y consumidor en hilos distintos, como tarea de IRQ y update()
+YBX_TEST(ring_spsc_threads)
+{
+  static YuboxLoRaWANEventRing r;
+  const uint32_t N = 20000;
+  uint32_t got = 0, expect = 0;
+  bool ordered = true;
+
+  std::thread prod([&]() {
+    for (uint32_t i = 0; i < N; ) {
+      yuboxlorawan_radio_event_t * ev = r.reserve();
+      if (ev == NULL) {
+        std::this_thread::yield();
+        continue;
+      }
+      ev->ts = i++;
+      r.commit();
+    }
+  });
+  while (got < N) {
+    yuboxlorawan_radio_event_t * ev = r.peek();
+    if (ev == NULL) {
+      std::this_thread::yield();
+      continue;
+    }
+    if (ev->ts != expect) ordered = false;
+    expect++;
+    got++;
+    r.release();
+  }
+  prod.join();
+
+  YBX_CHECK(ordered);
+  YBX_CHECK_EQ(got, N);
+}
@@ -0,0 +1,244 @@
+#include "ybx_test.h"
+
+#include "YuboxLoRaWANFlashLog.h"
+
+#define YBX_LOG_LABEL "lorawanlog"
+
+// Registros de 20 bytes: 32 bytes en flash, 8 por página y 128 por sector
+#define YBX_REC_LEN 20
+#define YBX_REC_SIZE 32
+
+static void fill(uint8_t * p, uint32_t i)
+{
+  for (uint32_t j = 0; j < YBX_REC_LEN; j++) p[j] = (uint8_t)(i + j + 1);
+}
+
+static void append_n(YuboxLoRaWANFlashLog & log, uint32_t first, uint32_t n, uint32_t now = 0)
+{
+  uint8_t p[YBX_REC_LEN];
+  for (uint32_t i = first; i < first + n; i++) {
+    fill(p, i);
+    YBX_CHECK(log.append(10, false, p, sizeof(p), now));
+  }
+}
+
+// Leer el registro pendiente más antiguo y verificar su secuencia y contenido
+static void check_peek(YuboxLoRaWANFlashLog & log, uint32_t expseq)
+{
+  yuboxlorawan_uplink_t m;
+  uint32_t seq = 0;
+  uint8_t p[YBX_REC_LEN];
+
+  YBX_CHECK(log.peek(m, seq));
+  YBX_CHECK_EQ(seq, expseq);
+  YBX_CHECK_EQ(m.len, YBX_REC_LEN);
+  fill(p, expseq - 1);
+  YBX_CHECK(memcmp(m.payload, p, sizeof(p)) == 0);
+}
+
+YBX_TEST(flashlog_missing_or_small_partition)
+{
+  YuboxLoRaWANFlashLog log;
+
+  mock_partition_create(YBX_LOG_LABEL, 0);
+  YBX_CHECK(!log.begin());
+  YBX_CHECK(!log.ready());
+  YBX_CHECK(!log.append(10, false, (const uint8_t *)"x", 1, 0));
+
+  mock_partition_create(YBX_LOG_LABEL, YUBOX_LORAWAN_LOG_SECTOR);
+  YBX_CHECK(!log.begin());
+  YBX_CHECK(!log.ready());
+}
+
+YBX_TEST(flashlog_append_flush_batching)
+{
+  YuboxLoRaWANFlashLog log;
+
+  mock_partition_create(YBX_LOG_LABEL, 2 * YUBOX_LORAWAN_LOG_SECTOR);
+  YBX_CHECK(log.begin());
+  YBX_CHECK_EQ(log.getCapacity(), 2 * YUBOX_LORAWAN_LOG_SECTOR);
+
+  // Una página completa queda en RAM, y el siguiente registro la escribe
+  append_n(log, 0, YUBOX_LORAWAN_LOG_PAGE / YBX_REC_SIZE, 1000);
+  YBX_CHECK_EQ(mock_flash.num_writes, 0);
+  append_n(log, YUBOX_LORAWAN_LOG_PAGE / YBX_REC_SIZE, 1, 2000);
+  YBX_CHECK_EQ(mock_flash.num_writes, 1);
+  YBX_CHECK_EQ(log.getNumWritten(), 9);
+  YBX_CHECK_EQ(log.getNumPending(), 9);
+
+  // El registro restante se escribe al vencer el plazo desde que entró al buffer
+  log.update(2000 + YUBOX_LORAWAN_LOG_FLUSH_MS - 1);
+  YBX_CHECK_EQ(mock_flash.num_writes, 1);
+  log.update(2000 + YUBOX_LORAWAN_LOG_FLUSH_MS);
+  YBX_CHECK_EQ(mock_flash.num_writes, 2);
+
+  // Sin registros en RAM no hay escritura
+  YBX_CHECK(log.flush());
+  log.update(100000);
+  YBX_CHECK_EQ(mock_flash.num_writes, 2);
+  YBX_CHECK_EQ(mock_flash.num_erases, 0);
+
+  // Un fallo de escritura pierde los registros del buffer, no los anteriores
+  append_n(log, 9, 2);
+  mock_flash.fail_writes = true;
+  YBX_CHECK(!log.flush());
+  mock_flash.fail_writes = false;
+  YBX_CHECK_EQ(log.getNumLost(), 2);
+  YBX_CHECK_EQ(log.getNumPending(), 9);
+  check_peek(log, 1);
+}
+
+YBX_TEST(flashlog_begin_after_reboot)
+{
+  mock_partition_create(YBX_LOG_LABEL, 4 * YUBOX_LORAWAN_LOG_SECTOR);
+  {
+    YuboxLoRaWANFlashLog log;
+    YBX_CHECK(log.begin());
+    append_n(log, 0, 5);
+    YBX_CHECK(log.flush());
+    check_peek(log, 1);
+    YBX_CHECK(log.markDone(1));
+    check_peek(log, 2);
+    YBX_CHECK(log.markDone(2));
+
+    // Lo que quedó en RAM se pierde al reiniciar
+    append_n(log, 5, 1);
+  }
+
+  YuboxLoRaWANFlashLog log;
+  YBX_CHECK(log.begin());
+  YBX_CHECK_EQ(log.getNumPending(), 3);
+  check_peek(log, 3);
+
+  // La secuencia continúa luego del último registro escrito
+  YBX_CHECK(log.markDone(3));
+  YBX_CHECK(log.markDone(4) == false);
+  check_peek(log, 4);
+  YBX_CHECK(log.markDone(4));
+  check_peek(log, 5);
+  YBX_CHECK(log.markDone(5));
+  uint8_t p[YBX_REC_LEN];
+  fill(p, 5);
+  YBX_CHECK(log.append(10, false, p, sizeof(p), 0));
+  check_peek(log, 6);
+  YBX_CHECK_EQ(log.getNumPending(), 1);
+}
+
+YBX_TEST(flashlog_sector_wraparound)
+{
+  const uint32_t per_sector = YUBOX_LORAWAN_LOG_SECTOR / YBX_REC_SIZE;
+
+  mock_partition_create(YBX_LOG_LABEL, 2 * YUBOX_LORAWAN_LOG_SECTOR);
+  {
+    YuboxLoRaWANFlashLog log;
+    YBX_CHECK(log.begin());
+
+    // Llenar ambos sectores: pasar al segundo no pierde nada
+    append_n(log, 0, 2 * per_sector);
+    YBX_CHECK_EQ(mock_flash.num_erases, 1);
+    YBX_CHECK_EQ(log.getNumLost(), 0);
+    YBX_CHECK_EQ(log.getNumPending(), 2 * per_sector);
+
+    // Despachar algunos del sector más antiguo antes de sobrescribirlo
+    check_peek(log, 1);
+    YBX_CHECK(log.markDone(1));
+    check_peek(log, 2);
+    YBX_CHECK(log.markDone(2));
+
+    // Volver al primer sector lo borra, y se pierden sólo sus pendientes
+    append_n(log, 2 * per_sector, 1);
+    YBX_CHECK_EQ(mock_flash.num_erases, 2);
+    YBX_CHECK_EQ(log.getNumLost(), per_sector - 2);
+    YBX_CHECK_EQ(log.getNumPending(), per_sector + 1);
+    YBX_CHECK(log.markDone(3) == false);
+    check_peek(log, per_sector + 1);
+    YBX_CHECK(log.flush());
+  }
+
+  // Luego de reiniciar, el sector sobrescrito es el más reciente
+  YuboxLoRaWANFlashLog log;
+  YBX_CHECK(log.begin());
+  YBX_CHECK_EQ(log.getNumPending(), per_sector + 1);
+  check_peek(log, per_sector + 1);
+  YBX_CHECK_EQ(log.getNumLost(), 0);
+}
+
+YBX_TEST(flashlog_bad_crc_skipped)
+{
+  mock_partition_create(YBX_LOG_LABEL, 2 * YUBOX_LORAWAN_LOG_SECTOR);
+  {
+    YuboxLoRaWANFlashLog log;
+    YBX_CHECK(log.begin());
+    append_n(log, 0, 4);
+    YBX_CHECK(log.flush());
+
+    // Dañar el payload del segundo registro, como una escritura interrumpida
+    uint8_t * mem = mock_partition_data(YBX_LOG_LABEL);
+    mem[YBX_REC_SIZE + sizeof(yuboxlorawan_log_hdr_t)] = 0x00;
+
+    check_peek(log, 1);
+    YBX_CHECK(log.markDone(1));
+    check_peek(log, 3);
+    YBX_CHECK_EQ(log.getNumCorrupt(), 1);
+    YBX_CHECK_EQ(log.getNumPending(), 2);
+    YBX_CHECK(log.markDone(3));
+  }
+
+  // El registro dañado sigue marcado pendiente en flash, y se salta otra vez
+  YuboxLoRaWANFlashLog log;
+  YBX_CHECK(log.begin());
+  YBX_CHECK_EQ(log.getNumCorrupt(), 1);
+  YBX_CHECK_EQ(log.getNumPending(), 1);
+  check_peek(log, 4);
+  YBX_CHECK(log.markDone(4));
+  YBX_CHECK_EQ(log.getNumPending(), 0);
+
+  yuboxlorawan_uplink_t m;
+  uint32_t seq;
+  YBX_CHECK(!log.peek(m, seq));
+}
+
+YBX_TEST(flashlog_markdone_order)
+{
+  mock_partition_create(YBX_LOG_LABEL, 2 * YUBOX_LORAWAN_LOG_SECTOR);
+  {
+    YuboxLoRaWANFlashLog log;
+    YBX_CHECK(log.begin());
+    append_n(log, 0, 3);
+
+    // Sin peek() previo no hay registro que marcar
+    YBX_CHECK(!log.markDone(1));
+
+    // Los registros en RAM también se leen, en orden de escritura
+    check_peek(log, 1);
+    check_peek(log, 1);
+    YBX_CHECK(!log.markDone(2));
+    YBX_CHECK(log.markDone(1));
+    YBX_CHECK(!log.markDone(1));
+    YBX_CHECK_EQ(log.getNumDone(), 1);
+
+    // Un registro descartado cuenta como perdido y no como despachado
+    check_peek(log, 2);
+    YBX_CHECK(log.markLost(2));
+    YBX_CHECK_EQ(log.getNumLost(), 1);
+    YBX_CHECK_EQ(log.getNumDone(), 1);
+
+    // Si no puede escribirse la marca, el registro avanza igual en RAM
+    check_peek(log, 3);
+    mock_flash.fail_writes = true;
+    YBX_CHECK(!log.markDone(3));
+    mock_flash.fail_writes = false;
+    YBX_CHECK_EQ(log.getNumMarkFailures(), 1);
+    YBX_CHECK_EQ(log.getNumPending(), 0);
+
+    yuboxlorawan_uplink_t m;
+    uint32_t seq;
+    YBX_CHECK(!log.peek(m, seq));
+  }
+
+  // ...y se repite luego de reiniciar
+  YuboxLoRaWANFlashLog log;
+  YBX_CHECK(log.begin());
+  YBX_CHECK_EQ(log.getNumPending(), 1);
+  check_peek(log, 3);
+}
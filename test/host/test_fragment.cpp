@@ -0,0 +1,89 @@
+#include "ybx_test.h"
+
+#include "YuboxLoRaWANFragment.h"
+
+YBX_TEST(frag_count)
+{
+  YBX_CHECK_EQ(yuboxlorawan_frag_count(0, 51), 0);
+  YBX_CHECK_EQ(yuboxlorawan_frag_count(10, YUBOX_LORAWAN_FRAG_HEADER), 0);
+  YBX_CHECK_EQ(yuboxlorawan_frag_count(48, 51), 1);
+  YBX_CHECK_EQ(yuboxlorawan_frag_count(49, 51), 2);
+  YBX_CHECK_EQ(yuboxlorawan_frag_count(YUBOX_LORAWAN_FRAG_MAX_MSG, 51), 0);
+  YBX_CHECK_EQ(yuboxlorawan_frag_count(YUBOX_LORAWAN_FRAG_MAX_MSG, 242), 5);
+}
+
+static void fill(uint8_t * p, size_t n)
+{
+  for (size_t i = 0; i < n; i++) p[i] = (uint8_t)(i * 7 + 3);
+}
+
+YBX_TEST(frag_roundtrip_in_order)
+{
+  uint8_t msg[300], f[51];
+  YuboxLoRaWANReassembler r;
+
+  fill(msg, sizeof(msg));
+  uint8_t cnt = yuboxlorawan_frag_count(sizeof(msg), sizeof(f));
+  YBX_CHECK_EQ(cnt, 7);
+
+  bool done = false;
+  for (uint8_t i = 0; i < cnt; i++) {
+    uint8_t n = yuboxlorawan_frag_build(f, 9, i, cnt, 17, msg, sizeof(msg), sizeof(f));
+    YBX_CHECK(!done);
+    done = r.add(f, n, 0);
+  }
+  YBX_CHECK(done);
+  YBX_CHECK_EQ(r.port(), 17);
+  YBX_CHECK_EQ(r.length(), sizeof(msg));
+  YBX_CHECK(memcmp(r.data(), msg, sizeof(msg)) == 0);
+  YBX_CHECK_EQ(r.getNumComplete(), 1);
+}
+
+YBX_TEST(frag_last_first)
+{
+  uint8_t msg[100], f[3][51];
+  uint8_t n[3];
+  YuboxLoRaWANReassembler r;
+
+  fill(msg, sizeof(msg));
+  for (uint8_t i = 0; i < 3; i++) n[i] = yuboxlorawan_frag_build(f[i], 1, i, 3, 5, msg, sizeof(msg), 51);
+
+  YBX_CHECK(!r.add(f[2], n[2], 0));
+  YBX_CHECK(!r.add(f[0], n[0], 0));
+  // Fragmento repetido no cambia nada
+  YBX_CHECK(!r.add(f[0], n[0], 0));
+  YBX_CHECK(r.add(f[1], n[1], 0));
+  YBX_CHECK_EQ(r.length(), sizeof(msg));
+  YBX_CHECK(memcmp(r.data(), msg, sizeof(msg)) == 0);
+}
+
+YBX_TEST(frag_new_msgid_discards)
+{
+  uint8_t msg[100], f[51];
+  YuboxLoRaWANReassembler r;
+
+  fill(msg, sizeof(msg));
+  uint8_t n = yuboxlorawan_frag_build(f, 1, 0, 3, 5, msg, sizeof(msg), sizeof(f));
+  r.add(f, n, 0);
+  n = yuboxlorawan_frag_build(f, 2, 0, 3, 5, msg, sizeof(msg), sizeof(f));
+  r.add(f, n, 0);
+  YBX_CHECK_EQ(r.getNumDiscarded(), 1);
+  YBX_CHECK(r.pending());
+
+  YBX_CHECK(!r.expire(1000, 5000));
+  YBX_CHECK(r.expire(5000, 5000));
+  YBX_CHECK(!r.pending());
+  YBX_CHECK_EQ(r.getNumDiscarded(), 2);
+}
+
+YBX_TEST(frag_malformed)
+{
+  uint8_t f[4] = { 1, 0x12, 5, 0 };
+  YuboxLoRaWANReassembler r;
+
+  // Índice 1 de 3 es válido, índice fuera de rango y fragmento corto no
+  YBX_CHECK(!r.add(f, 2, 0));
+  f[1] = 0x31;
+  YBX_CHECK(!r.add(f, sizeof(f), 0));
+  YBX_CHECK_EQ(r.getNumDiscarded(), 2);
+}
@@ -0,0 +1,169 @@
+#include "ybx_test.h"
+#include "ybx_bench.h"
+
+#include <string>
+
+#include "YuboxLoRaWANJSONWriter.h"
+
+YBX_TEST(json_object_fields)
+{
+  char buf[128];
+  YuboxLoRaWANJSONWriter json(buf, sizeof(buf));
+  const uint8_t h[2] = { 0xAB, 0x01 };
+
+  json.beginObject();
+  json.fieldUInt("u", 4294967295UL);
+  json.fieldInt("i", -2147483647L - 1);
+  json.fieldStr("s", "a\"b\n");
+  json.fieldHex("h", h, sizeof(h));
+  json.fieldTS("ts", 0);
+  json.key("a");
+  json.beginArray();
+  json.valueBool(true);
+  json.valueNull();
+  json.endArray();
+  json.endObject();
+
+  YBX_CHECK(!json.overflow());
+  YBX_CHECK(strcmp(json.c_str(),
+    "{\"u\":4294967295,\"i\":-2147483648,\"s\":\"a\\\"b\\u000a\",\"h\":\"ab01\",\"ts\":null,\"a\":[true,null]}") == 0);
+}
+
+YBX_TEST(json_uint64)
+{
+  char buf[64];
+  YuboxLoRaWANJSONWriter json(buf, sizeof(buf));
+
+  json.beginArray();
+  json.valueUInt64(0);
+  json.valueUInt64(4294967296ULL);
+  json.valueUInt64(UINT64_MAX);
+  json.endArray();
+
+  YBX_CHECK(!json.overflow());
+  YBX_CHECK(strcmp(json.c_str(), "[0,4294967296,18446744073709551615]") == 0);
+}
+
+YBX_TEST(json_overflow_truncates)
+{
+  char buf[8];
+  YuboxLoRaWANJSONWriter json(buf, sizeof(buf));
+
+  json.beginObject();
+  json.fieldUInt64("sum", 123456789012ULL);
+  json.endObject();
+
+  YBX_CHECK(json.overflow());
+  YBX_CHECK_EQ(json.length(), sizeof(buf) - 1);
+  YBX_CHECK_EQ(strlen(json.c_str()), sizeof(buf) - 1);
+}
+
+YBX_TEST(json_hex_roundtrip)
+{
+  const uint8_t key[16] = {
+    0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C
+  };
+  char s[33];
+  uint8_t back[16];
+
+  yuboxlorawan_bin2hex(key, sizeof(key), s);
+  YBX_CHECK(strcmp(s, "2b7e151628aed2a6abf7158809cf4f3c") == 0);
+  YBX_CHECK(yuboxlorawan_hex2bin("2B7E151628AED2A6ABF7158809CF4F3C", back, sizeof(back)));
+  YBX_CHECK(memcmp(back, key, sizeof(key)) == 0);
+
+  YBX_CHECK(!yuboxlorawan_hex2bin("2b7e", back, 3));
+  YBX_CHECK(!yuboxlorawan_hex2bin("2b7g", back, 2));
+}
+
+// Camino anterior: un sprintf y un String += por byte, y el JSON armado como
+// cadena dinámica. ArduinoJson no se compila en el host, así que su
+// DynamicJsonDocument no entra en la cuenta y el camino anterior real asignaba
+// todavía más.
+static std::string bench_bin2str(const uint8_t * p, size_t n)
+{
+  std::string s = "";
+  while (n > 0) {
+    char buf[4];
+    sprintf(buf, "%02x", *p);
+    s += buf;
+    n--; p++;
+  }
+  return s;
+}
+
+static bool bench_str2bin(const char * s, uint8_t * p, size_t n)
+{
+  while (n > 0) {
+    char buf[4];
+    unsigned int x;
+
+    if (s[0] == '\0' || s[1] == '\0') return false;
+    buf[0] = s[0];
+    buf[1] = s[1];
+    buf[2] = '\0';
+    if (sscanf(buf, "%x", &x) < 1) return false;
+    *p = (uint8_t)x;
+    n--; p++; s += 2;
+  }
+  return true;
+}
+
+YBX_TEST(json_bench_config_and_hex)
+{
+  uint8_t deveui[8] = { 0x00, 0x4A, 0x77, 0x00, 0x66, 0x00, 0x11, 0x22 };
+  uint8_t appeui[8] = { 0x70, 0xB3, 0xD5, 0x7E, 0xD0, 0x00, 0x00, 0x01 };
+  uint8_t appkey[16] = { 0 };
+  uint8_t nwkskey[16] = { 0 };
+  for (uint8_t i = 0; i < 16; i++) { appkey[i] = i * 17; nwkskey[i] = 255 - i; }
+  const uint32_t iters = 20000;
+  volatile size_t sink = 0;
+
+  ybx_alloc_scope old_allocs;
+  double old_ns = ybx_bench_ns(iters, [&]() {
+    std::string json = "{\"deviceEUI\":\"";
+    json += bench_bin2str(deveui, sizeof(deveui));
+    json += "\",\"appEUI\":\"";
+    json += bench_bin2str(appeui, sizeof(appeui));
+    json += "\",\"appKey\":\"";
+    json += bench_bin2str(appkey, sizeof(appkey));
+    json += "\",\"nwkSKey\":\"";
+    json += bench_bin2str(nwkskey, sizeof(nwkskey));
+    json += "\",\"region\":";
+    json += std::to_string(5);
+    json += ",\"txduty\":";
+    json += std::to_string(60);
+    json += "}";
+    sink = sink + json.size();
+  });
+  uint64_t old_count = old_allocs.count(), old_bytes = old_allocs.bytes();
+
+  ybx_alloc_scope new_allocs;
+  double new_ns = ybx_bench_ns(iters, [&]() {
+    char buf[192];
+    YuboxLoRaWANJSONWriter json(buf, sizeof(buf));
+    json.beginObject();
+    json.fieldHex("deviceEUI", deveui, sizeof(deveui));
+    json.fieldHex("appEUI", appeui, sizeof(appeui));
+    json.fieldHex("appKey", appkey, sizeof(appkey));
+    json.fieldHex("nwkSKey", nwkskey, sizeof(nwkskey));
+    json.fieldUInt("region", 5);
+    json.fieldUInt("txduty", 60);
+    json.endObject();
+    sink = sink + json.length();
+  });
+  uint64_t new_count = new_allocs.count(), new_bytes = new_allocs.bytes();
+
+  const char * hex = "2b7e151628aed2a6abf7158809cf4f3c";
+  uint8_t key[16];
+  double old_dec_ns = ybx_bench_ns(iters, [&]() { sink = sink + bench_str2bin(hex, key, sizeof(key)); });
+  double new_dec_ns = ybx_bench_ns(iters, [&]() { sink = sink + yuboxlorawan_hex2bin(hex, key, sizeof(key)); });
+
+  printf("JSON de configuración y claves hexadecimales:\n");
+  ybx_bench_report("config.json, String + sprintf por byte", old_ns, (double)old_count / iters, (double)old_bytes / iters);
+  ybx_bench_report("config.json, YuboxLoRaWANJSONWriter", new_ns, (double)new_count / iters, (double)new_bytes / iters);
+  ybx_bench_report("clave de 16 bytes, sscanf por byte", old_dec_ns, 0, 0);
+  ybx_bench_report("clave de 16 bytes, tabla hexadecimal", new_dec_ns, 0, 0);
+
+  YBX_CHECK(old_count > 0);
+  YBX_CHECK_EQ(new_count, 0);
+}
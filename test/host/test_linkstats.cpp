@@ -0,0 +1,52 @@
+#include "ybx_test.h"
+
+#include "YuboxLoRaWANLinkStats.h"
+
+YBX_TEST(linkstats_empty)
+{
+  YuboxLoRaWANLinkStats s;
+  yuboxlorawan_link_stats_t st;
+  int16_t r, n;
+
+  YBX_CHECK(s.empty());
+  YBX_CHECK(s.last() == NULL);
+  YBX_CHECK(!s.compute(st));
+  YBX_CHECK(!s.mean(r, n));
+}
+
+YBX_TEST(linkstats_compute)
+{
+  YuboxLoRaWANLinkStats s;
+  yuboxlorawan_link_stats_t st;
+
+  // RSSI -110..-101, SNR -5..4
+  for (int i = 0; i < 10; i++) s.add(-110 + i, (int8_t)(-5 + i), 1000 + i);
+  YBX_CHECK(s.compute(st));
+  YBX_CHECK_EQ(st.count, 10);
+  YBX_CHECK_EQ(st.total, 10);
+  YBX_CHECK_EQ(st.ts_last, 1009);
+  YBX_CHECK_EQ(st.rssi.last, -101);
+  YBX_CHECK_EQ(st.rssi.min, -110);
+  YBX_CHECK_EQ(st.rssi.max, -101);
+  YBX_CHECK_EQ(st.rssi.p10, -110);
+  YBX_CHECK_EQ(st.rssi.p50, -106);
+  YBX_CHECK_EQ(st.rssi.p90, -102);
+  // -105.5 redondea alejándose de cero
+  YBX_CHECK_EQ(st.rssi.mean, -106);
+  YBX_CHECK_EQ(st.snr.min, -5);
+  YBX_CHECK_EQ(st.snr.max, 4);
+}
+
+YBX_TEST(linkstats_ring_wraps)
+{
+  YuboxLoRaWANLinkStats s;
+  int16_t r, n;
+
+  for (int i = 0; i < YUBOX_LORAWAN_LINK_STATS_LEN; i++) s.add(-120, -10, i);
+  for (int i = 0; i < YUBOX_LORAWAN_LINK_STATS_LEN; i++) s.add(-60, 10, 100 + i);
+  YBX_CHECK_EQ(s.count(), YUBOX_LORAWAN_LINK_STATS_LEN);
+  YBX_CHECK_EQ(s.total(), 2 * YUBOX_LORAWAN_LINK_STATS_LEN);
+  YBX_CHECK(s.mean(r, n));
+  YBX_CHECK_EQ(r, -60);
+  YBX_CHECK_EQ(n, 10);
+}
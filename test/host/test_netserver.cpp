@@ -0,0 +1,162 @@
+#include "ybx_test.h"
+
+#include "sim/ybx_sim.h"
+
+YBX_TEST(netserver_single_device_end_to_end)
+{
+  ybx_sim_config_t cfg;
+  ybx_sim_default_config(cfg);
+  cfg.confirmed_every = 2;
+  YbxSimNetwork net(cfg);
+
+  // Join OTAA con claves derivadas por separado en dispositivo y servidor
+  net.run(10000);
+  YbxSimNetwork::sim_device_t & d = net.device(0);
+  YBX_CHECK(d.lw->isJoined());
+  YBX_CHECK_EQ(net.report.devices_joined, 1);
+  YBX_CHECK_EQ(net.report.key_mismatch, 0);
+  YBX_CHECK_EQ(memcmp(d.mac.nwkSKey, d.ns.nwkSKey, 16), 0);
+  YBX_CHECK_EQ(memcmp(d.mac.appSKey, d.ns.appSKey, 16), 0);
+  YBX_CHECK_EQ(d.mac.devAddr, d.ns.devAddr);
+
+  // Downlink inyectado en un puerto elegido, entregado tras el siguiente uplink
+  const uint8_t cmd[3] = { 0xAB, 0xCD, 0xEF };
+  net.queueDownlink(0, 10, cmd, sizeof(cmd));
+
+  net.run(60000);
+  YBX_CHECK(net.report.delivered >= 5);
+  YBX_CHECK_EQ(net.report.delivered, net.report.app_enqueued - d.lw->getUplinkQueueDepth());
+  YBX_CHECK_EQ(net.report.mic_fail, 0);
+  YBX_CHECK_EQ(net.report.duplicates, 0);
+  YBX_CHECK(net.report.confirm_ok >= 2);
+  YBX_CHECK_EQ(net.report.confirm_fail, 0);
+  YBX_CHECK_EQ(net.report.acks_sent, net.report.confirm_ok);
+
+  YBX_CHECK_EQ(net.report.downlinks_sent, 1);
+  YBX_CHECK_EQ(net.report.downlinks_received, 1);
+  YBX_CHECK_EQ(d.rx.size(), 1);
+  if (d.rx.size() == 1) {
+    YBX_CHECK_EQ(d.rx[0].first, 10);
+    YBX_CHECK(d.rx[0].second == std::vector<uint8_t>(cmd, cmd + sizeof(cmd)));
+  }
+  YBX_CHECK_EQ(d.mac.downcnt, d.ns.fcnt_down);
+
+  // Latencia: espera en la cola de la clase más tiempo en aire y backhaul
+  YBX_CHECK(ybx_sim_percentile(net.report.latency_ms, 100) < 2000);
+  YBX_CHECK(ybx_sim_percentile(net.report.latency_ms, 50) >= cfg.backhaul_ms);
+}
+
+YBX_TEST(netserver_confirmed_without_downlink_fails)
+{
+  ybx_sim_config_t cfg;
+  ybx_sim_default_config(cfg);
+  cfg.confirmed_every = 1;
+  YbxSimNetwork net(cfg);
+
+  net.run(10000);
+  YBX_CHECK(net.device(0).lw->isJoined());
+
+  // Sin bajada ningún ACK llega, y cada confirmado agota sus reintentos
+  net.config().loss_down_permille = 1000;
+  net.run(120000);
+
+  YBX_CHECK(net.report.acks_lost > 0);
+  YBX_CHECK(net.report.confirm_fail > 0);
+  YBX_CHECK_EQ(net.report.confirm_ok, 0);
+  YBX_CHECK(net.report.frames_tx > net.report.confirm_fail);
+
+  // El servidor sí recibe los reintentos, y los cuenta como duplicados
+  YBX_CHECK(net.report.duplicates > 0);
+}
+
+YBX_TEST(netserver_wrong_appkey_never_joins)
+{
+  ybx_sim_config_t cfg;
+  ybx_sim_default_config(cfg);
+  YbxSimNetwork net(cfg);
+
+  // El servidor tiene otra AppKey: el MIC del JoinRequest no valida
+  net.device(0).ns.appKey[0] ^= 0x01;
+  net.run(60000);
+
+  YBX_CHECK(!net.device(0).lw->isJoined());
+  YBX_CHECK(net.report.join_requests >= 2);
+  YBX_CHECK_EQ(net.report.join_mic_fail, net.report.join_requests);
+  YBX_CHECK_EQ(net.report.join_accepts, 0);
+}
+
+YBX_TEST(netserver_uplink_loss_retransmits_confirmed)
+{
+  ybx_sim_config_t cfg;
+  ybx_sim_default_config(cfg);
+  cfg.num_devices = 20;
+  cfg.confirmed_every = 1;
+  cfg.loss_up_permille = 300;
+  cfg.join_spread_ms = 5000;
+  YbxSimNetwork net(cfg);
+
+  net.run(300000);
+  YBX_CHECK_EQ(net.report.devices_joined, 20);
+  YBX_CHECK(net.report.frames_lost > 0);
+
+  // Las retransmisiones de confirmados recuperan casi toda la pérdida
+  YBX_CHECK(net.report.frames_tx > net.report.app_enqueued);
+  YBX_CHECK(net.report.delivered * 100 >= net.report.app_enqueued * 90);
+  YBX_CHECK(net.report.confirm_ok > net.report.confirm_fail);
+  YBX_CHECK_EQ(net.report.mic_fail, 0);
+  YBX_CHECK_EQ(net.report.key_mismatch, 0);
+}
+
+// Escenario de referencia: 500 nodos, un uplink cada 10 s, 5% de pérdida
+YBX_TEST(netserver_scenario_500_nodes_10s_5pct_loss)
+{
+  ybx_sim_config_t cfg;
+  ybx_sim_default_config(cfg);
+  cfg.num_devices = 500;
+  cfg.tx_interval_ms = 10000;
+  cfg.loss_up_permille = 50;
+  cfg.loss_down_permille = 50;
+  cfg.join_spread_ms = 30000;
+  cfg.confirmed_every = 10;
+  YbxSimNetwork net(cfg);
+
+  uint8_t cmd = 0x01;
+  for (uint32_t i = 0; i < 500; i += 5) net.queueDownlink(i, 20, &cmd, 1);
+
+  net.run(300000);
+  net.printReport(stdout, "500 nodos, 10 s, 5% pérdida");
+
+  YBX_CHECK_EQ(net.report.devices_joined, 500);
+  YBX_CHECK_EQ(net.report.key_mismatch, 0);
+  YBX_CHECK_EQ(net.report.mic_fail, 0);
+  YBX_CHECK_EQ(net.report.downlink_mic_fail, 0);
+  YBX_CHECK(net.report.app_enqueued > 500 * 20);
+
+  // Sin colisiones la entrega sólo pierde el 5% de los no confirmados
+  YBX_CHECK(net.report.delivered * 100 >= net.report.app_enqueued * 92);
+  YBX_CHECK(net.report.delivered * 100 <= net.report.app_enqueued * 99);
+  YBX_CHECK(net.report.downlinks_received > 80);
+}
+
+// Colisiones ALOHA por canal y datarate, con ciclo de trabajo en el gateway
+YBX_TEST(netserver_scenario_collisions)
+{
+  ybx_sim_config_t cfg;
+  ybx_sim_default_config(cfg);
+  cfg.num_devices = 200;
+  cfg.tx_interval_ms = 10000;
+  cfg.loss_up_permille = 50;
+  cfg.loss_down_permille = 50;
+  cfg.join_spread_ms = 30000;
+  cfg.collisions = true;
+  cfg.channels = 8;
+  cfg.gw_duty_permille = 100;
+  YbxSimNetwork net(cfg);
+
+  net.run(180000);
+  net.printReport(stdout, "200 nodos, 10 s, 5% pérdida, colisiones en 8 canales");
+
+  YBX_CHECK(net.report.frames_collided > 0);
+  YBX_CHECK(net.report.delivered < net.report.app_enqueued);
+  YBX_CHECK_EQ(net.report.mic_fail, 0);
+}
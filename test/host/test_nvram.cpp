@@ -0,0 +1,69 @@
+#include "ybx_test.h"
+
+#include "YuboxLoRaWANNVRAMState.h"
+
+YBX_TEST(crc32_check_value)
+{
+  YBX_CHECK_EQ(yuboxlorawan_crc32((const uint8_t *)"123456789", 9), 0xCBF43926UL);
+}
+
+YBX_TEST(nvram_state_roundtrip)
+{
+  yuboxlorawan_nvram_state_t s, d;
+
+  memset(&s, 0, sizeof(s));
+  s.flags = YBX_NVRAM_F_CONF | YBX_NVRAM_F_SESSION;
+  s.region = 5;
+  s.devaddr = 0x26011234;
+  s.uplinkcnt = 77;
+  s.datarate = 3;
+  yuboxlorawan_nvram_state_seal(s);
+
+  memset(&d, 0, sizeof(d));
+  YBX_CHECK(yuboxlorawan_nvram_state_decode((const uint8_t *)&s, sizeof(s), d));
+  YBX_CHECK(memcmp(&s, &d, sizeof(s)) == 0);
+
+  // Un bit cambiado invalida el registro
+  uint8_t buf[sizeof(s)];
+  memcpy(buf, &s, sizeof(s));
+  buf[sizeof(s) - 1] ^= 0x01;
+  YBX_CHECK(!yuboxlorawan_nvram_state_decode(buf, sizeof(buf), d));
+  YBX_CHECK(!yuboxlorawan_nvram_state_decode(buf, YUBOX_LORAWAN_NVRAM_HEADER - 1, d));
+}
+
+YBX_TEST(nvram_state_older_version)
+{
+  yuboxlorawan_nvram_state_t s, d;
+  const size_t oldsize = offsetof(yuboxlorawan_nvram_state_t, devclass);
+
+  // Registro de una versión anterior sin los campos finales
+  memset(&s, 0, sizeof(s));
+  s.region = 8;
+  s.magic = YUBOX_LORAWAN_NVRAM_MAGIC;
+  s.version = YUBOX_LORAWAN_NVRAM_VERSION;
+  s.size = oldsize;
+  s.crc = yuboxlorawan_crc32((const uint8_t *)&s + YUBOX_LORAWAN_NVRAM_HEADER, oldsize - YUBOX_LORAWAN_NVRAM_HEADER);
+
+  memset(&d, 0, sizeof(d));
+  d.jointrials = 3;
+  d.datarate = -1;
+  YBX_CHECK(yuboxlorawan_nvram_state_decode((const uint8_t *)&s, oldsize, d));
+  YBX_CHECK_EQ(d.region, 8);
+  YBX_CHECK_EQ(d.jointrials, 3);
+  YBX_CHECK_EQ(d.datarate, -1);
+}
+
+YBX_TEST(rtc_session_seal)
+{
+  yuboxlorawan_rtc_session_t s;
+
+  memset(&s, 0, sizeof(s));
+  YBX_CHECK(!yuboxlorawan_rtc_session_valid(s));
+  s.UpLinkCounter = 1234;
+  yuboxlorawan_rtc_session_seal(s);
+  YBX_CHECK(yuboxlorawan_rtc_session_valid(s));
+  s.UpLinkCounter++;
+  YBX_CHECK(!yuboxlorawan_rtc_session_valid(s));
+  yuboxlorawan_rtc_session_clear(s);
+  YBX_CHECK(!yuboxlorawan_rtc_session_valid(s));
+}
@@ -0,0 +1,86 @@
+#include "ybx_test.h"
+
+#include "YuboxLoRaWANUplinkQueue.h"
+
+YBX_TEST(queue_priority_order)
+{
+  YuboxLoRaWANUplinkQueue q;
+  uint8_t a = 1, b = 2, c = 3;
+
+  YBX_CHECK(q.push(YBX_LW_PRIO_NORMAL, 10, false, &a, 1));
+  YBX_CHECK(q.push(YBX_LW_PRIO_HIGH, 11, true, &b, 1));
+  YBX_CHECK(q.push(YBX_LW_PRIO_NORMAL, 12, false, &c, 1));
+  YBX_CHECK_EQ(q.depth(), 3);
+
+  YBX_CHECK_EQ(q.front()->port, 11);
+  YBX_CHECK(q.front()->confirmed);
+  q.pop();
+  YBX_CHECK_EQ(q.front()->payload[0], 1);
+  q.pop();
+  YBX_CHECK_EQ(q.front()->payload[0], 3);
+  q.pop();
+  YBX_CHECK(q.front() == NULL);
+  YBX_CHECK_EQ(q.getNumSent(), 3);
+  YBX_CHECK_EQ(q.getMaxDepth(), 3);
+}
+
+YBX_TEST(queue_drop_new)
+{
+  YuboxLoRaWANUplinkQueue q;
+
+  for (uint8_t i = 0; i < YUBOX_LORAWAN_UPLINK_QUEUE_LEN; i++) YBX_CHECK(q.push(YBX_LW_PRIO_NORMAL, 1, false, &i, 1));
+  uint8_t x = 99;
+  YBX_CHECK(!q.push(YBX_LW_PRIO_NORMAL, 1, false, &x, 1));
+  YBX_CHECK_EQ(q.getNumDropped(), 1);
+  YBX_CHECK_EQ(q.front()->payload[0], 0);
+  YBX_CHECK_EQ(q.available(YBX_LW_PRIO_NORMAL), 0);
+  YBX_CHECK_EQ(q.available(YBX_LW_PRIO_HIGH), YUBOX_LORAWAN_UPLINK_QUEUE_LEN);
+}
+
+YBX_TEST(queue_drop_oldest)
+{
+  YuboxLoRaWANUplinkQueue q;
+
+  q.setPolicy(YBX_LW_QUEUE_DROP_OLDEST);
+  for (uint8_t i = 0; i <= YUBOX_LORAWAN_UPLINK_QUEUE_LEN; i++) YBX_CHECK(q.push(YBX_LW_PRIO_NORMAL, 1, false, &i, 1));
+  YBX_CHECK_EQ(q.getNumDropped(), 1);
+  YBX_CHECK_EQ(q.depth(), YUBOX_LORAWAN_UPLINK_QUEUE_LEN);
+  YBX_CHECK_EQ(q.front()->payload[0], 1);
+}
+
+YBX_TEST(queue_segments)
+{
+  YuboxLoRaWANUplinkQueue q;
+  const uint8_t h[2] = { 0xAA, 0xBB };
+  const uint8_t d[3] = { 1, 2, 3 };
+  yuboxlorawan_segment_t segs[3] = { { h, 2 }, { NULL, 5 }, { d, 3 } };
+
+  YBX_CHECK_EQ(yuboxlorawan_segments_len(segs, 3), 5);
+  YBX_CHECK(q.push(YBX_LW_PRIO_NORMAL, 1, false, segs, 3));
+  YBX_CHECK_EQ(q.front()->len, 5);
+  YBX_CHECK_EQ(q.front()->payload[1], 0xBB);
+  YBX_CHECK_EQ(q.front()->payload[4], 3);
+}
+
+YBX_TEST(queue_drop_head)
+{
+  YuboxLoRaWANUplinkQueue q;
+  const uint8_t a = 1, b = 2;
+
+  YBX_CHECK(q.push(YBX_LW_PRIO_NORMAL, 1, false, &a, 1));
+  YBX_CHECK(q.push(YBX_LW_PRIO_NORMAL, 1, false, &b, 1));
+  YBX_CHECK_EQ(q.front()->attempts, 0);
+  q.front()->attempts = 3;
+
+  q.drop();
+  YBX_CHECK_EQ(q.getNumDropped(), 1);
+  YBX_CHECK_EQ(q.getNumSent(), 0);
+  YBX_CHECK_EQ(q.depth(), 1);
+  YBX_CHECK_EQ(q.front()->payload[0], 2);
+  YBX_CHECK_EQ(q.front()->attempts, 0);
+
+  q.pop();
+  q.drop();
+  YBX_CHECK_EQ(q.getNumDropped(), 1);
+  YBX_CHECK_EQ(q.getNumSent(), 1);
+}
@@ -0,0 +1,27 @@
+#include <stdlib.h>
+
+#include <atomic>
+#include <new>
+
+#include "ybx_bench.h"
+
+static std::atomic<uint64_t> ybx_allocs(0);
+static std::atomic<uint64_t> ybx_alloc_total(0);
+
+uint64_t ybx_alloc_count(void) { return ybx_allocs.load(); }
+uint64_t ybx_alloc_bytes(void) { return ybx_alloc_total.load(); }
+
+void * operator new(size_t n)
+{
+    ybx_allocs++;
+    ybx_alloc_total += n;
+    void * p = malloc(n ? n : 1);
+    if (p == NULL) throw std::bad_alloc();
+    return p;
+}
+
+void * operator new[](size_t n) { return operator new(n); }
+void operator delete(void * p) noexcept { free(p); }
+void operator delete[](void * p) noexcept { free(p); }
+void operator delete(void * p, size_t) noexcept { free(p); }
+void operator delete[](void * p, size_t) noexcept { free(p); }
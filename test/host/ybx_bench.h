@@ -0,0 +1,49 @@
+#ifndef _YUBOX_HOST_BENCH_H_
+#define _YUBOX_HOST_BENCH_H_
+
+/*
+ * Apoyo para mediciones en el host. ybx_alloc.cpp reemplaza el operator new
+ * global de cada ejecutable de pruebas y cuenta las asignaciones, sin cambiar
+ * su comportamiento. Los tiempos se miden con el reloj monotónico del host en
+ * nanosegundos por operación: sirven para comparar dos caminos en la misma
+ * máquina, no como ciclos de ESP32. Las pruebas verifican las cuentas de
+ * asignaciones y sólo imprimen los tiempos.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <chrono>
+
+// Asignaciones y bytes pedidos a operator new desde el inicio del proceso
+uint64_t ybx_alloc_count(void);
+uint64_t ybx_alloc_bytes(void);
+
+// Asignaciones ocurridas desde la construcción
+struct ybx_alloc_scope
+{
+  uint64_t c0;
+  uint64_t b0;
+
+  ybx_alloc_scope(void) : c0(ybx_alloc_count()), b0(ybx_alloc_bytes()) {}
+  uint64_t count(void) { return ybx_alloc_count() - c0; }
+  uint64_t bytes(void) { return ybx_alloc_bytes() - b0; }
+};
+
+// Tiempo promedio de fn() en nanosegundos
+template <typename F>
+double ybx_bench_ns(uint32_t iters, F fn)
+{
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < iters; i++) fn();
+  auto t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / iters;
+}
+
+// Línea de resultados con formato común a todas las mediciones
+inline void ybx_bench_report(const char * name, double ns, double allocs, double bytes)
+{
+  printf("  %-44s %10.1f ns/op %8.2f asign/op %10.1f bytes/op\n", name, ns, allocs, bytes);
+}
+
+#endif
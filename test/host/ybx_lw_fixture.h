@@ -0,0 +1,98 @@
+#ifndef _YUBOX_HOST_LW_FIXTURE_H_
+#define _YUBOX_HOST_LW_FIXTURE_H_
+
+/*
+ * Instancia de YuboxLoRaWANConfigClass sobre los sustitutos de mocks/, lista
+ * para configurarse por HTTP y unirse a la red con la MAC falsa. Por omisión
+ * borra la NVS simulada; con fresh=false conserva lo guardado por una
+ * instancia anterior, como un reinicio del dispositivo.
+ */
+
+#include <initializer_list>
+#include <utility>
+
+#include <esp_sleep.h>
+
+#include "YuboxLoRaWANConfigClass.h"
+
+static const uint8_t ybx_test_nwkskey[16] = {
+  0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C
+};
+static const uint8_t ybx_test_appskey[16] = {
+  0x3C, 0x4F, 0xCF, 0x09, 0x88, 0x15, 0xF7, 0xAB, 0xA6, 0xD2, 0xAE, 0x28, 0x16, 0x15, 0x7E, 0x2B
+};
+
+#define YBX_TEST_DEVADDR 0x26011BDAUL
+
+typedef std::initializer_list<std::pair<const char *, const char *> > ybx_params_t;
+
+struct YbxLWFixture
+{
+  AsyncWebServer srv;
+  YuboxLoRaWANConfigClass * lw;
+  bool begun;
+
+  YbxLWFixture(bool fresh = true)
+  {
+    if (fresh) {
+      mock_nvs_reset();
+      mock_set_us(1000000ULL);
+    }
+    mock_lmh_reset();
+    mock_wakeup_cause = ESP_SLEEP_WAKEUP_UNDEFINED;
+    lw = new YuboxLoRaWANConfigClass();
+    begun = lw->begin(srv);
+  }
+
+  ~YbxLWFixture() { delete lw; }
+
+  // Invocar una ruta HTTP, devuelve el código de respuesta
+  int request(const char * uri, WebRequestMethodComposite m, ybx_params_t params, std::string * body = NULL)
+  {
+    AsyncWebServerRequest req(m);
+    for (auto & p : params) req.addParam(p.first, p.second, true);
+    if (!srv.mock_request(uri, req)) return 404;
+    if (body != NULL) *body = req.body;
+    return req.code;
+  }
+
+  int get(const char * uri, std::string * body) { return request(uri, HTTP_GET, {}, body); }
+
+  // Configuración mínima por POST, más los parámetros adicionales indicados
+  int configure(ybx_params_t extra = {})
+  {
+    static const char * const defaults[][2] = {
+      { "region", "1" },
+      { "subband", "2" },
+      { "deviceEUI", "0011223344556677" },
+      { "appEUI", "" },
+      { "appKey", "000102030405060708090A0B0C0D0E0F" },
+    };
+    AsyncWebServerRequest req(HTTP_POST);
+    for (auto & p : extra) req.addParam(p.first, p.second, true);
+    for (auto & d : defaults) if (!req.hasParam(d[0], true)) req.addParam(d[0], d[1], true);
+    srv.mock_request("/yubox-api/lorawan/config.json", req);
+    return req.code;
+  }
+
+  // Correr update() n veces, avanzando ms milisegundos antes de cada una
+  void run(uint32_t n = 1, uint32_t ms = 10)
+  {
+    for (uint32_t i = 0; i < n; i++) {
+      mock_advance_ms(ms);
+      lw->update();
+    }
+  }
+
+  // Iniciar la sesión y aceptar el join OTAA
+  bool join(void)
+  {
+    run();
+    if (mock_lmh.join_status != LMH_ONGOING) return false;
+    mock_lmh_join_accept(YBX_TEST_DEVADDR, ybx_test_nwkskey, ybx_test_appskey);
+    run();
+    return lw->isJoined();
+  }
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef _YUBOX_HOST_TEST_H_
+#define _YUBOX_HOST_TEST_H_
+
+/*
+ * Arnés mínimo de pruebas para el host. Cada YBX_TEST() se registra antes de
+ * main(), y ybx_test_main.cpp las ejecuta en orden de declaración. Una
+ * verificación fallida se reporta con archivo y línea y marca la prueba como
+ * fallida sin abortar las demás.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef void (*ybx_test_fn_t)(void);
+
+void ybx_test_register(const char * name, ybx_test_fn_t fn);
+void ybx_test_fail(const char * file, int line, const char * expr);
+
+struct ybx_test_reg
+{
+  ybx_test_reg(const char * name, ybx_test_fn_t fn) { ybx_test_register(name, fn); }
+};
+
+#define YBX_TEST(name) \
+  static void name(void); \
+  static ybx_test_reg name##_reg(#name, name); \
+  static void name(void)
+
+#define YBX_CHECK(cond) \
+  do { if (!(cond)) ybx_test_fail(__FILE__, __LINE__, #cond); } while (0)
+
+#define YBX_CHECK_EQ(a, b) \
+  do { \
+    long long _a = (long long)(a), _b = (long long)(b); \
+    if (_a != _b) { \
+      char _m[256]; \
+      snprintf(_m, sizeof(_m), "%s == %s (%lld != %lld)", #a, #b, _a, _b); \
+      ybx_test_fail(__FILE__, __LINE__, _m); \
+    } \
+  } while (0)
+
+#define YBX_CHECK_STR(s, sub) \
+  do { \
+    if (strstr((s), (sub)) == NULL) { \
+      char _m[256]; \
+      snprintf(_m, sizeof(_m), "\"%s\" no encontrado en %s", (sub), #s); \
+      ybx_test_fail(__FILE__, __LINE__, _m); \
+    } \
+  } while (0)
+
+#endif
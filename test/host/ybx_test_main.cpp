@@ -0,0 +1,46 @@
+#include <vector>
+
+#include "ybx_test.h"
+
+typedef struct {
+    const char * name;
+    ybx_test_fn_t fn;
+} ybx_test_entry_t;
+
+static std::vector<ybx_test_entry_t> & ybx_tests(void)
+{
+    static std::vector<ybx_test_entry_t> t;
+    return t;
+}
+
+static unsigned int ybx_failures = 0;
+
+void ybx_test_register(const char * name, ybx_test_fn_t fn)
+{
+    ybx_test_entry_t e = { name, fn };
+    ybx_tests().push_back(e);
+}
+
+void ybx_test_fail(const char * file, int line, const char * expr)
+{
+    fprintf(stderr, "%s:%d: FALLA: %s\n", file, line, expr);
+    ybx_failures++;
+}
+
+int main(int argc, char ** argv)
+{
+    unsigned int nfail = 0;
+
+    for (auto & t : ybx_tests()) {
+        // Con argumento, sólo se ejecutan las pruebas que lo contienen
+        if (argc > 1 && strstr(t.name, argv[1]) == NULL) continue;
+
+        unsigned int before = ybx_failures;
+        t.fn();
+        bool ok = (ybx_failures == before);
+        printf("[%s] %s\n", ok ? " OK " : "FAIL", t.name);
+        if (!ok) nfail++;
+    }
+    printf("%u pruebas, %u fallidas\n", (unsigned int)ybx_tests().size(), nfail);
+    return (nfail > 0) ? 1 : 0;
+}